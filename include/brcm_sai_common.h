@@ -28,6 +28,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <arpa/inet.h>
+#include <pthread.h>
+#include <semaphore.h>
 
 /*
 ################################################################################
@@ -50,6 +52,7 @@
 #include <syslog.h>
 #endif
 #include "brcm_sai_custom_attr.h"
+#include "brcm_sai_custom_api.h"
 
 #ifndef STATIC
 #define STATIC
@@ -160,6 +163,28 @@ typedef struct _brcm_sai_buf_profile_s {
     sai_uint32_t xon_thresh;
 } _brcm_sai_buf_profile_t;
 
+typedef struct _brcm_sai_route_info_s {
+    sai_object_id_t nh_id;         /* Next hop or next hop group */
+    sai_packet_action_t action;
+    bool host;                     /* Programmed in the host table */
+} _brcm_sai_route_info_t;
+
+typedef struct _brcm_sai_rib_node_s {
+    struct _brcm_sai_rib_node_s *parent;
+    struct _brcm_sai_rib_node_s *child[2];
+    uint8_t key[16];               /* Network byte order, host bits cleared */
+    uint8_t len;                   /* Prefix length */
+    uint8_t addr_family;           /* sai_ip_addr_family_t */
+    bool valid;                    /* Set when the node carries a route */
+    bool suppressed;               /* Covered by an identical route, not
+                                      programmed (FIB compression) */
+    sai_uint32_t vr_id;
+    _brcm_sai_route_info_t info;
+} _brcm_sai_rib_node_t;
+
+typedef sai_status_t (*_brcm_sai_rib_walk_cb)(_brcm_sai_rib_node_t *node,
+                                              void *data);
+
 /*
 ################################################################################
 #                                  Common macros                               #
@@ -546,6 +571,69 @@ extern sai_status_t _brcm_sai_buffer_pool_get(sai_object_id_t buffer_pool_id,
                                               _brcm_sai_buf_pool_t **buf_pool);
 extern sai_status_t _brcm_sai_egress_shared_limit_set(int pool_idx, int pool_size,
                                                       int bp_size);
+extern sai_status_t _brcm_sai_alloc_rib(int max);
+extern void _brcm_sai_free_rib(void);
+extern void _brcm_sai_rib_hw_count_update(sai_uint32_t vr_id,
+                                          sai_ip_addr_family_t af,
+                                          bool host, int delta);
+extern sai_uint32_t _brcm_sai_rib_hw_count_get(sai_uint32_t vr_id,
+                                               sai_ip_addr_family_t af,
+                                               bool host);
+extern sai_uint32_t _brcm_sai_rib_hw_total_get(sai_ip_addr_family_t af,
+                                               bool host);
+extern _brcm_sai_rib_node_t *_brcm_sai_rib_lookup(sai_uint32_t vr_id,
+                                                  const sai_ip_prefix_t *prefix);
+extern sai_status_t _brcm_sai_rib_add(sai_uint32_t vr_id,
+                                      const sai_ip_prefix_t *prefix,
+                                      const _brcm_sai_route_info_t *info,
+                                      _brcm_sai_rib_node_t **out);
+extern sai_status_t _brcm_sai_rib_delete(sai_uint32_t vr_id,
+                                         const sai_ip_prefix_t *prefix);
+extern _brcm_sai_rib_node_t *_brcm_sai_rib_cover_get(_brcm_sai_rib_node_t *node);
+extern void _brcm_sai_rib_route_get(const _brcm_sai_rib_node_t *node,
+                                    sai_unicast_route_entry_t *route);
+extern sai_status_t _brcm_sai_rib_subtree_walk(_brcm_sai_rib_node_t *node,
+                                               _brcm_sai_rib_walk_cb cb,
+                                               void *data);
+extern sai_status_t _brcm_sai_rib_walk(_brcm_sai_rib_walk_cb cb, void *data);
+extern sai_status_t _brcm_sai_route_coalesce_set(const sai_attribute_t *attr);
+extern void _brcm_sai_free_route(void);
+extern void _brcm_sai_free_nhg(void);
+extern void _brcm_sai_free_nh(void);
+extern void _brcm_sai_nh_mac_update(sai_object_id_t rif_id,
+                                    const sai_ip_address_t *ip,
+                                    const sai_mac_t old_mac,
+                                    const sai_mac_t new_mac);
+extern sai_status_t _brcm_sai_nhg_link_protect_set(bool enable);
+extern bool _brcm_sai_nhg_link_protect_get(void);
+extern void _brcm_sai_nhg_link_event(opennsl_port_t port, bool up);
+extern sai_status_t _brcm_sai_deps_ref(sai_object_id_t oid,
+                                       sai_object_id_t user);
+extern void _brcm_sai_deps_unref(sai_object_id_t oid, sai_object_id_t user);
+extern sai_status_t _brcm_sai_deps_set(sai_object_id_t user,
+                                       sai_uint32_t count,
+                                       const sai_object_id_t *oids);
+extern void _brcm_sai_deps_release(sai_object_id_t user);
+extern sai_uint32_t _brcm_sai_deps_count(sai_object_id_t oid);
+extern void _brcm_sai_free_deps(void);
+extern void _brcm_sai_rib_info_set(_brcm_sai_rib_node_t *node,
+                                   const _brcm_sai_route_info_t *info);
+extern sai_status_t _brcm_sai_route_fib_compress_set(bool enable);
+extern sai_status_t _brcm_sai_route_async_set(const sai_attribute_t *attr);
+extern sai_status_t _brcm_sai_route_resource_set(const sai_attribute_t *attr);
+extern sai_status_t _brcm_sai_route_resource_get(sai_attribute_t *attr);
+extern void _brcm_sai_route_host_evict(sai_uint32_t vr_id,
+                                       const sai_ip_address_t *ip_address);
+extern void _brcm_sai_route_nhi_refresh(sai_object_id_t target_id);
+extern void _brcm_sai_route_egr_refresh(opennsl_if_t base);
+extern bool _brcm_sai_route_nhi_owned(opennsl_if_t ecmp_intf);
+extern sai_status_t _brcm_sai_nbr_scan_set(const sai_attribute_t *attr);
+extern sai_status_t _brcm_sai_nbr_scan_get(sai_attribute_t *attr);
+extern void _brcm_sai_free_nbr(void);
+extern sai_status_t _brcm_sai_fdb_switch_attr_set(const sai_attribute_t *attr);
+extern sai_status_t _brcm_sai_fdb_switch_attr_get(sai_attribute_t *attr);
+extern sai_status_t _brcm_sai_fdb_init(void);
+extern void _brcm_sai_free_fdb(void);
 
 /*
  * This should be last after all the public declarations
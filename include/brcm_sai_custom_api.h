@@ -0,0 +1,377 @@
+/*********************************************************************
+ *
+ * (C) Copyright Broadcom Corporation 2013-2016
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ **********************************************************************/
+
+#if !defined (_BRM_SAI_CUSTOM_API)
+#define _BRM_SAI_CUSTOM_API
+
+/*
+################################################################################
+#                               Custom route APIs                              #
+################################################################################
+*/
+typedef enum _brcm_sai_route_op_t {
+    BRCM_SAI_ROUTE_OP_CREATE,
+    BRCM_SAI_ROUTE_OP_REMOVE,
+    BRCM_SAI_ROUTE_OP_SET
+} brcm_sai_route_op_t;
+
+/*
+* Routine Description:
+*    Completion of a route operation queued while asynchronous route
+*    programming is enabled. Called from the route worker thread in queue
+*    order, it must not block on the route queue.
+*
+* Arguments:
+*    [in] op - operation
+*    [in] unicast_route_entry - route entry
+*    [in] status - result of the operation
+*
+* Return Values:
+*    None
+*/
+typedef void (*brcm_sai_route_async_notification_fn)(
+    _In_ brcm_sai_route_op_t op,
+    _In_ const sai_unicast_route_entry_t *unicast_route_entry,
+    _In_ sai_status_t status);
+
+/*
+* Routine Description:
+*    Create a batch of routes. The switch init and parameter checks are done
+*    once for the whole batch and the SDK is programmed in a single pass.
+*
+* Arguments:
+*    [in] object_count - number of routes
+*    [in] route_entries - array of route entries
+*    [in] attr_count - per route number of attributes
+*    [in] attr_list - per route array of attributes
+*    [out] object_statuses - per route status
+*
+* Return Values:
+*    SAI_STATUS_SUCCESS if all the routes were created
+*    SAI_STATUS_FAILURE if any route failed, see object_statuses
+*    Failure status code on error
+*/
+extern sai_status_t
+brcm_sai_bulk_create_route(_In_ uint32_t object_count,
+                           _In_ const sai_unicast_route_entry_t *route_entries,
+                           _In_ const uint32_t *attr_count,
+                           _In_ const sai_attribute_t **attr_list,
+                           _Out_ sai_status_t *object_statuses);
+
+/*
+* Routine Description:
+*    Remove a batch of routes.
+*
+* Arguments:
+*    [in] object_count - number of routes
+*    [in] route_entries - array of route entries
+*    [out] object_statuses - per route status
+*
+* Return Values:
+*    SAI_STATUS_SUCCESS if all the routes were removed
+*    SAI_STATUS_FAILURE if any route failed, see object_statuses
+*    Failure status code on error
+*/
+extern sai_status_t
+brcm_sai_bulk_remove_route(_In_ uint32_t object_count,
+                           _In_ const sai_unicast_route_entry_t *route_entries,
+                           _Out_ sai_status_t *object_statuses);
+
+/*
+* Routine Description:
+*    Register the completion callback for asynchronous route programming.
+*    Once SAI_SWITCH_ATTR_BRCM_ROUTE_ASYNC_ENABLE is set route create, remove
+*    and set return as soon as the operation is queued.
+*
+* Arguments:
+*    [in] notification - callback, NULL to unregister
+*
+* Return Values:
+*    SAI_STATUS_SUCCESS on success
+*/
+extern sai_status_t
+brcm_sai_route_async_notification_register(_In_
+    brcm_sai_route_async_notification_fn notification);
+
+typedef enum _brcm_sai_route_table_t {
+    BRCM_SAI_ROUTE_TABLE_LPM,
+    BRCM_SAI_ROUTE_TABLE_HOST
+} brcm_sai_route_table_t;
+
+/*
+* Routine Description:
+*    Route table occupancy crossed a watermark. Raised once when the number
+*    of routes in the table reaches the high watermark and once when it then
+*    falls to the low watermark. Called from the thread which changed the
+*    table after it drops the route lock, the route APIs may be used to
+*    shed or aggregate routes.
+*
+* Arguments:
+*    [in] table - route table
+*    [in] high - true for the high watermark, false for the low watermark
+*    [in] count - IPv4 and IPv6 routes in the table
+*/
+typedef void (*brcm_sai_route_resource_notification_fn)(
+    _In_ brcm_sai_route_table_t table,
+    _In_ bool high,
+    _In_ sai_uint32_t count);
+
+/*
+* Routine Description:
+*    Register the route table watermark callback. The watermarks are set
+*    with the SAI_SWITCH_ATTR_BRCM_ROUTE_*_WATERMARK attributes.
+*
+* Arguments:
+*    [in] notification - callback, NULL to unregister
+*
+* Return Values:
+*    SAI_STATUS_SUCCESS on success
+*/
+extern sai_status_t
+brcm_sai_route_resource_notification_register(_In_
+    brcm_sai_route_resource_notification_fn notification);
+
+/*
+################################################################################
+#                          Custom next hop APIs                                #
+################################################################################
+*/
+
+/*
+* Routine Description:
+*    Create an indirect next hop. The indirect next hop is a next hop group
+*    owned by the adapter which forwards like its target, a next hop or a
+*    next hop group. Routes which use it follow a retarget with no further
+*    route updates.
+*
+* Arguments:
+*    [out] indirect_id - indirect next hop id, a next hop group object
+*    [in] target_id - next hop or next hop group to forward to
+*
+* Return Values:
+*    SAI_STATUS_SUCCESS on success
+*    Failure status code on error
+*/
+extern sai_status_t
+brcm_sai_create_indirect_next_hop(_Out_ sai_object_id_t *indirect_id,
+                                  _In_ sai_object_id_t target_id);
+
+/*
+* Routine Description:
+*    Retarget an indirect next hop. The hardware group is replaced in place
+*    so all the routes using it switch over with a single update.
+*
+* Arguments:
+*    [in] indirect_id - indirect next hop id
+*    [in] target_id - new next hop or next hop group to forward to
+*
+* Return Values:
+*    SAI_STATUS_SUCCESS on success
+*    Failure status code on error
+*/
+extern sai_status_t
+brcm_sai_set_indirect_next_hop(_In_ sai_object_id_t indirect_id,
+                               _In_ sai_object_id_t target_id);
+
+/*
+* Routine Description:
+*    Get the current target of an indirect next hop.
+*
+* Arguments:
+*    [in] indirect_id - indirect next hop id
+*    [out] target_id - next hop or next hop group forwarded to
+*
+* Return Values:
+*    SAI_STATUS_SUCCESS on success
+*    Failure status code on error
+*/
+extern sai_status_t
+brcm_sai_get_indirect_next_hop(_In_ sai_object_id_t indirect_id,
+                               _Out_ sai_object_id_t *target_id);
+
+/*
+* Routine Description:
+*    Remove an indirect next hop. Fails while routes still use it.
+*
+* Arguments:
+*    [in] indirect_id - indirect next hop id
+*
+* Return Values:
+*    SAI_STATUS_SUCCESS on success
+*    Failure status code on error
+*/
+extern sai_status_t
+brcm_sai_remove_indirect_next_hop(_In_ sai_object_id_t indirect_id);
+
+/*
+################################################################################
+#                          Custom neighbor APIs                                #
+################################################################################
+*/
+
+/*
+* Routine Description:
+*    Create a batch of neighbor entries. The switch init and parameter
+*    checks are done once for the whole batch.
+*
+* Arguments:
+*    [in] object_count - number of neighbor entries
+*    [in] neighbor_entries - array of neighbor entries
+*    [in] attr_count - per neighbor number of attributes
+*    [in] attr_list - per neighbor array of attributes
+*    [out] object_statuses - per neighbor status
+*
+* Return Values:
+*    SAI_STATUS_SUCCESS if all the neighbor entries were created
+*    SAI_STATUS_FAILURE if any neighbor entry failed, see object_statuses
+*    Failure status code on error
+*/
+extern sai_status_t
+brcm_sai_bulk_create_neighbor_entry(_In_ uint32_t object_count,
+                                    _In_ const sai_neighbor_entry_t *neighbor_entries,
+                                    _In_ const uint32_t *attr_count,
+                                    _In_ const sai_attribute_t **attr_list,
+                                    _Out_ sai_status_t *object_statuses);
+
+/*
+* Routine Description:
+*    Remove a batch of neighbor entries.
+*
+* Arguments:
+*    [in] object_count - number of neighbor entries
+*    [in] neighbor_entries - array of neighbor entries
+*    [out] object_statuses - per neighbor status
+*
+* Return Values:
+*    SAI_STATUS_SUCCESS if all the neighbor entries were removed
+*    SAI_STATUS_FAILURE if any neighbor entry failed, see object_statuses
+*    Failure status code on error
+*/
+extern sai_status_t
+brcm_sai_bulk_remove_neighbor_entry(_In_ uint32_t object_count,
+                                    _In_ const sai_neighbor_entry_t *neighbor_entries,
+                                    _Out_ sai_status_t *object_statuses);
+
+/*
+* Routine Description:
+*    Neighbors found idle by the activity scan. A neighbor is reported once
+*    when it has not been hit for SAI_SWITCH_ATTR_BRCM_NEIGHBOR_IDLE_TIMEOUT
+*    seconds and again only after it has been hit. Neighbors without a
+*    host entry are not scanned. Called from the scan
+*    thread without any adapter lock held, the neighbor APIs may be used to
+*    refresh or remove the entries.
+*
+* Arguments:
+*    [in] count - number of neighbor entries
+*    [in] neighbor_entries - idle neighbor entries
+*
+* Return Values:
+*    None
+*/
+typedef void (*brcm_sai_neighbor_idle_notification_fn)(
+    _In_ uint32_t count,
+    _In_ const sai_neighbor_entry_t *neighbor_entries);
+
+/*
+* Routine Description:
+*    Register the idle neighbor callback. The scan is started with the
+*    SAI_SWITCH_ATTR_BRCM_NEIGHBOR_SCAN_* attributes.
+*
+* Arguments:
+*    [in] notification - callback, NULL to unregister
+*
+* Return Values:
+*    SAI_STATUS_SUCCESS on success
+*/
+extern sai_status_t
+brcm_sai_neighbor_idle_notification_register(_In_
+    brcm_sai_neighbor_idle_notification_fn notification);
+
+/*
+################################################################################
+#                             Custom FDB APIs                                  #
+################################################################################
+*/
+
+/*
+* Routine Description:
+*    MAC addresses damped for moving between ports too often, see the
+*    SAI_SWITCH_ATTR_BRCM_FDB_MOVE_* attributes. The learn and age
+*    notifications of a damped MAC are suppressed, it is reported here once
+*    when damping starts. MACs damped within a window are reported together.
+*    A released MAC is reported with a learn or age FDB event, in order with
+*    the other FDB events. Called from the damping thread without any
+*    adapter lock held.
+*
+* Arguments:
+*    [in] count - number of FDB entries
+*    [in] fdb_entries - damped FDB entries
+*
+* Return Values:
+*    None
+*/
+typedef void (*brcm_sai_fdb_move_storm_notification_fn)(
+    _In_ uint32_t count,
+    _In_ const sai_fdb_entry_t *fdb_entries);
+
+/*
+* Routine Description:
+*    Register the MAC move storm callback. Damping is started with
+*    SAI_SWITCH_ATTR_BRCM_FDB_MOVE_THRESHOLD.
+*
+* Arguments:
+*    [in] notification - callback, NULL to unregister
+*
+* Return Values:
+*    SAI_STATUS_SUCCESS on success
+*/
+extern sai_status_t
+brcm_sai_fdb_move_storm_notification_register(_In_
+    brcm_sai_fdb_move_storm_notification_fn notification);
+
+/*
+################################################################################
+#                           Custom object APIs                                 #
+################################################################################
+*/
+
+/*
+* Routine Description:
+*    Get what uses an object. Router interfaces are used by neighbors, next
+*    hops and routes, next hops by next hop groups and routes, next hop
+*    groups by indirect next hops and routes. Removing an object in use
+*    fails with SAI_STATUS_OBJECT_IN_USE. Routes and neighbors count in the
+*    references but are not listed.
+*
+* Arguments:
+*    [in] object_id - object id
+*    [out] ref_count - number of references to the object
+*    [inout] users - objects using the object
+*
+* Return Values:
+*    SAI_STATUS_SUCCESS on success
+*    SAI_STATUS_BUFFER_OVERFLOW if users is too short, users->count is set
+*    to the number needed
+*    Failure status code on error
+*/
+extern sai_status_t
+brcm_sai_get_object_users(_In_ sai_object_id_t object_id,
+                          _Out_ sai_uint32_t *ref_count,
+                          _Inout_ sai_object_list_t *users);
+
+#endif /* _BRM_SAI_CUSTOM_API */
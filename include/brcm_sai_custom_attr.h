@@ -26,6 +26,102 @@
 */
 #define SAI_SWITCH_ATTR_BRCM_CUSTOM_SWITCH_START     ((sai_attr_id_t)0x10000000)
 #define SAI_SWITCH_ATTR_BRCM_SWITCH_SHELL_ENABLE     ((sai_attr_id_t)0x10000001)
+/* Route write coalescing: bool, u32 msec (0 = no timer), u32 routes
+   (0 = no batch limit) and a write-only trigger to flush immediately */
+#define SAI_SWITCH_ATTR_BRCM_ROUTE_COALESCE_ENABLE   ((sai_attr_id_t)0x10000002)
+#define SAI_SWITCH_ATTR_BRCM_ROUTE_COALESCE_INTERVAL ((sai_attr_id_t)0x10000003)
+#define SAI_SWITCH_ATTR_BRCM_ROUTE_COALESCE_BATCH    ((sai_attr_id_t)0x10000004)
+#define SAI_SWITCH_ATTR_BRCM_ROUTE_COALESCE_FLUSH    ((sai_attr_id_t)0x10000005)
+/* FIB compression of routes covered by an identical route: bool */
+#define SAI_SWITCH_ATTR_BRCM_ROUTE_FIB_COMPRESS      ((sai_attr_id_t)0x10000006)
+/* Asynchronous route programming: bool, u32 queue depth (set while disabled)
+   and a write-only trigger that waits for the queue to drain */
+#define SAI_SWITCH_ATTR_BRCM_ROUTE_ASYNC_ENABLE      ((sai_attr_id_t)0x10000007)
+#define SAI_SWITCH_ATTR_BRCM_ROUTE_ASYNC_DEPTH       ((sai_attr_id_t)0x10000008)
+#define SAI_SWITCH_ATTR_BRCM_ROUTE_ASYNC_DRAIN       ((sai_attr_id_t)0x10000009)
+/* Programmed routes across all the vrfs by family and table: read-only u32 */
+#define SAI_SWITCH_ATTR_BRCM_ROUTE_IPV4_LPM_ENTRIES  ((sai_attr_id_t)0x1000000A)
+#define SAI_SWITCH_ATTR_BRCM_ROUTE_IPV4_HOST_ENTRIES ((sai_attr_id_t)0x1000000B)
+#define SAI_SWITCH_ATTR_BRCM_ROUTE_IPV6_LPM_ENTRIES  ((sai_attr_id_t)0x1000000C)
+#define SAI_SWITCH_ATTR_BRCM_ROUTE_IPV6_HOST_ENTRIES ((sai_attr_id_t)0x1000000D)
+/* Route table occupancy watermarks, IPv4 and IPv6 routes together: u32
+   (high 0 = disabled, low must be below high) */
+#define SAI_SWITCH_ATTR_BRCM_ROUTE_LPM_HIGH_WATERMARK  ((sai_attr_id_t)0x1000000E)
+#define SAI_SWITCH_ATTR_BRCM_ROUTE_LPM_LOW_WATERMARK   ((sai_attr_id_t)0x1000000F)
+#define SAI_SWITCH_ATTR_BRCM_ROUTE_HOST_HIGH_WATERMARK ((sai_attr_id_t)0x10000010)
+#define SAI_SWITCH_ATTR_BRCM_ROUTE_HOST_LOW_WATERMARK  ((sai_attr_id_t)0x10000011)
+/* Next hop group members going out of a port that goes down are pruned from
+   the hardware groups until the link comes back up: bool */
+#define SAI_SWITCH_ATTR_BRCM_ECMP_LINK_PROTECT       ((sai_attr_id_t)0x10000012)
+/* Neighbor activity scan: u32 msec between batches (0 = stopped), u32
+   neighbors per batch and u32 seconds without traffic after which a
+   neighbor is reported idle (0 = no notification) */
+#define SAI_SWITCH_ATTR_BRCM_NEIGHBOR_SCAN_INTERVAL  ((sai_attr_id_t)0x10000013)
+#define SAI_SWITCH_ATTR_BRCM_NEIGHBOR_SCAN_BATCH     ((sai_attr_id_t)0x10000014)
+#define SAI_SWITCH_ATTR_BRCM_NEIGHBOR_IDLE_TIMEOUT   ((sai_attr_id_t)0x10000015)
+/* Batched FDB event delivery: u32 events per notification (0 = one event per
+   notification, from the SDK thread unless move damping is on, at most
+   1024), u32 msec to wait for a batch to fill, u32 queue depth (set while
+   batching and damping are off) and read-only u64 events dropped because
+   the queue was full */
+#define SAI_SWITCH_ATTR_BRCM_FDB_EVENT_BATCH         ((sai_attr_id_t)0x10000016)
+#define SAI_SWITCH_ATTR_BRCM_FDB_EVENT_DELAY         ((sai_attr_id_t)0x10000017)
+#define SAI_SWITCH_ATTR_BRCM_FDB_EVENT_DEPTH         ((sai_attr_id_t)0x10000018)
+#define SAI_SWITCH_ATTR_BRCM_FDB_EVENT_DROPS         ((sai_attr_id_t)0x10000019)
+/* FDB attribute gets are served from an adapter copy of the table: bool to
+   read the hardware on every get and log where the copy disagrees */
+#define SAI_SWITCH_ATTR_BRCM_FDB_VERIFY              ((sai_attr_id_t)0x1000001A)
+/* MAC move damping: u32 moves per window (0 = off), u32 window msec, u32
+   msec without moves before a MAC is released, bool to pin damped MACs
+   static and read-only u32 MACs damped now */
+#define SAI_SWITCH_ATTR_BRCM_FDB_MOVE_THRESHOLD      ((sai_attr_id_t)0x1000001B)
+#define SAI_SWITCH_ATTR_BRCM_FDB_MOVE_WINDOW         ((sai_attr_id_t)0x1000001C)
+#define SAI_SWITCH_ATTR_BRCM_FDB_MOVE_HOLD           ((sai_attr_id_t)0x1000001D)
+#define SAI_SWITCH_ATTR_BRCM_FDB_MOVE_PIN            ((sai_attr_id_t)0x1000001E)
+#define SAI_SWITCH_ATTR_BRCM_FDB_MOVE_DAMPED         ((sai_attr_id_t)0x1000001F)
 #define SAI_SWITCH_ATTR_BRCM_CUSTOM_SWITCH_END       ((sai_attr_id_t)0x1000ffff)
 
+/*
+################################################################################
+#                       Custom virtual router attributes                       #
+################################################################################
+*/
+#define SAI_VIRTUAL_ROUTER_ATTR_BRCM_CUSTOM_START      ((sai_attr_id_t)0x10000000)
+/* Programmed routes of the vrf by family and table: read-only u32 */
+#define SAI_VIRTUAL_ROUTER_ATTR_BRCM_IPV4_LPM_ENTRIES  ((sai_attr_id_t)0x10000001)
+#define SAI_VIRTUAL_ROUTER_ATTR_BRCM_IPV4_HOST_ENTRIES ((sai_attr_id_t)0x10000002)
+#define SAI_VIRTUAL_ROUTER_ATTR_BRCM_IPV6_LPM_ENTRIES  ((sai_attr_id_t)0x10000003)
+#define SAI_VIRTUAL_ROUTER_ATTR_BRCM_IPV6_HOST_ENTRIES ((sai_attr_id_t)0x10000004)
+#define SAI_VIRTUAL_ROUTER_ATTR_BRCM_CUSTOM_END        ((sai_attr_id_t)0x1000ffff)
+
+/*
+################################################################################
+#                       Custom next hop group attributes                       #
+################################################################################
+*/
+#define SAI_NEXT_HOP_GROUP_ATTR_BRCM_CUSTOM_START      ((sai_attr_id_t)0x10000000)
+/* Share the hardware group with other groups created with this set and the
+   same next hops, create only: bool. A shared group can't be changed while
+   it has more than one user */
+#define SAI_NEXT_HOP_GROUP_ATTR_BRCM_SHARED            ((sai_attr_id_t)0x10000001)
+/* Resilient hashing over a fixed table of buckets, create only: u32 bucket
+   count (0 = plain ECMP, else at least the number of next hops and at most
+   SAI_SWITCH_ATTR_ECMP_MAX_PATHS) */
+#define SAI_NEXT_HOP_GROUP_ATTR_BRCM_RESILIENT_BUCKETS ((sai_attr_id_t)0x10000002)
+/* Weighted ECMP: u32list of weights (>= 1) in next hop list order, set at
+   create or replaced with set. Next hops added later get a weight of 1 */
+#define SAI_NEXT_HOP_GROUP_ATTR_BRCM_NEXT_HOP_WEIGHTS  ((sai_attr_id_t)0x10000003)
+#define SAI_NEXT_HOP_GROUP_ATTR_BRCM_CUSTOM_END        ((sai_attr_id_t)0x1000ffff)
+
+/*
+################################################################################
+#                          Custom neighbor attributes                          #
+################################################################################
+*/
+#define SAI_NEIGHBOR_ATTR_BRCM_CUSTOM_START            ((sai_attr_id_t)0x10000000)
+/* Seconds since the neighbor was last seen hit by the activity scan, or
+   since it was created: read-only u32 */
+#define SAI_NEIGHBOR_ATTR_BRCM_IDLE_TIME               ((sai_attr_id_t)0x10000001)
+#define SAI_NEIGHBOR_ATTR_BRCM_CUSTOM_END              ((sai_attr_id_t)0x1000ffff)
+
 #endif /* _BRM_SAI_CUSTOM_ATTR */
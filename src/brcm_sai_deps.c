@@ -0,0 +1,479 @@
+/*********************************************************************
+ *
+ * (C) Copyright Broadcom Corporation 2013-2016
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ **********************************************************************/
+
+#include <sai.h>
+#include <brcm_sai_common.h>
+
+/*
+################################################################################
+#                                Local state                                   #
+################################################################################
+*/
+#define _BRCM_SAI_DEPS_BUCKETS      4096
+
+/*
+ * Object dependency graph. An object which is used by others has a node
+ * with the number of references to it and the list of objects using it.
+ * Objects which use others also have a node, with the list of what they use,
+ * so letting go of an object drops all its references in one go. Users
+ * which aren't objects themselves, routes and neighbors, only count in the
+ * references. Nodes exist only while they have references or uses.
+ */
+struct _brcm_sai_deps_node_s;
+
+typedef struct _brcm_sai_deps_edge_s {
+    struct _brcm_sai_deps_edge_s *use_next;     /* In the user's uses */
+    struct _brcm_sai_deps_edge_s *prev;         /* In the object's users */
+    struct _brcm_sai_deps_edge_s *next;
+    struct _brcm_sai_deps_node_s *user;
+    struct _brcm_sai_deps_node_s *obj;
+    sai_uint32_t count;
+} _brcm_sai_deps_edge_t;
+
+typedef struct _brcm_sai_deps_node_s {
+    struct _brcm_sai_deps_node_s *next;         /* By object id */
+    sai_object_id_t oid;
+    sai_uint32_t ref_count;                     /* All the references */
+    sai_uint32_t user_count;                    /* Objects in users */
+    _brcm_sai_deps_edge_t *uses;
+    _brcm_sai_deps_edge_t *users;
+} _brcm_sai_deps_node_t;
+
+static pthread_mutex_t _brcm_sai_deps_mutex = PTHREAD_MUTEX_INITIALIZER;
+static _brcm_sai_deps_node_t *_brcm_sai_deps[_BRCM_SAI_DEPS_BUCKETS];
+
+#define _BRCM_SAI_DEPS_LOCK()    pthread_mutex_lock(&_brcm_sai_deps_mutex)
+#define _BRCM_SAI_DEPS_UNLOCK()  pthread_mutex_unlock(&_brcm_sai_deps_mutex)
+
+/*
+################################################################################
+#                             Forward declarations                             #
+################################################################################
+*/
+STATIC _brcm_sai_deps_node_t **
+_brcm_sai_deps_find(sai_object_id_t oid);
+STATIC _brcm_sai_deps_node_t *
+_brcm_sai_deps_node_get(sai_object_id_t oid);
+STATIC void
+_brcm_sai_deps_node_put(_brcm_sai_deps_node_t *node);
+STATIC sai_status_t
+_brcm_sai_deps_edge_add(_brcm_sai_deps_node_t *user,
+                        _brcm_sai_deps_node_t *obj);
+STATIC void
+_brcm_sai_deps_uses_drop(_brcm_sai_deps_node_t *user);
+
+/*
+################################################################################
+#                              Dependency functions                            #
+################################################################################
+*/
+/*
+ * Routine to add a reference to an object. The user is the object taking
+ * the reference, or SAI_NULL_OBJECT_ID for a route or a neighbor.
+ */
+sai_status_t
+_brcm_sai_deps_ref(sai_object_id_t oid, sai_object_id_t user)
+{
+    sai_status_t rv = SAI_STATUS_SUCCESS;
+    _brcm_sai_deps_node_t *obj, *unode;
+
+    if (SAI_NULL_OBJECT_ID == oid)
+    {
+        return SAI_STATUS_SUCCESS;
+    }
+    _BRCM_SAI_DEPS_LOCK();
+    obj = _brcm_sai_deps_node_get(oid);
+    if (NULL == obj)
+    {
+        rv = SAI_STATUS_NO_MEMORY;
+    }
+    else if (SAI_NULL_OBJECT_ID == user)
+    {
+        obj->ref_count++;
+    }
+    else
+    {
+        unode = _brcm_sai_deps_node_get(user);
+        rv = (NULL == unode) ? SAI_STATUS_NO_MEMORY :
+             _brcm_sai_deps_edge_add(unode, obj);
+        if (NULL != unode)
+        {
+            _brcm_sai_deps_node_put(unode);
+        }
+    }
+    if (NULL != obj)
+    {
+        _brcm_sai_deps_node_put(obj);
+    }
+    _BRCM_SAI_DEPS_UNLOCK();
+    return rv;
+}
+
+/* Routine to drop a reference taken with _brcm_sai_deps_ref */
+void
+_brcm_sai_deps_unref(sai_object_id_t oid, sai_object_id_t user)
+{
+    _brcm_sai_deps_node_t *obj;
+    _brcm_sai_deps_edge_t *edge, **link;
+
+    if (SAI_NULL_OBJECT_ID == oid)
+    {
+        return;
+    }
+    _BRCM_SAI_DEPS_LOCK();
+    obj = *_brcm_sai_deps_find(oid);
+    if ((NULL != obj) && (SAI_NULL_OBJECT_ID == user))
+    {
+        if (obj->ref_count)
+        {
+            obj->ref_count--;
+        }
+        _brcm_sai_deps_node_put(obj);
+    }
+    else if (NULL != obj)
+    {
+        for (edge = obj->users; NULL != edge; edge = edge->next)
+        {
+            if (user == edge->user->oid)
+            {
+                break;
+            }
+        }
+        if (NULL != edge)
+        {
+            obj->ref_count--;
+            if (0 == --edge->count)
+            {
+                for (link = &edge->user->uses; edge != *link;
+                     link = &(*link)->use_next);
+                *link = edge->use_next;
+                if (NULL != edge->prev)
+                {
+                    edge->prev->next = edge->next;
+                }
+                else
+                {
+                    obj->users = edge->next;
+                }
+                if (NULL != edge->next)
+                {
+                    edge->next->prev = edge->prev;
+                }
+                obj->user_count--;
+                _brcm_sai_deps_node_put(edge->user);
+                free(edge);
+            }
+            _brcm_sai_deps_node_put(obj);
+        }
+    }
+    _BRCM_SAI_DEPS_UNLOCK();
+}
+
+/*
+ * Routine to replace everything an object uses with a new list, e.g. the
+ * members of a next hop group. Nothing changes when it fails.
+ */
+sai_status_t
+_brcm_sai_deps_set(sai_object_id_t user, sai_uint32_t count,
+                   const sai_object_id_t *oids)
+{
+    int i;
+    sai_status_t rv = SAI_STATUS_SUCCESS;
+    _brcm_sai_deps_node_t *unode, *obj;
+    _brcm_sai_deps_edge_t *old, *new_uses;
+
+    _BRCM_SAI_DEPS_LOCK();
+    unode = _brcm_sai_deps_node_get(user);
+    if (NULL == unode)
+    {
+        _BRCM_SAI_DEPS_UNLOCK();
+        return SAI_STATUS_NO_MEMORY;
+    }
+    /* Build the new uses first so the old ones can be put back */
+    old = unode->uses;
+    unode->uses = NULL;
+    for (i=0; (i<count) && (SAI_STATUS_SUCCESS == rv); i++)
+    {
+        if (SAI_NULL_OBJECT_ID == oids[i])
+        {
+            continue;
+        }
+        obj = _brcm_sai_deps_node_get(oids[i]);
+        rv = (NULL == obj) ? SAI_STATUS_NO_MEMORY :
+             _brcm_sai_deps_edge_add(unode, obj);
+        if (NULL != obj)
+        {
+            _brcm_sai_deps_node_put(obj);
+        }
+    }
+    if (SAI_STATUS_SUCCESS == rv)
+    {
+        new_uses = unode->uses;
+        unode->uses = old;
+        _brcm_sai_deps_uses_drop(unode);
+        unode->uses = new_uses;
+    }
+    else
+    {
+        _brcm_sai_deps_uses_drop(unode);
+        unode->uses = old;
+    }
+    _brcm_sai_deps_node_put(unode);
+    _BRCM_SAI_DEPS_UNLOCK();
+    return rv;
+}
+
+/* Routine to drop everything an object uses, when it is removed */
+void
+_brcm_sai_deps_release(sai_object_id_t user)
+{
+    _brcm_sai_deps_node_t *unode;
+
+    _BRCM_SAI_DEPS_LOCK();
+    unode = *_brcm_sai_deps_find(user);
+    if (NULL != unode)
+    {
+        _brcm_sai_deps_uses_drop(unode);
+        _brcm_sai_deps_node_put(unode);
+    }
+    _BRCM_SAI_DEPS_UNLOCK();
+}
+
+/* Routine to get the number of references to an object */
+sai_uint32_t
+_brcm_sai_deps_count(sai_object_id_t oid)
+{
+    sai_uint32_t count = 0;
+    _brcm_sai_deps_node_t *obj;
+
+    _BRCM_SAI_DEPS_LOCK();
+    obj = *_brcm_sai_deps_find(oid);
+    if (NULL != obj)
+    {
+        count = obj->ref_count;
+    }
+    _BRCM_SAI_DEPS_UNLOCK();
+    return count;
+}
+
+/*
+* Routine Description:
+*    Get what uses an object. Routes and neighbors count in the references
+*    but are not listed.
+*
+* Arguments:
+*    [in] object_id - object id
+*    [out] ref_count - number of references to the object
+*    [inout] users - objects using the object
+*
+* Return Values:
+*    SAI_STATUS_SUCCESS on success
+*    SAI_STATUS_BUFFER_OVERFLOW if users is too short, users->count is set
+*    to the number needed
+*    Failure status code on error
+*/
+sai_status_t
+brcm_sai_get_object_users(_In_ sai_object_id_t object_id,
+                          _Out_ sai_uint32_t *ref_count,
+                          _Inout_ sai_object_list_t *users)
+{
+    int i = 0;
+    sai_status_t rv = SAI_STATUS_SUCCESS;
+    _brcm_sai_deps_node_t *obj;
+    _brcm_sai_deps_edge_t *edge;
+
+    BRCM_SAI_SWITCH_INIT_CHECK;
+    if ((NULL == ref_count) || (NULL == users) ||
+        ((0 != users->count) && (NULL == users->list)))
+    {
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+    _BRCM_SAI_DEPS_LOCK();
+    obj = *_brcm_sai_deps_find(object_id);
+    if ((NULL != obj) && (obj->user_count > users->count))
+    {
+        rv = SAI_STATUS_BUFFER_OVERFLOW;
+    }
+    else if (NULL != obj)
+    {
+        for (edge = obj->users; NULL != edge; edge = edge->next)
+        {
+            users->list[i++] = edge->user->oid;
+        }
+    }
+    *ref_count = (NULL != obj) ? obj->ref_count : 0;
+    users->count = (NULL != obj) ? obj->user_count : 0;
+    _BRCM_SAI_DEPS_UNLOCK();
+    return rv;
+}
+
+/*
+################################################################################
+#                                Internal functions                            #
+################################################################################
+*/
+/* Routine to find the link pointing at the node of an object */
+STATIC _brcm_sai_deps_node_t **
+_brcm_sai_deps_find(sai_object_id_t oid)
+{
+    _brcm_sai_deps_node_t **link;
+
+    link = &_brcm_sai_deps[(sai_uint32_t)(oid ^ (oid >> 32)) %
+                           _BRCM_SAI_DEPS_BUCKETS];
+    while ((NULL != *link) && (oid != (*link)->oid))
+    {
+        link = &(*link)->next;
+    }
+    return link;
+}
+
+/* Routine to find or create the node of an object */
+STATIC _brcm_sai_deps_node_t *
+_brcm_sai_deps_node_get(sai_object_id_t oid)
+{
+    _brcm_sai_deps_node_t **link, *node;
+
+    link = _brcm_sai_deps_find(oid);
+    if (NULL != *link)
+    {
+        return *link;
+    }
+    node = (_brcm_sai_deps_node_t*)calloc(1, sizeof(_brcm_sai_deps_node_t));
+    if (NULL == node)
+    {
+        return NULL;
+    }
+    node->oid = oid;
+    *link = node;
+    return node;
+}
+
+/* Routine to free the node of an object once nothing refers to it */
+STATIC void
+_brcm_sai_deps_node_put(_brcm_sai_deps_node_t *node)
+{
+    _brcm_sai_deps_node_t **link;
+
+    if ((0 != node->ref_count) || (NULL != node->uses))
+    {
+        return;
+    }
+    link = _brcm_sai_deps_find(node->oid);
+    *link = node->next;
+    free(node);
+}
+
+/* Routine to add a use of obj to user, both nodes stay allocated */
+STATIC sai_status_t
+_brcm_sai_deps_edge_add(_brcm_sai_deps_node_t *user,
+                        _brcm_sai_deps_node_t *obj)
+{
+    _brcm_sai_deps_edge_t *edge;
+
+    for (edge = user->uses; NULL != edge; edge = edge->use_next)
+    {
+        if (obj == edge->obj)
+        {
+            break;
+        }
+    }
+    if (NULL == edge)
+    {
+        edge = (_brcm_sai_deps_edge_t*)calloc(1,
+                   sizeof(_brcm_sai_deps_edge_t));
+        if (NULL == edge)
+        {
+            return SAI_STATUS_NO_MEMORY;
+        }
+        edge->user = user;
+        edge->obj = obj;
+        edge->use_next = user->uses;
+        user->uses = edge;
+        edge->next = obj->users;
+        if (NULL != obj->users)
+        {
+            obj->users->prev = edge;
+        }
+        obj->users = edge;
+        obj->user_count++;
+    }
+    edge->count++;
+    obj->ref_count++;
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Routine to drop all the uses of an object, the user node is kept */
+STATIC void
+_brcm_sai_deps_uses_drop(_brcm_sai_deps_node_t *user)
+{
+    _brcm_sai_deps_node_t *obj;
+    _brcm_sai_deps_edge_t *edge;
+
+    while (NULL != user->uses)
+    {
+        edge = user->uses;
+        user->uses = edge->use_next;
+        obj = edge->obj;
+        if (NULL != edge->prev)
+        {
+            edge->prev->next = edge->next;
+        }
+        else
+        {
+            obj->users = edge->next;
+        }
+        if (NULL != edge->next)
+        {
+            edge->next->prev = edge->prev;
+        }
+        obj->ref_count -= edge->count;
+        obj->user_count--;
+        free(edge);
+        if (obj != user)
+        {
+            _brcm_sai_deps_node_put(obj);
+        }
+    }
+}
+
+/* Routine to free the dependency graph */
+void
+_brcm_sai_free_deps(void)
+{
+    int i;
+    _brcm_sai_deps_node_t *node, *next;
+    _brcm_sai_deps_edge_t *edge;
+
+    _BRCM_SAI_DEPS_LOCK();
+    for (i=0; i<_BRCM_SAI_DEPS_BUCKETS; i++)
+    {
+        for (node = _brcm_sai_deps[i]; NULL != node; node = next)
+        {
+            next = node->next;
+            while (NULL != node->uses)
+            {
+                edge = node->uses;
+                node->uses = edge->use_next;
+                free(edge);
+            }
+            free(node);
+        }
+        _brcm_sai_deps[i] = NULL;
+    }
+    _BRCM_SAI_DEPS_UNLOCK();
+}
@@ -17,9 +17,210 @@
  **********************************************************************/
 
 #include <string.h>
+#include <time.h>
+#include <sched.h>
 #include <sai.h>
 #include <brcm_sai_common.h>
 
+/*
+################################################################################
+#                                Local state                                   #
+################################################################################
+*/
+#define _BRCM_SAI_FDB_EVENT_BATCH_MAX   1024
+#define _BRCM_SAI_FDB_EVENT_DELAY       10
+#define _BRCM_SAI_FDB_EVENT_DEPTH       16384
+#define _BRCM_SAI_FDB_SHADOW_MIN        1024
+#define _BRCM_SAI_FDB_MOVE_SLOTS        16384
+#define _BRCM_SAI_FDB_MOVE_PROBES       8
+#define _BRCM_SAI_FDB_MOVE_WINDOW       1000
+#define _BRCM_SAI_FDB_MOVE_HOLD         10000
+
+/* Shadow slot states */
+#define _BRCM_SAI_FDB_SLOT_EMPTY        0
+#define _BRCM_SAI_FDB_SLOT_USED         1
+#define _BRCM_SAI_FDB_SLOT_DELETED      2
+
+/* Shadow entry flags */
+#define _BRCM_SAI_FDB_STATIC            0x1
+#define _BRCM_SAI_FDB_L3LOOKUP          0x2
+#define _BRCM_SAI_FDB_DISCARD           0x4
+#define _BRCM_SAI_FDB_COPY_TO_CPU       0x8
+
+typedef struct _brcm_sai_fdb_event_s {
+    sai_fdb_event_t type;
+    sai_mac_t mac;
+    sai_vlan_id_t vid;
+    int port;
+} _brcm_sai_fdb_event_t;
+
+/*
+ * FDB events queued by the SDK L2 callback thread for the dispatcher. The
+ * ring has a single producer and a single consumer, head is only written by
+ * the callback and tail only by the dispatcher. The callback posts the
+ * semaphore when the ring stops being empty or a batch fills up. MACs
+ * released from move damping are queued separately under the mutex, the
+ * dispatcher reports where they are when it delivers them.
+ */
+typedef struct _brcm_sai_fdb_events_s {
+    bool enabled;
+    bool thread_run;
+    pthread_t thread;
+    sem_t sem;
+    sai_uint32_t batch;                         /* 0 when not batching */
+    sai_uint32_t delay;                         /* msec */
+    sai_uint32_t depth;
+    sai_uint32_t mask;
+    sai_uint32_t head;                          /* Next slot to fill */
+    sai_uint32_t tail;                          /* Next slot to deliver */
+    sai_uint32_t busy;                          /* Callbacks in the ring */
+    uint64_t drops;
+    uint64_t drops_logged;
+    _brcm_sai_fdb_event_t *ring;
+    sai_fdb_event_notification_data_t *notify;
+    sai_attribute_t *attrs;
+    pthread_mutex_t mutex;
+    sai_uint32_t released;                      /* Released MACs queued */
+    sai_uint32_t released_size;
+    _brcm_sai_fdb_event_t *release;
+} _brcm_sai_fdb_events_t;
+
+static _brcm_sai_fdb_events_t _brcm_sai_fdb_events = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .delay = _BRCM_SAI_FDB_EVENT_DELAY,
+    .depth = _BRCM_SAI_FDB_EVENT_DEPTH,
+};
+
+/* Shadow entry, kept to 16 bytes so that a probe stays in a cache line */
+typedef struct _brcm_sai_fdb_entry_s {
+    uint64_t key;                               /* VLAN << 48 | MAC */
+    int port;
+    uint8_t flags;
+    uint8_t state;
+} _brcm_sai_fdb_entry_t;
+
+/*
+ * Adapter copy of the FDB, keyed by (MAC, VLAN) in an open addressed table
+ * with linear probing. It follows the FDB APIs and the SDK learn and age
+ * callbacks so that attribute reads don't need the SDK.
+ */
+typedef struct _brcm_sai_fdb_shadow_s {
+    _brcm_sai_fdb_entry_t *slots;
+    sai_uint32_t size;                          /* Power of 2 */
+    sai_uint32_t count;                         /* Used slots */
+    sai_uint32_t deleted;                       /* Deleted slots */
+    bool verify;                                /* Read hardware on gets */
+} _brcm_sai_fdb_shadow_t;
+
+static _brcm_sai_fdb_shadow_t _brcm_sai_fdb_shadow;
+static pthread_mutex_t _brcm_sai_fdb_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+#define _BRCM_SAI_FDB_LOCK()   pthread_mutex_lock(&_brcm_sai_fdb_mutex)
+#define _BRCM_SAI_FDB_UNLOCK() pthread_mutex_unlock(&_brcm_sai_fdb_mutex)
+
+/* MAC move tracker */
+typedef struct _brcm_sai_fdb_move_s {
+    uint64_t key;
+    uint64_t start;                             /* Window start, msec */
+    uint64_t until;                             /* Damped until, msec */
+    int port;                                   /* Last learned on */
+    uint16_t prev;                              /* Moves in the last window */
+    uint16_t cur;                               /* Moves in this window */
+    bool used;
+    bool damped;
+    bool reported;
+    bool pinned;
+} _brcm_sai_fdb_move_t;
+
+/*
+ * MAC move damping. Moves are counted per (MAC, VLAN) in a fixed size cache
+ * of trackers, a tracker with no moves for two windows is reused. The move
+ * rate is the sliding window estimate of the moves in the last window.
+ * A MAC reaching the threshold has its notifications suppressed until it
+ * has not moved for the hold time and is optionally pinned static on its
+ * port. The damping thread pins and releases MACs and reports the newly
+ * damped ones in at most one storm notification per window. Damping has
+ * its own lock, the SDK thread only takes it while damping is on.
+ */
+typedef struct _brcm_sai_fdb_damp_s {
+    pthread_mutex_t mutex;
+    bool thread_run;
+    pthread_t thread;
+    pthread_cond_t cond;
+    sai_uint32_t threshold;                     /* 0 when not damping */
+    sai_uint32_t window;                        /* msec */
+    sai_uint32_t hold;                          /* msec */
+    bool pin;
+    bool kick;                                  /* Run before the next tick */
+    sai_uint32_t damped;                        /* MACs damped now */
+    uint64_t reported;                          /* Last storm, msec */
+    _brcm_sai_fdb_move_t *slots;
+    brcm_sai_fdb_move_storm_notification_fn notify;
+} _brcm_sai_fdb_damp_t;
+
+static _brcm_sai_fdb_damp_t _brcm_sai_fdb_damp = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+    .window = _BRCM_SAI_FDB_MOVE_WINDOW,
+    .hold = _BRCM_SAI_FDB_MOVE_HOLD,
+};
+
+#define _BRCM_SAI_FDB_DAMP_LOCK() pthread_mutex_lock(&_brcm_sai_fdb_damp.mutex)
+#define _BRCM_SAI_FDB_DAMP_UNLOCK()                                           \
+    pthread_mutex_unlock(&_brcm_sai_fdb_damp.mutex)
+
+#define _BRCM_SAI_FDB_DAMPING()                                               \
+    (0 != __atomic_load_n(&_brcm_sai_fdb_damp.threshold, __ATOMIC_ACQUIRE))
+
+/* Static entries matching a flush, -1 port or vid matches any */
+typedef struct _brcm_sai_fdb_flush_s {
+    int port;
+    int vid;
+    int count;
+    int size;
+    opennsl_l2_addr_t *entries;
+} _brcm_sai_fdb_flush_t;
+
+/*
+################################################################################
+#                             Forward declarations                             #
+################################################################################
+*/
+STATIC void
+_brcm_sai_fdb_event_fill(const _brcm_sai_fdb_event_t *event,
+                         sai_fdb_event_notification_data_t *notify,
+                         sai_attribute_t *attr);
+STATIC bool
+_brcm_sai_fdb_event_post(const _brcm_sai_fdb_event_t *event);
+STATIC int
+_brcm_sai_fdb_flush_static(int port, int vid);
+STATIC uint8_t
+_brcm_sai_fdb_flags_get(const opennsl_l2_addr_t *l2addr);
+STATIC sai_status_t
+_brcm_sai_fdb_action_set(sai_packet_action_t action, opennsl_l2_addr_t *l2addr);
+STATIC sai_packet_action_t
+_brcm_sai_fdb_action_get(uint8_t flags);
+STATIC void
+_brcm_sai_fdb_l2addr_get(const uint8_t *mac, int vid,
+                         const _brcm_sai_fdb_entry_t *entry,
+                         opennsl_l2_addr_t *l2addr);
+STATIC void
+_brcm_sai_fdb_shadow_update(const opennsl_l2_addr_t *l2addr, bool grow);
+STATIC void
+_brcm_sai_fdb_shadow_remove(const uint8_t *mac, int vid);
+STATIC bool
+_brcm_sai_fdb_shadow_get(const uint8_t *mac, int vid,
+                         _brcm_sai_fdb_entry_t *entry);
+STATIC void
+_brcm_sai_fdb_shadow_flush(int port, int vid, bool statics, bool dynamics);
+STATIC bool
+_brcm_sai_fdb_move_check(const opennsl_l2_addr_t *l2addr, int operation);
+STATIC void
+_brcm_sai_fdb_move_forget(const uint8_t *mac, int vid);
+STATIC void
+_brcm_sai_fdb_event_release(const _brcm_sai_fdb_event_t *released,
+                            int count);
+
 /*
 ################################################################################
 #                               Event handlers                                 #
@@ -29,35 +230,43 @@ void
 _brcm_sai_fdb_event_cb(int unit, opennsl_l2_addr_t *l2addr, int operation,
                        void *userdata)
 {
-    uint32_t attr_count = 0;
-    sai_attribute_t attr[2];
+    sai_attribute_t attr;
     sai_fdb_event_notification_data_t notify;
+    _brcm_sai_fdb_event_t event;
 
     BRCM_SAI_LOG_FDB(SAI_LOG_INFO, "FDB event: %d\n", operation);
 
-    if (NULL == host_callbacks.on_fdb_event)
-    {
-        return;
-    }
     if (OPENNSL_L2_CALLBACK_ADD == operation)
     {
-        notify.event_type = SAI_FDB_EVENT_LEARNED;
+        _brcm_sai_fdb_shadow_update(l2addr, false);
+        event.type = SAI_FDB_EVENT_LEARNED;
     }
     else if (OPENNSL_L2_CALLBACK_DELETE == operation)
     {
-        notify.event_type = SAI_FDB_EVENT_AGED;
+        _brcm_sai_fdb_shadow_remove(l2addr->mac, l2addr->vid);
+        event.type = SAI_FDB_EVENT_AGED;
     }
     else
     {
         return;
     }
-    attr[attr_count].id = SAI_FDB_ENTRY_ATTR_PORT_ID;
-    attr[attr_count].value.oid = BRCM_SAI_CREATE_OBJ(SAI_OBJECT_TYPE_PORT, l2addr->port);
-    attr_count++;
-    memcpy(notify.fdb_entry.mac_address, l2addr->mac, sizeof(sai_mac_t));
-    notify.fdb_entry.vlan_id = l2addr->vid;
-    notify.attr_count = attr_count;
-    notify.attr = attr;
+    if (_brcm_sai_fdb_move_check(l2addr, operation))
+    {
+        /* Damped, the MAC is reported in a move storm */
+        return;
+    }
+    if (NULL == host_callbacks.on_fdb_event)
+    {
+        return;
+    }
+    memcpy(event.mac, l2addr->mac, sizeof(sai_mac_t));
+    event.vid = l2addr->vid;
+    event.port = l2addr->port;
+    if (_brcm_sai_fdb_event_post(&event))
+    {
+        return;
+    }
+    _brcm_sai_fdb_event_fill(&event, &notify, &attr);
     host_callbacks.on_fdb_event(1, &notify);
 }
 
@@ -123,6 +332,11 @@ brcm_sai_create_fdb_entry(_In_ const sai_fdb_entry_t* fdb_entry,
                 l2addr.port = BRCM_SAI_GET_OBJ_VAL(int, BRCM_SAI_ATTR_LIST_OBJ(i));
                 break;
             case SAI_FDB_ENTRY_ATTR_PACKET_ACTION:
+                rv = _brcm_sai_fdb_action_set(attr_list[i].value.s32, &l2addr);
+                if (SAI_STATUS_SUCCESS != rv)
+                {
+                    return rv;
+                }
                 break;
             case SAI_FDB_ENTRY_ATTR_CUSTOM_RANGE_BASE:
                 l2addr.flags |= OPENNSL_L2_L3LOOKUP;
@@ -137,6 +351,8 @@ brcm_sai_create_fdb_entry(_In_ const sai_fdb_entry_t* fdb_entry,
     BRCM_SAI_LOG_FDB(SAI_LOG_DEBUG, "L2 port: %d\n", l2addr.port);
     rv = opennsl_l2_addr_add(0, &l2addr);
     BRCM_SAI_API_CHK(SAI_API_FDB, "Create FDB", rv);
+    _brcm_sai_fdb_shadow_update(&l2addr, true);
+    _brcm_sai_fdb_move_forget(l2addr.mac, l2addr.vid);
 
     BRCM_SAI_FUNCTION_EXIT(SAI_API_FDB);
 
@@ -171,7 +387,13 @@ brcm_sai_remove_fdb_entry(_In_ const sai_fdb_entry_t* fdb_entry)
     memcpy(mac, fdb_entry->mac_address, sizeof(opennsl_mac_t));
     vid = fdb_entry->vlan_id;
     rv = opennsl_l2_addr_delete(0, mac, vid);
+    if (OPENNSL_E_NOT_FOUND == rv)
+    {
+        /* Aged out in hardware, don't keep serving it */
+        _brcm_sai_fdb_shadow_remove(mac, vid);
+    }
     BRCM_SAI_API_CHK(SAI_API_FDB, "Remove FDB", rv);
+    _brcm_sai_fdb_shadow_remove(mac, vid);
 
     BRCM_SAI_FUNCTION_EXIT(SAI_API_FDB);
 
@@ -194,7 +416,13 @@ STATIC sai_status_t
 brcm_sai_set_fdb_entry_attribute(_In_ const sai_fdb_entry_t* fdb_entry,
                                  _In_ const sai_attribute_t *attr)
 {
+    sai_status_t rv = OPENNSL_E_NONE;
+    bool found;
+    uint32 flags;
     opennsl_l2_addr_t l2addr;
+    opennsl_mac_t mac;
+    opennsl_vlan_t vid;
+    _brcm_sai_fdb_entry_t entry;
 
     BRCM_SAI_FUNCTION_ENTER(SAI_API_FDB);
     BRCM_SAI_SWITCH_INIT_CHECK;
@@ -203,6 +431,23 @@ brcm_sai_set_fdb_entry_attribute(_In_ const sai_fdb_entry_t* fdb_entry,
     {
         return SAI_STATUS_INVALID_PARAMETER;
     }
+    memcpy(mac, fdb_entry->mac_address, sizeof(opennsl_mac_t));
+    vid = fdb_entry->vlan_id;
+    _BRCM_SAI_FDB_LOCK();
+    found = _brcm_sai_fdb_shadow_get(mac, vid, &entry);
+    _BRCM_SAI_FDB_UNLOCK();
+    if (found)
+    {
+        _brcm_sai_fdb_l2addr_get(mac, vid, &entry, &l2addr);
+    }
+    else
+    {
+        memset(&l2addr, 0, sizeof(opennsl_l2_addr_t));
+        rv = opennsl_l2_addr_get(0, mac, vid, &l2addr);
+        BRCM_SAI_API_CHK(SAI_API_FDB, "FDB attrib get", rv);
+    }
+    flags = l2addr.flags;
+    /* Each change is a single write that updates the entry in place */
     switch (attr->id)
     {
         case SAI_FDB_ENTRY_ATTR_TYPE:
@@ -210,20 +455,57 @@ brcm_sai_set_fdb_entry_attribute(_In_ const sai_fdb_entry_t* fdb_entry,
             {
                 l2addr.flags |= OPENNSL_L2_STATIC;
             }
-            /*FIXME*/
+            else if (SAI_FDB_ENTRY_DYNAMIC == attr->value.s32)
+            {
+                l2addr.flags &= ~OPENNSL_L2_STATIC;
+            }
+            else
+            {
+                return SAI_STATUS_INVALID_ATTR_VALUE_0;
+            }
+            if (flags != l2addr.flags)
+            {
+                rv = opennsl_l2_addr_add(0, &l2addr);
+            }
+            /* The type is the host's to decide now, don't unpin it */
+            _brcm_sai_fdb_move_forget(mac, vid);
             break;
         case SAI_FDB_ENTRY_ATTR_PORT_ID:
+            if (BRCM_SAI_GET_OBJ_VAL(int, attr->value.oid) == l2addr.port)
+            {
+                break;
+            }
+            rv = opennsl_l2_replace(0, OPENNSL_L2_REPLACE_MATCH_MAC |
+                                    OPENNSL_L2_REPLACE_MATCH_VLAN |
+                                    ((flags & OPENNSL_L2_STATIC) ?
+                                     OPENNSL_L2_REPLACE_MATCH_STATIC : 0),
+                                    &l2addr, 0,
+                                    BRCM_SAI_GET_OBJ_VAL(int, attr->value.oid),
+                                    OPENNSL_TRUNK_INVALID);
             l2addr.port = BRCM_SAI_GET_OBJ_VAL(int, attr->value.oid);
-            /*opennsl_l2_replace()*/
             break;
         case SAI_FDB_ENTRY_ATTR_PACKET_ACTION:
+            rv = _brcm_sai_fdb_action_set(attr->value.s32, &l2addr);
+            if (SAI_STATUS_SUCCESS != rv)
+            {
+                return rv;
+            }
+            if (flags != l2addr.flags)
+            {
+                rv = opennsl_l2_addr_add(0, &l2addr);
+            }
             break;
-        default: break;
+        default:
+            BRCM_SAI_LOG_FDB(SAI_LOG_ERROR, "Unknown FDB attribute %d passed\n",
+                             attr->id);
+            return SAI_STATUS_INVALID_ATTRIBUTE_0;
     }
+    BRCM_SAI_API_CHK(SAI_API_FDB, "FDB attrib set", rv);
+    _brcm_sai_fdb_shadow_update(&l2addr, true);
 
     BRCM_SAI_FUNCTION_EXIT(SAI_API_FDB);
 
-    return SAI_STATUS_SUCCESS;
+    return BRCM_RV_OPENNSL_TO_SAI(rv);
 }
 
 /*
@@ -245,10 +527,12 @@ brcm_sai_get_fdb_entry_attribute(_In_ const sai_fdb_entry_t* fdb_entry,
                                  _Inout_ sai_attribute_t *attr_list)
 {
     int i;
-    sai_status_t rv;
+    sai_status_t rv = OPENNSL_E_NONE;
+    bool found, verify;
     opennsl_l2_addr_t l2addr;
     opennsl_mac_t mac;
     opennsl_vlan_t vid;
+    _brcm_sai_fdb_entry_t entry;
 
     BRCM_SAI_FUNCTION_ENTER(SAI_API_FDB);
     BRCM_SAI_SWITCH_INIT_CHECK;
@@ -259,16 +543,42 @@ brcm_sai_get_fdb_entry_attribute(_In_ const sai_fdb_entry_t* fdb_entry,
     }
     memcpy(mac, fdb_entry->mac_address, sizeof(opennsl_mac_t));
     vid = fdb_entry->vlan_id;
-    memset(&l2addr, 0, sizeof(opennsl_l2_addr_t));
-    rv = opennsl_l2_addr_get(0, mac, vid, &l2addr);
-    BRCM_SAI_API_CHK(SAI_API_FDB, "FDB attrib get", rv);
+    _BRCM_SAI_FDB_LOCK();
+    found = _brcm_sai_fdb_shadow_get(mac, vid, &entry);
+    verify = _brcm_sai_fdb_shadow.verify;
+    _BRCM_SAI_FDB_UNLOCK();
+    if ((false == found) || verify)
+    {
+        /* Entries learned before the callback was registered get picked up
+           here */
+        memset(&l2addr, 0, sizeof(opennsl_l2_addr_t));
+        rv = opennsl_l2_addr_get(0, mac, vid, &l2addr);
+        if (found && (OPENNSL_E_NOT_FOUND == rv))
+        {
+            BRCM_SAI_LOG_FDB(SAI_LOG_WARN, "FDB shadow has an entry missing "
+                             "in hardware, vlan %d\n", vid);
+            _brcm_sai_fdb_shadow_remove(mac, vid);
+        }
+        BRCM_SAI_API_CHK(SAI_API_FDB, "FDB attrib get", rv);
+        if (found && ((entry.port != l2addr.port) ||
+                      (entry.flags != _brcm_sai_fdb_flags_get(&l2addr))))
+        {
+            BRCM_SAI_LOG_FDB(SAI_LOG_WARN, "FDB shadow out of sync, vlan %d "
+                             "port %d flags 0x%x, hardware port %d flags 0x%x\n",
+                             vid, entry.port, entry.flags, l2addr.port,
+                             _brcm_sai_fdb_flags_get(&l2addr));
+        }
+        _brcm_sai_fdb_shadow_update(&l2addr, true);
+        entry.port = l2addr.port;
+        entry.flags = _brcm_sai_fdb_flags_get(&l2addr);
+    }
 
     for (i=0; i<attr_count; i++)
     {
         switch(attr_list[i].id)
         {
             case SAI_FDB_ENTRY_ATTR_TYPE:
-                if (l2addr.flags & OPENNSL_L2_STATIC)
+                if (entry.flags & _BRCM_SAI_FDB_STATIC)
                 {
                     attr_list[i].value.s32 = SAI_FDB_ENTRY_STATIC;
                 }
@@ -279,9 +589,10 @@ brcm_sai_get_fdb_entry_attribute(_In_ const sai_fdb_entry_t* fdb_entry,
                 break;
             case SAI_FDB_ENTRY_ATTR_PORT_ID:
                 BRCM_SAI_ATTR_LIST_OBJ(i) =
-                    BRCM_SAI_CREATE_OBJ(SAI_OBJECT_TYPE_PORT, l2addr.port);
+                    BRCM_SAI_CREATE_OBJ(SAI_OBJECT_TYPE_PORT, entry.port);
                 break;
             case SAI_FDB_ENTRY_ATTR_PACKET_ACTION:
+                attr_list[i].value.s32 = _brcm_sai_fdb_action_get(entry.flags);
                 break;
             default: break;
         }
@@ -308,7 +619,1507 @@ STATIC sai_status_t
 brcm_sai_flush_fdb_entries(_In_ uint32_t attr_count,
                            _In_ const sai_attribute_t *attr_list)
 {
-    return SAI_STATUS_NOT_IMPLEMENTED;
+    int i, port = -1, vid = -1;
+    uint32 flags = OPENNSL_L2_DELETE_STATIC;
+    bool dynamic = true;
+    sai_status_t rv;
+    opennsl_mac_t mac;
+    opennsl_l2_addr_t l2addr;
+
+    BRCM_SAI_FUNCTION_ENTER(SAI_API_FDB);
+    BRCM_SAI_SWITCH_INIT_CHECK;
+
+    if ((0 != attr_count) && (NULL == attr_list))
+    {
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+    for (i=0; i<attr_count; i++)
+    {
+        switch (attr_list[i].id)
+        {
+            case SAI_FDB_FLUSH_ATTR_PORT_ID:
+                port = BRCM_SAI_GET_OBJ_VAL(int, BRCM_SAI_ATTR_LIST_OBJ(i));
+                break;
+            case SAI_FDB_FLUSH_ATTR_VLAN_ID:
+                vid = attr_list[i].value.u16;
+                break;
+            case SAI_FDB_FLUSH_ATTR_ENTRY_TYPE:
+                if (SAI_FDB_FLUSH_ENTRY_DYNAMIC == attr_list[i].value.s32)
+                {
+                    flags = 0;
+                }
+                else if (SAI_FDB_FLUSH_ENTRY_STATIC == attr_list[i].value.s32)
+                {
+                    dynamic = false;
+                }
+                else
+                {
+                    BRCM_SAI_LOG_FDB(SAI_LOG_ERROR,
+                                     "Invalid flush entry type %d\n",
+                                     attr_list[i].value.s32);
+                    return SAI_STATUS_INVALID_ATTR_VALUE_0;
+                }
+                break;
+            default:
+                BRCM_SAI_LOG_FDB(SAI_LOG_ERROR,
+                                 "Unknown flush attribute %d passed\n",
+                                 attr_list[i].id);
+                return SAI_STATUS_UNKNOWN_ATTRIBUTE_0;
+        }
+    }
+    BRCM_SAI_LOG_FDB(SAI_LOG_DEBUG, "FDB flush port: %d vlan: %d type: %s\n",
+                     port, vid, (false == dynamic) ? "static" :
+                     (0 == flags) ? "dynamic" : "all");
+    if (false == dynamic)
+    {
+        /* The bulk deletes can't leave dynamic entries behind */
+        rv = _brcm_sai_fdb_flush_static(port, vid);
+    }
+    else if ((-1 != port) && (-1 != vid))
+    {
+        rv = opennsl_l2_addr_delete_by_vlan_port(0, vid, 0, port, flags);
+    }
+    else if (-1 != port)
+    {
+        rv = opennsl_l2_addr_delete_by_port(0, 0, port, flags);
+    }
+    else if (-1 != vid)
+    {
+        rv = opennsl_l2_addr_delete_by_vlan(0, vid, flags);
+    }
+    else
+    {
+        /* Nothing to match on, delete the whole table */
+        memset(mac, 0, sizeof(opennsl_mac_t));
+        opennsl_l2_addr_t_init(&l2addr, mac, 0);
+        rv = opennsl_l2_replace(0, OPENNSL_L2_REPLACE_DELETE |
+                                (flags ? OPENNSL_L2_REPLACE_MATCH_STATIC : 0),
+                                &l2addr, 0, 0, 0);
+    }
+    BRCM_SAI_API_CHK(SAI_API_FDB, "FDB flush", rv);
+    _brcm_sai_fdb_shadow_flush(port, vid, (0 != flags), dynamic);
+
+    BRCM_SAI_FUNCTION_EXIT(SAI_API_FDB);
+
+    return BRCM_RV_OPENNSL_TO_SAI(rv);
+}
+
+/*
+* Routine Description:
+*    Register the MAC move storm callback
+*
+* Arguments:
+*    [in] notification - callback, NULL to unregister
+*
+* Return Values:
+*    SAI_STATUS_SUCCESS on success
+*/
+sai_status_t
+brcm_sai_fdb_move_storm_notification_register(_In_
+    brcm_sai_fdb_move_storm_notification_fn notification)
+{
+    BRCM_SAI_FUNCTION_ENTER(SAI_API_FDB);
+
+    _BRCM_SAI_FDB_DAMP_LOCK();
+    _brcm_sai_fdb_damp.notify = notification;
+    _BRCM_SAI_FDB_DAMP_UNLOCK();
+
+    BRCM_SAI_FUNCTION_EXIT(SAI_API_FDB);
+
+    return SAI_STATUS_SUCCESS;
+}
+
+/*
+################################################################################
+#                               Internal functions                             #
+################################################################################
+*/
+/* Traverse callback collecting the static entries to flush */
+STATIC int
+_brcm_sai_fdb_static_collect(int unit, opennsl_l2_addr_t *info,
+                             void *user_data)
+{
+    _brcm_sai_fdb_flush_t *flush = (_brcm_sai_fdb_flush_t*)user_data;
+    opennsl_l2_addr_t *entries;
+
+    if ((0 == (info->flags & OPENNSL_L2_STATIC)) ||
+        ((-1 != flush->port) && (info->port != flush->port)) ||
+        ((-1 != flush->vid) && (info->vid != flush->vid)))
+    {
+        return OPENNSL_E_NONE;
+    }
+    if (flush->count == flush->size)
+    {
+        entries = (opennsl_l2_addr_t*)
+            realloc(flush->entries, (flush->size ? flush->size * 2 : 64) *
+                    sizeof(opennsl_l2_addr_t));
+        if (NULL == entries)
+        {
+            return OPENNSL_E_MEMORY;
+        }
+        flush->entries = entries;
+        flush->size = flush->size ? flush->size * 2 : 64;
+    }
+    flush->entries[flush->count++] = *info;
+    return OPENNSL_E_NONE;
+}
+
+/*
+ * Routine to flush only static entries. There is no SDK bulk delete that
+ * keeps dynamic entries, so they are collected first and deleted one by one.
+ * Returns an OpenNSL error code.
+ */
+STATIC int
+_brcm_sai_fdb_flush_static(int port, int vid)
+{
+    int i, rv;
+    _brcm_sai_fdb_flush_t flush;
+
+    memset(&flush, 0, sizeof(flush));
+    flush.port = port;
+    flush.vid = vid;
+    rv = opennsl_l2_traverse(0, _brcm_sai_fdb_static_collect, &flush);
+    for (i=0; (OPENNSL_E_NONE == rv) && (i<flush.count); i++)
+    {
+        rv = opennsl_l2_addr_delete(0, flush.entries[i].mac,
+                                    flush.entries[i].vid);
+        if (OPENNSL_E_NOT_FOUND == rv)
+        {
+            /* Removed since the traverse */
+            rv = OPENNSL_E_NONE;
+        }
+        if (OPENNSL_E_NONE == rv)
+        {
+            _brcm_sai_fdb_shadow_remove(flush.entries[i].mac,
+                                        flush.entries[i].vid);
+        }
+    }
+    CHECK_FREE(flush.entries);
+    return rv;
+}
+
+/* Routine to build the shadow key of an entry */
+STATIC uint64_t
+_brcm_sai_fdb_key(const uint8_t *mac, int vid)
+{
+    int i;
+    uint64_t key = (uint16_t)vid;
+
+    for (i=0; i<6; i++)
+    {
+        key = (key << 8) | mac[i];
+    }
+    return key;
+}
+
+/* Routine to get the shadow flags of an SDK entry */
+STATIC uint8_t
+_brcm_sai_fdb_flags_get(const opennsl_l2_addr_t *l2addr)
+{
+    uint8_t flags = 0;
+
+    if (l2addr->flags & OPENNSL_L2_STATIC)
+    {
+        flags |= _BRCM_SAI_FDB_STATIC;
+    }
+    if (l2addr->flags & OPENNSL_L2_L3LOOKUP)
+    {
+        flags |= _BRCM_SAI_FDB_L3LOOKUP;
+    }
+    if (l2addr->flags & OPENNSL_L2_DISCARD_DST)
+    {
+        flags |= _BRCM_SAI_FDB_DISCARD;
+    }
+    if (l2addr->flags & OPENNSL_L2_COPY_TO_CPU)
+    {
+        flags |= _BRCM_SAI_FDB_COPY_TO_CPU;
+    }
+    return flags;
+}
+
+/* Routine to set the SDK flags for a packet action */
+STATIC sai_status_t
+_brcm_sai_fdb_action_set(sai_packet_action_t action, opennsl_l2_addr_t *l2addr)
+{
+    l2addr->flags &= ~(OPENNSL_L2_DISCARD_DST | OPENNSL_L2_COPY_TO_CPU);
+    switch (action)
+    {
+        case SAI_PACKET_ACTION_FORWARD:
+            break;
+        case SAI_PACKET_ACTION_DROP:
+            l2addr->flags |= OPENNSL_L2_DISCARD_DST;
+            break;
+        case SAI_PACKET_ACTION_TRAP:
+            l2addr->flags |= OPENNSL_L2_DISCARD_DST | OPENNSL_L2_COPY_TO_CPU;
+            break;
+        case SAI_PACKET_ACTION_LOG:
+            l2addr->flags |= OPENNSL_L2_COPY_TO_CPU;
+            break;
+        default:
+            BRCM_SAI_LOG_FDB(SAI_LOG_ERROR, "Unsupported packet action %d\n",
+                             action);
+            return SAI_STATUS_INVALID_ATTR_VALUE_0;
+    }
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Routine to get the packet action of a shadow entry */
+STATIC sai_packet_action_t
+_brcm_sai_fdb_action_get(uint8_t flags)
+{
+    if (flags & _BRCM_SAI_FDB_DISCARD)
+    {
+        return (flags & _BRCM_SAI_FDB_COPY_TO_CPU) ? SAI_PACKET_ACTION_TRAP :
+                                                     SAI_PACKET_ACTION_DROP;
+    }
+    return (flags & _BRCM_SAI_FDB_COPY_TO_CPU) ? SAI_PACKET_ACTION_LOG :
+                                                 SAI_PACKET_ACTION_FORWARD;
+}
+
+/* Routine to build the SDK entry for a shadow entry */
+STATIC void
+_brcm_sai_fdb_l2addr_get(const uint8_t *mac, int vid,
+                         const _brcm_sai_fdb_entry_t *entry,
+                         opennsl_l2_addr_t *l2addr)
+{
+    opennsl_l2_addr_t_init(l2addr, mac, vid);
+    l2addr->port = entry->port;
+    if (entry->flags & _BRCM_SAI_FDB_STATIC)
+    {
+        l2addr->flags |= OPENNSL_L2_STATIC;
+    }
+    if (entry->flags & _BRCM_SAI_FDB_L3LOOKUP)
+    {
+        l2addr->flags |= OPENNSL_L2_L3LOOKUP;
+    }
+    if (entry->flags & _BRCM_SAI_FDB_DISCARD)
+    {
+        l2addr->flags |= OPENNSL_L2_DISCARD_DST;
+    }
+    if (entry->flags & _BRCM_SAI_FDB_COPY_TO_CPU)
+    {
+        l2addr->flags |= OPENNSL_L2_COPY_TO_CPU;
+    }
+}
+
+/*
+ * Routine to find the slot of a key. Returns the slot holding it or, when
+ * missing, the slot to add it in. Called with the FDB lock held and the
+ * table allocated, the load limit keeps an empty slot to stop the probe.
+ */
+STATIC _brcm_sai_fdb_entry_t *
+_brcm_sai_fdb_slot_find(_brcm_sai_fdb_entry_t *slots, sai_uint32_t size,
+                        uint64_t key)
+{
+    sai_uint32_t i;
+    _brcm_sai_fdb_entry_t *slot, *free = NULL;
+
+    for (i = (sai_uint32_t)((key * 0x9E3779B97F4A7C15ull) >> 32) & (size - 1);
+         ; i = (i + 1) & (size - 1))
+    {
+        slot = &slots[i];
+        if (_BRCM_SAI_FDB_SLOT_EMPTY == slot->state)
+        {
+            return (NULL != free) ? free : slot;
+        }
+        if (_BRCM_SAI_FDB_SLOT_DELETED == slot->state)
+        {
+            if (NULL == free)
+            {
+                free = slot;
+            }
+        }
+        else if (slot->key == key)
+        {
+            return slot;
+        }
+    }
+}
+
+/*
+ * Routine to grow the shadow, or to rehash it to drop deleted slots, once
+ * half of it is in use. Called with the FDB lock held, which is dropped
+ * around the allocation. The SDK thread never calls this, learns only fill
+ * the room left so that the callback doesn't allocate or rehash.
+ */
+STATIC void
+_brcm_sai_fdb_shadow_grow(void)
+{
+    sai_uint32_t i, size;
+    _brcm_sai_fdb_entry_t *slots, *slot;
+
+    size = _brcm_sai_fdb_shadow.size;
+    if (0 == size)
+    {
+        size = _BRCM_SAI_FDB_SHADOW_MIN;
+    }
+    else if (((_brcm_sai_fdb_shadow.count + 1) * 2) > size)
+    {
+        size *= 2;
+    }
+    else if (((_brcm_sai_fdb_shadow.count + _brcm_sai_fdb_shadow.deleted) *
+              2) <= size)
+    {
+        return;
+    }
+    _BRCM_SAI_FDB_UNLOCK();
+    slots = (_brcm_sai_fdb_entry_t*)calloc(size, sizeof(_brcm_sai_fdb_entry_t));
+    _BRCM_SAI_FDB_LOCK();
+    if (NULL == slots)
+    {
+        BRCM_SAI_LOG_FDB(SAI_LOG_ERROR, "Error allocating FDB shadow\n");
+        return;
+    }
+    if (size < _brcm_sai_fdb_shadow.size)
+    {
+        /* Grown meanwhile */
+        free(slots);
+        return;
+    }
+    for (i=0; i<_brcm_sai_fdb_shadow.size; i++)
+    {
+        if (_BRCM_SAI_FDB_SLOT_USED == _brcm_sai_fdb_shadow.slots[i].state)
+        {
+            slot = _brcm_sai_fdb_slot_find(slots, size,
+                                           _brcm_sai_fdb_shadow.slots[i].key);
+            *slot = _brcm_sai_fdb_shadow.slots[i];
+        }
+    }
+    CHECK_FREE(_brcm_sai_fdb_shadow.slots);
+    _brcm_sai_fdb_shadow.slots = slots;
+    _brcm_sai_fdb_shadow.size = size;
+    _brcm_sai_fdb_shadow.deleted = 0;
+}
+
+/*
+ * Routine to add or update an entry in the shadow, grow is set when not on
+ * the SDK thread. An entry which doesn't fit is left out, gets then fall
+ * back to the hardware for it.
+ */
+STATIC void
+_brcm_sai_fdb_shadow_update(const opennsl_l2_addr_t *l2addr, bool grow)
+{
+    uint64_t key = _brcm_sai_fdb_key(l2addr->mac, l2addr->vid);
+    _brcm_sai_fdb_entry_t *slot;
+
+    _BRCM_SAI_FDB_LOCK();
+    if (grow)
+    {
+        _brcm_sai_fdb_shadow_grow();
+    }
+    if (NULL == _brcm_sai_fdb_shadow.slots)
+    {
+        _BRCM_SAI_FDB_UNLOCK();
+        return;
+    }
+    slot = _brcm_sai_fdb_slot_find(_brcm_sai_fdb_shadow.slots,
+                                   _brcm_sai_fdb_shadow.size, key);
+    /* Keep the load under 3/4 */
+    if ((_BRCM_SAI_FDB_SLOT_EMPTY == slot->state) &&
+        (((_brcm_sai_fdb_shadow.count + _brcm_sai_fdb_shadow.deleted + 1) *
+          4) > (_brcm_sai_fdb_shadow.size * 3)))
+    {
+        _BRCM_SAI_FDB_UNLOCK();
+        return;
+    }
+    if (_BRCM_SAI_FDB_SLOT_USED != slot->state)
+    {
+        if (_BRCM_SAI_FDB_SLOT_DELETED == slot->state)
+        {
+            _brcm_sai_fdb_shadow.deleted--;
+        }
+        _brcm_sai_fdb_shadow.count++;
+        slot->key = key;
+        slot->state = _BRCM_SAI_FDB_SLOT_USED;
+    }
+    slot->port = l2addr->port;
+    slot->flags = _brcm_sai_fdb_flags_get(l2addr);
+    _BRCM_SAI_FDB_UNLOCK();
+}
+
+/* Routine to remove an entry from the shadow */
+STATIC void
+_brcm_sai_fdb_shadow_remove(const uint8_t *mac, int vid)
+{
+    _brcm_sai_fdb_entry_t *slot;
+
+    _BRCM_SAI_FDB_LOCK();
+    if (NULL != _brcm_sai_fdb_shadow.slots)
+    {
+        slot = _brcm_sai_fdb_slot_find(_brcm_sai_fdb_shadow.slots,
+                                       _brcm_sai_fdb_shadow.size,
+                                       _brcm_sai_fdb_key(mac, vid));
+        if (_BRCM_SAI_FDB_SLOT_USED == slot->state)
+        {
+            slot->state = _BRCM_SAI_FDB_SLOT_DELETED;
+            _brcm_sai_fdb_shadow.count--;
+            _brcm_sai_fdb_shadow.deleted++;
+        }
+    }
+    _BRCM_SAI_FDB_UNLOCK();
+}
+
+/* Routine to copy out a shadow entry, called with the FDB lock held */
+STATIC bool
+_brcm_sai_fdb_shadow_get(const uint8_t *mac, int vid,
+                         _brcm_sai_fdb_entry_t *entry)
+{
+    _brcm_sai_fdb_entry_t *slot;
+
+    if (NULL == _brcm_sai_fdb_shadow.slots)
+    {
+        return false;
+    }
+    slot = _brcm_sai_fdb_slot_find(_brcm_sai_fdb_shadow.slots,
+                                   _brcm_sai_fdb_shadow.size,
+                                   _brcm_sai_fdb_key(mac, vid));
+    if (_BRCM_SAI_FDB_SLOT_USED != slot->state)
+    {
+        return false;
+    }
+    *entry = *slot;
+    return true;
+}
+
+/* Routine to remove the entries matching a flush from the shadow */
+STATIC void
+_brcm_sai_fdb_shadow_flush(int port, int vid, bool statics, bool dynamics)
+{
+    sai_uint32_t i;
+    _brcm_sai_fdb_entry_t *slot;
+
+    _BRCM_SAI_FDB_LOCK();
+    for (i=0; i<_brcm_sai_fdb_shadow.size; i++)
+    {
+        slot = &_brcm_sai_fdb_shadow.slots[i];
+        if ((_BRCM_SAI_FDB_SLOT_USED != slot->state) ||
+            ((-1 != port) && (slot->port != port)) ||
+            ((-1 != vid) && ((int)(slot->key >> 48) != vid)))
+        {
+            continue;
+        }
+        if ((slot->flags & _BRCM_SAI_FDB_STATIC) ? statics : dynamics)
+        {
+            slot->state = _BRCM_SAI_FDB_SLOT_DELETED;
+            _brcm_sai_fdb_shadow.count--;
+            _brcm_sai_fdb_shadow.deleted++;
+        }
+    }
+    _BRCM_SAI_FDB_UNLOCK();
+}
+
+/* Routine to get the monotonic time in msec */
+STATIC uint64_t
+_brcm_sai_fdb_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000) + (ts.tv_nsec / 1000000);
+}
+
+/* Routine to get the MAC and VLAN of a shadow key */
+STATIC void
+_brcm_sai_fdb_key_get(uint64_t key, opennsl_mac_t mac, opennsl_vlan_t *vid)
+{
+    int i;
+
+    for (i=5; i>=0; i--)
+    {
+        mac[i] = key & 0xff;
+        key >>= 8;
+    }
+    *vid = (opennsl_vlan_t)key;
+}
+
+/*
+ * Routine to find the move tracker of a key. With create set a missing key
+ * takes a free or idle tracker, NULL when there is none in its probe range.
+ * Called with the damping lock held and the trackers allocated.
+ */
+STATIC _brcm_sai_fdb_move_t *
+_brcm_sai_fdb_move_find(uint64_t key, uint64_t now, bool create)
+{
+    int i;
+    sai_uint32_t idx;
+    _brcm_sai_fdb_move_t *move, *free = NULL;
+
+    idx = (sai_uint32_t)((key * 0x9E3779B97F4A7C15ull) >> 32);
+    for (i=0; i<_BRCM_SAI_FDB_MOVE_PROBES; i++)
+    {
+        move = &_brcm_sai_fdb_damp.slots[(idx + i) &
+                                         (_BRCM_SAI_FDB_MOVE_SLOTS - 1)];
+        if (move->used && (move->key == key))
+        {
+            return move;
+        }
+        if ((NULL == free) &&
+            ((false == move->used) ||
+             ((false == move->damped) &&
+              ((now - move->start) >= (2 * (uint64_t)_brcm_sai_fdb_damp.window)))))
+        {
+            free = move;
+        }
+    }
+    if ((false == create) || (NULL == free))
+    {
+        return NULL;
+    }
+    memset(free, 0, sizeof(*free));
+    free->used = true;
+    free->key = key;
+    free->start = now;
+    free->port = -1;
+    return free;
+}
+
+/*
+ * Routine to count a learn towards MAC move damping, called from the SDK
+ * thread. Returns true when the MAC is damped and its notifications are
+ * to be suppressed.
+ */
+STATIC bool
+_brcm_sai_fdb_move_check(const opennsl_l2_addr_t *l2addr, int operation)
+{
+    bool damped;
+    uint64_t now, elapsed, window, estimate;
+    _brcm_sai_fdb_move_t *move;
+
+    if (false == _BRCM_SAI_FDB_DAMPING())
+    {
+        return false;
+    }
+    _BRCM_SAI_FDB_DAMP_LOCK();
+    if (NULL == _brcm_sai_fdb_damp.slots)
+    {
+        _BRCM_SAI_FDB_DAMP_UNLOCK();
+        return false;
+    }
+    now = _brcm_sai_fdb_now();
+    /* Trackers outlive the entries, a move can be a delete then a learn */
+    move = _brcm_sai_fdb_move_find(_brcm_sai_fdb_key(l2addr->mac, l2addr->vid),
+                                   now, OPENNSL_L2_CALLBACK_ADD == operation);
+    if (NULL == move)
+    {
+        _BRCM_SAI_FDB_DAMP_UNLOCK();
+        return false;
+    }
+    if ((OPENNSL_L2_CALLBACK_ADD == operation) && (move->port != l2addr->port))
+    {
+        if (-1 == move->port)
+        {
+            move->port = l2addr->port;
+            _BRCM_SAI_FDB_DAMP_UNLOCK();
+            return false;
+        }
+        move->port = l2addr->port;
+        window = _brcm_sai_fdb_damp.window;
+        elapsed = now - move->start;
+        if (elapsed >= window)
+        {
+            move->prev = (elapsed < (2 * window)) ? move->cur : 0;
+            move->cur = 0;
+            move->start = now - (elapsed % window);
+            elapsed %= window;
+        }
+        if (move->cur < 0xffff)
+        {
+            move->cur++;
+        }
+        estimate = ((move->prev * (window - elapsed)) / window) + move->cur;
+        if (move->damped)
+        {
+            move->until = now + _brcm_sai_fdb_damp.hold;
+        }
+        else if (estimate >= _brcm_sai_fdb_damp.threshold)
+        {
+            move->damped = true;
+            move->reported = false;
+            move->until = now + _brcm_sai_fdb_damp.hold;
+            _brcm_sai_fdb_damp.damped++;
+            BRCM_SAI_LOG_FDB(SAI_LOG_WARN, "Damping MAC move on vlan %d, %d "
+                             "moves in %d msec\n", l2addr->vid, (int)estimate,
+                             (int)window);
+            if (_brcm_sai_fdb_damp.pin ||
+                ((now - _brcm_sai_fdb_damp.reported) >= window))
+            {
+                _brcm_sai_fdb_damp.kick = true;
+                pthread_cond_signal(&_brcm_sai_fdb_damp.cond);
+            }
+        }
+    }
+    damped = move->damped;
+    _BRCM_SAI_FDB_DAMP_UNLOCK();
+    return damped;
+}
+
+/* Routine to keep damping from changing a type the host set */
+STATIC void
+_brcm_sai_fdb_move_forget(const uint8_t *mac, int vid)
+{
+    _brcm_sai_fdb_move_t *move;
+
+    if (false == _BRCM_SAI_FDB_DAMPING())
+    {
+        return;
+    }
+    _BRCM_SAI_FDB_DAMP_LOCK();
+    if (NULL != _brcm_sai_fdb_damp.slots)
+    {
+        move = _brcm_sai_fdb_move_find(_brcm_sai_fdb_key(mac, vid),
+                                       _brcm_sai_fdb_now(), false);
+        if (NULL != move)
+        {
+            move->pinned = false;
+        }
+    }
+    _BRCM_SAI_FDB_DAMP_UNLOCK();
+}
+
+/* Routine to pin a damped MAC static on its port or to unpin it */
+STATIC void
+_brcm_sai_fdb_move_pin(uint64_t key, bool pin)
+{
+    int rv;
+    bool found;
+    uint32 flags;
+    opennsl_mac_t mac;
+    opennsl_vlan_t vid;
+    opennsl_l2_addr_t l2addr;
+    _brcm_sai_fdb_entry_t entry;
+
+    _brcm_sai_fdb_key_get(key, mac, &vid);
+    _BRCM_SAI_FDB_LOCK();
+    found = _brcm_sai_fdb_shadow_get(mac, vid, &entry);
+    _BRCM_SAI_FDB_UNLOCK();
+    if (false == found)
+    {
+        /* Aged out or removed, nothing to pin */
+        return;
+    }
+    _brcm_sai_fdb_l2addr_get(mac, vid, &entry, &l2addr);
+    flags = l2addr.flags;
+    if (pin)
+    {
+        l2addr.flags |= OPENNSL_L2_STATIC;
+    }
+    else
+    {
+        l2addr.flags &= ~OPENNSL_L2_STATIC;
+    }
+    if (flags == l2addr.flags)
+    {
+        return;
+    }
+    rv = opennsl_l2_addr_add(0, &l2addr);
+    if (OPENNSL_E_NONE != rv)
+    {
+        BRCM_SAI_LOG_FDB(SAI_LOG_ERROR, "Error %d %s MAC on vlan %d\n", rv,
+                         pin ? "pinning" : "unpinning", vid);
+        return;
+    }
+    _brcm_sai_fdb_shadow_update(&l2addr, true);
+}
+
+/* MAC move damping thread */
+STATIC void *
+_brcm_sai_fdb_damp_thread(void *arg)
+{
+    int i, count, pins, releases;
+    bool report;
+    uint64_t now;
+    struct timespec ts;
+    sai_fdb_entry_t *entries;
+    uint64_t *keys;
+    bool *pin;
+    opennsl_vlan_t vid;
+    _brcm_sai_fdb_event_t *released;
+    _brcm_sai_fdb_move_t *move;
+    brcm_sai_fdb_move_storm_notification_fn notify;
+
+    _BRCM_SAI_FDB_DAMP_LOCK();
+    while (_brcm_sai_fdb_damp.thread_run)
+    {
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += _brcm_sai_fdb_damp.window / 1000;
+        ts.tv_nsec += (_brcm_sai_fdb_damp.window % 1000) * 1000000;
+        if (ts.tv_nsec >= 1000000000)
+        {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000;
+        }
+        if (false == _brcm_sai_fdb_damp.kick)
+        {
+            (void)pthread_cond_timedwait(&_brcm_sai_fdb_damp.cond,
+                                         &_brcm_sai_fdb_damp.mutex, &ts);
+        }
+        _brcm_sai_fdb_damp.kick = false;
+        if (false == _brcm_sai_fdb_damp.thread_run)
+        {
+            break;
+        }
+        if (0 == _brcm_sai_fdb_damp.damped)
+        {
+            continue;
+        }
+        entries = (sai_fdb_entry_t*)calloc(_brcm_sai_fdb_damp.damped,
+                                           sizeof(sai_fdb_entry_t));
+        keys = (uint64_t*)calloc(_brcm_sai_fdb_damp.damped, sizeof(uint64_t));
+        pin = (bool*)calloc(_brcm_sai_fdb_damp.damped, sizeof(bool));
+        released = (_brcm_sai_fdb_event_t*)
+            calloc(_brcm_sai_fdb_damp.damped, sizeof(_brcm_sai_fdb_event_t));
+        if ((NULL == entries) || (NULL == keys) || (NULL == pin) ||
+            (NULL == released))
+        {
+            CHECK_FREE(entries);
+            CHECK_FREE(keys);
+            CHECK_FREE(pin);
+            CHECK_FREE(released);
+            continue;
+        }
+        now = _brcm_sai_fdb_now();
+        report = ((now - _brcm_sai_fdb_damp.reported) >=
+                  _brcm_sai_fdb_damp.window);
+        count = pins = releases = 0;
+        for (i=0; i<_BRCM_SAI_FDB_MOVE_SLOTS; i++)
+        {
+            move = &_brcm_sai_fdb_damp.slots[i];
+            if ((false == move->used) || (false == move->damped))
+            {
+                continue;
+            }
+            if (move->until <= now)
+            {
+                move->damped = false;
+                move->prev = move->cur = 0;
+                _brcm_sai_fdb_damp.damped--;
+                _brcm_sai_fdb_key_get(move->key, released[releases].mac, &vid);
+                released[releases].vid = vid;
+                released[releases++].port = move->port;
+                if (move->pinned)
+                {
+                    move->pinned = false;
+                    keys[pins] = move->key;
+                    pin[pins++] = false;
+                }
+                continue;
+            }
+            if (_brcm_sai_fdb_damp.pin && (false == move->pinned))
+            {
+                move->pinned = true;
+                keys[pins] = move->key;
+                pin[pins++] = true;
+            }
+            if (report && (false == move->reported))
+            {
+                move->reported = true;
+                _brcm_sai_fdb_key_get(move->key, entries[count].mac_address,
+                                      &entries[count].vlan_id);
+                count++;
+            }
+        }
+        if (count)
+        {
+            _brcm_sai_fdb_damp.reported = now;
+        }
+        notify = _brcm_sai_fdb_damp.notify;
+        /* The SDK writes and the callback run without the lock */
+        _BRCM_SAI_FDB_DAMP_UNLOCK();
+        for (i=0; i<pins; i++)
+        {
+            _brcm_sai_fdb_move_pin(keys[i], pin[i]);
+        }
+        _brcm_sai_fdb_event_release(released, releases);
+        if (count)
+        {
+            BRCM_SAI_LOG_FDB(SAI_LOG_WARN, "MAC move storm, %d MACs damped\n",
+                             count);
+            if (NULL != notify)
+            {
+                notify(count, entries);
+            }
+        }
+        CHECK_FREE(entries);
+        CHECK_FREE(keys);
+        CHECK_FREE(pin);
+        CHECK_FREE(released);
+        _BRCM_SAI_FDB_DAMP_LOCK();
+    }
+    _BRCM_SAI_FDB_DAMP_UNLOCK();
+    return NULL;
+}
+
+/*
+ * Routine to stop damping, called without the damping lock. The trackers
+ * are freed and, with release set, pinned MACs are made dynamic again and
+ * the damped ones are reported where they are.
+ */
+STATIC void
+_brcm_sai_fdb_damp_stop(bool release)
+{
+    int i, pins = 0, releases = 0;
+    bool running;
+    uint64_t *keys = NULL;
+    opennsl_vlan_t vid;
+    _brcm_sai_fdb_event_t *released = NULL;
+    _brcm_sai_fdb_move_t *slots;
+
+    _BRCM_SAI_FDB_DAMP_LOCK();
+    running = _brcm_sai_fdb_damp.thread_run;
+    _brcm_sai_fdb_damp.thread_run = false;
+    pthread_cond_signal(&_brcm_sai_fdb_damp.cond);
+    _BRCM_SAI_FDB_DAMP_UNLOCK();
+    if (running)
+    {
+        pthread_join(_brcm_sai_fdb_damp.thread, NULL);
+    }
+    _BRCM_SAI_FDB_DAMP_LOCK();
+    slots = _brcm_sai_fdb_damp.slots;
+    _brcm_sai_fdb_damp.slots = NULL;
+    _brcm_sai_fdb_damp.damped = 0;
+    _brcm_sai_fdb_damp.kick = false;
+    _BRCM_SAI_FDB_DAMP_UNLOCK();
+    if (NULL == slots)
+    {
+        return;
+    }
+    if (release)
+    {
+        keys = (uint64_t*)calloc(_BRCM_SAI_FDB_MOVE_SLOTS, sizeof(uint64_t));
+        released = (_brcm_sai_fdb_event_t*)
+            calloc(_BRCM_SAI_FDB_MOVE_SLOTS, sizeof(_brcm_sai_fdb_event_t));
+    }
+    for (i=0; (NULL != keys) && (NULL != released) &&
+              (i<_BRCM_SAI_FDB_MOVE_SLOTS); i++)
+    {
+        if (false == (slots[i].used && slots[i].damped))
+        {
+            continue;
+        }
+        if (slots[i].pinned)
+        {
+            keys[pins++] = slots[i].key;
+        }
+        _brcm_sai_fdb_key_get(slots[i].key, released[releases].mac, &vid);
+        released[releases].vid = vid;
+        released[releases++].port = slots[i].port;
+    }
+    free(slots);
+    for (i=0; i<pins; i++)
+    {
+        _brcm_sai_fdb_move_pin(keys[i], false);
+    }
+    _brcm_sai_fdb_event_release(released, releases);
+    CHECK_FREE(keys);
+    CHECK_FREE(released);
+}
+
+/* Routine to start damping, called with the damping lock held */
+STATIC sai_status_t
+_brcm_sai_fdb_damp_start(void)
+{
+    if (_brcm_sai_fdb_damp.thread_run || (0 == _brcm_sai_fdb_damp.threshold))
+    {
+        return SAI_STATUS_SUCCESS;
+    }
+    _brcm_sai_fdb_damp.slots = (_brcm_sai_fdb_move_t*)
+        calloc(_BRCM_SAI_FDB_MOVE_SLOTS, sizeof(_brcm_sai_fdb_move_t));
+    if (NULL == _brcm_sai_fdb_damp.slots)
+    {
+        BRCM_SAI_LOG_FDB(SAI_LOG_ERROR, "Error allocating MAC move trackers\n");
+        return SAI_STATUS_NO_MEMORY;
+    }
+    _brcm_sai_fdb_damp.thread_run = true;
+    if (0 != pthread_create(&_brcm_sai_fdb_damp.thread, NULL,
+                            _brcm_sai_fdb_damp_thread, NULL))
+    {
+        _brcm_sai_fdb_damp.thread_run = false;
+        free(_brcm_sai_fdb_damp.slots);
+        _brcm_sai_fdb_damp.slots = NULL;
+        BRCM_SAI_LOG_FDB(SAI_LOG_ERROR, "Error creating MAC move thread\n");
+        return SAI_STATUS_FAILURE;
+    }
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Routine to build the notification of an FDB event */
+STATIC void
+_brcm_sai_fdb_event_fill(const _brcm_sai_fdb_event_t *event,
+                         sai_fdb_event_notification_data_t *notify,
+                         sai_attribute_t *attr)
+{
+    attr->id = SAI_FDB_ENTRY_ATTR_PORT_ID;
+    attr->value.oid = BRCM_SAI_CREATE_OBJ(SAI_OBJECT_TYPE_PORT, event->port);
+    notify->event_type = event->type;
+    memcpy(notify->fdb_entry.mac_address, event->mac, sizeof(sai_mac_t));
+    notify->fdb_entry.vlan_id = event->vid;
+    notify->attr_count = 1;
+    notify->attr = attr;
+}
+
+/*
+ * Routine to queue an FDB event for the dispatcher, called from the SDK
+ * thread. Returns false when events are not being batched. The event is
+ * counted and dropped when the ring is full.
+ */
+STATIC bool
+_brcm_sai_fdb_event_post(const _brcm_sai_fdb_event_t *event)
+{
+    sai_uint32_t head, tail, batch;
+
+    __atomic_add_fetch(&_brcm_sai_fdb_events.busy, 1, __ATOMIC_SEQ_CST);
+    if (false == __atomic_load_n(&_brcm_sai_fdb_events.enabled,
+                                 __ATOMIC_SEQ_CST))
+    {
+        __atomic_sub_fetch(&_brcm_sai_fdb_events.busy, 1, __ATOMIC_RELEASE);
+        return false;
+    }
+    head = _brcm_sai_fdb_events.head;
+    tail = __atomic_load_n(&_brcm_sai_fdb_events.tail, __ATOMIC_ACQUIRE);
+    if ((head - tail) > _brcm_sai_fdb_events.mask)
+    {
+        __atomic_add_fetch(&_brcm_sai_fdb_events.drops, 1, __ATOMIC_RELAXED);
+        __atomic_sub_fetch(&_brcm_sai_fdb_events.busy, 1, __ATOMIC_RELEASE);
+        return true;
+    }
+    _brcm_sai_fdb_events.ring[head & _brcm_sai_fdb_events.mask] = *event;
+    __atomic_store_n(&_brcm_sai_fdb_events.head, head + 1, __ATOMIC_SEQ_CST);
+    /* Pairs with the dispatcher storing tail before it looks at head */
+    tail = __atomic_load_n(&_brcm_sai_fdb_events.tail, __ATOMIC_SEQ_CST);
+    batch = __atomic_load_n(&_brcm_sai_fdb_events.batch, __ATOMIC_RELAXED);
+    if ((tail == head) || ((head + 1 - tail) == batch))
+    {
+        sem_post(&_brcm_sai_fdb_events.sem);
+    }
+    __atomic_sub_fetch(&_brcm_sai_fdb_events.busy, 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/*
+ * Routine to queue MACs released from damping for the dispatcher, which
+ * runs while damping is on. Their events were suppressed while damped.
+ */
+STATIC void
+_brcm_sai_fdb_event_release(const _brcm_sai_fdb_event_t *released,
+                            int count)
+{
+    sai_uint32_t size;
+    _brcm_sai_fdb_event_t *release;
+
+    if ((0 == count) || (false == _brcm_sai_fdb_events.thread_run))
+    {
+        return;
+    }
+    pthread_mutex_lock(&_brcm_sai_fdb_events.mutex);
+    size = _brcm_sai_fdb_events.released_size;
+    while ((_brcm_sai_fdb_events.released + count) > size)
+    {
+        size = size ? (size * 2) : _BRCM_SAI_FDB_EVENT_BATCH_MAX;
+    }
+    if (size != _brcm_sai_fdb_events.released_size)
+    {
+        release = (_brcm_sai_fdb_event_t*)
+            realloc(_brcm_sai_fdb_events.release,
+                    size * sizeof(_brcm_sai_fdb_event_t));
+        if (NULL == release)
+        {
+            pthread_mutex_unlock(&_brcm_sai_fdb_events.mutex);
+            BRCM_SAI_LOG_FDB(SAI_LOG_ERROR, "Error queuing %d released "
+                             "MACs\n", count);
+            return;
+        }
+        _brcm_sai_fdb_events.release = release;
+        _brcm_sai_fdb_events.released_size = size;
+    }
+    memcpy(&_brcm_sai_fdb_events.release[_brcm_sai_fdb_events.released],
+           released, count * sizeof(_brcm_sai_fdb_event_t));
+    __atomic_store_n(&_brcm_sai_fdb_events.released,
+                     _brcm_sai_fdb_events.released + count, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&_brcm_sai_fdb_events.mutex);
+    sem_post(&_brcm_sai_fdb_events.sem);
+}
+
+/*
+ * Routine to deliver the MACs released from damping. Each is reported as
+ * learned where it is now or, when gone, as aged on the port it was last
+ * learned on. Reading the state at delivery keeps a learn queued before
+ * this from leaving the host with an older port.
+ */
+STATIC void
+_brcm_sai_fdb_event_release_deliver(void)
+{
+    int i, count;
+    bool found;
+    opennsl_l2_addr_t l2addr;
+    _brcm_sai_fdb_entry_t entry;
+    _brcm_sai_fdb_event_t *release;
+    sai_fdb_event_notification_fn notify;
+
+    pthread_mutex_lock(&_brcm_sai_fdb_events.mutex);
+    release = _brcm_sai_fdb_events.release;
+    count = _brcm_sai_fdb_events.released;
+    _brcm_sai_fdb_events.release = NULL;
+    _brcm_sai_fdb_events.released_size = 0;
+    __atomic_store_n(&_brcm_sai_fdb_events.released, 0, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&_brcm_sai_fdb_events.mutex);
+    for (i=0; i<count; i++)
+    {
+        _BRCM_SAI_FDB_LOCK();
+        found = _brcm_sai_fdb_shadow_get(release[i].mac, release[i].vid,
+                                         &entry);
+        _BRCM_SAI_FDB_UNLOCK();
+        if (found)
+        {
+            release[i].type = SAI_FDB_EVENT_LEARNED;
+            release[i].port = entry.port;
+        }
+        else if (OPENNSL_E_NONE == opennsl_l2_addr_get(0, release[i].mac,
+                                                       release[i].vid,
+                                                       &l2addr))
+        {
+            /* Not in the shadow, it may have been full */
+            release[i].type = SAI_FDB_EVENT_LEARNED;
+            release[i].port = l2addr.port;
+        }
+        else
+        {
+            release[i].type = SAI_FDB_EVENT_AGED;
+        }
+        _brcm_sai_fdb_event_fill(&release[i],
+                                 &_brcm_sai_fdb_events.notify[i %
+                                     _BRCM_SAI_FDB_EVENT_BATCH_MAX],
+                                 &_brcm_sai_fdb_events.attrs[i %
+                                     _BRCM_SAI_FDB_EVENT_BATCH_MAX]);
+        notify = host_callbacks.on_fdb_event;
+        if ((NULL != notify) &&
+            (((i + 1) == count) ||
+             (0 == ((i + 1) % _BRCM_SAI_FDB_EVENT_BATCH_MAX))))
+        {
+            notify((i % _BRCM_SAI_FDB_EVENT_BATCH_MAX) + 1,
+                   _brcm_sai_fdb_events.notify);
+        }
+    }
+    CHECK_FREE(release);
+}
+
+/*
+ * Routine to deliver the queued events in notifications of up to a batch.
+ * Released MACs queued before an event go out ahead of it.
+ */
+STATIC void
+_brcm_sai_fdb_event_deliver(void)
+{
+    int i;
+    sai_uint32_t head, tail, batch, count;
+    uint64_t drops;
+    sai_fdb_event_notification_fn notify;
+
+    tail = _brcm_sai_fdb_events.tail;
+    head = __atomic_load_n(&_brcm_sai_fdb_events.head, __ATOMIC_SEQ_CST);
+    while ((head != tail) ||
+           __atomic_load_n(&_brcm_sai_fdb_events.released, __ATOMIC_ACQUIRE))
+    {
+        if (__atomic_load_n(&_brcm_sai_fdb_events.released, __ATOMIC_ACQUIRE))
+        {
+            _brcm_sai_fdb_event_release_deliver();
+        }
+        batch = __atomic_load_n(&_brcm_sai_fdb_events.batch, __ATOMIC_RELAXED);
+        if (0 == batch)
+        {
+            /* Running for damping only, or stopping and flushing the rest
+               in full size notifications */
+            batch = __atomic_load_n(&_brcm_sai_fdb_events.thread_run,
+                                    __ATOMIC_ACQUIRE) ?
+                    1 : _BRCM_SAI_FDB_EVENT_BATCH_MAX;
+        }
+        count = ((head - tail) < batch) ? (head - tail) : batch;
+        for (i=0; i<count; i++)
+        {
+            _brcm_sai_fdb_event_fill(
+                &_brcm_sai_fdb_events.ring[(tail + i) &
+                                           _brcm_sai_fdb_events.mask],
+                &_brcm_sai_fdb_events.notify[i],
+                &_brcm_sai_fdb_events.attrs[i]);
+        }
+        tail += count;
+        __atomic_store_n(&_brcm_sai_fdb_events.tail, tail, __ATOMIC_SEQ_CST);
+        notify = host_callbacks.on_fdb_event;
+        if ((NULL != notify) && count)
+        {
+            notify(count, _brcm_sai_fdb_events.notify);
+        }
+        head = __atomic_load_n(&_brcm_sai_fdb_events.head, __ATOMIC_SEQ_CST);
+    }
+    drops = __atomic_load_n(&_brcm_sai_fdb_events.drops, __ATOMIC_RELAXED);
+    if (drops != _brcm_sai_fdb_events.drops_logged)
+    {
+        BRCM_SAI_LOG_FDB(SAI_LOG_WARN, "%llu FDB events dropped, queue full\n",
+                         (unsigned long long)
+                         (drops - _brcm_sai_fdb_events.drops_logged));
+        _brcm_sai_fdb_events.drops_logged = drops;
+    }
+}
+
+/* FDB event dispatcher thread */
+STATIC void *
+_brcm_sai_fdb_event_thread(void *arg)
+{
+    struct timespec ts;
+    sai_uint32_t delay, count;
+
+    while (__atomic_load_n(&_brcm_sai_fdb_events.thread_run,
+                           __ATOMIC_ACQUIRE))
+    {
+        count = __atomic_load_n(&_brcm_sai_fdb_events.head, __ATOMIC_SEQ_CST) -
+                _brcm_sai_fdb_events.tail;
+        if ((0 == count) &&
+            (0 == __atomic_load_n(&_brcm_sai_fdb_events.released,
+                                  __ATOMIC_ACQUIRE)))
+        {
+            sem_wait(&_brcm_sai_fdb_events.sem);
+            continue;
+        }
+        /* Give the batch up to the delay to fill */
+        delay = __atomic_load_n(&_brcm_sai_fdb_events.delay, __ATOMIC_RELAXED);
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += delay / 1000;
+        ts.tv_nsec += (delay % 1000) * 1000000;
+        if (ts.tv_nsec >= 1000000000)
+        {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000;
+        }
+        while ((count < __atomic_load_n(&_brcm_sai_fdb_events.batch,
+                                        __ATOMIC_RELAXED)) &&
+               __atomic_load_n(&_brcm_sai_fdb_events.thread_run,
+                               __ATOMIC_ACQUIRE) &&
+               (0 == sem_timedwait(&_brcm_sai_fdb_events.sem, &ts)))
+        {
+            count = __atomic_load_n(&_brcm_sai_fdb_events.head,
+                                    __ATOMIC_SEQ_CST) -
+                    _brcm_sai_fdb_events.tail;
+        }
+        _brcm_sai_fdb_event_deliver();
+    }
+    /* Nothing is posted any more, hand over what is left */
+    _brcm_sai_fdb_event_deliver();
+    return NULL;
+}
+
+/*
+ * Routine to stop the dispatcher. New events go straight to the host again
+ * and the dispatcher delivers the queued ones before it exits.
+ */
+STATIC void
+_brcm_sai_fdb_event_stop(void)
+{
+    if (false == _brcm_sai_fdb_events.thread_run)
+    {
+        return;
+    }
+    __atomic_store_n(&_brcm_sai_fdb_events.enabled, false, __ATOMIC_SEQ_CST);
+    /* Wait for a callback still writing into the ring */
+    while (0 != __atomic_load_n(&_brcm_sai_fdb_events.busy, __ATOMIC_SEQ_CST))
+    {
+        sched_yield();
+    }
+    __atomic_store_n(&_brcm_sai_fdb_events.thread_run, false,
+                     __ATOMIC_RELEASE);
+    sem_post(&_brcm_sai_fdb_events.sem);
+    pthread_join(_brcm_sai_fdb_events.thread, NULL);
+    sem_destroy(&_brcm_sai_fdb_events.sem);
+    CHECK_FREE(_brcm_sai_fdb_events.ring);
+    CHECK_FREE(_brcm_sai_fdb_events.notify);
+    CHECK_FREE(_brcm_sai_fdb_events.attrs);
+    CHECK_FREE(_brcm_sai_fdb_events.release);
+    _brcm_sai_fdb_events.release = NULL;
+    _brcm_sai_fdb_events.released = _brcm_sai_fdb_events.released_size = 0;
+    _brcm_sai_fdb_events.ring = NULL;
+    _brcm_sai_fdb_events.notify = NULL;
+    _brcm_sai_fdb_events.attrs = NULL;
+}
+
+/*
+ * Routine to allocate the ring and start the dispatcher. It runs while
+ * batching or damping is on, so that only one thread notifies the host.
+ */
+STATIC sai_status_t
+_brcm_sai_fdb_event_start(void)
+{
+    sai_uint32_t size;
+
+    if (_brcm_sai_fdb_events.thread_run)
+    {
+        return SAI_STATUS_SUCCESS;
+    }
+    /* Ring size must be a power of 2 for the index mask */
+    for (size = 1; size < _brcm_sai_fdb_events.depth; size <<= 1);
+    _brcm_sai_fdb_events.ring = (_brcm_sai_fdb_event_t*)
+        calloc(size, sizeof(_brcm_sai_fdb_event_t));
+    _brcm_sai_fdb_events.notify = (sai_fdb_event_notification_data_t*)
+        calloc(_BRCM_SAI_FDB_EVENT_BATCH_MAX,
+               sizeof(sai_fdb_event_notification_data_t));
+    _brcm_sai_fdb_events.attrs = (sai_attribute_t*)
+        calloc(_BRCM_SAI_FDB_EVENT_BATCH_MAX, sizeof(sai_attribute_t));
+    if ((NULL == _brcm_sai_fdb_events.ring) ||
+        (NULL == _brcm_sai_fdb_events.notify) ||
+        (NULL == _brcm_sai_fdb_events.attrs))
+    {
+        CHECK_FREE(_brcm_sai_fdb_events.ring);
+        CHECK_FREE(_brcm_sai_fdb_events.notify);
+        CHECK_FREE(_brcm_sai_fdb_events.attrs);
+        _brcm_sai_fdb_events.ring = NULL;
+        _brcm_sai_fdb_events.notify = NULL;
+        _brcm_sai_fdb_events.attrs = NULL;
+        BRCM_SAI_LOG_FDB(SAI_LOG_ERROR, "Error allocating FDB event queue\n");
+        return SAI_STATUS_NO_MEMORY;
+    }
+    _brcm_sai_fdb_events.mask = size - 1;
+    _brcm_sai_fdb_events.head = _brcm_sai_fdb_events.tail = 0;
+    if (0 != sem_init(&_brcm_sai_fdb_events.sem, 0, 0))
+    {
+        free(_brcm_sai_fdb_events.ring);
+        free(_brcm_sai_fdb_events.notify);
+        free(_brcm_sai_fdb_events.attrs);
+        _brcm_sai_fdb_events.ring = NULL;
+        _brcm_sai_fdb_events.notify = NULL;
+        _brcm_sai_fdb_events.attrs = NULL;
+        BRCM_SAI_LOG_FDB(SAI_LOG_ERROR, "Error creating FDB semaphore\n");
+        return SAI_STATUS_FAILURE;
+    }
+    _brcm_sai_fdb_events.thread_run = true;
+    if (0 != pthread_create(&_brcm_sai_fdb_events.thread, NULL,
+                            _brcm_sai_fdb_event_thread, NULL))
+    {
+        _brcm_sai_fdb_events.thread_run = false;
+        sem_destroy(&_brcm_sai_fdb_events.sem);
+        free(_brcm_sai_fdb_events.ring);
+        free(_brcm_sai_fdb_events.notify);
+        free(_brcm_sai_fdb_events.attrs);
+        _brcm_sai_fdb_events.ring = NULL;
+        _brcm_sai_fdb_events.notify = NULL;
+        _brcm_sai_fdb_events.attrs = NULL;
+        BRCM_SAI_LOG_FDB(SAI_LOG_ERROR, "Error creating FDB event thread\n");
+        return SAI_STATUS_FAILURE;
+    }
+    __atomic_store_n(&_brcm_sai_fdb_events.enabled, true, __ATOMIC_SEQ_CST);
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Routine to handle the FDB switch attributes */
+sai_status_t
+_brcm_sai_fdb_switch_attr_set(const sai_attribute_t *attr)
+{
+    sai_status_t rv = SAI_STATUS_SUCCESS;
+
+    switch (attr->id)
+    {
+        case SAI_SWITCH_ATTR_BRCM_FDB_EVENT_BATCH:
+            if (attr->value.u32 > _BRCM_SAI_FDB_EVENT_BATCH_MAX)
+            {
+                return SAI_STATUS_INVALID_ATTR_VALUE_0;
+            }
+            if (0 == attr->value.u32)
+            {
+                if (false == _BRCM_SAI_FDB_DAMPING())
+                {
+                    _brcm_sai_fdb_event_stop();
+                }
+                __atomic_store_n(&_brcm_sai_fdb_events.batch, 0,
+                                 __ATOMIC_RELAXED);
+                break;
+            }
+            __atomic_store_n(&_brcm_sai_fdb_events.batch, attr->value.u32,
+                             __ATOMIC_RELAXED);
+            rv = _brcm_sai_fdb_event_start();
+            if (SAI_STATUS_SUCCESS != rv)
+            {
+                __atomic_store_n(&_brcm_sai_fdb_events.batch, 0,
+                                 __ATOMIC_RELAXED);
+                break;
+            }
+            /* A smaller batch may already be full */
+            sem_post(&_brcm_sai_fdb_events.sem);
+            break;
+        case SAI_SWITCH_ATTR_BRCM_FDB_EVENT_DELAY:
+            __atomic_store_n(&_brcm_sai_fdb_events.delay, attr->value.u32,
+                             __ATOMIC_RELAXED);
+            break;
+        case SAI_SWITCH_ATTR_BRCM_FDB_EVENT_DEPTH:
+            if (_brcm_sai_fdb_events.thread_run)
+            {
+                BRCM_SAI_LOG_FDB(SAI_LOG_ERROR, "FDB event queue depth can't "
+                                 "change while in use\n");
+                return SAI_STATUS_OBJECT_IN_USE;
+            }
+            if (0 == attr->value.u32)
+            {
+                return SAI_STATUS_INVALID_ATTR_VALUE_0;
+            }
+            _brcm_sai_fdb_events.depth = attr->value.u32;
+            break;
+        case SAI_SWITCH_ATTR_BRCM_FDB_VERIFY:
+            _BRCM_SAI_FDB_LOCK();
+            _brcm_sai_fdb_shadow.verify = attr->value.booldata;
+            _BRCM_SAI_FDB_UNLOCK();
+            break;
+        case SAI_SWITCH_ATTR_BRCM_FDB_MOVE_THRESHOLD:
+            if (0 == attr->value.u32)
+            {
+                _brcm_sai_fdb_damp_stop(true);
+                __atomic_store_n(&_brcm_sai_fdb_damp.threshold, 0,
+                                 __ATOMIC_RELEASE);
+                if (0 == __atomic_load_n(&_brcm_sai_fdb_events.batch,
+                                         __ATOMIC_RELAXED))
+                {
+                    /* The released MACs are delivered before it exits */
+                    _brcm_sai_fdb_event_stop();
+                }
+                break;
+            }
+            /* Released MACs are reported through the dispatcher */
+            rv = _brcm_sai_fdb_event_start();
+            if (SAI_STATUS_SUCCESS != rv)
+            {
+                break;
+            }
+            _BRCM_SAI_FDB_DAMP_LOCK();
+            __atomic_store_n(&_brcm_sai_fdb_damp.threshold, attr->value.u32,
+                             __ATOMIC_RELEASE);
+            rv = _brcm_sai_fdb_damp_start();
+            if (SAI_STATUS_SUCCESS != rv)
+            {
+                __atomic_store_n(&_brcm_sai_fdb_damp.threshold, 0,
+                                 __ATOMIC_RELEASE);
+            }
+            _BRCM_SAI_FDB_DAMP_UNLOCK();
+            if ((SAI_STATUS_SUCCESS != rv) &&
+                (0 == __atomic_load_n(&_brcm_sai_fdb_events.batch,
+                                      __ATOMIC_RELAXED)))
+            {
+                _brcm_sai_fdb_event_stop();
+            }
+            break;
+        case SAI_SWITCH_ATTR_BRCM_FDB_MOVE_WINDOW:
+            if (0 == attr->value.u32)
+            {
+                return SAI_STATUS_INVALID_ATTR_VALUE_0;
+            }
+            _BRCM_SAI_FDB_DAMP_LOCK();
+            _brcm_sai_fdb_damp.window = attr->value.u32;
+            _BRCM_SAI_FDB_DAMP_UNLOCK();
+            break;
+        case SAI_SWITCH_ATTR_BRCM_FDB_MOVE_HOLD:
+            _BRCM_SAI_FDB_DAMP_LOCK();
+            _brcm_sai_fdb_damp.hold = attr->value.u32;
+            _BRCM_SAI_FDB_DAMP_UNLOCK();
+            break;
+        case SAI_SWITCH_ATTR_BRCM_FDB_MOVE_PIN:
+            _BRCM_SAI_FDB_DAMP_LOCK();
+            _brcm_sai_fdb_damp.pin = attr->value.booldata;
+            _BRCM_SAI_FDB_DAMP_UNLOCK();
+            break;
+        default:
+            rv = SAI_STATUS_INVALID_PARAMETER;
+            break;
+    }
+    return rv;
+}
+
+/* Routine to get the FDB switch attributes */
+sai_status_t
+_brcm_sai_fdb_switch_attr_get(sai_attribute_t *attr)
+{
+    sai_status_t rv = SAI_STATUS_SUCCESS;
+
+    switch (attr->id)
+    {
+        case SAI_SWITCH_ATTR_BRCM_FDB_EVENT_BATCH:
+            attr->value.u32 = __atomic_load_n(&_brcm_sai_fdb_events.batch,
+                                              __ATOMIC_RELAXED);
+            break;
+        case SAI_SWITCH_ATTR_BRCM_FDB_EVENT_DELAY:
+            attr->value.u32 = __atomic_load_n(&_brcm_sai_fdb_events.delay,
+                                              __ATOMIC_RELAXED);
+            break;
+        case SAI_SWITCH_ATTR_BRCM_FDB_EVENT_DEPTH:
+            attr->value.u32 = _brcm_sai_fdb_events.depth;
+            break;
+        case SAI_SWITCH_ATTR_BRCM_FDB_EVENT_DROPS:
+            attr->value.u64 = __atomic_load_n(&_brcm_sai_fdb_events.drops,
+                                              __ATOMIC_RELAXED);
+            break;
+        case SAI_SWITCH_ATTR_BRCM_FDB_VERIFY:
+            _BRCM_SAI_FDB_LOCK();
+            attr->value.booldata = _brcm_sai_fdb_shadow.verify;
+            _BRCM_SAI_FDB_UNLOCK();
+            break;
+        case SAI_SWITCH_ATTR_BRCM_FDB_MOVE_THRESHOLD:
+            attr->value.u32 = __atomic_load_n(&_brcm_sai_fdb_damp.threshold,
+                                              __ATOMIC_ACQUIRE);
+            break;
+        case SAI_SWITCH_ATTR_BRCM_FDB_MOVE_WINDOW:
+            _BRCM_SAI_FDB_DAMP_LOCK();
+            attr->value.u32 = _brcm_sai_fdb_damp.window;
+            _BRCM_SAI_FDB_DAMP_UNLOCK();
+            break;
+        case SAI_SWITCH_ATTR_BRCM_FDB_MOVE_HOLD:
+            _BRCM_SAI_FDB_DAMP_LOCK();
+            attr->value.u32 = _brcm_sai_fdb_damp.hold;
+            _BRCM_SAI_FDB_DAMP_UNLOCK();
+            break;
+        case SAI_SWITCH_ATTR_BRCM_FDB_MOVE_PIN:
+            _BRCM_SAI_FDB_DAMP_LOCK();
+            attr->value.booldata = _brcm_sai_fdb_damp.pin;
+            _BRCM_SAI_FDB_DAMP_UNLOCK();
+            break;
+        case SAI_SWITCH_ATTR_BRCM_FDB_MOVE_DAMPED:
+            _BRCM_SAI_FDB_DAMP_LOCK();
+            attr->value.u32 = _brcm_sai_fdb_damp.damped;
+            _BRCM_SAI_FDB_DAMP_UNLOCK();
+            break;
+        default:
+            rv = SAI_STATUS_INVALID_PARAMETER;
+            break;
+    }
+    return rv;
+}
+
+/* Routine to set up the FDB shadow before the SDK callback fills it */
+sai_status_t
+_brcm_sai_fdb_init(void)
+{
+    sai_status_t rv;
+
+    _BRCM_SAI_FDB_LOCK();
+    _brcm_sai_fdb_shadow_grow();
+    rv = (NULL != _brcm_sai_fdb_shadow.slots) ? SAI_STATUS_SUCCESS :
+                                                SAI_STATUS_NO_MEMORY;
+    _BRCM_SAI_FDB_UNLOCK();
+    return rv;
+}
+
+/* Routine to free FDB state, pinned MACs are left as they are */
+void
+_brcm_sai_free_fdb(void)
+{
+    _brcm_sai_fdb_damp_stop(false);
+    _BRCM_SAI_FDB_DAMP_LOCK();
+    __atomic_store_n(&_brcm_sai_fdb_damp.threshold, 0, __ATOMIC_RELEASE);
+    _brcm_sai_fdb_damp.window = _BRCM_SAI_FDB_MOVE_WINDOW;
+    _brcm_sai_fdb_damp.hold = _BRCM_SAI_FDB_MOVE_HOLD;
+    _brcm_sai_fdb_damp.pin = false;
+    _brcm_sai_fdb_damp.reported = 0;
+    _BRCM_SAI_FDB_DAMP_UNLOCK();
+    _brcm_sai_fdb_event_stop();
+    _brcm_sai_fdb_events.batch = 0;
+    _brcm_sai_fdb_events.delay = _BRCM_SAI_FDB_EVENT_DELAY;
+    _brcm_sai_fdb_events.depth = _BRCM_SAI_FDB_EVENT_DEPTH;
+    _brcm_sai_fdb_events.drops = _brcm_sai_fdb_events.drops_logged = 0;
+    _BRCM_SAI_FDB_LOCK();
+    CHECK_FREE(_brcm_sai_fdb_shadow.slots);
+    memset(&_brcm_sai_fdb_shadow, 0, sizeof(_brcm_sai_fdb_shadow));
+    _BRCM_SAI_FDB_UNLOCK();
 }
 
 /*
@@ -21,7 +21,95 @@
 
 /*
 ################################################################################
-#                        Router interface functions                            #
+#                                Local state                                   #
+################################################################################
+*/
+#define _BRCM_SAI_NBR_LIST_MIN  256
+#define _BRCM_SAI_NBR_BUCKETS   16384
+#define _BRCM_SAI_NBR_SCAN_BATCH 256
+#define _BRCM_SAI_NBR_ATTRS_MAX  4
+
+/*
+ * Neighbor programmed through the adapter, hashed by router interface and
+ * IP. It holds the handles of the host entry and its egress object so that
+ * attribute changes are made in place and reads never reach the hardware.
+ */
+typedef struct _brcm_sai_nbr_s {
+    struct _brcm_sai_nbr_s *next;
+    sai_neighbor_entry_t key;                   /* Unused address bytes 0 */
+    opennsl_vrf_t vrf;                          /* Host entry */
+    bool host;                                  /* Host entry and egr found */
+    opennsl_if_t egr;
+    sai_mac_t mac;
+    sai_packet_action_t action;
+    bool no_host_route;
+    sai_uint32_t meta_data;
+    uint64_t last_hit;                          /* Monotonic msec */
+    bool idle;                                  /* Reported, not hit since */
+} _brcm_sai_nbr_t;
+
+/* Hit bit scan of the neighbor host entries */
+typedef struct _brcm_sai_nbr_scan_s {
+    bool thread_run;
+    pthread_t thread;
+    pthread_cond_t cond;
+    sai_uint32_t interval;                      /* msec, 0 when stopped */
+    sai_uint32_t batch;
+    sai_uint32_t idle_timeout;                  /* sec, 0 for no reports */
+    sai_uint32_t cursor;                        /* Next bucket to scan */
+    brcm_sai_neighbor_idle_notification_fn notify;
+} _brcm_sai_nbr_scan_t;
+
+static pthread_mutex_t _brcm_sai_nbr_mutex = PTHREAD_MUTEX_INITIALIZER;
+static _brcm_sai_nbr_t **_brcm_sai_nbr_table;
+static _brcm_sai_nbr_scan_t _brcm_sai_nbr_scan = {
+    .cond = PTHREAD_COND_INITIALIZER,
+    .batch = _BRCM_SAI_NBR_SCAN_BATCH,
+};
+
+#define _BRCM_SAI_NBR_LOCK()   pthread_mutex_lock(&_brcm_sai_nbr_mutex)
+#define _BRCM_SAI_NBR_UNLOCK() pthread_mutex_unlock(&_brcm_sai_nbr_mutex)
+
+/*
+################################################################################
+#                             Forward declarations                             #
+################################################################################
+*/
+STATIC sai_status_t
+_brcm_sai_nbr_vrf_get(sai_object_id_t rif_id, opennsl_vrf_t *vrf);
+STATIC sai_status_t
+_brcm_sai_nbr_create(const sai_neighbor_entry_t *neighbor_entry,
+                     opennsl_vrf_t vrf, uint32_t attr_count,
+                     const sai_attribute_t *attr_list);
+STATIC sai_status_t
+_brcm_sai_nbr_add(const sai_neighbor_entry_t *neighbor_entry,
+                  opennsl_vrf_t vrf, uint32_t attr_count,
+                  const sai_attribute_t *attr_list);
+STATIC void
+_brcm_sai_nbr_delete(const sai_neighbor_entry_t *neighbor_entry);
+STATIC void
+_brcm_sai_nbr_unlink(const sai_neighbor_entry_t *neighbor_entry);
+STATIC _brcm_sai_nbr_t **
+_brcm_sai_nbr_find(const sai_neighbor_entry_t *key);
+STATIC void
+_brcm_sai_nbr_key_get(const sai_neighbor_entry_t *neighbor_entry,
+                      sai_neighbor_entry_t *key);
+STATIC uint64_t
+_brcm_sai_nbr_now(void);
+STATIC void
+_brcm_sai_nbr_attr_parse(_brcm_sai_nbr_t *nbr, uint32_t attr_count,
+                         const sai_attribute_t *attr_list);
+STATIC void
+_brcm_sai_nbr_handles_get(_brcm_sai_nbr_t *nbr);
+STATIC sai_status_t
+_brcm_sai_nbr_egr_update(_brcm_sai_nbr_t *nbr, const sai_mac_t mac,
+                         sai_packet_action_t action);
+STATIC sai_status_t
+_brcm_sai_nbr_recreate(_brcm_sai_nbr_t *nbr, const sai_attribute_t *attr);
+
+/*
+################################################################################
+#                            Neighbor functions                                #
 ################################################################################
 */
 
@@ -43,9 +131,20 @@ brcm_sai_create_neighbor_entry(_In_ const sai_neighbor_entry_t* neighbor_entry,
                                _In_ uint32_t attr_count,
                                _In_ const sai_attribute_t *attr_list)
 {
-    return _brcm_sai_create_neighbor_entry(neighbor_entry,
-                                           attr_count,
-                                           attr_list);
+    sai_status_t rv;
+    opennsl_vrf_t vrf;
+
+    if (NULL == neighbor_entry)
+    {
+        BRCM_SAI_LOG_NBOR(SAI_LOG_ERROR, "NULL neighbor entry passed\n");
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+    rv = _brcm_sai_nbr_vrf_get(neighbor_entry->rif_id, &vrf);
+    if (SAI_STATUS_SUCCESS != rv)
+    {
+        return rv;
+    }
+    return _brcm_sai_nbr_create(neighbor_entry, vrf, attr_count, attr_list);
 }
 
 /*
@@ -62,7 +161,15 @@ brcm_sai_create_neighbor_entry(_In_ const sai_neighbor_entry_t* neighbor_entry,
 STATIC sai_status_t
 brcm_sai_remove_neighbor_entry(_In_ const sai_neighbor_entry_t* neighbor_entry)
 {
-    return _brcm_sai_remove_neighbor_entry(neighbor_entry);
+    sai_status_t rv;
+
+    rv = _brcm_sai_remove_neighbor_entry(neighbor_entry);
+    if (SAI_STATUS_SUCCESS == rv)
+    {
+        _brcm_sai_nbr_delete(neighbor_entry);
+        _brcm_sai_deps_unref(neighbor_entry->rif_id, SAI_NULL_OBJECT_ID);
+    }
+    return rv;
 }
 
 /*
@@ -81,12 +188,90 @@ STATIC sai_status_t
 brcm_sai_set_neighbor_attribute(_In_ const sai_neighbor_entry_t* neighbor_entry,
                                 _In_ const sai_attribute_t *attr)
 {
-    sai_status_t rv = SAI_STATUS_NOT_IMPLEMENTED;
+    bool mac_changed = false;
+    sai_mac_t old_mac;
+    sai_status_t rv = SAI_STATUS_SUCCESS;
+    sai_neighbor_entry_t key;
+    _brcm_sai_nbr_t *nbr;
 
     BRCM_SAI_FUNCTION_ENTER(SAI_API_NEIGHBOR);
 
     BRCM_SAI_SWITCH_INIT_CHECK;
 
+    if ((NULL == neighbor_entry) || (NULL == attr))
+    {
+        BRCM_SAI_LOG_NBOR(SAI_LOG_ERROR, "NULL params passed\n");
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+    _brcm_sai_nbr_key_get(neighbor_entry, &key);
+    _BRCM_SAI_NBR_LOCK();
+    nbr = (NULL != _brcm_sai_nbr_table) ? *_brcm_sai_nbr_find(&key) : NULL;
+    if (NULL == nbr)
+    {
+        _BRCM_SAI_NBR_UNLOCK();
+        return SAI_STATUS_ITEM_NOT_FOUND;
+    }
+    memcpy(old_mac, nbr->mac, sizeof(sai_mac_t));
+    switch (attr->id)
+    {
+        case SAI_NEIGHBOR_ATTR_DST_MAC_ADDRESS:
+            if (0 == memcmp(nbr->mac, attr->value.mac, sizeof(sai_mac_t)))
+            {
+                break;
+            }
+            /* A host move only rewrites the egress object */
+            rv = nbr->host ?
+                 _brcm_sai_nbr_egr_update(nbr, attr->value.mac, nbr->action) :
+                 _brcm_sai_nbr_recreate(nbr, attr);
+            mac_changed = (SAI_STATUS_SUCCESS == rv);
+            break;
+        case SAI_NEIGHBOR_ATTR_PACKET_ACTION:
+            switch (attr->value.s32)
+            {
+                case SAI_PACKET_ACTION_FORWARD:
+                case SAI_PACKET_ACTION_LOG:
+                case SAI_PACKET_ACTION_TRAP:
+                case SAI_PACKET_ACTION_DROP:
+                    break;
+                default:
+                    rv = SAI_STATUS_INVALID_ATTR_VALUE_0;
+                    break;
+            }
+            if ((SAI_STATUS_SUCCESS != rv) || (nbr->action == attr->value.s32))
+            {
+                break;
+            }
+            rv = nbr->host ?
+                 _brcm_sai_nbr_egr_update(nbr, nbr->mac, attr->value.s32) :
+                 _brcm_sai_nbr_recreate(nbr, attr);
+            break;
+        case SAI_NEIGHBOR_ATTR_NO_HOST_ROUTE:
+            if (nbr->no_host_route != attr->value.booldata)
+            {
+                rv = _brcm_sai_nbr_recreate(nbr, attr);
+            }
+            break;
+        case SAI_NEIGHBOR_ATTR_META_DATA:
+            if (nbr->meta_data != attr->value.u32)
+            {
+                rv = _brcm_sai_nbr_recreate(nbr, attr);
+            }
+            break;
+        default:
+            BRCM_SAI_LOG_NBOR(SAI_LOG_ERROR,
+                              "Unknown neighbor attribute %d passed\n",
+                              attr->id);
+            rv = SAI_STATUS_INVALID_ATTRIBUTE_0;
+            break;
+    }
+    _BRCM_SAI_NBR_UNLOCK();
+    if (mac_changed)
+    {
+        /* Next hops resolved through the neighbor follow it */
+        _brcm_sai_nh_mac_update(key.rif_id, &key.ip_address, old_mac,
+                                attr->value.mac);
+    }
+
     BRCM_SAI_FUNCTION_EXIT(SAI_API_NEIGHBOR);
 
     return rv;
@@ -110,12 +295,64 @@ brcm_sai_get_neighbor_attribute(_In_ const sai_neighbor_entry_t* neighbor_entry,
                                 _In_ uint32_t attr_count,
                                 _Inout_ sai_attribute_t *attr_list)
 {
-    sai_status_t rv = SAI_STATUS_NOT_IMPLEMENTED;
+    int i;
+    uint64_t now;
+    sai_status_t rv = SAI_STATUS_SUCCESS;
+    sai_neighbor_entry_t key;
+    _brcm_sai_nbr_t *nbr;
 
     BRCM_SAI_FUNCTION_ENTER(SAI_API_NEIGHBOR);
 
     BRCM_SAI_SWITCH_INIT_CHECK;
 
+    if ((NULL == neighbor_entry) || (0 == attr_count) || (NULL == attr_list))
+    {
+        BRCM_SAI_LOG_NBOR(SAI_LOG_ERROR, "NULL params passed\n");
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+    _brcm_sai_nbr_key_get(neighbor_entry, &key);
+    now = _brcm_sai_nbr_now();
+    _BRCM_SAI_NBR_LOCK();
+    nbr = (NULL != _brcm_sai_nbr_table) ? *_brcm_sai_nbr_find(&key) : NULL;
+    if (NULL == nbr)
+    {
+        _BRCM_SAI_NBR_UNLOCK();
+        return SAI_STATUS_ITEM_NOT_FOUND;
+    }
+    for (i=0; i<attr_count; i++)
+    {
+        switch (attr_list[i].id)
+        {
+            case SAI_NEIGHBOR_ATTR_DST_MAC_ADDRESS:
+                memcpy(attr_list[i].value.mac, nbr->mac, sizeof(sai_mac_t));
+                break;
+            case SAI_NEIGHBOR_ATTR_PACKET_ACTION:
+                attr_list[i].value.s32 = nbr->action;
+                break;
+            case SAI_NEIGHBOR_ATTR_NO_HOST_ROUTE:
+                attr_list[i].value.booldata = nbr->no_host_route;
+                break;
+            case SAI_NEIGHBOR_ATTR_META_DATA:
+                attr_list[i].value.u32 = nbr->meta_data;
+                break;
+            case SAI_NEIGHBOR_ATTR_BRCM_IDLE_TIME:
+                attr_list[i].value.u32 =
+                    (sai_uint32_t)((now - nbr->last_hit) / 1000);
+                break;
+            default:
+                BRCM_SAI_LOG_NBOR(SAI_LOG_ERROR,
+                                  "Unknown neighbor attribute %d passed\n",
+                                  attr_list[i].id);
+                rv = SAI_STATUS_UNKNOWN_ATTRIBUTE_0 + i;
+                break;
+        }
+        if (SAI_STATUS_SUCCESS != rv)
+        {
+            break;
+        }
+    }
+    _BRCM_SAI_NBR_UNLOCK();
+
     BRCM_SAI_FUNCTION_EXIT(SAI_API_NEIGHBOR);
 
     return rv;
@@ -135,17 +372,872 @@ brcm_sai_get_neighbor_attribute(_In_ const sai_neighbor_entry_t* neighbor_entry,
 STATIC sai_status_t
 brcm_sai_remove_all_neighbor_entries(void)
 {
-    sai_status_t rv = SAI_STATUS_NOT_IMPLEMENTED;
+    int i, count = 0, size = 0;
+    sai_status_t status, ret = SAI_STATUS_SUCCESS;
+    sai_neighbor_entry_t *entries = NULL, *grown;
+    _brcm_sai_nbr_t *nbr;
 
     BRCM_SAI_FUNCTION_ENTER(SAI_API_NEIGHBOR);
 
     BRCM_SAI_SWITCH_INIT_CHECK;
 
+    /*
+     * Collect the neighbors, NO_HOST_ROUTE ones included, and remove them
+     * after the walk as removing one takes the neighbor lock.
+     */
+    _BRCM_SAI_NBR_LOCK();
+    for (i=0; (NULL != _brcm_sai_nbr_table) && (i<_BRCM_SAI_NBR_BUCKETS); i++)
+    {
+        for (nbr = _brcm_sai_nbr_table[i]; NULL != nbr; nbr = nbr->next)
+        {
+            if (count == size)
+            {
+                size = size ? (size * 2) : _BRCM_SAI_NBR_LIST_MIN;
+                grown = (sai_neighbor_entry_t*)realloc(entries,
+                            size * sizeof(sai_neighbor_entry_t));
+                if (NULL == grown)
+                {
+                    _BRCM_SAI_NBR_UNLOCK();
+                    CHECK_FREE(entries);
+                    BRCM_SAI_LOG_NBOR(SAI_LOG_ERROR, "Error with alloc %d\n",
+                                      size);
+                    return SAI_STATUS_NO_MEMORY;
+                }
+                entries = grown;
+            }
+            entries[count++] = nbr->key;
+        }
+    }
+    _BRCM_SAI_NBR_UNLOCK();
+    for (i=0; i<count; i++)
+    {
+        status = brcm_sai_remove_neighbor_entry(&entries[i]);
+        if (SAI_STATUS_SUCCESS != status)
+        {
+            BRCM_SAI_LOG_NBOR(SAI_LOG_ERROR, "Error %d removing neighbor\n",
+                              status);
+            ret = status;
+        }
+    }
+    BRCM_SAI_LOG_NBOR(SAI_LOG_DEBUG, "Removed %d neighbors, status %d\n",
+                      count, ret);
+    CHECK_FREE(entries);
+
     BRCM_SAI_FUNCTION_EXIT(SAI_API_NEIGHBOR);
 
+    return ret;
+}
+
+/*
+* Routine Description:
+*    Create a batch of neighbor entries
+*
+* Arguments:
+*    [in] object_count - number of neighbor entries
+*    [in] neighbor_entries - array of neighbor entries
+*    [in] attr_count - per neighbor number of attributes
+*    [in] attr_list - per neighbor array of attributes
+*    [out] object_statuses - per neighbor status
+*
+* Return Values:
+*    SAI_STATUS_SUCCESS if all the neighbor entries were created
+*    SAI_STATUS_FAILURE if any neighbor entry failed
+*    Failure status code on error
+*/
+sai_status_t
+brcm_sai_bulk_create_neighbor_entry(_In_ uint32_t object_count,
+                                    _In_ const sai_neighbor_entry_t *neighbor_entries,
+                                    _In_ const uint32_t *attr_count,
+                                    _In_ const sai_attribute_t **attr_list,
+                                    _Out_ sai_status_t *object_statuses)
+{
+    int i;
+    opennsl_vrf_t vrf = 0;
+    sai_object_id_t rif_id = SAI_NULL_OBJECT_ID;
+    sai_status_t rv = SAI_STATUS_INVALID_PARAMETER;
+    sai_status_t status = SAI_STATUS_SUCCESS;
+
+    BRCM_SAI_FUNCTION_ENTER(SAI_API_NEIGHBOR);
+    BRCM_SAI_SWITCH_INIT_CHECK;
+
+    if ((0 == object_count) || (NULL == neighbor_entries) ||
+        (NULL == attr_count) || (NULL == attr_list) ||
+        (NULL == object_statuses))
+    {
+        BRCM_SAI_LOG_NBOR(SAI_LOG_ERROR, "NULL params passed\n");
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+    for (i=0; i<object_count; i++)
+    {
+        object_statuses[i] = SAI_STATUS_INVALID_PARAMETER;
+        if ((NULL == attr_list[i]) || (0 == attr_count[i]))
+        {
+            status = SAI_STATUS_FAILURE;
+            continue;
+        }
+        /* Batches are mostly on one interface, look its VRF up once */
+        if ((0 == i) || (neighbor_entries[i].rif_id != rif_id))
+        {
+            rif_id = neighbor_entries[i].rif_id;
+            rv = _brcm_sai_nbr_vrf_get(rif_id, &vrf);
+        }
+        object_statuses[i] = rv;
+        if (SAI_STATUS_SUCCESS == rv)
+        {
+            object_statuses[i] =
+                _brcm_sai_nbr_create(&neighbor_entries[i], vrf,
+                                     attr_count[i], attr_list[i]);
+        }
+        if (SAI_STATUS_SUCCESS != object_statuses[i])
+        {
+            status = SAI_STATUS_FAILURE;
+        }
+    }
+    BRCM_SAI_LOG_NBOR(SAI_LOG_DEBUG, "Bulk add of %d neighbors, status %d\n",
+                      object_count, status);
+
+    BRCM_SAI_FUNCTION_EXIT(SAI_API_NEIGHBOR);
+
+    return status;
+}
+
+/*
+* Routine Description:
+*    Remove a batch of neighbor entries
+*
+* Arguments:
+*    [in] object_count - number of neighbor entries
+*    [in] neighbor_entries - array of neighbor entries
+*    [out] object_statuses - per neighbor status
+*
+* Return Values:
+*    SAI_STATUS_SUCCESS if all the neighbor entries were removed
+*    SAI_STATUS_FAILURE if any neighbor entry failed
+*    Failure status code on error
+*/
+sai_status_t
+brcm_sai_bulk_remove_neighbor_entry(_In_ uint32_t object_count,
+                                    _In_ const sai_neighbor_entry_t *neighbor_entries,
+                                    _Out_ sai_status_t *object_statuses)
+{
+    int i;
+    sai_status_t status = SAI_STATUS_SUCCESS;
+
+    BRCM_SAI_FUNCTION_ENTER(SAI_API_NEIGHBOR);
+    BRCM_SAI_SWITCH_INIT_CHECK;
+
+    if ((0 == object_count) || (NULL == neighbor_entries) ||
+        (NULL == object_statuses))
+    {
+        BRCM_SAI_LOG_NBOR(SAI_LOG_ERROR, "NULL params passed\n");
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+    for (i=0; i<object_count; i++)
+    {
+        object_statuses[i] =
+            _brcm_sai_remove_neighbor_entry(&neighbor_entries[i]);
+        if (SAI_STATUS_SUCCESS != object_statuses[i])
+        {
+            status = SAI_STATUS_FAILURE;
+            continue;
+        }
+        _brcm_sai_deps_unref(neighbor_entries[i].rif_id, SAI_NULL_OBJECT_ID);
+    }
+    /* Drop the removed neighbors from the table in one pass */
+    _BRCM_SAI_NBR_LOCK();
+    for (i=0; i<object_count; i++)
+    {
+        if (SAI_STATUS_SUCCESS == object_statuses[i])
+        {
+            _brcm_sai_nbr_unlink(&neighbor_entries[i]);
+        }
+    }
+    _BRCM_SAI_NBR_UNLOCK();
+    BRCM_SAI_LOG_NBOR(SAI_LOG_DEBUG, "Bulk delete of %d neighbors, status "
+                      "%d\n", object_count, status);
+
+    BRCM_SAI_FUNCTION_EXIT(SAI_API_NEIGHBOR);
+
+    return status;
+}
+
+/*
+* Routine Description:
+*    Register the idle neighbor callback
+*
+* Arguments:
+*    [in] notification - callback, NULL to unregister
+*
+* Return Values:
+*    SAI_STATUS_SUCCESS on success
+*/
+sai_status_t
+brcm_sai_neighbor_idle_notification_register(_In_
+    brcm_sai_neighbor_idle_notification_fn notification)
+{
+    BRCM_SAI_FUNCTION_ENTER(SAI_API_NEIGHBOR);
+
+    _BRCM_SAI_NBR_LOCK();
+    _brcm_sai_nbr_scan.notify = notification;
+    _BRCM_SAI_NBR_UNLOCK();
+
+    BRCM_SAI_FUNCTION_EXIT(SAI_API_NEIGHBOR);
+
+    return SAI_STATUS_SUCCESS;
+}
+
+/*
+################################################################################
+#                               Internal functions                             #
+################################################################################
+*/
+/* Routine to get the monotonic time in msec */
+STATIC uint64_t
+_brcm_sai_nbr_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000) + (ts.tv_nsec / 1000000);
+}
+
+/* Routine to get the lookup key of a neighbor, unused address bytes are 0 */
+STATIC void
+_brcm_sai_nbr_key_get(const sai_neighbor_entry_t *neighbor_entry,
+                      sai_neighbor_entry_t *key)
+{
+    memset(key, 0, sizeof(*key));
+    key->rif_id = neighbor_entry->rif_id;
+    key->ip_address.addr_family = neighbor_entry->ip_address.addr_family;
+    if (SAI_IP_ADDR_FAMILY_IPV4 == neighbor_entry->ip_address.addr_family)
+    {
+        key->ip_address.addr.ip4 = neighbor_entry->ip_address.addr.ip4;
+    }
+    else
+    {
+        memcpy(key->ip_address.addr.ip6, neighbor_entry->ip_address.addr.ip6,
+               sizeof(sai_ip6_t));
+    }
+}
+
+/* Routine to hash a neighbor key */
+STATIC sai_uint32_t
+_brcm_sai_nbr_hash(const sai_neighbor_entry_t *key)
+{
+    int i;
+    sai_uint32_t hash = 2166136261u;
+    const uint8_t *bytes = (const uint8_t*)key;
+
+    for (i=0; i<sizeof(*key); i++)
+    {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash & (_BRCM_SAI_NBR_BUCKETS - 1);
+}
+
+/*
+ * Routine to find a neighbor, returns the link pointing at it. Called with
+ * the neighbor lock held and the table allocated.
+ */
+STATIC _brcm_sai_nbr_t **
+_brcm_sai_nbr_find(const sai_neighbor_entry_t *key)
+{
+    _brcm_sai_nbr_t **link;
+
+    for (link = &_brcm_sai_nbr_table[_brcm_sai_nbr_hash(key)];
+         NULL != *link; link = &(*link)->next)
+    {
+        if (0 == memcmp(&(*link)->key, key, sizeof(*key)))
+        {
+            break;
+        }
+    }
+    return link;
+}
+
+/* Routine to record the neighbor attributes */
+STATIC void
+_brcm_sai_nbr_attr_parse(_brcm_sai_nbr_t *nbr, uint32_t attr_count,
+                         const sai_attribute_t *attr_list)
+{
+    int i;
+
+    for (i=0; i<attr_count; i++)
+    {
+        switch (attr_list[i].id)
+        {
+            case SAI_NEIGHBOR_ATTR_DST_MAC_ADDRESS:
+                memcpy(nbr->mac, attr_list[i].value.mac, sizeof(sai_mac_t));
+                break;
+            case SAI_NEIGHBOR_ATTR_PACKET_ACTION:
+                nbr->action = attr_list[i].value.s32;
+                break;
+            case SAI_NEIGHBOR_ATTR_NO_HOST_ROUTE:
+                nbr->no_host_route = attr_list[i].value.booldata;
+                break;
+            case SAI_NEIGHBOR_ATTR_META_DATA:
+                nbr->meta_data = attr_list[i].value.u32;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+/* Routine to fill in the key of the host entry of a neighbor */
+STATIC void
+_brcm_sai_nbr_host_key(const _brcm_sai_nbr_t *nbr, opennsl_l3_host_t *l3_host)
+{
+    opennsl_l3_host_t_init(l3_host);
+    l3_host->l3a_vrf = nbr->vrf;
+    if (SAI_IP_ADDR_FAMILY_IPV4 == nbr->key.ip_address.addr_family)
+    {
+        l3_host->l3a_ip_addr = ntohl(nbr->key.ip_address.addr.ip4);
+    }
+    else
+    {
+        l3_host->l3a_flags |= OPENNSL_L3_IP6;
+        memcpy(l3_host->l3a_ip6_addr, nbr->key.ip_address.addr.ip6,
+               sizeof(l3_host->l3a_ip6_addr));
+    }
+}
+
+/*
+ * Routine to look up the host entry and egress object programmed for a
+ * neighbor. Neighbors without a host entry are only changed by recreating
+ * them.
+ */
+STATIC void
+_brcm_sai_nbr_handles_get(_brcm_sai_nbr_t *nbr)
+{
+    opennsl_l3_host_t l3_host;
+
+    nbr->host = false;
+    if (nbr->no_host_route)
+    {
+        return;
+    }
+    _brcm_sai_nbr_host_key(nbr, &l3_host);
+    if ((OPENNSL_E_NONE == opennsl_l3_host_find(0, &l3_host)) &&
+        (0 == (l3_host.l3a_flags & OPENNSL_L3_MULTIPATH)))
+    {
+        nbr->egr = l3_host.l3a_intf;
+        nbr->host = true;
+    }
+}
+
+/* Routine to rewrite the egress object of a neighbor in place */
+STATIC sai_status_t
+_brcm_sai_nbr_egr_update(_brcm_sai_nbr_t *nbr, const sai_mac_t mac,
+                         sai_packet_action_t action)
+{
+    int rv;
+    opennsl_l3_egress_t l3_egr;
+
+    rv = opennsl_l3_egress_get(0, nbr->egr, &l3_egr);
+    BRCM_SAI_API_CHK(SAI_API_NEIGHBOR, "L3 egress get", rv);
+    memcpy(l3_egr.mac_addr, mac, sizeof(l3_egr.mac_addr));
+    l3_egr.flags &= ~(OPENNSL_L3_DST_DISCARD | OPENNSL_L3_COPY_TO_CPU);
+    if ((SAI_PACKET_ACTION_DROP == action) ||
+        (SAI_PACKET_ACTION_TRAP == action))
+    {
+        l3_egr.flags |= OPENNSL_L3_DST_DISCARD;
+    }
+    if ((SAI_PACKET_ACTION_LOG == action) ||
+        (SAI_PACKET_ACTION_TRAP == action))
+    {
+        l3_egr.flags |= OPENNSL_L3_COPY_TO_CPU;
+    }
+    rv = opennsl_l3_egress_create(0, OPENNSL_L3_REPLACE | OPENNSL_L3_WITH_ID,
+                                  &l3_egr, &nbr->egr);
+    BRCM_SAI_API_CHK(SAI_API_NEIGHBOR, "L3 egress replace", rv);
+    memcpy(nbr->mac, mac, sizeof(sai_mac_t));
+    nbr->action = action;
+
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Routine to build the create attributes of a neighbor, attr overrides */
+STATIC uint32_t
+_brcm_sai_nbr_attrs_build(const _brcm_sai_nbr_t *nbr,
+                          const sai_attribute_t *attr,
+                          sai_attribute_t *attrs)
+{
+    int i;
+    uint32_t count = 0;
+
+    attrs[count].id = SAI_NEIGHBOR_ATTR_DST_MAC_ADDRESS;
+    memcpy(attrs[count++].value.mac, nbr->mac, sizeof(sai_mac_t));
+    attrs[count].id = SAI_NEIGHBOR_ATTR_PACKET_ACTION;
+    attrs[count++].value.s32 = nbr->action;
+    if (nbr->no_host_route)
+    {
+        attrs[count].id = SAI_NEIGHBOR_ATTR_NO_HOST_ROUTE;
+        attrs[count++].value.booldata = true;
+    }
+    if (nbr->meta_data)
+    {
+        attrs[count].id = SAI_NEIGHBOR_ATTR_META_DATA;
+        attrs[count++].value.u32 = nbr->meta_data;
+    }
+    if (NULL == attr)
+    {
+        return count;
+    }
+    for (i=0; i<count; i++)
+    {
+        if (attrs[i].id == attr->id)
+        {
+            attrs[i] = *attr;
+            return count;
+        }
+    }
+    attrs[count++] = *attr;
+    return count;
+}
+
+/*
+ * Routine to apply a change which can't be made in place by recreating the
+ * neighbor. The previous entry is restored if the new one can't be created.
+ * Called with the neighbor lock held.
+ */
+STATIC sai_status_t
+_brcm_sai_nbr_recreate(_brcm_sai_nbr_t *nbr, const sai_attribute_t *attr)
+{
+    uint32_t count;
+    sai_status_t rv;
+    sai_attribute_t attrs[_BRCM_SAI_NBR_ATTRS_MAX];
+
+    rv = _brcm_sai_remove_neighbor_entry(&nbr->key);
+    if (SAI_STATUS_SUCCESS != rv)
+    {
+        return rv;
+    }
+    if ((SAI_NEIGHBOR_ATTR_NO_HOST_ROUTE == attr->id) &&
+        (false == attr->value.booldata))
+    {
+        /* A /32 or /128 route may be holding the host entry */
+        _brcm_sai_route_host_evict(nbr->vrf, &nbr->key.ip_address);
+    }
+    count = _brcm_sai_nbr_attrs_build(nbr, attr, attrs);
+    rv = _brcm_sai_create_neighbor_entry(&nbr->key, count, attrs);
+    if (SAI_STATUS_SUCCESS == rv)
+    {
+        _brcm_sai_nbr_attr_parse(nbr, 1, attr);
+    }
+    else
+    {
+        BRCM_SAI_LOG_NBOR(SAI_LOG_ERROR, "Error %d recreating neighbor, "
+                          "restoring it\n", rv);
+        count = _brcm_sai_nbr_attrs_build(nbr, NULL, attrs);
+        if (SAI_STATUS_SUCCESS !=
+            _brcm_sai_create_neighbor_entry(&nbr->key, count, attrs))
+        {
+            BRCM_SAI_LOG_NBOR(SAI_LOG_CRITICAL,
+                              "Error restoring neighbor\n");
+        }
+    }
+    _brcm_sai_nbr_handles_get(nbr);
+
+    return rv;
+}
+
+/* Routine to get the VRF of a neighbor's router interface */
+STATIC sai_status_t
+_brcm_sai_nbr_vrf_get(sai_object_id_t rif_id, opennsl_vrf_t *vrf)
+{
+    int rv;
+    opennsl_l3_intf_t l3_intf;
+
+    opennsl_l3_intf_t_init(&l3_intf);
+    l3_intf.l3a_intf_id = BRCM_SAI_GET_OBJ_VAL(opennsl_if_t, rif_id);
+    rv = opennsl_l3_intf_get(0, &l3_intf);
+    if (OPENNSL_E_NONE != rv)
+    {
+        BRCM_SAI_LOG_NBOR(SAI_LOG_ERROR,
+                          "Error %d getting router interface %d\n", rv,
+                          l3_intf.l3a_intf_id);
+        return BRCM_RV_OPENNSL_TO_SAI(rv);
+    }
+    *vrf = l3_intf.l3a_vrf;
+
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Routine to create a neighbor on a router interface in a known VRF */
+STATIC sai_status_t
+_brcm_sai_nbr_create(const sai_neighbor_entry_t *neighbor_entry,
+                     opennsl_vrf_t vrf, uint32_t attr_count,
+                     const sai_attribute_t *attr_list)
+{
+    sai_status_t rv;
+
+    /* A /32 or /128 route may be holding the host entry */
+    _brcm_sai_route_host_evict(vrf, &neighbor_entry->ip_address);
+    rv = _brcm_sai_create_neighbor_entry(neighbor_entry,
+                                         attr_count,
+                                         attr_list);
+    if (SAI_STATUS_SUCCESS != rv)
+    {
+        return rv;
+    }
+    rv = _brcm_sai_nbr_add(neighbor_entry, vrf, attr_count, attr_list);
+    if (SAI_STATUS_SUCCESS != rv)
+    {
+        (void)_brcm_sai_remove_neighbor_entry(neighbor_entry);
+        return rv;
+    }
+    (void)_brcm_sai_deps_ref(neighbor_entry->rif_id, SAI_NULL_OBJECT_ID);
+    return rv;
+}
+
+/* Routine to add a neighbor once its host entry is programmed */
+STATIC sai_status_t
+_brcm_sai_nbr_add(const sai_neighbor_entry_t *neighbor_entry,
+                  opennsl_vrf_t vrf, uint32_t attr_count,
+                  const sai_attribute_t *attr_list)
+{
+    _brcm_sai_nbr_t *nbr, **link;
+
+    nbr = (_brcm_sai_nbr_t*)calloc(1, sizeof(_brcm_sai_nbr_t));
+    if (NULL == nbr)
+    {
+        BRCM_SAI_LOG_NBOR(SAI_LOG_ERROR, "Error allocating neighbor\n");
+        return SAI_STATUS_NO_MEMORY;
+    }
+    _brcm_sai_nbr_key_get(neighbor_entry, &nbr->key);
+    nbr->vrf = vrf;
+    nbr->action = SAI_PACKET_ACTION_FORWARD;
+    _brcm_sai_nbr_attr_parse(nbr, attr_count, attr_list);
+    _brcm_sai_nbr_handles_get(nbr);
+    nbr->last_hit = _brcm_sai_nbr_now();
+
+    _BRCM_SAI_NBR_LOCK();
+    if (NULL == _brcm_sai_nbr_table)
+    {
+        _brcm_sai_nbr_table = (_brcm_sai_nbr_t**)
+            calloc(_BRCM_SAI_NBR_BUCKETS, sizeof(_brcm_sai_nbr_t*));
+        if (NULL == _brcm_sai_nbr_table)
+        {
+            _BRCM_SAI_NBR_UNLOCK();
+            free(nbr);
+            BRCM_SAI_LOG_NBOR(SAI_LOG_ERROR,
+                              "Error allocating neighbor table\n");
+            return SAI_STATUS_NO_MEMORY;
+        }
+    }
+    link = _brcm_sai_nbr_find(&nbr->key);
+    if (NULL != *link)
+    {
+        /* The adapter accepted a duplicate, keep the original */
+        _BRCM_SAI_NBR_UNLOCK();
+        free(nbr);
+        return SAI_STATUS_SUCCESS;
+    }
+    *link = nbr;
+    _BRCM_SAI_NBR_UNLOCK();
+
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Routine to delete a neighbor once its host entry is removed */
+STATIC void
+_brcm_sai_nbr_delete(const sai_neighbor_entry_t *neighbor_entry)
+{
+    _BRCM_SAI_NBR_LOCK();
+    _brcm_sai_nbr_unlink(neighbor_entry);
+    _BRCM_SAI_NBR_UNLOCK();
+}
+
+/* Routine to drop a neighbor from the table, called with the lock held */
+STATIC void
+_brcm_sai_nbr_unlink(const sai_neighbor_entry_t *neighbor_entry)
+{
+    sai_neighbor_entry_t key;
+    _brcm_sai_nbr_t *nbr, **link;
+
+    if (NULL == _brcm_sai_nbr_table)
+    {
+        return;
+    }
+    _brcm_sai_nbr_key_get(neighbor_entry, &key);
+    link = _brcm_sai_nbr_find(&key);
+    nbr = *link;
+    if (NULL != nbr)
+    {
+        *link = nbr->next;
+        free(nbr);
+    }
+}
+
+/*
+ * Routine to read and clear the hit bits of the next batch of neighbors.
+ * Whole buckets are scanned so a batch may run over by a few entries.
+ * Neighbors crossing the idle timeout are returned in a list for the
+ * caller to free. Called with the neighbor lock held.
+ */
+STATIC void
+_brcm_sai_nbr_scan_batch(sai_neighbor_entry_t **idle, int *idle_count)
+{
+    int rv, size = 0;
+    uint64_t now = _brcm_sai_nbr_now();
+    bool report;
+    sai_uint32_t scanned = 0, buckets = 0;
+    opennsl_l3_host_t l3_host;
+    sai_neighbor_entry_t *list;
+    _brcm_sai_nbr_t *nbr;
+
+    *idle = NULL;
+    *idle_count = 0;
+    if (NULL == _brcm_sai_nbr_table)
+    {
+        return;
+    }
+    report = (NULL != _brcm_sai_nbr_scan.notify) &&
+             (0 != _brcm_sai_nbr_scan.idle_timeout);
+    while ((scanned < _brcm_sai_nbr_scan.batch) &&
+           (buckets++ < _BRCM_SAI_NBR_BUCKETS))
+    {
+        for (nbr = _brcm_sai_nbr_table[_brcm_sai_nbr_scan.cursor];
+             NULL != nbr; nbr = nbr->next)
+        {
+            if (false == nbr->host)
+            {
+                continue;
+            }
+            scanned++;
+            _brcm_sai_nbr_host_key(nbr, &l3_host);
+            l3_host.l3a_flags |= OPENNSL_L3_HIT_CLEAR;
+            rv = opennsl_l3_host_find(0, &l3_host);
+            if (OPENNSL_E_NONE != rv)
+            {
+                continue;
+            }
+            if (l3_host.l3a_flags & OPENNSL_L3_HIT)
+            {
+                nbr->last_hit = now;
+                nbr->idle = false;
+                continue;
+            }
+            if ((false == report) || nbr->idle ||
+                ((now - nbr->last_hit) <
+                 ((uint64_t)_brcm_sai_nbr_scan.idle_timeout * 1000)))
+            {
+                continue;
+            }
+            if (*idle_count == size)
+            {
+                size = size ? (size * 2) : _BRCM_SAI_NBR_LIST_MIN;
+                list = (sai_neighbor_entry_t*)realloc(*idle,
+                           size * sizeof(sai_neighbor_entry_t));
+                if (NULL == list)
+                {
+                    /* Try again on the next pass */
+                    BRCM_SAI_LOG_NBOR(SAI_LOG_ERROR, "Error with alloc %d\n",
+                                      size);
+                    report = false;
+                    continue;
+                }
+                *idle = list;
+            }
+            nbr->idle = true;
+            (*idle)[(*idle_count)++] = nbr->key;
+        }
+        _brcm_sai_nbr_scan.cursor = (_brcm_sai_nbr_scan.cursor + 1) &
+                                    (_BRCM_SAI_NBR_BUCKETS - 1);
+    }
+}
+
+/* Hit bit scan thread */
+STATIC void *
+_brcm_sai_nbr_scan_thread(void *arg)
+{
+    int count;
+    struct timespec ts;
+    sai_neighbor_entry_t *idle;
+    brcm_sai_neighbor_idle_notification_fn notify;
+
+    _BRCM_SAI_NBR_LOCK();
+    while (_brcm_sai_nbr_scan.thread_run)
+    {
+        if (0 == _brcm_sai_nbr_scan.interval)
+        {
+            /* Stopped from the idle callback, nobody will join us */
+            _brcm_sai_nbr_scan.thread_run = false;
+            pthread_detach(pthread_self());
+            break;
+        }
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += _brcm_sai_nbr_scan.interval / 1000;
+        ts.tv_nsec += (_brcm_sai_nbr_scan.interval % 1000) * 1000000;
+        if (ts.tv_nsec >= 1000000000)
+        {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000;
+        }
+        (void)pthread_cond_timedwait(&_brcm_sai_nbr_scan.cond,
+                                     &_brcm_sai_nbr_mutex, &ts);
+        if (false == _brcm_sai_nbr_scan.thread_run)
+        {
+            break;
+        }
+        _brcm_sai_nbr_scan_batch(&idle, &count);
+        notify = _brcm_sai_nbr_scan.notify;
+        if (count && (NULL != notify))
+        {
+            /* The callback may call back into the neighbor APIs */
+            _BRCM_SAI_NBR_UNLOCK();
+            notify(count, idle);
+            _BRCM_SAI_NBR_LOCK();
+        }
+        CHECK_FREE(idle);
+    }
+    _BRCM_SAI_NBR_UNLOCK();
+    return NULL;
+}
+
+/* Routine to stop the scan thread, called without the neighbor lock */
+STATIC void
+_brcm_sai_nbr_scan_stop(void)
+{
+    bool running;
+
+    _BRCM_SAI_NBR_LOCK();
+    running = _brcm_sai_nbr_scan.thread_run;
+    _brcm_sai_nbr_scan.thread_run = false;
+    pthread_cond_signal(&_brcm_sai_nbr_scan.cond);
+    _BRCM_SAI_NBR_UNLOCK();
+    if (running)
+    {
+        pthread_join(_brcm_sai_nbr_scan.thread, NULL);
+    }
+}
+
+/* Routine to start the scan thread if needed, called with the neighbor lock */
+STATIC sai_status_t
+_brcm_sai_nbr_scan_start(void)
+{
+    if (_brcm_sai_nbr_scan.thread_run || (0 == _brcm_sai_nbr_scan.interval))
+    {
+        return SAI_STATUS_SUCCESS;
+    }
+    _brcm_sai_nbr_scan.thread_run = true;
+    if (0 != pthread_create(&_brcm_sai_nbr_scan.thread, NULL,
+                            _brcm_sai_nbr_scan_thread, NULL))
+    {
+        _brcm_sai_nbr_scan.thread_run = false;
+        BRCM_SAI_LOG_NBOR(SAI_LOG_ERROR,
+                          "Error creating neighbor scan thread\n");
+        return SAI_STATUS_FAILURE;
+    }
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Routine to handle the neighbor scan switch attributes */
+sai_status_t
+_brcm_sai_nbr_scan_set(const sai_attribute_t *attr)
+{
+    sai_status_t rv = SAI_STATUS_SUCCESS;
+
+    switch (attr->id)
+    {
+        case SAI_SWITCH_ATTR_BRCM_NEIGHBOR_SCAN_INTERVAL:
+            _BRCM_SAI_NBR_LOCK();
+            if (_brcm_sai_nbr_scan.thread_run &&
+                pthread_equal(pthread_self(), _brcm_sai_nbr_scan.thread))
+            {
+                /*
+                 * Set from the idle callback, the scan thread can not
+                 * join itself so leave it to pick the interval up.
+                 */
+                _brcm_sai_nbr_scan.interval = attr->value.u32;
+                _BRCM_SAI_NBR_UNLOCK();
+                break;
+            }
+            _BRCM_SAI_NBR_UNLOCK();
+            _brcm_sai_nbr_scan_stop();
+            _BRCM_SAI_NBR_LOCK();
+            _brcm_sai_nbr_scan.interval = attr->value.u32;
+            rv = _brcm_sai_nbr_scan_start();
+            _BRCM_SAI_NBR_UNLOCK();
+            break;
+        case SAI_SWITCH_ATTR_BRCM_NEIGHBOR_SCAN_BATCH:
+            if (0 == attr->value.u32)
+            {
+                return SAI_STATUS_INVALID_ATTR_VALUE_0;
+            }
+            _BRCM_SAI_NBR_LOCK();
+            _brcm_sai_nbr_scan.batch = attr->value.u32;
+            _BRCM_SAI_NBR_UNLOCK();
+            break;
+        case SAI_SWITCH_ATTR_BRCM_NEIGHBOR_IDLE_TIMEOUT:
+            _BRCM_SAI_NBR_LOCK();
+            _brcm_sai_nbr_scan.idle_timeout = attr->value.u32;
+            _BRCM_SAI_NBR_UNLOCK();
+            break;
+        default:
+            rv = SAI_STATUS_INVALID_PARAMETER;
+            break;
+    }
     return rv;
 }
 
+/* Routine to get the neighbor scan switch attributes */
+sai_status_t
+_brcm_sai_nbr_scan_get(sai_attribute_t *attr)
+{
+    sai_status_t rv = SAI_STATUS_SUCCESS;
+
+    _BRCM_SAI_NBR_LOCK();
+    switch (attr->id)
+    {
+        case SAI_SWITCH_ATTR_BRCM_NEIGHBOR_SCAN_INTERVAL:
+            attr->value.u32 = _brcm_sai_nbr_scan.interval;
+            break;
+        case SAI_SWITCH_ATTR_BRCM_NEIGHBOR_SCAN_BATCH:
+            attr->value.u32 = _brcm_sai_nbr_scan.batch;
+            break;
+        case SAI_SWITCH_ATTR_BRCM_NEIGHBOR_IDLE_TIMEOUT:
+            attr->value.u32 = _brcm_sai_nbr_scan.idle_timeout;
+            break;
+        default:
+            rv = SAI_STATUS_INVALID_PARAMETER;
+            break;
+    }
+    _BRCM_SAI_NBR_UNLOCK();
+    return rv;
+}
+
+/* Routine to free neighbor state, the scan is stopped */
+void
+_brcm_sai_free_nbr(void)
+{
+    int i;
+    _brcm_sai_nbr_t *nbr, *next;
+
+    _brcm_sai_nbr_scan_stop();
+    _BRCM_SAI_NBR_LOCK();
+    if (NULL != _brcm_sai_nbr_table)
+    {
+        for (i=0; i<_BRCM_SAI_NBR_BUCKETS; i++)
+        {
+            for (nbr = _brcm_sai_nbr_table[i]; NULL != nbr; nbr = next)
+            {
+                next = nbr->next;
+                free(nbr);
+            }
+        }
+        free(_brcm_sai_nbr_table);
+        _brcm_sai_nbr_table = NULL;
+    }
+    _brcm_sai_nbr_scan.interval = 0;
+    _brcm_sai_nbr_scan.batch = _BRCM_SAI_NBR_SCAN_BATCH;
+    _brcm_sai_nbr_scan.idle_timeout = 0;
+    _brcm_sai_nbr_scan.cursor = 0;
+    _brcm_sai_nbr_scan.notify = NULL;
+    _BRCM_SAI_NBR_UNLOCK();
+}
+
 /*
 ################################################################################
 #                                Functions map                                 #
@@ -19,6 +19,74 @@
 #include <sai.h>
 #include <brcm_sai_common.h>
 
+/*
+################################################################################
+#                                Local state                                   #
+################################################################################
+*/
+#define _BRCM_SAI_NH_MIN_SLOTS      256
+#define _BRCM_SAI_NH_EMPTY          0xFFFFFFFF
+
+/*
+ * Shadow of the next hops by (router interface, IP) and by egress id. The
+ * entries live in an array with a free list, two open addressing tables of
+ * entry indices find them by key and by id. Creating a next hop which
+ * already exists takes a reference on it instead of another egress object.
+ */
+typedef struct _brcm_sai_nh_s {
+    sai_object_id_t rif_id;
+    sai_ip_address_t ip;                        /* Unused bytes cleared */
+    sai_next_hop_type_t type;
+    opennsl_if_t intf;
+    sai_uint32_t ref_count;                     /* 0 for a free entry */
+    sai_uint32_t next_free;
+} _brcm_sai_nh_t;
+
+typedef struct _brcm_sai_nh_table_s {
+    _brcm_sai_nh_t *entries;
+    sai_uint32_t size;                          /* Entries */
+    sai_uint32_t count;                         /* In use */
+    sai_uint32_t free_head;
+    sai_uint32_t *by_key;                       /* Entry indices */
+    sai_uint32_t *by_id;
+    sai_uint32_t slots;                         /* Power of 2 */
+} _brcm_sai_nh_table_t;
+
+static pthread_mutex_t _brcm_sai_nh_mutex = PTHREAD_MUTEX_INITIALIZER;
+static _brcm_sai_nh_table_t _brcm_sai_nh = { NULL, 0, 0, _BRCM_SAI_NH_EMPTY,
+                                             NULL, NULL, 0 };
+
+#define _BRCM_SAI_NH_LOCK()      pthread_mutex_lock(&_brcm_sai_nh_mutex)
+#define _BRCM_SAI_NH_UNLOCK()    pthread_mutex_unlock(&_brcm_sai_nh_mutex)
+
+/*
+################################################################################
+#                             Forward declarations                             #
+################################################################################
+*/
+STATIC sai_status_t
+_brcm_sai_nh_key_get(uint32_t attr_count, const sai_attribute_t *attr_list,
+                     _brcm_sai_nh_t *key);
+STATIC sai_uint32_t
+_brcm_sai_nh_key_hash(const _brcm_sai_nh_t *nh);
+STATIC sai_uint32_t
+_brcm_sai_nh_id_hash(opennsl_if_t intf);
+STATIC bool
+_brcm_sai_nh_key_match(const _brcm_sai_nh_t *a, const _brcm_sai_nh_t *b);
+STATIC sai_uint32_t *
+_brcm_sai_nh_key_find(const _brcm_sai_nh_t *key);
+STATIC sai_uint32_t *
+_brcm_sai_nh_id_find(opennsl_if_t intf);
+STATIC sai_status_t
+_brcm_sai_nh_insert(const _brcm_sai_nh_t *nh);
+STATIC void
+_brcm_sai_nh_delete(sai_uint32_t idx);
+STATIC sai_status_t
+_brcm_sai_nh_grow(void);
+STATIC void
+_brcm_sai_nh_slot_clear(sai_uint32_t *table, sai_uint32_t *slot,
+                        bool by_key);
+
 /*
 ################################################################################
 #                                Next hop functions                            #
@@ -43,9 +111,50 @@ brcm_sai_create_next_hop(_Out_ sai_object_id_t* next_hop_id,
                          _In_ uint32_t attr_count,
                          _In_ const sai_attribute_t *attr_list)
 {
-    return _brcm_sai_create_next_hop(next_hop_id,
-                                     attr_count,
-                                     attr_list);
+    sai_status_t rv, key_rv;
+    sai_uint32_t *slot = NULL;
+    _brcm_sai_nh_t key, *nh;
+
+    /* Without a key the create reports what is wrong with the attributes */
+    key_rv = _brcm_sai_nh_key_get(attr_count, attr_list, &key);
+    _BRCM_SAI_NH_LOCK();
+    if (SAI_STATUS_SUCCESS == key_rv)
+    {
+        slot = _brcm_sai_nh_key_find(&key);
+    }
+    if ((NULL != next_hop_id) && (NULL != slot) &&
+        (_BRCM_SAI_NH_EMPTY != *slot))
+    {
+        nh = &_brcm_sai_nh.entries[*slot];
+        nh->ref_count++;
+        *next_hop_id = BRCM_SAI_CREATE_OBJ(SAI_OBJECT_TYPE_NEXT_HOP,
+                                           nh->intf);
+        BRCM_SAI_LOG_NH(SAI_LOG_DEBUG, "Reusing next hop %d, ref count %d\n",
+                        nh->intf, nh->ref_count);
+        _BRCM_SAI_NH_UNLOCK();
+        return SAI_STATUS_SUCCESS;
+    }
+    rv = _brcm_sai_create_next_hop(next_hop_id,
+                                   attr_count,
+                                   attr_list);
+    if ((SAI_STATUS_SUCCESS == rv) && (SAI_STATUS_SUCCESS == key_rv))
+    {
+        key.intf = BRCM_SAI_GET_OBJ_VAL(opennsl_if_t, *next_hop_id);
+        rv = _brcm_sai_nh_insert(&key);
+        if (SAI_STATUS_SUCCESS != rv)
+        {
+            BRCM_SAI_LOG_NH(SAI_LOG_ERROR, "Error allocating next hop "
+                            "state\n");
+            (void)opennsl_l3_egress_destroy(0, key.intf);
+        }
+    }
+    _BRCM_SAI_NH_UNLOCK();
+    if (SAI_STATUS_SUCCESS == rv)
+    {
+        /* Keeps the router interface from going away under it */
+        (void)_brcm_sai_deps_ref(key.rif_id, *next_hop_id);
+    }
+    return rv;
 }
 
 /*
@@ -63,13 +172,40 @@ STATIC sai_status_t
 brcm_sai_remove_next_hop(_In_ sai_object_id_t next_hop_id)
 {
     sai_status_t rv = SAI_STATUS_NOT_IMPLEMENTED;
+    sai_uint32_t *slot;
+    opennsl_if_t intf;
 
     BRCM_SAI_FUNCTION_ENTER(SAI_API_NEXT_HOP);
     BRCM_SAI_SWITCH_INIT_CHECK;
 
-    rv = opennsl_l3_egress_destroy(0, BRCM_SAI_GET_OBJ_VAL(opennsl_if_t,
-                                                           next_hop_id));
+    intf = BRCM_SAI_GET_OBJ_VAL(opennsl_if_t, next_hop_id);
+    _BRCM_SAI_NH_LOCK();
+    slot = _brcm_sai_nh_id_find(intf);
+    if ((NULL != slot) && (_BRCM_SAI_NH_EMPTY != *slot) &&
+        (1 < _brcm_sai_nh.entries[*slot].ref_count))
+    {
+        /* Still shared with other users */
+        _brcm_sai_nh.entries[*slot].ref_count--;
+        _BRCM_SAI_NH_UNLOCK();
+        BRCM_SAI_FUNCTION_EXIT(SAI_API_NEXT_HOP);
+        return SAI_STATUS_SUCCESS;
+    }
+    if (_brcm_sai_deps_count(next_hop_id))
+    {
+        _BRCM_SAI_NH_UNLOCK();
+        BRCM_SAI_LOG_NH(SAI_LOG_ERROR, "Next hop still used by routes or "
+                        "groups\n");
+        return SAI_STATUS_OBJECT_IN_USE;
+    }
+    rv = opennsl_l3_egress_destroy(0, intf);
+    if ((OPENNSL_E_NONE == rv) && (NULL != slot) &&
+        (_BRCM_SAI_NH_EMPTY != *slot))
+    {
+        _brcm_sai_nh_delete(*slot);
+    }
+    _BRCM_SAI_NH_UNLOCK();
     BRCM_SAI_API_CHK(SAI_API_NEXT_HOP, "L3 egress destroy", rv);
+    _brcm_sai_deps_release(next_hop_id);
 
     BRCM_SAI_FUNCTION_EXIT(SAI_API_NEXT_HOP);
 
@@ -92,11 +228,59 @@ STATIC sai_status_t
 brcm_sai_set_next_hop_attribute(_In_ sai_object_id_t next_hop_id,
                                 _In_ const sai_attribute_t *attr)
 {
-    sai_status_t rv = SAI_STATUS_NOT_IMPLEMENTED;
+    sai_status_t rv = SAI_STATUS_SUCCESS;
+    sai_uint32_t *slot;
+    _brcm_sai_nh_t key, *nh;
 
     BRCM_SAI_FUNCTION_ENTER(SAI_API_NEXT_HOP);
     BRCM_SAI_SWITCH_INIT_CHECK;
 
+    if (NULL == attr)
+    {
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+    _BRCM_SAI_NH_LOCK();
+    slot = _brcm_sai_nh_id_find(BRCM_SAI_GET_OBJ_VAL(opennsl_if_t,
+                                                     next_hop_id));
+    if ((NULL == slot) || (_BRCM_SAI_NH_EMPTY == *slot))
+    {
+        _BRCM_SAI_NH_UNLOCK();
+        return SAI_STATUS_INVALID_OBJECT_ID;
+    }
+    /* All the attributes are create only, setting the same value is fine */
+    nh = &_brcm_sai_nh.entries[*slot];
+    key = *nh;
+    switch (attr->id)
+    {
+        case SAI_NEXT_HOP_ATTR_TYPE:
+            key.type = attr->value.s32;
+            break;
+        case SAI_NEXT_HOP_ATTR_IP:
+            memset(&key.ip, 0, sizeof(key.ip));
+            key.ip.addr_family = attr->value.ipaddr.addr_family;
+            if (SAI_IP_ADDR_FAMILY_IPV4 == key.ip.addr_family)
+            {
+                key.ip.addr.ip4 = attr->value.ipaddr.addr.ip4;
+            }
+            else
+            {
+                memcpy(key.ip.addr.ip6, attr->value.ipaddr.addr.ip6,
+                       sizeof(sai_ip6_t));
+            }
+            break;
+        case SAI_NEXT_HOP_ATTR_ROUTER_INTERFACE_ID:
+            key.rif_id = attr->value.oid;
+            break;
+        default:
+            rv = SAI_STATUS_UNKNOWN_ATTRIBUTE_0;
+            break;
+    }
+    if ((SAI_STATUS_SUCCESS == rv) &&
+        ((key.type != nh->type) || !_brcm_sai_nh_key_match(&key, nh)))
+    {
+        rv = SAI_STATUS_INVALID_ATTRIBUTE_0;
+    }
+    _BRCM_SAI_NH_UNLOCK();
 
     BRCM_SAI_FUNCTION_EXIT(SAI_API_NEXT_HOP);
 
@@ -121,16 +305,379 @@ brcm_sai_get_next_hop_attribute(_In_ sai_object_id_t next_hop_id,
                                 _In_ uint32_t attr_count,
                                 _Inout_ sai_attribute_t *attr_list)
 {
-    sai_status_t rv = SAI_STATUS_NOT_IMPLEMENTED;
+    int i;
+    sai_status_t rv = SAI_STATUS_SUCCESS;
+    sai_uint32_t *slot;
+    _brcm_sai_nh_t *nh;
 
     BRCM_SAI_FUNCTION_ENTER(SAI_API_NEXT_HOP);
     BRCM_SAI_SWITCH_INIT_CHECK;
 
+    if (NULL == attr_list)
+    {
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+    _BRCM_SAI_NH_LOCK();
+    slot = _brcm_sai_nh_id_find(BRCM_SAI_GET_OBJ_VAL(opennsl_if_t,
+                                                     next_hop_id));
+    if ((NULL == slot) || (_BRCM_SAI_NH_EMPTY == *slot))
+    {
+        _BRCM_SAI_NH_UNLOCK();
+        return SAI_STATUS_INVALID_OBJECT_ID;
+    }
+    nh = &_brcm_sai_nh.entries[*slot];
+    for (i=0; (i<attr_count) && (SAI_STATUS_SUCCESS == rv); i++)
+    {
+        switch (attr_list[i].id)
+        {
+            case SAI_NEXT_HOP_ATTR_TYPE:
+                attr_list[i].value.s32 = nh->type;
+                break;
+            case SAI_NEXT_HOP_ATTR_IP:
+                attr_list[i].value.ipaddr = nh->ip;
+                break;
+            case SAI_NEXT_HOP_ATTR_ROUTER_INTERFACE_ID:
+                attr_list[i].value.oid = nh->rif_id;
+                break;
+            default:
+                rv = SAI_STATUS_UNKNOWN_ATTRIBUTE_0 + i;
+                break;
+        }
+    }
+    _BRCM_SAI_NH_UNLOCK();
+
     BRCM_SAI_FUNCTION_EXIT(SAI_API_NEXT_HOP);
 
     return rv;
 }
 
+/*
+################################################################################
+#                                Internal functions                            #
+################################################################################
+*/
+/* Routine to build the shadow key of a next hop from its attributes */
+STATIC sai_status_t
+_brcm_sai_nh_key_get(uint32_t attr_count, const sai_attribute_t *attr_list,
+                     _brcm_sai_nh_t *key)
+{
+    int i;
+    bool ip = false, rif = false;
+
+    memset(key, 0, sizeof(_brcm_sai_nh_t));
+    if (NULL == attr_list)
+    {
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+    key->type = SAI_NEXT_HOP_IP;
+    for (i=0; i<attr_count; i++)
+    {
+        switch (attr_list[i].id)
+        {
+            case SAI_NEXT_HOP_ATTR_TYPE:
+                key->type = attr_list[i].value.s32;
+                break;
+            case SAI_NEXT_HOP_ATTR_IP:
+                key->ip.addr_family = attr_list[i].value.ipaddr.addr_family;
+                if (SAI_IP_ADDR_FAMILY_IPV4 == key->ip.addr_family)
+                {
+                    key->ip.addr.ip4 = attr_list[i].value.ipaddr.addr.ip4;
+                }
+                else
+                {
+                    memcpy(key->ip.addr.ip6,
+                           attr_list[i].value.ipaddr.addr.ip6,
+                           sizeof(sai_ip6_t));
+                }
+                ip = true;
+                break;
+            case SAI_NEXT_HOP_ATTR_ROUTER_INTERFACE_ID:
+                key->rif_id = attr_list[i].value.oid;
+                rif = true;
+                break;
+            default:
+                break;
+        }
+    }
+    return (ip && rif) ? SAI_STATUS_SUCCESS :
+                         SAI_MANDATORY_ATTRIBUTE_MISSING;
+}
+
+/* Routine to hash a next hop by router interface and IP */
+STATIC sai_uint32_t
+_brcm_sai_nh_key_hash(const _brcm_sai_nh_t *nh)
+{
+    int i;
+    sai_uint32_t hash = 2166136261u;
+    const uint8_t *bytes;
+
+    bytes = (const uint8_t*)&nh->rif_id;
+    for (i=0; i<sizeof(nh->rif_id); i++)
+    {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    bytes = (const uint8_t*)&nh->ip;
+    for (i=0; i<sizeof(nh->ip); i++)
+    {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/* Routine to hash a next hop by egress id */
+STATIC sai_uint32_t
+_brcm_sai_nh_id_hash(opennsl_if_t intf)
+{
+    return (sai_uint32_t)intf * 2654435761u;
+}
+
+/* Routine to compare the keys of two next hops */
+STATIC bool
+_brcm_sai_nh_key_match(const _brcm_sai_nh_t *a, const _brcm_sai_nh_t *b)
+{
+    return (a->rif_id == b->rif_id) &&
+           (0 == memcmp(&a->ip, &b->ip, sizeof(sai_ip_address_t)));
+}
+
+/*
+ * Routine to find the key table slot of a next hop, the slot is empty when
+ * it isn't there. NULL when there is no table yet.
+ */
+STATIC sai_uint32_t *
+_brcm_sai_nh_key_find(const _brcm_sai_nh_t *key)
+{
+    sai_uint32_t pos, mask = _brcm_sai_nh.slots - 1;
+
+    if (0 == _brcm_sai_nh.slots)
+    {
+        return NULL;
+    }
+    for (pos = _brcm_sai_nh_key_hash(key) & mask;
+         _BRCM_SAI_NH_EMPTY != _brcm_sai_nh.by_key[pos];
+         pos = (pos + 1) & mask)
+    {
+        if (_brcm_sai_nh_key_match(key,
+                &_brcm_sai_nh.entries[_brcm_sai_nh.by_key[pos]]))
+        {
+            break;
+        }
+    }
+    return &_brcm_sai_nh.by_key[pos];
+}
+
+/* Routine to find the id table slot of a next hop, as above */
+STATIC sai_uint32_t *
+_brcm_sai_nh_id_find(opennsl_if_t intf)
+{
+    sai_uint32_t pos, mask = _brcm_sai_nh.slots - 1;
+
+    if (0 == _brcm_sai_nh.slots)
+    {
+        return NULL;
+    }
+    for (pos = _brcm_sai_nh_id_hash(intf) & mask;
+         _BRCM_SAI_NH_EMPTY != _brcm_sai_nh.by_id[pos];
+         pos = (pos + 1) & mask)
+    {
+        if (intf == _brcm_sai_nh.entries[_brcm_sai_nh.by_id[pos]].intf)
+        {
+            break;
+        }
+    }
+    return &_brcm_sai_nh.by_id[pos];
+}
+
+/* Routine to add a next hop to the shadow with one reference */
+STATIC sai_status_t
+_brcm_sai_nh_insert(const _brcm_sai_nh_t *nh)
+{
+    sai_uint32_t idx;
+    sai_status_t rv;
+
+    /* Keep the tables at most half full */
+    if ((_brcm_sai_nh.count + 1) * 2 > _brcm_sai_nh.slots)
+    {
+        rv = _brcm_sai_nh_grow();
+        if (SAI_STATUS_SUCCESS != rv)
+        {
+            return rv;
+        }
+    }
+    idx = _brcm_sai_nh.free_head;
+    _brcm_sai_nh.free_head = _brcm_sai_nh.entries[idx].next_free;
+    _brcm_sai_nh.entries[idx] = *nh;
+    _brcm_sai_nh.entries[idx].ref_count = 1;
+    *_brcm_sai_nh_key_find(nh) = idx;
+    *_brcm_sai_nh_id_find(nh->intf) = idx;
+    _brcm_sai_nh.count++;
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Routine to take a next hop out of the shadow */
+STATIC void
+_brcm_sai_nh_delete(sai_uint32_t idx)
+{
+    _brcm_sai_nh_t *nh = &_brcm_sai_nh.entries[idx];
+
+    _brcm_sai_nh_slot_clear(_brcm_sai_nh.by_key, _brcm_sai_nh_key_find(nh),
+                            true);
+    _brcm_sai_nh_slot_clear(_brcm_sai_nh.by_id,
+                            _brcm_sai_nh_id_find(nh->intf), false);
+    nh->ref_count = 0;
+    nh->next_free = _brcm_sai_nh.free_head;
+    _brcm_sai_nh.free_head = idx;
+    _brcm_sai_nh.count--;
+}
+
+/*
+ * Routine to empty a slot of a linear probing table, moving back the entries
+ * after it which would no longer be found.
+ */
+STATIC void
+_brcm_sai_nh_slot_clear(sai_uint32_t *table, sai_uint32_t *slot,
+                        bool by_key)
+{
+    sai_uint32_t hole, pos, home, mask = _brcm_sai_nh.slots - 1;
+    _brcm_sai_nh_t *nh;
+
+    hole = slot - table;
+    table[hole] = _BRCM_SAI_NH_EMPTY;
+    for (pos = (hole + 1) & mask; _BRCM_SAI_NH_EMPTY != table[pos];
+         pos = (pos + 1) & mask)
+    {
+        nh = &_brcm_sai_nh.entries[table[pos]];
+        home = (by_key ? _brcm_sai_nh_key_hash(nh) :
+                         _brcm_sai_nh_id_hash(nh->intf)) & mask;
+        /* Move it if its home isn't cyclically in (hole, pos] */
+        if (((pos - home) & mask) >= ((pos - hole) & mask))
+        {
+            table[hole] = table[pos];
+            table[pos] = _BRCM_SAI_NH_EMPTY;
+            hole = pos;
+        }
+    }
+}
+
+/* Routine to double the shadow and rehash the next hops */
+STATIC sai_status_t
+_brcm_sai_nh_grow(void)
+{
+    sai_uint32_t i, slots, size, *by_key, *by_id;
+    _brcm_sai_nh_t *entries;
+
+    slots = _brcm_sai_nh.slots ? (_brcm_sai_nh.slots * 2) :
+                                 _BRCM_SAI_NH_MIN_SLOTS;
+    size = slots / 2;
+    entries = (_brcm_sai_nh_t*)realloc(_brcm_sai_nh.entries,
+                                       size * sizeof(_brcm_sai_nh_t));
+    if (NULL == entries)
+    {
+        return SAI_STATUS_NO_MEMORY;
+    }
+    _brcm_sai_nh.entries = entries;
+    by_key = (sai_uint32_t*)malloc(slots * sizeof(sai_uint32_t));
+    by_id = (sai_uint32_t*)malloc(slots * sizeof(sai_uint32_t));
+    if ((NULL == by_key) || (NULL == by_id))
+    {
+        CHECK_FREE(by_key);
+        CHECK_FREE(by_id);
+        return SAI_STATUS_NO_MEMORY;
+    }
+    /* New entries go on the free list */
+    for (i=size; i>_brcm_sai_nh.size; i--)
+    {
+        entries[i-1].ref_count = 0;
+        entries[i-1].next_free = _brcm_sai_nh.free_head;
+        _brcm_sai_nh.free_head = i-1;
+    }
+    _brcm_sai_nh.size = size;
+    CHECK_FREE(_brcm_sai_nh.by_key);
+    CHECK_FREE(_brcm_sai_nh.by_id);
+    memset(by_key, 0xFF, slots * sizeof(sai_uint32_t));
+    memset(by_id, 0xFF, slots * sizeof(sai_uint32_t));
+    _brcm_sai_nh.by_key = by_key;
+    _brcm_sai_nh.by_id = by_id;
+    _brcm_sai_nh.slots = slots;
+    for (i=0; i<size; i++)
+    {
+        if (0 != entries[i].ref_count)
+        {
+            *_brcm_sai_nh_key_find(&entries[i]) = i;
+            *_brcm_sai_nh_id_find(entries[i].intf) = i;
+        }
+    }
+    return SAI_STATUS_SUCCESS;
+}
+
+/*
+ * Routine to move the next hop for a neighbor to the neighbor's new MAC.
+ * Only a next hop still using the old MAC is rewritten.
+ */
+void
+_brcm_sai_nh_mac_update(sai_object_id_t rif_id, const sai_ip_address_t *ip,
+                        const sai_mac_t old_mac, const sai_mac_t new_mac)
+{
+    int rv;
+    bool updated;
+    sai_uint32_t *slot;
+    opennsl_if_t intf;
+    opennsl_l3_egress_t l3_egr;
+    _brcm_sai_nh_t key;
+
+    memset(&key, 0, sizeof(key));
+    key.rif_id = rif_id;
+    key.ip.addr_family = ip->addr_family;
+    if (SAI_IP_ADDR_FAMILY_IPV4 == ip->addr_family)
+    {
+        key.ip.addr.ip4 = ip->addr.ip4;
+    }
+    else
+    {
+        memcpy(key.ip.addr.ip6, ip->addr.ip6, sizeof(sai_ip6_t));
+    }
+    _BRCM_SAI_NH_LOCK();
+    slot = _brcm_sai_nh_key_find(&key);
+    if ((NULL == slot) || (_BRCM_SAI_NH_EMPTY == *slot))
+    {
+        _BRCM_SAI_NH_UNLOCK();
+        return;
+    }
+    intf = _brcm_sai_nh.entries[*slot].intf;
+    rv = opennsl_l3_egress_get(0, intf, &l3_egr);
+    updated = (OPENNSL_E_NONE == rv) &&
+              (0 == memcmp(l3_egr.mac_addr, old_mac, sizeof(sai_mac_t)));
+    if (updated)
+    {
+        memcpy(l3_egr.mac_addr, new_mac, sizeof(l3_egr.mac_addr));
+        rv = opennsl_l3_egress_create(0, OPENNSL_L3_REPLACE |
+                                      OPENNSL_L3_WITH_ID, &l3_egr, &intf);
+    }
+    if (OPENNSL_E_NONE != rv)
+    {
+        BRCM_SAI_LOG_NH(SAI_LOG_ERROR, "Error %d updating next hop %d MAC\n",
+                        rv, intf);
+    }
+    _BRCM_SAI_NH_UNLOCK();
+    if (updated && (OPENNSL_E_NONE == rv))
+    {
+        /* Copies made for routes (e.g. LOG) carry the MAC too */
+        _brcm_sai_route_egr_refresh(intf);
+    }
+}
+
+/* Routine to free next hop state */
+void
+_brcm_sai_free_nh(void)
+{
+    _BRCM_SAI_NH_LOCK();
+    CHECK_FREE(_brcm_sai_nh.entries);
+    CHECK_FREE(_brcm_sai_nh.by_key);
+    CHECK_FREE(_brcm_sai_nh.by_id);
+    memset(&_brcm_sai_nh, 0, sizeof(_brcm_sai_nh));
+    _brcm_sai_nh.free_head = _BRCM_SAI_NH_EMPTY;
+    _BRCM_SAI_NH_UNLOCK();
+}
+
 /*
 ################################################################################
 #                                Functions map                                 #
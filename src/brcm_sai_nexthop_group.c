@@ -19,6 +19,164 @@
 #include <sai.h>
 #include <brcm_sai_common.h>
 
+/*
+################################################################################
+#                                Local state                                   #
+################################################################################
+*/
+#define _BRCM_SAI_NHG_BUCKETS       1024
+#define _BRCM_SAI_NHG_MAX_PATHS     64
+#define _BRCM_SAI_NHG_PORT_BUCKETS  64
+#define _BRCM_SAI_NHG_NO_PORT       -1
+
+/*
+ * Shadow of a next hop group's members in hardware order, so that members
+ * can be added and removed in place without reading the group back.
+ * Groups created shared are also hashed by their sorted member set,
+ * creating a shared group with the same members as an existing one returns
+ * the existing group with an extra reference. Other groups are private and
+ * can always be changed.
+ *
+ * Resilient and weighted groups program a table of buckets instead of their
+ * members, each member getting a share of the buckets in line with its
+ * weight. A resilient table has a fixed size so the hardware hashes flows
+ * over a path count which never changes. A weighted table is as small as
+ * the weights allow within the ECMP path limit. Member and weight changes
+ * only move the buckets needed to get every member to its new share.
+ *
+ * With link protection on, the members going out of a port are pruned from
+ * the hardware groups straight from the link scan callback and put back
+ * when the link comes up, so traffic stops hashing onto a dead port before
+ * the control plane gets to react. Groups are indexed by the ports of their
+ * members for this. A group always keeps at least one path in hardware.
+ */
+typedef struct _brcm_sai_nhg_path_s {
+    opennsl_if_t intf;
+    sai_uint32_t weight;
+} _brcm_sai_nhg_path_t;
+
+typedef struct _brcm_sai_nhg_link_s {
+    opennsl_port_t port;                        /* Or _BRCM_SAI_NHG_NO_PORT */
+    bool pruned;                                /* Taken out on link down */
+} _brcm_sai_nhg_link_t;
+
+struct _brcm_sai_nhg_s;
+
+/* Port index entry, one per group and port of its members */
+typedef struct _brcm_sai_nhg_port_ref_s {
+    struct _brcm_sai_nhg_port_ref_s *next;      /* By port */
+    struct _brcm_sai_nhg_port_ref_s *nhg_next;  /* By group */
+    opennsl_port_t port;
+    struct _brcm_sai_nhg_s *nhg;
+} _brcm_sai_nhg_port_ref_t;
+
+typedef struct _brcm_sai_nhg_s {
+    struct _brcm_sai_nhg_s *next;               /* By ecmp_intf */
+    struct _brcm_sai_nhg_s *set_next;           /* By member set */
+    opennsl_if_t ecmp_intf;
+    sai_uint32_t set_hash;
+    sai_uint32_t ref_count;
+    bool shared;                                /* In the member set hash */
+    int count;
+    int max_paths;                              /* Members, or table size */
+    opennsl_if_t *members;
+    _brcm_sai_nhg_link_t *links;                /* In member order */
+    _brcm_sai_nhg_port_ref_t *ports;
+    _brcm_sai_nhg_path_t *sorted;
+    bool resilient;
+    int buckets;                                /* 0 for a plain group */
+    sai_uint32_t *weights;                      /* Bucket groups only */
+    opennsl_if_t *table;
+} _brcm_sai_nhg_t;
+
+/* Copy of the member state of a bucket group, to undo a failed change */
+typedef struct _brcm_sai_nhg_saved_s {
+    int count;
+    int buckets;
+    opennsl_if_t *members;
+    _brcm_sai_nhg_link_t *links;
+    sai_uint32_t *weights;
+    opennsl_if_t *table;
+} _brcm_sai_nhg_saved_t;
+
+static pthread_mutex_t _brcm_sai_nhg_mutex = PTHREAD_MUTEX_INITIALIZER;
+static _brcm_sai_nhg_t *_brcm_sai_nhg[_BRCM_SAI_NHG_BUCKETS];
+static _brcm_sai_nhg_t *_brcm_sai_nhg_set[_BRCM_SAI_NHG_BUCKETS];
+static _brcm_sai_nhg_port_ref_t *_brcm_sai_nhg_port[_BRCM_SAI_NHG_PORT_BUCKETS];
+static bool _brcm_sai_nhg_link_protect = false;
+
+/* Weight a member gets buckets by, pruned members get none */
+#define _BRCM_SAI_NHG_WEIGHT(_nhg, _k) \
+    ((_nhg)->links[_k].pruned ? 0 : (_nhg)->weights[_k])
+
+#define _BRCM_SAI_NHG_LOCK()     pthread_mutex_lock(&_brcm_sai_nhg_mutex)
+#define _BRCM_SAI_NHG_UNLOCK()   pthread_mutex_unlock(&_brcm_sai_nhg_mutex)
+
+/*
+################################################################################
+#                             Forward declarations                             #
+################################################################################
+*/
+STATIC _brcm_sai_nhg_t **
+_brcm_sai_nhg_find(opennsl_if_t ecmp_intf);
+STATIC sai_status_t
+_brcm_sai_nhg_members_check(uint32_t next_hop_count,
+                            const sai_object_id_t* nexthops);
+STATIC void
+_brcm_sai_nhg_ecmp_init(const _brcm_sai_nhg_t *nhg,
+                        opennsl_l3_egress_ecmp_t *ecmp_object);
+STATIC void
+_brcm_sai_nhg_set_key(_brcm_sai_nhg_t *nhg);
+STATIC _brcm_sai_nhg_t *
+_brcm_sai_nhg_set_find(const _brcm_sai_nhg_t *key);
+STATIC void
+_brcm_sai_nhg_set_link(_brcm_sai_nhg_t *nhg);
+STATIC void
+_brcm_sai_nhg_set_unlink(_brcm_sai_nhg_t *nhg);
+STATIC void
+_brcm_sai_nhg_free(_brcm_sai_nhg_t *nhg);
+STATIC int
+_brcm_sai_nhg_paths_add(_brcm_sai_nhg_t *nhg, uint32_t next_hop_count,
+                        const sai_object_id_t* nexthops);
+STATIC int
+_brcm_sai_nhg_paths_remove(_brcm_sai_nhg_t *nhg, uint32_t next_hop_count,
+                           const sai_object_id_t* nexthops);
+STATIC sai_status_t
+_brcm_sai_nhg_members_unique(const _brcm_sai_nhg_t *nhg);
+STATIC sai_status_t
+_brcm_sai_nhg_buckets_assign(_brcm_sai_nhg_t *nhg);
+STATIC int
+_brcm_sai_nhg_buckets_update(_brcm_sai_nhg_t *nhg, bool add,
+                             uint32_t next_hop_count,
+                             const sai_object_id_t* nexthops);
+STATIC int
+_brcm_sai_nhg_weights_update(_brcm_sai_nhg_t *nhg,
+                             const sai_u32_list_t *weights);
+STATIC int
+_brcm_sai_nhg_ecmp_max_paths(void);
+STATIC int
+_brcm_sai_nhg_buckets_target(const _brcm_sai_nhg_t *nhg, const int *share,
+                             int *target);
+STATIC int
+_brcm_sai_nhg_save(const _brcm_sai_nhg_t *nhg, _brcm_sai_nhg_saved_t *saved);
+STATIC int
+_brcm_sai_nhg_buckets_write(_brcm_sai_nhg_t *nhg, _brcm_sai_nhg_saved_t *saved,
+                            int rv);
+STATIC void
+_brcm_sai_nhg_link_get(opennsl_if_t intf, _brcm_sai_nhg_link_t *link);
+STATIC int
+_brcm_sai_nhg_live(const _brcm_sai_nhg_t *nhg);
+STATIC void
+_brcm_sai_nhg_ports_link(_brcm_sai_nhg_t *nhg);
+STATIC void
+_brcm_sai_nhg_ports_unlink(_brcm_sai_nhg_t *nhg);
+STATIC int
+_brcm_sai_nhg_prune(_brcm_sai_nhg_t *nhg, opennsl_port_t port, bool down);
+STATIC void
+_brcm_sai_nhg_deps_set(const _brcm_sai_nhg_t *nhg);
+STATIC void
+_brcm_sai_nhg_paths_changed(const _brcm_sai_nhg_t *nhg);
+
 /*
 ################################################################################
 #                           Next hop group functions                           #
@@ -43,10 +201,13 @@ brcm_sai_create_next_hop_group(_Out_ sai_object_id_t* next_hop_group_id,
                                _In_ uint32_t attr_count,
                                _In_ const sai_attribute_t *attr_list)
 {
-    int i, j, count = 0;
+    int i, j, count = 0, buckets = 0;
+    bool share = false;
     sai_status_t rv;
     opennsl_l3_egress_ecmp_t ecmp_object;
-    opennsl_if_t *if_t = NULL;
+    opennsl_if_t *if_t = NULL, *paths;
+    const sai_u32_list_t *weights = NULL;
+    _brcm_sai_nhg_t *nhg, *shared, **bucket;
 
     BRCM_SAI_FUNCTION_ENTER(SAI_API_NEXT_HOP_GROUP);
     BRCM_SAI_SWITCH_INIT_CHECK;
@@ -72,6 +233,7 @@ brcm_sai_create_next_hop_group(_Out_ sai_object_id_t* next_hop_group_id,
                     BRCM_SAI_LOG_NHG(SAI_LOG_ERROR, "Error param %d\n", count);
                     return SAI_STATUS_INVALID_PARAMETER;
                 }
+                CHECK_FREE(if_t);
                 if_t = (opennsl_if_t*)malloc(count * sizeof(opennsl_if_t));
                 if (NULL == if_t)
                 {
@@ -85,10 +247,30 @@ brcm_sai_create_next_hop_group(_Out_ sai_object_id_t* next_hop_group_id,
                     BRCM_SAI_LOG_NHG(SAI_LOG_DEBUG, "path %d: %d\n", j, if_t[j]);
                 }
                 break;
+            case SAI_NEXT_HOP_GROUP_ATTR_BRCM_RESILIENT_BUCKETS:
+                if (attr_list[i].value.u32 >
+                    (sai_uint32_t)_brcm_sai_nhg_ecmp_max_paths())
+                {
+                    BRCM_SAI_LOG_NHG(SAI_LOG_ERROR, "%u buckets is more than "
+                                     "the hardware ecmp group size %d\n",
+                                     attr_list[i].value.u32,
+                                     _brcm_sai_nhg_ecmp_max_paths());
+                    CHECK_FREE(if_t);
+                    return SAI_STATUS_INVALID_ATTR_VALUE_0 + i;
+                }
+                buckets = attr_list[i].value.u32;
+                break;
+            case SAI_NEXT_HOP_GROUP_ATTR_BRCM_NEXT_HOP_WEIGHTS:
+                weights = &attr_list[i].value.u32list;
+                break;
+            case SAI_NEXT_HOP_GROUP_ATTR_BRCM_SHARED:
+                share = attr_list[i].value.booldata;
+                break;
             default:
                 BRCM_SAI_LOG_NHG(SAI_LOG_INFO,
                                  "Unknown nexthop group attribute %d passed\n",
                                  attr_list[i].id);
+                CHECK_FREE(if_t);
                 return SAI_STATUS_INVALID_PARAMETER;
         }
     }
@@ -97,9 +279,147 @@ brcm_sai_create_next_hop_group(_Out_ sai_object_id_t* next_hop_group_id,
         BRCM_SAI_LOG_NHG(SAI_LOG_ERROR, "Nexthop list of zero size.\n");
         return SAI_MANDATORY_ATTRIBUTE_MISSING;
     }
+    nhg = (_brcm_sai_nhg_t*)calloc(1, sizeof(_brcm_sai_nhg_t));
+    if (NULL == nhg)
+    {
+        BRCM_SAI_LOG_NHG(SAI_LOG_ERROR, "Error allocating nh group state\n");
+        CHECK_FREE(if_t);
+        return SAI_STATUS_NO_MEMORY;
+    }
+    nhg->count = count;
+    nhg->members = if_t;
+    nhg->shared = share;
+    nhg->resilient = (0 != buckets);
+    if (nhg->resilient)
+    {
+        /* Every member needs at least one bucket */
+        nhg->max_paths = buckets;
+    }
+    else if (NULL != weights)
+    {
+        nhg->max_paths = _brcm_sai_nhg_ecmp_max_paths();
+    }
+    else
+    {
+        /* Room to add members in place upto the default size */
+        nhg->max_paths = (count > _BRCM_SAI_NHG_MAX_PATHS) ?
+                         count : _BRCM_SAI_NHG_MAX_PATHS;
+    }
+    if ((nhg->resilient || (NULL != weights)) &&
+        ((count > nhg->max_paths) ||
+         (SAI_STATUS_SUCCESS != _brcm_sai_nhg_members_unique(nhg))))
+    {
+        BRCM_SAI_LOG_NHG(SAI_LOG_ERROR, "Bucket nh group needs distinct "
+                         "paths and a bucket per path\n");
+        _brcm_sai_nhg_free(nhg);
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+    if (NULL != weights)
+    {
+        if (count != weights->count)
+        {
+            BRCM_SAI_LOG_NHG(SAI_LOG_ERROR, "Need a weight per path\n");
+            _brcm_sai_nhg_free(nhg);
+            return SAI_STATUS_INVALID_PARAMETER;
+        }
+        for (i=0; i<count; i++)
+        {
+            if (0 == weights->list[i])
+            {
+                BRCM_SAI_LOG_NHG(SAI_LOG_ERROR, "Path weight can't be 0\n");
+                _brcm_sai_nhg_free(nhg);
+                return SAI_STATUS_INVALID_PARAMETER;
+            }
+        }
+    }
+    nhg->members = (opennsl_if_t*)malloc(nhg->max_paths * sizeof(opennsl_if_t));
+    nhg->links = (_brcm_sai_nhg_link_t*)calloc(nhg->max_paths,
+                                               sizeof(_brcm_sai_nhg_link_t));
+    nhg->sorted = (_brcm_sai_nhg_path_t*)malloc(nhg->max_paths *
+                                                sizeof(_brcm_sai_nhg_path_t));
+    if (nhg->resilient || (NULL != weights))
+    {
+        nhg->weights = (sai_uint32_t*)malloc(nhg->max_paths *
+                                             sizeof(sai_uint32_t));
+        nhg->table = (opennsl_if_t*)calloc(nhg->max_paths,
+                                           sizeof(opennsl_if_t));
+        /* A resilient table is always full */
+        nhg->buckets = buckets;
+    }
+    if (NULL != nhg->members)
+    {
+        memcpy(nhg->members, if_t, count * sizeof(opennsl_if_t));
+    }
+    free(if_t);
+    if ((NULL == nhg->members) || (NULL == nhg->links) ||
+        (NULL == nhg->sorted) || ((nhg->resilient || (NULL != weights)) &&
+         ((NULL == nhg->weights) || (NULL == nhg->table))))
+    {
+        BRCM_SAI_LOG_NHG(SAI_LOG_ERROR, "Error allocating nh group state\n");
+        _brcm_sai_nhg_free(nhg);
+        return SAI_STATUS_NO_MEMORY;
+    }
+    for (i=0; i<count; i++)
+    {
+        _brcm_sai_nhg_link_get(nhg->members[i], &nhg->links[i]);
+    }
+    if (NULL != nhg->weights)
+    {
+        for (i=0; i<count; i++)
+        {
+            nhg->weights[i] = (NULL != weights) ? weights->list[i] : 1;
+        }
+        if (SAI_STATUS_SUCCESS != _brcm_sai_nhg_buckets_assign(nhg))
+        {
+            BRCM_SAI_LOG_NHG(SAI_LOG_ERROR, "Error allocating nh group "
+                             "state\n");
+            _brcm_sai_nhg_free(nhg);
+            return SAI_STATUS_NO_MEMORY;
+        }
+    }
+    _brcm_sai_nhg_set_key(nhg);
+    _BRCM_SAI_NHG_LOCK();
+    shared = _brcm_sai_nhg_set_find(nhg);
+    if (NULL != shared)
+    {
+        shared->ref_count++;
+        *next_hop_group_id = BRCM_SAI_CREATE_OBJ(SAI_OBJECT_TYPE_NEXT_HOP_GROUP,
+                                                 shared->ecmp_intf);
+        _BRCM_SAI_NHG_UNLOCK();
+        BRCM_SAI_LOG_NHG(SAI_LOG_DEBUG, "Reusing nh group %d, ref count %d\n",
+                         shared->ecmp_intf, shared->ref_count);
+        _brcm_sai_nhg_free(nhg);
+        BRCM_SAI_FUNCTION_EXIT(SAI_API_NEXT_HOP_GROUP);
+        return SAI_STATUS_SUCCESS;
+    }
+    ecmp_object.max_paths = nhg->max_paths;
+    if (nhg->buckets)
+    {
+        count = nhg->buckets;
+        paths = nhg->table;
+    }
+    else
+    {
+        paths = nhg->members;
+    }
     BRCM_SAI_LOG_NHG(SAI_LOG_DEBUG, "Create nh group with %d paths\n", count);
-    rv = opennsl_l3_egress_ecmp_create(0, &ecmp_object, count, if_t);
-    CHECK_FREE(if_t);
+    rv = opennsl_l3_egress_ecmp_create(0, &ecmp_object, count, paths);
+    if (OPENNSL_E_NONE == rv)
+    {
+        nhg->ecmp_intf = ecmp_object.ecmp_intf;
+        nhg->ref_count = 1;
+        bucket = &_brcm_sai_nhg[nhg->ecmp_intf % _BRCM_SAI_NHG_BUCKETS];
+        nhg->next = *bucket;
+        *bucket = nhg;
+        _brcm_sai_nhg_set_link(nhg);
+        _brcm_sai_nhg_ports_link(nhg);
+        _brcm_sai_nhg_deps_set(nhg);
+    }
+    _BRCM_SAI_NHG_UNLOCK();
+    if (OPENNSL_E_NONE != rv)
+    {
+        _brcm_sai_nhg_free(nhg);
+    }
     BRCM_SAI_API_CHK(SAI_API_NEXT_HOP_GROUP, "ecmp nh group create", rv);
 
     *next_hop_group_id = BRCM_SAI_CREATE_OBJ(SAI_OBJECT_TYPE_NEXT_HOP_GROUP,
@@ -125,6 +445,7 @@ brcm_sai_remove_next_hop_group(_In_ sai_object_id_t next_hop_group_id)
 {
     sai_status_t rv;
     opennsl_l3_egress_ecmp_t ecmp_object;
+    _brcm_sai_nhg_t *nhg, **prev;
 
     BRCM_SAI_FUNCTION_ENTER(SAI_API_NEXT_HOP_GROUP);
 
@@ -132,7 +453,43 @@ brcm_sai_remove_next_hop_group(_In_ sai_object_id_t next_hop_group_id)
     opennsl_l3_egress_ecmp_t_init(&ecmp_object);
     ecmp_object.ecmp_intf = BRCM_SAI_GET_OBJ_VAL(opennsl_if_t,
                                                  next_hop_group_id);
+    if (_brcm_sai_route_nhi_owned(ecmp_object.ecmp_intf))
+    {
+        /* Only brcm_sai_remove_indirect_next_hop may free it */
+        BRCM_SAI_LOG_NHG(SAI_LOG_ERROR, "nh group %d is an indirect next "
+                         "hop\n", ecmp_object.ecmp_intf);
+        return SAI_STATUS_INVALID_OBJECT_ID;
+    }
+    _BRCM_SAI_NHG_LOCK();
+    prev = _brcm_sai_nhg_find(ecmp_object.ecmp_intf);
+    nhg = *prev;
+    if ((NULL != nhg) && (1 < nhg->ref_count))
+    {
+        /* Still shared with other users */
+        nhg->ref_count--;
+        _BRCM_SAI_NHG_UNLOCK();
+        BRCM_SAI_FUNCTION_EXIT(SAI_API_NEXT_HOP_GROUP);
+        return SAI_STATUS_SUCCESS;
+    }
+    if (_brcm_sai_deps_count(next_hop_group_id))
+    {
+        _BRCM_SAI_NHG_UNLOCK();
+        BRCM_SAI_LOG_NHG(SAI_LOG_ERROR, "nh group still used by routes\n");
+        return SAI_STATUS_OBJECT_IN_USE;
+    }
     rv = opennsl_l3_egress_ecmp_destroy(0, &ecmp_object);
+    if ((OPENNSL_E_NONE == rv) && (NULL != nhg))
+    {
+        *prev = nhg->next;
+        _brcm_sai_nhg_set_unlink(nhg);
+        _brcm_sai_nhg_ports_unlink(nhg);
+        _brcm_sai_nhg_free(nhg);
+    }
+    if (OPENNSL_E_NONE == rv)
+    {
+        _brcm_sai_deps_release(next_hop_group_id);
+    }
+    _BRCM_SAI_NHG_UNLOCK();
     BRCM_SAI_API_CHK(SAI_API_NEXT_HOP_GROUP, "ecmp nh group delete", rv);
 
     BRCM_SAI_FUNCTION_EXIT(SAI_API_NEXT_HOP_GROUP);
@@ -156,15 +513,54 @@ STATIC sai_status_t
 brcm_sai_set_next_hop_group_attribute(_In_ sai_object_id_t next_hop_group_id,
                                       _In_ const sai_attribute_t *attr)
 {
-    sai_status_t rv = SAI_STATUS_NOT_IMPLEMENTED;
+    int rv;
+    _brcm_sai_nhg_t *nhg;
 
     BRCM_SAI_FUNCTION_ENTER(SAI_API_NEXT_HOP_GROUP);
 
     BRCM_SAI_SWITCH_INIT_CHECK;
+    if (NULL == attr)
+    {
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+    if (SAI_NEXT_HOP_GROUP_ATTR_BRCM_NEXT_HOP_WEIGHTS != attr->id)
+    {
+        return SAI_STATUS_NOT_IMPLEMENTED;
+    }
+    _BRCM_SAI_NHG_LOCK();
+    nhg = *_brcm_sai_nhg_find(BRCM_SAI_GET_OBJ_VAL(opennsl_if_t,
+                                                   next_hop_group_id));
+    if ((NULL == nhg) || (NULL == nhg->weights))
+    {
+        _BRCM_SAI_NHG_UNLOCK();
+        BRCM_SAI_LOG_NHG(SAI_LOG_ERROR, "Not a weighted nh group\n");
+        return SAI_STATUS_INVALID_OBJECT_ID;
+    }
+    if (1 < nhg->ref_count)
+    {
+        _BRCM_SAI_NHG_UNLOCK();
+        BRCM_SAI_LOG_NHG(SAI_LOG_ERROR, "nh group %d is shared by %d users\n",
+                         nhg->ecmp_intf, nhg->ref_count);
+        return SAI_STATUS_OBJECT_IN_USE;
+    }
+    rv = _brcm_sai_nhg_weights_update(nhg, &attr->value.u32list);
+    if (OPENNSL_E_NONE == rv)
+    {
+        _brcm_sai_nhg_set_unlink(nhg);
+        _brcm_sai_nhg_set_key(nhg);
+        _brcm_sai_nhg_set_link(nhg);
+        _brcm_sai_nhg_paths_changed(nhg);
+    }
+    _BRCM_SAI_NHG_UNLOCK();
+    if (OPENNSL_E_PARAM == rv)
+    {
+        return SAI_STATUS_INVALID_ATTR_VALUE_0;
+    }
+    BRCM_SAI_API_CHK(SAI_API_NEXT_HOP_GROUP, "ecmp nh group weights", rv);
 
     BRCM_SAI_FUNCTION_EXIT(SAI_API_NEXT_HOP_GROUP);
 
-    return rv;
+    return BRCM_RV_OPENNSL_TO_SAI(rv);
 }
 
 /*
@@ -178,6 +574,8 @@ brcm_sai_set_next_hop_group_attribute(_In_ sai_object_id_t next_hop_group_id,
 *
 * Return Values:
 *    SAI_STATUS_SUCCESS on success
+*    SAI_STATUS_BUFFER_OVERFLOW if a list is too short, its count is set
+*    to the number needed
 *    Failure status code on error
 */
 STATIC sai_status_t
@@ -185,11 +583,91 @@ brcm_sai_get_next_hop_group_attribute(_In_ sai_object_id_t next_hop_group_id,
                                       _In_ uint32_t attr_count,
                                       _Inout_ sai_attribute_t *attr_list)
 {
-    sai_status_t rv = SAI_STATUS_NOT_IMPLEMENTED;
+    int i, j;
+    sai_status_t rv = SAI_STATUS_SUCCESS;
+    _brcm_sai_nhg_t *nhg;
 
     BRCM_SAI_FUNCTION_ENTER(SAI_API_NEXT_HOP_GROUP);
 
     BRCM_SAI_SWITCH_INIT_CHECK;
+    BRCM_SAI_GET_ATTRIB_PARAM_CHK;
+
+    if (SAI_OBJECT_TYPE_NEXT_HOP_GROUP !=
+        BRCM_SAI_GET_OBJ_TYPE(next_hop_group_id))
+    {
+        return SAI_STATUS_INVALID_OBJECT_TYPE;
+    }
+    _BRCM_SAI_NHG_LOCK();
+    /* Served from the shadow, the SDK is not consulted */
+    nhg = *_brcm_sai_nhg_find(BRCM_SAI_GET_OBJ_VAL(opennsl_if_t,
+                                                   next_hop_group_id));
+    if (NULL == nhg)
+    {
+        _BRCM_SAI_NHG_UNLOCK();
+        BRCM_SAI_LOG_NHG(SAI_LOG_ERROR, "Unknown nh group\n");
+        return SAI_STATUS_INVALID_OBJECT_ID;
+    }
+    for (i=0; i<attr_count; i++)
+    {
+        switch (attr_list[i].id)
+        {
+            case SAI_NEXT_HOP_GROUP_ATTR_NEXT_HOP_COUNT:
+                attr_list[i].value.u32 = nhg->count;
+                break;
+            case SAI_NEXT_HOP_GROUP_ATTR_TYPE:
+                attr_list[i].value.s32 = SAI_NEXT_HOP_GROUP_ECMP;
+                break;
+            case SAI_NEXT_HOP_GROUP_ATTR_NEXT_HOP_LIST:
+                if (BRCM_SAI_ATTR_LIST_OBJ_COUNT(i) < nhg->count)
+                {
+                    rv = SAI_STATUS_BUFFER_OVERFLOW;
+                }
+                else
+                {
+                    for (j=0; j<nhg->count; j++)
+                    {
+                        BRCM_SAI_ATTR_OBJ_LIST(i, j) =
+                            BRCM_SAI_CREATE_OBJ(SAI_OBJECT_TYPE_NEXT_HOP,
+                                                nhg->members[j]);
+                    }
+                }
+                BRCM_SAI_ATTR_LIST_OBJ_COUNT(i) = nhg->count;
+                break;
+            case SAI_NEXT_HOP_GROUP_ATTR_BRCM_RESILIENT_BUCKETS:
+                attr_list[i].value.u32 = nhg->resilient ? nhg->max_paths : 0;
+                break;
+            case SAI_NEXT_HOP_GROUP_ATTR_BRCM_NEXT_HOP_WEIGHTS:
+                if (attr_list[i].value.u32list.count < nhg->count)
+                {
+                    rv = SAI_STATUS_BUFFER_OVERFLOW;
+                }
+                else
+                {
+                    /* Members of a plain group are weighted alike */
+                    for (j=0; j<nhg->count; j++)
+                    {
+                        attr_list[i].value.u32list.list[j] =
+                            (NULL != nhg->weights) ? nhg->weights[j] : 1;
+                    }
+                }
+                attr_list[i].value.u32list.count = nhg->count;
+                break;
+            case SAI_NEXT_HOP_GROUP_ATTR_BRCM_SHARED:
+                attr_list[i].value.booldata = nhg->shared;
+                break;
+            default:
+                BRCM_SAI_LOG_NHG(SAI_LOG_ERROR,
+                                 "Unknown nexthop group attribute %d passed\n",
+                                 attr_list[i].id);
+                rv = SAI_STATUS_UNKNOWN_ATTRIBUTE_0 + i;
+                break;
+        }
+        if (SAI_STATUS_SUCCESS != rv)
+        {
+            break;
+        }
+    }
+    _BRCM_SAI_NHG_UNLOCK();
 
     BRCM_SAI_FUNCTION_EXIT(SAI_API_NEXT_HOP_GROUP);
 
@@ -214,15 +692,62 @@ brcm_sai_add_next_hop_to_group(_In_ sai_object_id_t next_hop_group_id,
                                _In_ uint32_t next_hop_count,
                                _In_ const sai_object_id_t* nexthops)
 {
-    sai_status_t rv = SAI_STATUS_NOT_IMPLEMENTED;
+    int rv;
+    _brcm_sai_nhg_t *nhg;
 
     BRCM_SAI_FUNCTION_ENTER(SAI_API_NEXT_HOP_GROUP);
 
     BRCM_SAI_SWITCH_INIT_CHECK;
+    if (SAI_STATUS_SUCCESS !=
+        _brcm_sai_nhg_members_check(next_hop_count, nexthops))
+    {
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+    _BRCM_SAI_NHG_LOCK();
+    nhg = *_brcm_sai_nhg_find(BRCM_SAI_GET_OBJ_VAL(opennsl_if_t,
+                                                   next_hop_group_id));
+    if (NULL == nhg)
+    {
+        _BRCM_SAI_NHG_UNLOCK();
+        BRCM_SAI_LOG_NHG(SAI_LOG_ERROR, "Unknown nh group\n");
+        return SAI_STATUS_INVALID_OBJECT_ID;
+    }
+    if (1 < nhg->ref_count)
+    {
+        /* Changing it would change the group for every other user too */
+        _BRCM_SAI_NHG_UNLOCK();
+        BRCM_SAI_LOG_NHG(SAI_LOG_ERROR, "nh group %d is shared by %d users\n",
+                         nhg->ecmp_intf, nhg->ref_count);
+        return SAI_STATUS_OBJECT_IN_USE;
+    }
+    if ((nhg->count + next_hop_count) > nhg->max_paths)
+    {
+        _BRCM_SAI_NHG_UNLOCK();
+        BRCM_SAI_LOG_NHG(SAI_LOG_ERROR, "nh group can't have more than %d "
+                         "paths\n", nhg->max_paths);
+        return SAI_STATUS_INSUFFICIENT_RESOURCES;
+    }
+    if (NULL != nhg->weights)
+    {
+        rv = _brcm_sai_nhg_buckets_update(nhg, true, next_hop_count, nexthops);
+    }
+    else
+    {
+        rv = _brcm_sai_nhg_paths_add(nhg, next_hop_count, nexthops);
+    }
+    _brcm_sai_nhg_set_unlink(nhg);
+    _brcm_sai_nhg_set_key(nhg);
+    _brcm_sai_nhg_set_link(nhg);
+    _brcm_sai_nhg_ports_unlink(nhg);
+    _brcm_sai_nhg_ports_link(nhg);
+    _brcm_sai_nhg_deps_set(nhg);
+    _brcm_sai_nhg_paths_changed(nhg);
+    _BRCM_SAI_NHG_UNLOCK();
+    BRCM_SAI_API_CHK(SAI_API_NEXT_HOP_GROUP, "ecmp nh group add", rv);
 
     BRCM_SAI_FUNCTION_EXIT(SAI_API_NEXT_HOP_GROUP);
 
-    return rv;
+    return BRCM_RV_OPENNSL_TO_SAI(rv);
 }
 
 /*
@@ -243,17 +768,1014 @@ brcm_sai_remove_next_hop_from_group(_In_ sai_object_id_t next_hop_group_id,
                                     _In_ uint32_t next_hop_count,
                                     _In_ const sai_object_id_t* nexthops)
 {
-    sai_status_t rv = SAI_STATUS_NOT_IMPLEMENTED;
+    int rv;
+    _brcm_sai_nhg_t *nhg;
 
     BRCM_SAI_FUNCTION_ENTER(SAI_API_NEXT_HOP_GROUP);
 
     BRCM_SAI_SWITCH_INIT_CHECK;
+    if (SAI_STATUS_SUCCESS !=
+        _brcm_sai_nhg_members_check(next_hop_count, nexthops))
+    {
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+    _BRCM_SAI_NHG_LOCK();
+    nhg = *_brcm_sai_nhg_find(BRCM_SAI_GET_OBJ_VAL(opennsl_if_t,
+                                                   next_hop_group_id));
+    if (NULL == nhg)
+    {
+        _BRCM_SAI_NHG_UNLOCK();
+        BRCM_SAI_LOG_NHG(SAI_LOG_ERROR, "Unknown nh group\n");
+        return SAI_STATUS_INVALID_OBJECT_ID;
+    }
+    if (1 < nhg->ref_count)
+    {
+        /* Changing it would change the group for every other user too */
+        _BRCM_SAI_NHG_UNLOCK();
+        BRCM_SAI_LOG_NHG(SAI_LOG_ERROR, "nh group %d is shared by %d users\n",
+                         nhg->ecmp_intf, nhg->ref_count);
+        return SAI_STATUS_OBJECT_IN_USE;
+    }
+    if (next_hop_count >= nhg->count)
+    {
+        _BRCM_SAI_NHG_UNLOCK();
+        BRCM_SAI_LOG_NHG(SAI_LOG_ERROR, "Can't remove all the paths of a "
+                         "nh group\n");
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+    if (NULL != nhg->weights)
+    {
+        rv = _brcm_sai_nhg_buckets_update(nhg, false, next_hop_count,
+                                          nexthops);
+    }
+    else
+    {
+        rv = _brcm_sai_nhg_paths_remove(nhg, next_hop_count, nexthops);
+    }
+    _brcm_sai_nhg_set_unlink(nhg);
+    _brcm_sai_nhg_set_key(nhg);
+    _brcm_sai_nhg_set_link(nhg);
+    _brcm_sai_nhg_ports_unlink(nhg);
+    _brcm_sai_nhg_ports_link(nhg);
+    _brcm_sai_nhg_deps_set(nhg);
+    _brcm_sai_nhg_paths_changed(nhg);
+    _BRCM_SAI_NHG_UNLOCK();
+    BRCM_SAI_API_CHK(SAI_API_NEXT_HOP_GROUP, "ecmp nh group delete", rv);
 
     BRCM_SAI_FUNCTION_EXIT(SAI_API_NEXT_HOP_GROUP);
 
+    return BRCM_RV_OPENNSL_TO_SAI(rv);
+}
+
+/*
+################################################################################
+#                                Internal functions                            #
+################################################################################
+*/
+/* Routine to find the link pointing at the shadow of a group */
+STATIC _brcm_sai_nhg_t **
+_brcm_sai_nhg_find(opennsl_if_t ecmp_intf)
+{
+    _brcm_sai_nhg_t **prev;
+
+    prev = &_brcm_sai_nhg[ecmp_intf % _BRCM_SAI_NHG_BUCKETS];
+    while ((NULL != *prev) && (ecmp_intf != (*prev)->ecmp_intf))
+    {
+        prev = &(*prev)->next;
+    }
+    return prev;
+}
+
+/* Routine to validate a list of next hops passed to add or remove */
+STATIC sai_status_t
+_brcm_sai_nhg_members_check(uint32_t next_hop_count,
+                            const sai_object_id_t* nexthops)
+{
+    int i;
+
+    if ((0 == next_hop_count) || (NULL == nexthops))
+    {
+        BRCM_SAI_LOG_NHG(SAI_LOG_ERROR, "Empty next hop list\n");
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+    for (i=0; i<next_hop_count; i++)
+    {
+        if (SAI_OBJECT_TYPE_NEXT_HOP != BRCM_SAI_GET_OBJ_TYPE(nexthops[i]))
+        {
+            BRCM_SAI_LOG_NHG(SAI_LOG_ERROR, "Invalid next hop %d\n", i);
+            return SAI_STATUS_INVALID_PARAMETER;
+        }
+    }
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Routine to set up the ecmp object used to change a group's members */
+STATIC void
+_brcm_sai_nhg_ecmp_init(const _brcm_sai_nhg_t *nhg,
+                        opennsl_l3_egress_ecmp_t *ecmp_object)
+{
+    opennsl_l3_egress_ecmp_t_init(ecmp_object);
+    ecmp_object->ecmp_intf = nhg->ecmp_intf;
+    ecmp_object->max_paths = nhg->max_paths;
+}
+
+/* Routine to add paths to the hardware group one at a time */
+STATIC int
+_brcm_sai_nhg_paths_add(_brcm_sai_nhg_t *nhg, uint32_t next_hop_count,
+                        const sai_object_id_t* nexthops)
+{
+    int i, rv = OPENNSL_E_NONE;
+    opennsl_if_t intf;
+    opennsl_l3_egress_ecmp_t ecmp_object;
+
+    _brcm_sai_nhg_ecmp_init(nhg, &ecmp_object);
+    for (i=0; i<next_hop_count; i++)
+    {
+        intf = BRCM_SAI_GET_OBJ_VAL(opennsl_if_t, nexthops[i]);
+        rv = opennsl_l3_egress_ecmp_add(0, &ecmp_object, intf);
+        if (OPENNSL_E_NONE != rv)
+        {
+            BRCM_SAI_LOG_NHG(SAI_LOG_ERROR, "Error %d adding path %d\n", rv,
+                             intf);
+            break;
+        }
+        _brcm_sai_nhg_link_get(intf, &nhg->links[nhg->count]);
+        nhg->members[nhg->count++] = intf;
+    }
+    if (OPENNSL_E_NONE != rv)
+    {
+        /* Leave the group as it was */
+        while (i--)
+        {
+            (void)opennsl_l3_egress_ecmp_delete(0, &ecmp_object,
+                                                nhg->members[--nhg->count]);
+        }
+    }
+    return rv;
+}
+
+/*
+ * Routine to remove paths from the hardware group one at a time. When one
+ * fails the saved members are written back whole, in their old order and
+ * with the dead ones pruned as before.
+ */
+STATIC int
+_brcm_sai_nhg_paths_remove(_brcm_sai_nhg_t *nhg, uint32_t next_hop_count,
+                           const sai_object_id_t* nexthops)
+{
+    int i, j, count, live, rv = OPENNSL_E_NONE;
+    opennsl_if_t intf, *members;
+    _brcm_sai_nhg_link_t *links;
+    opennsl_l3_egress_ecmp_t ecmp_object;
+
+    count = nhg->count;
+    members = (opennsl_if_t*)malloc(count * sizeof(opennsl_if_t));
+    links = (_brcm_sai_nhg_link_t*)malloc(count *
+                                          sizeof(_brcm_sai_nhg_link_t));
+    if ((NULL == members) || (NULL == links))
+    {
+        CHECK_FREE(members);
+        CHECK_FREE(links);
+        return OPENNSL_E_MEMORY;
+    }
+    memcpy(members, nhg->members, count * sizeof(opennsl_if_t));
+    memcpy(links, nhg->links, count * sizeof(_brcm_sai_nhg_link_t));
+    _brcm_sai_nhg_ecmp_init(nhg, &ecmp_object);
+    for (i=0; i<next_hop_count; i++)
+    {
+        intf = BRCM_SAI_GET_OBJ_VAL(opennsl_if_t, nexthops[i]);
+        for (j=nhg->count-1; j>=0; j--)
+        {
+            if (intf == nhg->members[j])
+            {
+                break;
+            }
+        }
+        if (0 > j)
+        {
+            BRCM_SAI_LOG_NHG(SAI_LOG_ERROR, "Path %d not in nh group\n", intf);
+            rv = OPENNSL_E_NOT_FOUND;
+            break;
+        }
+        if (!nhg->links[j].pruned && (1 == _brcm_sai_nhg_live(nhg)))
+        {
+            /* Dead paths are better than an empty group */
+            (void)_brcm_sai_nhg_prune(nhg, _BRCM_SAI_NHG_NO_PORT, false);
+        }
+        if (!nhg->links[j].pruned)
+        {
+            rv = opennsl_l3_egress_ecmp_delete(0, &ecmp_object, intf);
+        }
+        if (OPENNSL_E_NONE != rv)
+        {
+            BRCM_SAI_LOG_NHG(SAI_LOG_ERROR, "Error %d removing path %d\n", rv,
+                             intf);
+            break;
+        }
+        /* The hardware keeps the remaining paths in order */
+        memmove(&nhg->members[j], &nhg->members[j+1],
+                (nhg->count - j - 1) * sizeof(opennsl_if_t));
+        memmove(&nhg->links[j], &nhg->links[j+1],
+                (nhg->count - j - 1) * sizeof(_brcm_sai_nhg_link_t));
+        nhg->count--;
+    }
+    if (OPENNSL_E_NONE != rv)
+    {
+        memcpy(nhg->members, members, count * sizeof(opennsl_if_t));
+        memcpy(nhg->links, links, count * sizeof(_brcm_sai_nhg_link_t));
+        nhg->count = count;
+        /* The hardware has the live members only */
+        for (live=0, j=0; j<count; j++)
+        {
+            if (!links[j].pruned)
+            {
+                members[live++] = members[j];
+            }
+        }
+        _brcm_sai_nhg_ecmp_init(nhg, &ecmp_object);
+        ecmp_object.flags |= (OPENNSL_L3_REPLACE | OPENNSL_L3_WITH_ID);
+        if (OPENNSL_E_NONE !=
+            opennsl_l3_egress_ecmp_create(0, &ecmp_object, live, members))
+        {
+            BRCM_SAI_LOG_NHG(SAI_LOG_ERROR, "Error restoring nh group %d\n",
+                             nhg->ecmp_intf);
+        }
+    }
+    free(members);
+    free(links);
     return rv;
 }
 
+/*
+ * Routine to work out the number of buckets of a group and how many each
+ * member should get, by the largest remainder of its weighted share. Ties
+ * go to the members which have more buckets now so that fewer move. Pruned
+ * members get no buckets.
+ */
+STATIC int
+_brcm_sai_nhg_buckets_target(const _brcm_sai_nhg_t *nhg, const int *share,
+                             int *target)
+{
+    int k, j, max, size, left;
+    sai_uint32_t div;
+    uint64_t total = 0, *rem;
+
+    rem = (uint64_t*)malloc(nhg->count * sizeof(uint64_t));
+    if (NULL == rem)
+    {
+        return -1;
+    }
+    if (nhg->resilient)
+    {
+        size = nhg->max_paths;
+    }
+    else
+    {
+        /* Smallest table with the exact ratios, if it fits */
+        for (div = _BRCM_SAI_NHG_WEIGHT(nhg, 0), k=1; k<nhg->count; k++)
+        {
+            sai_uint32_t a = div, b = _BRCM_SAI_NHG_WEIGHT(nhg, k), t;
+
+            while (b)
+            {
+                t = a % b;
+                a = b;
+                b = t;
+            }
+            div = a;
+        }
+        for (size = 0, k=0; k<nhg->count; k++)
+        {
+            size += _BRCM_SAI_NHG_WEIGHT(nhg, k) / div;
+            if (size >= nhg->max_paths)
+            {
+                size = nhg->max_paths;
+                break;
+            }
+        }
+    }
+    for (k=0; k<nhg->count; k++)
+    {
+        total += _BRCM_SAI_NHG_WEIGHT(nhg, k);
+    }
+    for (left = size, k=0; k<nhg->count; k++)
+    {
+        target[k] = ((uint64_t)_BRCM_SAI_NHG_WEIGHT(nhg, k) * size) / total;
+        rem[k] = ((uint64_t)_BRCM_SAI_NHG_WEIGHT(nhg, k) * size) % total;
+        left -= target[k];
+    }
+    while (left--)
+    {
+        for (j=0, k=1; k<nhg->count; k++)
+        {
+            if ((rem[k] > rem[j]) ||
+                ((rem[k] == rem[j]) && (share[k] > share[j])))
+            {
+                j = k;
+            }
+        }
+        target[j]++;
+        rem[j] = 0;
+    }
+    /* Every member keeps at least one bucket, taken from the largest */
+    for (k=0; k<nhg->count; k++)
+    {
+        if ((0 == target[k]) && !nhg->links[k].pruned)
+        {
+            for (max=0, j=1; j<nhg->count; j++)
+            {
+                if (target[j] > target[max])
+                {
+                    max = j;
+                }
+            }
+            target[max]--;
+            target[k]++;
+        }
+    }
+    free(rem);
+    return size;
+}
+
+/*
+ * Routine to share out the buckets of a group among its members. Buckets
+ * which already point at a member keep pointing at it unless the member
+ * has more than its share, so a change only moves the buckets of members
+ * which left or lost weight to the members which joined or gained weight.
+ */
+STATIC sai_status_t
+_brcm_sai_nhg_buckets_assign(_brcm_sai_nhg_t *nhg)
+{
+    int b, k, size;
+    int *owner, *share, *target;
+    sai_status_t rv = SAI_STATUS_SUCCESS;
+
+    owner = (int*)malloc(nhg->max_paths * sizeof(int));
+    share = (int*)calloc(nhg->count, sizeof(int));
+    target = (int*)calloc(nhg->count, sizeof(int));
+    if ((NULL == owner) || (NULL == share) || (NULL == target))
+    {
+        CHECK_FREE(owner);
+        CHECK_FREE(share);
+        CHECK_FREE(target);
+        return SAI_STATUS_NO_MEMORY;
+    }
+    for (b=0; b<nhg->max_paths; b++)
+    {
+        owner[b] = -1;
+        for (k=0; (b<nhg->buckets) && (k<nhg->count); k++)
+        {
+            if (nhg->table[b] == nhg->members[k])
+            {
+                owner[b] = k;
+                share[k]++;
+                break;
+            }
+        }
+    }
+    size = _brcm_sai_nhg_buckets_target(nhg, share, target);
+    if (0 <= size)
+    {
+        /* Free the buckets past the end or above a member's share */
+        for (b=0; b<nhg->max_paths; b++)
+        {
+            k = owner[b];
+            if ((0 <= k) && ((b >= size) || (share[k] > target[k])))
+            {
+                owner[b] = -1;
+                share[k]--;
+            }
+        }
+        /* Hand the free buckets to the members below their share */
+        for (k=0, b=0; b<size; b++)
+        {
+            if (0 <= owner[b])
+            {
+                continue;
+            }
+            while (share[k] >= target[k])
+            {
+                k++;
+            }
+            share[k]++;
+            nhg->table[b] = nhg->members[k];
+        }
+        nhg->buckets = size;
+    }
+    else
+    {
+        rv = SAI_STATUS_NO_MEMORY;
+    }
+    free(owner);
+    free(share);
+    free(target);
+    return rv;
+}
+
+/* Routine to copy the member state of a bucket group */
+STATIC int
+_brcm_sai_nhg_save(const _brcm_sai_nhg_t *nhg, _brcm_sai_nhg_saved_t *saved)
+{
+    saved->count = nhg->count;
+    saved->buckets = nhg->buckets;
+    saved->members = (opennsl_if_t*)malloc(nhg->max_paths *
+                                           sizeof(opennsl_if_t));
+    saved->links = (_brcm_sai_nhg_link_t*)malloc(nhg->max_paths *
+                                                 sizeof(_brcm_sai_nhg_link_t));
+    saved->weights = (sai_uint32_t*)malloc(nhg->max_paths *
+                                           sizeof(sai_uint32_t));
+    saved->table = (opennsl_if_t*)malloc(nhg->max_paths *
+                                         sizeof(opennsl_if_t));
+    if ((NULL == saved->members) || (NULL == saved->links) ||
+        (NULL == saved->weights) || (NULL == saved->table))
+    {
+        CHECK_FREE(saved->members);
+        CHECK_FREE(saved->links);
+        CHECK_FREE(saved->weights);
+        CHECK_FREE(saved->table);
+        return OPENNSL_E_MEMORY;
+    }
+    memcpy(saved->members, nhg->members, nhg->count * sizeof(opennsl_if_t));
+    memcpy(saved->links, nhg->links, nhg->count * sizeof(_brcm_sai_nhg_link_t));
+    memcpy(saved->weights, nhg->weights, nhg->count * sizeof(sai_uint32_t));
+    memcpy(saved->table, nhg->table, nhg->buckets * sizeof(opennsl_if_t));
+    return OPENNSL_E_NONE;
+}
+
+/*
+ * Routine to program the new member state of a bucket group, or to go back
+ * to the saved state when that fails. Frees the saved state.
+ */
+STATIC int
+_brcm_sai_nhg_buckets_write(_brcm_sai_nhg_t *nhg, _brcm_sai_nhg_saved_t *saved,
+                            int rv)
+{
+    opennsl_l3_egress_ecmp_t ecmp_object;
+
+    if (OPENNSL_E_NONE == rv)
+    {
+        rv = (SAI_STATUS_SUCCESS == _brcm_sai_nhg_buckets_assign(nhg)) ?
+             OPENNSL_E_NONE : OPENNSL_E_MEMORY;
+    }
+    if (OPENNSL_E_NONE == rv)
+    {
+        _brcm_sai_nhg_ecmp_init(nhg, &ecmp_object);
+        ecmp_object.flags |= (OPENNSL_L3_REPLACE | OPENNSL_L3_WITH_ID);
+        rv = opennsl_l3_egress_ecmp_create(0, &ecmp_object, nhg->buckets,
+                                           nhg->table);
+    }
+    if (OPENNSL_E_NONE != rv)
+    {
+        memcpy(nhg->members, saved->members,
+               saved->count * sizeof(opennsl_if_t));
+        memcpy(nhg->links, saved->links,
+               saved->count * sizeof(_brcm_sai_nhg_link_t));
+        memcpy(nhg->weights, saved->weights,
+               saved->count * sizeof(sai_uint32_t));
+        memcpy(nhg->table, saved->table, saved->buckets * sizeof(opennsl_if_t));
+        nhg->count = saved->count;
+        nhg->buckets = saved->buckets;
+    }
+    free(saved->members);
+    free(saved->links);
+    free(saved->weights);
+    free(saved->table);
+    return rv;
+}
+
+/*
+ * Routine to add or remove members of a bucket group, new members get a
+ * weight of 1. The bucket table is rewritten in place, flows in the
+ * buckets which didn't move are not disturbed.
+ */
+STATIC int
+_brcm_sai_nhg_buckets_update(_brcm_sai_nhg_t *nhg, bool add,
+                             uint32_t next_hop_count,
+                             const sai_object_id_t* nexthops)
+{
+    int i, j, rv;
+    opennsl_if_t intf;
+    _brcm_sai_nhg_saved_t saved;
+
+    rv = _brcm_sai_nhg_save(nhg, &saved);
+    if (OPENNSL_E_NONE != rv)
+    {
+        return rv;
+    }
+    for (i=0; (i<next_hop_count) && (OPENNSL_E_NONE == rv); i++)
+    {
+        intf = BRCM_SAI_GET_OBJ_VAL(opennsl_if_t, nexthops[i]);
+        for (j=0; (j<nhg->count) && (intf != nhg->members[j]); j++);
+        if (add)
+        {
+            nhg->weights[nhg->count] = 1;
+            _brcm_sai_nhg_link_get(intf, &nhg->links[nhg->count]);
+            nhg->members[nhg->count++] = intf;
+            if (j < nhg->count - 1)
+            {
+                BRCM_SAI_LOG_NHG(SAI_LOG_ERROR, "Path %d already in nh group"
+                                 "\n", intf);
+                rv = OPENNSL_E_EXISTS;
+            }
+        }
+        else if (j == nhg->count)
+        {
+            BRCM_SAI_LOG_NHG(SAI_LOG_ERROR, "Path %d not in nh group\n", intf);
+            rv = OPENNSL_E_NOT_FOUND;
+        }
+        else
+        {
+            memmove(&nhg->members[j], &nhg->members[j+1],
+                    (nhg->count - j - 1) * sizeof(opennsl_if_t));
+            memmove(&nhg->links[j], &nhg->links[j+1],
+                    (nhg->count - j - 1) * sizeof(_brcm_sai_nhg_link_t));
+            memmove(&nhg->weights[j], &nhg->weights[j+1],
+                    (nhg->count - j - 1) * sizeof(sai_uint32_t));
+            nhg->count--;
+        }
+    }
+    if ((OPENNSL_E_NONE == rv) && (0 == _brcm_sai_nhg_live(nhg)))
+    {
+        /* Dead paths are better than an empty table */
+        for (j=0; j<nhg->count; j++)
+        {
+            nhg->links[j].pruned = false;
+        }
+    }
+    return _brcm_sai_nhg_buckets_write(nhg, &saved, rv);
+}
+
+/* Routine to change the member weights of a bucket group */
+STATIC int
+_brcm_sai_nhg_weights_update(_brcm_sai_nhg_t *nhg,
+                             const sai_u32_list_t *weights)
+{
+    int i, rv;
+    _brcm_sai_nhg_saved_t saved;
+
+    if ((NULL == weights->list) || (nhg->count != weights->count))
+    {
+        BRCM_SAI_LOG_NHG(SAI_LOG_ERROR, "Need a weight per path\n");
+        return OPENNSL_E_PARAM;
+    }
+    for (i=0; i<nhg->count; i++)
+    {
+        if (0 == weights->list[i])
+        {
+            BRCM_SAI_LOG_NHG(SAI_LOG_ERROR, "Path weight can't be 0\n");
+            return OPENNSL_E_PARAM;
+        }
+    }
+    rv = _brcm_sai_nhg_save(nhg, &saved);
+    if (OPENNSL_E_NONE != rv)
+    {
+        return rv;
+    }
+    memcpy(nhg->weights, weights->list, nhg->count * sizeof(sai_uint32_t));
+    return _brcm_sai_nhg_buckets_write(nhg, &saved, rv);
+}
+
+/* Routine to get the most paths an ECMP group can have */
+STATIC int
+_brcm_sai_nhg_ecmp_max_paths(void)
+{
+    sai_attribute_t attr;
+
+    attr.id = SAI_SWITCH_ATTR_ECMP_MAX_PATHS;
+    if ((SAI_STATUS_SUCCESS == _brcm_sai_get_switch_attribute(1, &attr)) &&
+        (0 < attr.value.u32))
+    {
+        return attr.value.u32;
+    }
+    return _BRCM_SAI_NHG_MAX_PATHS;
+}
+
+/* Routine to check that the members of a group are all different */
+STATIC sai_status_t
+_brcm_sai_nhg_members_unique(const _brcm_sai_nhg_t *nhg)
+{
+    int i, j;
+
+    for (i=0; i<nhg->count; i++)
+    {
+        for (j=i+1; j<nhg->count; j++)
+        {
+            if (nhg->members[i] == nhg->members[j])
+            {
+                return SAI_STATUS_INVALID_PARAMETER;
+            }
+        }
+    }
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Routine to order the members of a group */
+STATIC int
+_brcm_sai_nhg_path_cmp(const void *a, const void *b)
+{
+    const _brcm_sai_nhg_path_t *x = a, *y = b;
+
+    if (x->intf != y->intf)
+    {
+        return (x->intf < y->intf) ? -1 : 1;
+    }
+    return (x->weight < y->weight) ? -1 : (x->weight > y->weight);
+}
+
+/*
+ * Routine to compute the sorted member set of a group and its hash. The
+ * kind of group is part of the key, a bucket group only matches another
+ * bucket group with the same weights.
+ */
+STATIC void
+_brcm_sai_nhg_set_key(_brcm_sai_nhg_t *nhg)
+{
+    int i;
+    sai_uint32_t hash = 2166136261u;
+
+    for (i=0; i<nhg->count; i++)
+    {
+        nhg->sorted[i].intf = nhg->members[i];
+        nhg->sorted[i].weight = (NULL != nhg->weights) ? nhg->weights[i] : 0;
+    }
+    qsort(nhg->sorted, nhg->count, sizeof(_brcm_sai_nhg_path_t),
+          _brcm_sai_nhg_path_cmp);
+    for (i=0; i<nhg->count; i++)
+    {
+        hash = (hash ^ (sai_uint32_t)nhg->sorted[i].intf) * 16777619u;
+        hash = (hash ^ nhg->sorted[i].weight) * 16777619u;
+    }
+    hash = (hash ^ (nhg->resilient ? nhg->max_paths : 0)) * 16777619u;
+    nhg->set_hash = hash;
+}
+
+/* Routine to find a shared group with the same member set as key */
+STATIC _brcm_sai_nhg_t *
+_brcm_sai_nhg_set_find(const _brcm_sai_nhg_t *key)
+{
+    _brcm_sai_nhg_t *nhg;
+
+    if (false == key->shared)
+    {
+        return NULL;
+    }
+    for (nhg = _brcm_sai_nhg_set[key->set_hash % _BRCM_SAI_NHG_BUCKETS];
+         NULL != nhg; nhg = nhg->set_next)
+    {
+        if ((key->set_hash == nhg->set_hash) && (key->count == nhg->count) &&
+            (key->resilient == nhg->resilient) &&
+            (!key->resilient || (key->max_paths == nhg->max_paths)) &&
+            (0 == memcmp(key->sorted, nhg->sorted,
+                         key->count * sizeof(_brcm_sai_nhg_path_t))))
+        {
+            return nhg;
+        }
+    }
+    return NULL;
+}
+
+/* Routine to add a shared group to the member set hash */
+STATIC void
+_brcm_sai_nhg_set_link(_brcm_sai_nhg_t *nhg)
+{
+    _brcm_sai_nhg_t **bucket;
+
+    if (false == nhg->shared)
+    {
+        return;
+    }
+    bucket = &_brcm_sai_nhg_set[nhg->set_hash % _BRCM_SAI_NHG_BUCKETS];
+    nhg->set_next = *bucket;
+    *bucket = nhg;
+}
+
+/* Routine to take a group out of the member set hash */
+STATIC void
+_brcm_sai_nhg_set_unlink(_brcm_sai_nhg_t *nhg)
+{
+    _brcm_sai_nhg_t **prev;
+
+    prev = &_brcm_sai_nhg_set[nhg->set_hash % _BRCM_SAI_NHG_BUCKETS];
+    while ((NULL != *prev) && (nhg != *prev))
+    {
+        prev = &(*prev)->set_next;
+    }
+    if (NULL != *prev)
+    {
+        *prev = nhg->set_next;
+    }
+}
+
+/* Routine to find the port a next hop goes out of */
+STATIC void
+_brcm_sai_nhg_link_get(opennsl_if_t intf, _brcm_sai_nhg_link_t *link)
+{
+    opennsl_l3_egress_t l3_egr;
+
+    link->port = _BRCM_SAI_NHG_NO_PORT;
+    link->pruned = false;
+    opennsl_l3_egress_t_init(&l3_egr);
+    /* Trunk members fail over in the trunk, not in the group */
+    if ((OPENNSL_E_NONE == opennsl_l3_egress_get(0, intf, &l3_egr)) &&
+        !(l3_egr.flags & OPENNSL_L3_TGID))
+    {
+        link->port = l3_egr.port;
+    }
+}
+
+/* Routine to count the members of a group which are in hardware */
+STATIC int
+_brcm_sai_nhg_live(const _brcm_sai_nhg_t *nhg)
+{
+    int k, live = 0;
+
+    for (k=0; k<nhg->count; k++)
+    {
+        if (!nhg->links[k].pruned)
+        {
+            live++;
+        }
+    }
+    return live;
+}
+
+/* Routine to add a group to the port index, once per port */
+STATIC void
+_brcm_sai_nhg_ports_link(_brcm_sai_nhg_t *nhg)
+{
+    int k;
+    opennsl_port_t port;
+    _brcm_sai_nhg_port_ref_t *ref, **bucket;
+
+    for (k=0; k<nhg->count; k++)
+    {
+        port = nhg->links[k].port;
+        if (_BRCM_SAI_NHG_NO_PORT == port)
+        {
+            continue;
+        }
+        for (ref = nhg->ports; (NULL != ref) && (port != ref->port);
+             ref = ref->nhg_next);
+        if (NULL != ref)
+        {
+            continue;
+        }
+        ref = (_brcm_sai_nhg_port_ref_t*)
+                  calloc(1, sizeof(_brcm_sai_nhg_port_ref_t));
+        if (NULL == ref)
+        {
+            /* Only costs link protection for this port */
+            BRCM_SAI_LOG_NHG(SAI_LOG_ERROR, "Error allocating port index "
+                             "entry\n");
+            continue;
+        }
+        ref->port = port;
+        ref->nhg = nhg;
+        bucket = &_brcm_sai_nhg_port[port % _BRCM_SAI_NHG_PORT_BUCKETS];
+        ref->next = *bucket;
+        *bucket = ref;
+        ref->nhg_next = nhg->ports;
+        nhg->ports = ref;
+    }
+}
+
+/* Routine to take a group out of the port index */
+STATIC void
+_brcm_sai_nhg_ports_unlink(_brcm_sai_nhg_t *nhg)
+{
+    _brcm_sai_nhg_port_ref_t *ref, **prev;
+
+    while (NULL != nhg->ports)
+    {
+        ref = nhg->ports;
+        prev = &_brcm_sai_nhg_port[ref->port % _BRCM_SAI_NHG_PORT_BUCKETS];
+        while ((NULL != *prev) && (ref != *prev))
+        {
+            prev = &(*prev)->next;
+        }
+        if (NULL != *prev)
+        {
+            *prev = ref->next;
+        }
+        nhg->ports = ref->nhg_next;
+        free(ref);
+    }
+}
+
+/*
+ * Routine to take the members going out of a port out of the hardware
+ * group on link down, keeping at least one, or to put them back on link up.
+ * Putting back with _BRCM_SAI_NHG_NO_PORT puts back all the members.
+ */
+STATIC int
+_brcm_sai_nhg_prune(_brcm_sai_nhg_t *nhg, opennsl_port_t port, bool down)
+{
+    int k, live, changed = 0, rv = OPENNSL_E_NONE;
+    opennsl_l3_egress_ecmp_t ecmp_object;
+    _brcm_sai_nhg_saved_t saved;
+
+    live = _brcm_sai_nhg_live(nhg);
+    if (NULL != nhg->weights)
+    {
+        rv = _brcm_sai_nhg_save(nhg, &saved);
+        if (OPENNSL_E_NONE != rv)
+        {
+            return rv;
+        }
+    }
+    else
+    {
+        _brcm_sai_nhg_ecmp_init(nhg, &ecmp_object);
+    }
+    for (k=0; k<nhg->count; k++)
+    {
+        if ((down == nhg->links[k].pruned) ||
+            ((port != nhg->links[k].port) &&
+             (down || (_BRCM_SAI_NHG_NO_PORT != port))) ||
+            (down && (1 == live)))
+        {
+            continue;
+        }
+        if (NULL == nhg->weights)
+        {
+            rv = down ?
+                 opennsl_l3_egress_ecmp_delete(0, &ecmp_object,
+                                               nhg->members[k]) :
+                 opennsl_l3_egress_ecmp_add(0, &ecmp_object, nhg->members[k]);
+            if (OPENNSL_E_NONE != rv)
+            {
+                BRCM_SAI_LOG_NHG(SAI_LOG_ERROR, "Error %d %s path %d\n", rv,
+                                 down ? "pruning" : "restoring",
+                                 nhg->members[k]);
+                continue;
+            }
+        }
+        nhg->links[k].pruned = down;
+        live += down ? -1 : 1;
+        changed++;
+    }
+    if (NULL != nhg->weights)
+    {
+        if (changed)
+        {
+            rv = _brcm_sai_nhg_buckets_write(nhg, &saved, OPENNSL_E_NONE);
+        }
+        else
+        {
+            free(saved.members);
+            free(saved.links);
+            free(saved.weights);
+            free(saved.table);
+        }
+    }
+    if (changed)
+    {
+        BRCM_SAI_LOG_NHG(SAI_LOG_DEBUG, "nh group %d: %s %d paths, rv %d\n",
+                         nhg->ecmp_intf, down ? "pruned" : "restored",
+                         changed, rv);
+        _brcm_sai_nhg_paths_changed(nhg);
+    }
+    return rv;
+}
+
+/* Routine to make a group's members depend on the group */
+STATIC void
+_brcm_sai_nhg_deps_set(const _brcm_sai_nhg_t *nhg)
+{
+    int k;
+    sai_object_id_t *oids;
+
+    oids = (sai_object_id_t*)malloc(nhg->count * sizeof(sai_object_id_t));
+    if (NULL != oids)
+    {
+        for (k=0; k<nhg->count; k++)
+        {
+            oids[k] = BRCM_SAI_CREATE_OBJ(SAI_OBJECT_TYPE_NEXT_HOP,
+                                          nhg->members[k]);
+        }
+    }
+    if ((NULL == oids) ||
+        (SAI_STATUS_SUCCESS !=
+         _brcm_sai_deps_set(BRCM_SAI_CREATE_OBJ(SAI_OBJECT_TYPE_NEXT_HOP_GROUP,
+                                                nhg->ecmp_intf),
+                            nhg->count, oids)))
+    {
+        BRCM_SAI_LOG_NHG(SAI_LOG_ERROR, "Error tracking the members of nh "
+                         "group %d\n", nhg->ecmp_intf);
+    }
+    CHECK_FREE(oids);
+}
+
+/*
+ * Routine to let the indirect next hops forwarding like a group pick up a
+ * change of its hardware paths. Called with the group lock, which is always
+ * taken before the route lock.
+ */
+STATIC void
+_brcm_sai_nhg_paths_changed(const _brcm_sai_nhg_t *nhg)
+{
+    _brcm_sai_route_nhi_refresh(
+        BRCM_SAI_CREATE_OBJ(SAI_OBJECT_TYPE_NEXT_HOP_GROUP, nhg->ecmp_intf));
+}
+
+/* Routine to free the shadow of a group */
+STATIC void
+_brcm_sai_nhg_free(_brcm_sai_nhg_t *nhg)
+{
+    _brcm_sai_nhg_port_ref_t *ref;
+
+    while (NULL != nhg->ports)
+    {
+        ref = nhg->ports;
+        nhg->ports = ref->nhg_next;
+        free(ref);
+    }
+    CHECK_FREE(nhg->members);
+    CHECK_FREE(nhg->links);
+    CHECK_FREE(nhg->sorted);
+    CHECK_FREE(nhg->weights);
+    CHECK_FREE(nhg->table);
+    free(nhg);
+}
+
+/* Routine to free next hop group state */
+void
+_brcm_sai_free_nhg(void)
+{
+    int i;
+    _brcm_sai_nhg_t *nhg, *next;
+
+    _BRCM_SAI_NHG_LOCK();
+    for (i=0; i<_BRCM_SAI_NHG_BUCKETS; i++)
+    {
+        for (nhg = _brcm_sai_nhg[i]; NULL != nhg; nhg = next)
+        {
+            next = nhg->next;
+            _brcm_sai_nhg_free(nhg);
+        }
+        _brcm_sai_nhg[i] = NULL;
+        _brcm_sai_nhg_set[i] = NULL;
+    }
+    for (i=0; i<_BRCM_SAI_NHG_PORT_BUCKETS; i++)
+    {
+        _brcm_sai_nhg_port[i] = NULL;
+    }
+    _brcm_sai_nhg_link_protect = false;
+    _BRCM_SAI_NHG_UNLOCK();
+}
+
+/* Routine to turn link protection on or off, off puts back pruned paths */
+sai_status_t
+_brcm_sai_nhg_link_protect_set(bool enable)
+{
+    int i, rv = OPENNSL_E_NONE;
+    _brcm_sai_nhg_t *nhg;
+
+    _BRCM_SAI_NHG_LOCK();
+    _brcm_sai_nhg_link_protect = enable;
+    for (i=0; !enable && (i<_BRCM_SAI_NHG_BUCKETS); i++)
+    {
+        for (nhg = _brcm_sai_nhg[i]; NULL != nhg; nhg = nhg->next)
+        {
+            if (OPENNSL_E_NONE !=
+                _brcm_sai_nhg_prune(nhg, _BRCM_SAI_NHG_NO_PORT, false))
+            {
+                rv = OPENNSL_E_FAIL;
+            }
+        }
+    }
+    _BRCM_SAI_NHG_UNLOCK();
+    return BRCM_RV_OPENNSL_TO_SAI(rv);
+}
+
+/* Routine to get whether link protection is on */
+bool
+_brcm_sai_nhg_link_protect_get(void)
+{
+    return _brcm_sai_nhg_link_protect;
+}
+
+/*
+ * Routine to prune or restore the paths going out of a port, called from
+ * the link scan callback.
+ */
+void
+_brcm_sai_nhg_link_event(opennsl_port_t port, bool up)
+{
+    _brcm_sai_nhg_port_ref_t *ref;
+
+    _BRCM_SAI_NHG_LOCK();
+    ref = _brcm_sai_nhg_port[port % _BRCM_SAI_NHG_PORT_BUCKETS];
+    for (; _brcm_sai_nhg_link_protect && (NULL != ref); ref = ref->next)
+    {
+        if (port == ref->port)
+        {
+            (void)_brcm_sai_nhg_prune(ref->nhg, port, !up);
+        }
+    }
+    _BRCM_SAI_NHG_UNLOCK();
+}
+
 /*
 *  Next Hop methods table retrieved with sai_api_query()
 */
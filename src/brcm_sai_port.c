@@ -30,6 +30,9 @@ _brcm_sai_link_event_cb(int unit, opennsl_port_t port,
 {
     sai_port_oper_status_notification_t status;
 
+    /* Fix up the data plane before telling the control plane */
+    _brcm_sai_nhg_link_event(port,
+                             OPENNSL_PORT_LINK_STATUS_UP == info->linkstatus);
     if (NULL == host_callbacks.on_port_state_change)
     {
         return;
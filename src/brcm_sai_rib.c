@@ -0,0 +1,531 @@
+/*********************************************************************
+ *
+ * (C) Copyright Broadcom Corporation 2013-2016
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ **********************************************************************/
+
+#include <sai.h>
+#include <brcm_sai_common.h>
+
+/*
+################################################################################
+#                                Local state                                   #
+################################################################################
+*/
+/*
+ * Shadow RIB of the programmed routes. Each vrf has a path compressed binary
+ * trie per address family. Keys are stored inline in the nodes in network
+ * byte order with the host bits cleared. Nodes which don't carry a route are
+ * only kept around as branch points with two children.
+ */
+typedef struct _brcm_sai_rib_s {
+    _brcm_sai_rib_node_t *root[2];   /* Indexed by sai_ip_addr_family_t */
+    sai_uint32_t count[2];           /* Number of routes */
+    sai_uint32_t hw_count[2][2];     /* Programmed routes by family and table */
+} _brcm_sai_rib_t;
+static _brcm_sai_rib_t *_brcm_sai_rib = NULL;
+static sai_uint32_t _brcm_sai_rib_vr_max;
+/* Programmed routes across all the vrfs by family and table */
+static sai_uint32_t _brcm_sai_rib_hw_total[2][2];
+
+/*
+################################################################################
+#                               Trie helpers                                   #
+################################################################################
+*/
+#define _BRCM_SAI_RIB_BIT(__key, __pos) \
+    (((__key)[(__pos) >> 3] >> (7 - ((__pos) & 7))) & 1)
+
+/* Number of leading bits, upto max, which are the same in both keys */
+STATIC int
+_brcm_sai_rib_common_len(const uint8_t *a, const uint8_t *b, int max)
+{
+    int len = 0;
+    uint8_t diff;
+
+    while (len < max)
+    {
+        diff = a[len >> 3] ^ b[len >> 3];
+        if (0 == diff)
+        {
+            len += 8;
+            continue;
+        }
+        while (0 == (diff & 0x80))
+        {
+            diff <<= 1;
+            len++;
+        }
+        break;
+    }
+    return (len < max) ? len : max;
+}
+
+/* Convert a SAI prefix into a masked key and a prefix length */
+STATIC sai_status_t
+_brcm_sai_rib_key_get(const sai_ip_prefix_t *prefix, uint8_t *key,
+                      uint8_t *len)
+{
+    int i, bytes;
+    const uint8_t *addr, *mask;
+
+    if (SAI_IP_ADDR_FAMILY_IPV4 == prefix->addr_family)
+    {
+        bytes = sizeof(sai_ip4_t);
+        addr = (const uint8_t*)&prefix->addr.ip4;
+        mask = (const uint8_t*)&prefix->mask.ip4;
+    }
+    else if (SAI_IP_ADDR_FAMILY_IPV6 == prefix->addr_family)
+    {
+        bytes = sizeof(sai_ip6_t);
+        addr = prefix->addr.ip6;
+        mask = prefix->mask.ip6;
+    }
+    else
+    {
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+    memset(key, 0, sizeof(sai_ip6_t));
+    *len = 0;
+    for (i=0; i<bytes; i++)
+    {
+        key[i] = addr[i] & mask[i];
+        *len += __builtin_popcount(mask[i]);
+    }
+    return SAI_STATUS_SUCCESS;
+}
+
+STATIC _brcm_sai_rib_node_t *
+_brcm_sai_rib_node_alloc(const uint8_t *key, uint8_t len)
+{
+    _brcm_sai_rib_node_t *node;
+
+    node = (_brcm_sai_rib_node_t*)calloc(1, sizeof(_brcm_sai_rib_node_t));
+    if (NULL == node)
+    {
+        return NULL;
+    }
+    memcpy(node->key, key, sizeof(node->key));
+    node->len = len;
+    return node;
+}
+
+/* Return the link in the parent (or the root) which points to a node */
+STATIC _brcm_sai_rib_node_t **
+_brcm_sai_rib_link_get(_brcm_sai_rib_node_t **root, _brcm_sai_rib_node_t *node)
+{
+    if (NULL == node->parent)
+    {
+        return root;
+    }
+    return (node->parent->child[0] == node) ? &node->parent->child[0] :
+                                              &node->parent->child[1];
+}
+
+STATIC void
+_brcm_sai_rib_tree_free(_brcm_sai_rib_node_t *node)
+{
+    if (NULL == node)
+    {
+        return;
+    }
+    _brcm_sai_rib_tree_free(node->child[0]);
+    _brcm_sai_rib_tree_free(node->child[1]);
+    free(node);
+}
+
+/*
+################################################################################
+#                                Internal functions                            #
+################################################################################
+*/
+
+/* Routine to allocate rib state */
+sai_status_t
+_brcm_sai_alloc_rib(int max)
+{
+    if ((NULL == _brcm_sai_rib) && max)
+    {
+        _brcm_sai_rib = (_brcm_sai_rib_t*)calloc(max+1,
+                                                 sizeof(_brcm_sai_rib_t));
+        if (NULL == _brcm_sai_rib)
+        {
+            BRCM_SAI_LOG_ROUTE(SAI_LOG_CRITICAL,
+                               "Error allocating memory for rib state.\n");
+            return SAI_STATUS_NO_MEMORY;
+        }
+        _brcm_sai_rib_vr_max = max;
+    }
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Routine to free rib state */
+void
+_brcm_sai_free_rib(void)
+{
+    int vr, af;
+
+    if (NULL != _brcm_sai_rib)
+    {
+        for (vr=0; vr<=_brcm_sai_rib_vr_max; vr++)
+        {
+            for (af=0; af<2; af++)
+            {
+                _brcm_sai_rib_tree_free(_brcm_sai_rib[vr].root[af]);
+            }
+        }
+        CHECK_FREE(_brcm_sai_rib);
+        _brcm_sai_rib = NULL;
+    }
+    memset(_brcm_sai_rib_hw_total, 0, sizeof(_brcm_sai_rib_hw_total));
+}
+
+/*
+ * Routine to account for a route being added to (delta > 0) or removed from
+ * (delta < 0) the host or LPM table. Called with the route lock held.
+ */
+void
+_brcm_sai_rib_hw_count_update(sai_uint32_t vr_id, sai_ip_addr_family_t af,
+                              bool host, int delta)
+{
+    if ((NULL == _brcm_sai_rib) || (_brcm_sai_rib_vr_max < vr_id))
+    {
+        return;
+    }
+    _brcm_sai_rib[vr_id].hw_count[af][host ? 1 : 0] += delta;
+    _brcm_sai_rib_hw_total[af][host ? 1 : 0] += delta;
+}
+
+/* Routine to get the number of routes a vrf has in the host or LPM table */
+sai_uint32_t
+_brcm_sai_rib_hw_count_get(sai_uint32_t vr_id, sai_ip_addr_family_t af,
+                           bool host)
+{
+    if ((NULL == _brcm_sai_rib) || (_brcm_sai_rib_vr_max < vr_id))
+    {
+        return 0;
+    }
+    return _brcm_sai_rib[vr_id].hw_count[af][host ? 1 : 0];
+}
+
+/* Routine to get the number of routes all vrfs have in the host or LPM table */
+sai_uint32_t
+_brcm_sai_rib_hw_total_get(sai_ip_addr_family_t af, bool host)
+{
+    return _brcm_sai_rib_hw_total[af][host ? 1 : 0];
+}
+
+/* Routine to find the exact match of a prefix */
+_brcm_sai_rib_node_t *
+_brcm_sai_rib_lookup(sai_uint32_t vr_id, const sai_ip_prefix_t *prefix)
+{
+    uint8_t key[sizeof(sai_ip6_t)], len;
+    _brcm_sai_rib_node_t *node;
+
+    if ((NULL == _brcm_sai_rib) || (_brcm_sai_rib_vr_max < vr_id) ||
+        (SAI_STATUS_SUCCESS != _brcm_sai_rib_key_get(prefix, key, &len)))
+    {
+        return NULL;
+    }
+    node = _brcm_sai_rib[vr_id].root[prefix->addr_family];
+    while ((NULL != node) && (node->len <= len))
+    {
+        if (_brcm_sai_rib_common_len(node->key, key, node->len) != node->len)
+        {
+            break;
+        }
+        if (node->len == len)
+        {
+            return node->valid ? node : NULL;
+        }
+        node = node->child[_BRCM_SAI_RIB_BIT(key, node->len)];
+    }
+    return NULL;
+}
+
+/* Routine to add a prefix, returns the existing node if already present */
+sai_status_t
+_brcm_sai_rib_add(sai_uint32_t vr_id, const sai_ip_prefix_t *prefix,
+                  const _brcm_sai_route_info_t *info,
+                  _brcm_sai_rib_node_t **out)
+{
+    int clen;
+    uint8_t key[sizeof(sai_ip6_t)], len;
+    _brcm_sai_rib_node_t **root, **link, *node, *parent = NULL;
+    _brcm_sai_rib_node_t *new_node, *glue;
+
+    if ((NULL == _brcm_sai_rib) || (_brcm_sai_rib_vr_max < vr_id) ||
+        (SAI_STATUS_SUCCESS != _brcm_sai_rib_key_get(prefix, key, &len)))
+    {
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+    root = &_brcm_sai_rib[vr_id].root[prefix->addr_family];
+    link = root;
+    node = *link;
+    while ((NULL != node) && (node->len <= len) &&
+           (_brcm_sai_rib_common_len(node->key, key, node->len) == node->len))
+    {
+        if (node->len == len)
+        {
+            if (out)
+            {
+                *out = node;
+            }
+            if (node->valid)
+            {
+                return SAI_STATUS_ITEM_ALREADY_EXISTS;
+            }
+            /* Branch node being turned into a route */
+            node->valid = true;
+            node->suppressed = false;
+            node->vr_id = vr_id;
+            node->addr_family = prefix->addr_family;
+            node->info = *info;
+            (void)_brcm_sai_deps_ref(info->nh_id, SAI_NULL_OBJECT_ID);
+            _brcm_sai_rib[vr_id].count[prefix->addr_family]++;
+            return SAI_STATUS_SUCCESS;
+        }
+        parent = node;
+        link = &node->child[_BRCM_SAI_RIB_BIT(key, node->len)];
+        node = *link;
+    }
+    new_node = _brcm_sai_rib_node_alloc(key, len);
+    if (NULL == new_node)
+    {
+        return SAI_STATUS_NO_MEMORY;
+    }
+    new_node->valid = true;
+    new_node->vr_id = vr_id;
+    new_node->addr_family = prefix->addr_family;
+    new_node->info = *info;
+    if (NULL == node)
+    {
+        new_node->parent = parent;
+        *link = new_node;
+    }
+    else
+    {
+        clen = _brcm_sai_rib_common_len(node->key, key,
+                                        (node->len < len) ? node->len : len);
+        if (clen == len)
+        {
+            /* New prefix covers the existing subtree */
+            new_node->child[_BRCM_SAI_RIB_BIT(node->key, len)] = node;
+            new_node->parent = parent;
+            node->parent = new_node;
+            *link = new_node;
+        }
+        else
+        {
+            /* Prefixes diverge, hang both off a branch node */
+            glue = _brcm_sai_rib_node_alloc(key, clen);
+            if (NULL == glue)
+            {
+                free(new_node);
+                return SAI_STATUS_NO_MEMORY;
+            }
+            memset(glue->key, 0, sizeof(glue->key));
+            memcpy(glue->key, key, clen >> 3);
+            if (clen & 7)
+            {
+                glue->key[clen >> 3] = key[clen >> 3] &
+                                       (uint8_t)(0xFF << (8 - (clen & 7)));
+            }
+            glue->child[_BRCM_SAI_RIB_BIT(key, clen)] = new_node;
+            glue->child[_BRCM_SAI_RIB_BIT(node->key, clen)] = node;
+            glue->parent = parent;
+            new_node->parent = glue;
+            node->parent = glue;
+            *link = glue;
+        }
+    }
+    (void)_brcm_sai_deps_ref(info->nh_id, SAI_NULL_OBJECT_ID);
+    _brcm_sai_rib[vr_id].count[prefix->addr_family]++;
+    if (out)
+    {
+        *out = new_node;
+    }
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Routine to remove a prefix and collapse the branch nodes left behind */
+sai_status_t
+_brcm_sai_rib_delete(sai_uint32_t vr_id, const sai_ip_prefix_t *prefix)
+{
+    _brcm_sai_rib_node_t **root, **link, *node, *child, *parent;
+
+    node = _brcm_sai_rib_lookup(vr_id, prefix);
+    if (NULL == node)
+    {
+        return SAI_STATUS_ITEM_NOT_FOUND;
+    }
+    root = &_brcm_sai_rib[vr_id].root[prefix->addr_family];
+    _brcm_sai_rib[vr_id].count[prefix->addr_family]--;
+    _brcm_sai_deps_unref(node->info.nh_id, SAI_NULL_OBJECT_ID);
+    node->valid = false;
+    while ((NULL != node) && (false == node->valid) &&
+           ((NULL == node->child[0]) || (NULL == node->child[1])))
+    {
+        parent = node->parent;
+        child = (NULL != node->child[0]) ? node->child[0] : node->child[1];
+        link = _brcm_sai_rib_link_get(root, node);
+        *link = child;
+        if (NULL != child)
+        {
+            child->parent = parent;
+        }
+        free(node);
+        /* Only a parent which lost a child can have become redundant */
+        node = (NULL == child) ? parent : NULL;
+    }
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Routine to change the forwarding of a route and its next hop reference */
+void
+_brcm_sai_rib_info_set(_brcm_sai_rib_node_t *node,
+                       const _brcm_sai_route_info_t *info)
+{
+    if (node->info.nh_id != info->nh_id)
+    {
+        (void)_brcm_sai_deps_ref(info->nh_id, SAI_NULL_OBJECT_ID);
+        _brcm_sai_deps_unref(node->info.nh_id, SAI_NULL_OBJECT_ID);
+    }
+    node->info = *info;
+}
+
+/* Routine to find the closest less specific route covering a route */
+_brcm_sai_rib_node_t *
+_brcm_sai_rib_cover_get(_brcm_sai_rib_node_t *node)
+{
+    for (node = node->parent; NULL != node; node = node->parent)
+    {
+        if (node->valid)
+        {
+            return node;
+        }
+    }
+    return NULL;
+}
+
+/* Routine to convert a route node back into a SAI route */
+void
+_brcm_sai_rib_route_get(const _brcm_sai_rib_node_t *node,
+                        sai_unicast_route_entry_t *route)
+{
+    int i, bytes;
+    uint8_t *addr, *mask;
+
+    memset(route, 0, sizeof(sai_unicast_route_entry_t));
+    route->vr_id = BRCM_SAI_CREATE_OBJ(SAI_OBJECT_TYPE_VIRTUAL_ROUTER,
+                                       node->vr_id);
+    route->destination.addr_family = node->addr_family;
+    if (SAI_IP_ADDR_FAMILY_IPV4 == node->addr_family)
+    {
+        bytes = sizeof(sai_ip4_t);
+        addr = (uint8_t*)&route->destination.addr.ip4;
+        mask = (uint8_t*)&route->destination.mask.ip4;
+    }
+    else
+    {
+        bytes = sizeof(sai_ip6_t);
+        addr = route->destination.addr.ip6;
+        mask = route->destination.mask.ip6;
+    }
+    memcpy(addr, node->key, bytes);
+    for (i=0; i<node->len; i++)
+    {
+        mask[i >> 3] |= 0x80 >> (i & 7);
+    }
+}
+
+/* Routine to visit the closest more specific routes below a node */
+sai_status_t
+_brcm_sai_rib_subtree_walk(_brcm_sai_rib_node_t *node,
+                           _brcm_sai_rib_walk_cb cb, void *data)
+{
+    int i;
+    sai_status_t rv, ret = SAI_STATUS_SUCCESS;
+    _brcm_sai_rib_node_t *child;
+
+    for (i=0; i<2; i++)
+    {
+        child = node->child[i];
+        if (NULL == child)
+        {
+            continue;
+        }
+        rv = child->valid ? cb(child, data) :
+                            _brcm_sai_rib_subtree_walk(child, cb, data);
+        if (SAI_STATUS_SUCCESS != rv)
+        {
+            ret = rv;
+        }
+    }
+    return ret;
+}
+
+/* Routine to visit every route, less specific routes first */
+STATIC sai_status_t
+_brcm_sai_rib_tree_walk(_brcm_sai_rib_node_t *node,
+                        _brcm_sai_rib_walk_cb cb, void *data)
+{
+    sai_status_t rv, ret = SAI_STATUS_SUCCESS;
+
+    if (NULL == node)
+    {
+        return SAI_STATUS_SUCCESS;
+    }
+    if (node->valid)
+    {
+        ret = cb(node, data);
+    }
+    rv = _brcm_sai_rib_tree_walk(node->child[0], cb, data);
+    if (SAI_STATUS_SUCCESS != rv)
+    {
+        ret = rv;
+    }
+    rv = _brcm_sai_rib_tree_walk(node->child[1], cb, data);
+    if (SAI_STATUS_SUCCESS != rv)
+    {
+        ret = rv;
+    }
+    return ret;
+}
+
+/* Routine to visit all the routes in all the vrfs */
+sai_status_t
+_brcm_sai_rib_walk(_brcm_sai_rib_walk_cb cb, void *data)
+{
+    int vr, af;
+    sai_status_t rv, ret = SAI_STATUS_SUCCESS;
+
+    if (NULL == _brcm_sai_rib)
+    {
+        return SAI_STATUS_SUCCESS;
+    }
+    for (vr=0; vr<=_brcm_sai_rib_vr_max; vr++)
+    {
+        for (af=0; af<2; af++)
+        {
+            rv = _brcm_sai_rib_tree_walk(_brcm_sai_rib[vr].root[af], cb, data);
+            if (SAI_STATUS_SUCCESS != rv)
+            {
+                ret = rv;
+            }
+        }
+    }
+    return ret;
+}
@@ -16,18 +16,230 @@
  *
  **********************************************************************/
 
+#include <sched.h>
 #include <sai.h>
 #include <brcm_sai_common.h>
 
+/*
+################################################################################
+#                                Local state                                   #
+################################################################################
+*/
+#define _BRCM_SAI_ROUTE_COALESCE_INTERVAL   10      /* msec */
+#define _BRCM_SAI_ROUTE_COALESCE_BATCH      1024
+#define _BRCM_SAI_ROUTE_PENDING_BUCKETS     4096
+#define _BRCM_SAI_ROUTE_LOG_EGR_BUCKETS     1024
+#define _BRCM_SAI_ROUTE_NHI_BUCKETS         256
+#define _BRCM_SAI_ROUTE_NHI_MAX_PATHS       64
+#define _BRCM_SAI_ROUTE_ASYNC_DEPTH         8192
+#define _BRCM_SAI_ROUTE_ASYNC_MAX_ATTRS     3
+
+typedef struct _brcm_sai_route_bulk_s {
+    bool exists;                    /* Identical route already there */
+    _brcm_sai_route_info_t info;
+    opennsl_l3_route_t l3_rt;
+} _brcm_sai_route_bulk_t;
+
+/*
+ * A prefix with route operations not yet written to the hardware. The rib
+ * always holds the latest requested state, a pending entry only remembers
+ * what the hardware had before the first deferred operation so that the
+ * flush can program the net difference.
+ */
+typedef struct _brcm_sai_route_pending_s {
+    struct _brcm_sai_route_pending_s *next;     /* Hash chain */
+    struct _brcm_sai_route_pending_s *list;     /* Flush order */
+    sai_unicast_route_entry_t route;
+    bool hw_valid;
+    _brcm_sai_route_info_t hw_info;
+} _brcm_sai_route_pending_t;
+
+typedef struct _brcm_sai_route_coalesce_s {
+    bool enabled;
+    bool thread_run;
+    pthread_t thread;
+    pthread_cond_t cond;
+    sai_uint32_t interval;                      /* msec, 0 for no timer */
+    sai_uint32_t batch;                         /* 0 for no batch limit */
+    sai_uint32_t count;
+    _brcm_sai_route_pending_t **table;
+    _brcm_sai_route_pending_t *head;
+    _brcm_sai_route_pending_t *tail;
+} _brcm_sai_route_coalesce_t;
+
+/*
+ * Egress objects derived from a next hop egress with extra flags, shared by
+ * all the routes which need the same variant (e.g. COPY_TO_CPU for LOG).
+ */
+typedef struct _brcm_sai_route_log_egr_s {
+    struct _brcm_sai_route_log_egr_s *next;
+    opennsl_if_t base;
+    uint32 flags;
+    opennsl_if_t clone;
+    sai_uint32_t ref_count;
+} _brcm_sai_route_log_egr_t;
+
+/*
+ * An indirect next hop, a group owned by the adapter which routes point at
+ * instead of their real next hop. Retargeting it replaces the group members
+ * in place so the routes never need to be rewritten. The next hop group
+ * module asks for a refresh when the members of a target group change.
+ */
+typedef struct _brcm_sai_route_nhi_s {
+    struct _brcm_sai_route_nhi_s *next;
+    opennsl_if_t ecmp_intf;
+    int max_paths;
+    sai_object_id_t target_id;
+} _brcm_sai_route_nhi_t;
+
+/*
+ * Route operations queued for the async worker. Slots carry a sequence
+ * number so that producers claim them with a single compare and swap and
+ * the worker knows when a claimed slot has been filled in.
+ */
+typedef struct _brcm_sai_route_async_slot_s {
+    sai_uint32_t seq;
+    brcm_sai_route_op_t op;
+    sai_unicast_route_entry_t route;
+    sai_uint32_t attr_count;
+    sai_attribute_t attrs[_BRCM_SAI_ROUTE_ASYNC_MAX_ATTRS];
+} _brcm_sai_route_async_slot_t;
+
+typedef struct _brcm_sai_route_async_s {
+    bool enabled;
+    bool thread_run;
+    pthread_t thread;
+    sem_t sem;                                  /* Queued entries */
+    pthread_mutex_t mutex;
+    pthread_cond_t drained;
+    sai_uint32_t depth;
+    sai_uint32_t mask;
+    sai_uint32_t head;                          /* Next slot to claim */
+    sai_uint32_t tail;                          /* Next slot to program */
+    sai_uint32_t posted;
+    sai_uint32_t done;
+    sai_uint32_t busy;                          /* Callers in post */
+    _brcm_sai_route_async_slot_t *ring;
+    brcm_sai_route_async_notification_fn notify;
+} _brcm_sai_route_async_t;
+
+/*
+ * Occupancy watermarks of a route table. The high watermark is raised once
+ * when reached and is armed again when the table drains to the low one.
+ * Crossings are recorded under the route lock and delivered after it.
+ */
+typedef struct _brcm_sai_route_watermark_s {
+    sai_uint32_t high;                          /* 0 for disabled */
+    sai_uint32_t low;
+    bool above;
+    bool notified;                              /* Last delivered above */
+    sai_uint32_t count;                         /* Entries at the crossing */
+} _brcm_sai_route_watermark_t;
+
+static pthread_mutex_t _brcm_sai_route_mutex = PTHREAD_MUTEX_INITIALIZER;
+static _brcm_sai_route_coalesce_t _brcm_sai_route_coalesce = {
+    .cond = PTHREAD_COND_INITIALIZER,
+    .interval = _BRCM_SAI_ROUTE_COALESCE_INTERVAL,
+    .batch = _BRCM_SAI_ROUTE_COALESCE_BATCH,
+};
+
+static _brcm_sai_route_async_t _brcm_sai_route_async = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .drained = PTHREAD_COND_INITIALIZER,
+    .depth = _BRCM_SAI_ROUTE_ASYNC_DEPTH,
+};
+
+static _brcm_sai_route_log_egr_t
+    *_brcm_sai_route_log_egr[_BRCM_SAI_ROUTE_LOG_EGR_BUCKETS];
+
+static _brcm_sai_route_nhi_t
+    *_brcm_sai_route_nhi[_BRCM_SAI_ROUTE_NHI_BUCKETS];
+
+static bool _brcm_sai_route_fib_compress = false;
+
+/* Indexed by brcm_sai_route_table_t */
+static _brcm_sai_route_watermark_t _brcm_sai_route_watermark[2];
+static brcm_sai_route_resource_notification_fn _brcm_sai_route_resource_notify;
+static bool _brcm_sai_route_resource_busy;      /* Delivering crossings */
+
+#define _BRCM_SAI_ROUTE_LOCK()   pthread_mutex_lock(&_brcm_sai_route_mutex)
+#define _BRCM_SAI_ROUTE_UNLOCK() _brcm_sai_route_unlock()
+
+#define _BRCM_SAI_ROUTE_ASYNC()                                               \
+    __atomic_load_n(&_brcm_sai_route_async.enabled, __ATOMIC_ACQUIRE)
+
+#define _BRCM_SAI_ROUTE_SAME_FWD(__a, __b)                                    \
+    (((__a)->nh_id == (__b)->nh_id) && ((__a)->action == (__b)->action))
+
 /*
 ################################################################################
 #                             Forward declarations                             #
 ################################################################################
 */
+STATIC void
+_brcm_sai_route_unlock(void);
+STATIC sai_status_t
+_brcm_sai_route_create(const sai_unicast_route_entry_t* unicast_route_entry,
+                       sai_uint32_t attr_count,
+                       const sai_attribute_t *attr_list);
+STATIC sai_status_t
+_brcm_sai_route_remove(const sai_unicast_route_entry_t* unicast_route_entry);
 STATIC sai_status_t
 _brcm_sai_update_route(const sai_unicast_route_entry_t* unicast_route_entry,
                        sai_uint32_t attr_count,
                        const sai_attribute_t *attr_list);
+STATIC sai_status_t
+_brcm_sai_route_key_set(const sai_unicast_route_entry_t* unicast_route_entry,
+                        opennsl_l3_route_t *l3_rt);
+STATIC sai_status_t
+_brcm_sai_route_attr_parse(sai_uint32_t attr_count,
+                           const sai_attribute_t *attr_list,
+                           _brcm_sai_route_info_t *info);
+STATIC sai_status_t
+_brcm_sai_route_check(const sai_unicast_route_entry_t* unicast_route_entry,
+                      const _brcm_sai_route_info_t *info);
+STATIC sai_status_t
+_brcm_sai_route_l3_build(const sai_unicast_route_entry_t* unicast_route_entry,
+                         const _brcm_sai_route_info_t *info,
+                         opennsl_l3_route_t *l3_rt);
+STATIC int
+_brcm_sai_route_hw_add(opennsl_l3_route_t *l3_rt, _brcm_sai_route_info_t *info,
+                       const _brcm_sai_route_info_t *hw_info);
+STATIC int
+_brcm_sai_route_hw_delete(const opennsl_l3_route_t *l3_rt, bool host);
+STATIC void
+_brcm_sai_route_hw_count(const opennsl_l3_route_t *l3_rt, bool host,
+                         int delta);
+STATIC sai_status_t
+_brcm_sai_route_log_egr_get(opennsl_if_t base, uint32 flags,
+                            opennsl_if_t *clone);
+STATIC void
+_brcm_sai_route_info_release(const _brcm_sai_route_info_t *info);
+STATIC sai_status_t
+_brcm_sai_route_pending_mark(const sai_unicast_route_entry_t* unicast_route_entry,
+                             const _brcm_sai_route_info_t *hw_info);
+STATIC void
+_brcm_sai_route_pending_batch_check(void);
+STATIC sai_status_t
+_brcm_sai_route_fib_create(const sai_unicast_route_entry_t* unicast_route_entry,
+                           const _brcm_sai_route_info_t *info);
+STATIC sai_status_t
+_brcm_sai_route_fib_remove(_brcm_sai_rib_node_t *node);
+STATIC sai_status_t
+_brcm_sai_route_fib_update(_brcm_sai_rib_node_t *node,
+                           const _brcm_sai_route_info_t *info);
+STATIC void
+_brcm_sai_route_pending_flush(void);
+STATIC bool
+_brcm_sai_route_async_post(brcm_sai_route_op_t op,
+                           const sai_unicast_route_entry_t* unicast_route_entry,
+                           sai_uint32_t attr_count,
+                           const sai_attribute_t *attr_list,
+                           sai_status_t *rv);
+STATIC void
+_brcm_sai_route_async_drain(void);
+STATIC void
+_brcm_sai_route_async_stop(void);
 
 /*
 ################################################################################
@@ -54,125 +266,21 @@ brcm_sai_create_route(_In_ const sai_unicast_route_entry_t* unicast_route_entry,
                       _In_ sai_uint32_t attr_count,
                       _In_ const sai_attribute_t *attr_list)
 {
-    int i;
     sai_status_t rv;
-    opennsl_if_t l3_if_id = -1;
-    opennsl_l3_route_t l3_rt;
-    bool trap = false,  drop = false, copy_to_cpu = false;
-    sai_uint32_t vr_id;
 
     BRCM_SAI_FUNCTION_ENTER(SAI_API_ROUTE);
     BRCM_SAI_SWITCH_INIT_CHECK;
     BRCM_SAI_OBJ_CREATE_PARAM_CHK(unicast_route_entry);
 
-    opennsl_l3_route_t_init(&l3_rt);
-    for (i=0; i<attr_count; i++)
-    {
-        switch (attr_list[i].id)
-        {
-            case SAI_ROUTE_ATTR_NEXT_HOP_ID:
-                l3_if_id = BRCM_SAI_GET_OBJ_VAL(opennsl_if_t,
-                                                BRCM_SAI_ATTR_LIST_OBJ(i));
-                if (SAI_OBJECT_TYPE_NEXT_HOP_GROUP ==
-                    BRCM_SAI_GET_OBJ_TYPE(BRCM_SAI_ATTR_LIST_OBJ(i)))
-                {
-                    l3_rt.l3a_flags |= OPENNSL_L3_MULTIPATH;
-                }
-                break;
-            case SAI_ROUTE_ATTR_PACKET_ACTION:
-                if (SAI_PACKET_ACTION_LOG == attr_list[i].value.u32)
-                {
-                    copy_to_cpu = true;
-                }
-                else if (SAI_PACKET_ACTION_TRAP == attr_list[i].value.u32)
-                {
-                    trap = true;
-                    l3_rt.l3a_flags |= OPENNSL_L3_DEFIP_CPU;
-                }
-                else if (SAI_PACKET_ACTION_DROP == attr_list[i].value.u32)
-                {
-                    drop = true;
-                    l3_rt.l3a_flags |= OPENNSL_L3_DST_DISCARD;
-                }
-                else
-                {
-                    BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "Bad attribute passed\n");
-                    return SAI_STATUS_INVALID_PARAMETER;
-                }
-                break;
-            default:
-                BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "Unimplemented attribute passed\n");
-                break;
-        }
-    }
-    if (-1 == l3_if_id && FALSE == trap && FALSE == drop)
-    {
-        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "Missing routing info.\n");
-                           return SAI_STATUS_INVALID_PARAMETER;
-    }
-    if (SAI_IP_ADDR_FAMILY_IPV4 == unicast_route_entry->destination.addr_family)
-    {
-        l3_rt.l3a_ip_mask = ntohl(unicast_route_entry->destination.mask.ip4);
-        l3_rt.l3a_subnet = ntohl(unicast_route_entry->destination.addr.ip4 &
-                                 unicast_route_entry->destination.mask.ip4);
-    }
-    else if (SAI_IP_ADDR_FAMILY_IPV6 ==
-             unicast_route_entry->destination.addr_family)
-    {
-        memcpy(l3_rt.l3a_ip6_net, unicast_route_entry->destination.addr.ip6,
-               sizeof(l3_rt.l3a_ip6_net));
-        memcpy(l3_rt.l3a_ip6_mask, unicast_route_entry->destination.mask.ip6,
-               sizeof(l3_rt.l3a_ip6_mask));
-    }
-    else
-    {
-        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "Bad address family passed\n");
-        return SAI_STATUS_INVALID_PARAMETER;
-    }
-    vr_id = BRCM_SAI_GET_OBJ_VAL(sai_uint32_t, unicast_route_entry->vr_id);
-    if (false == _brcm_sai_vr_id_valid(vr_id))
-    {
-        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR,
-                           "Invalid VR id passed during route create %d\n",
-                           vr_id);
-        return SAI_STATUS_INVALID_PARAMETER;
-    }
-
-    l3_rt.l3a_vrf = vr_id;
-    if (trap)
-    {
-        l3_rt.l3a_intf = _brcm_sai_vrf_if_get(l3_rt.l3a_vrf);
-    }
-    else if (drop)
-    {
-        l3_rt.l3a_intf = _brcm_sai_vrf_drop_if_get(l3_rt.l3a_vrf);
-    }
-    else
+    if (_brcm_sai_route_async_post(BRCM_SAI_ROUTE_OP_CREATE, unicast_route_entry,
+                                   attr_count, attr_list, &rv))
     {
-        l3_rt.l3a_intf = l3_if_id;
-
-        if (TRUE == copy_to_cpu)
-        {
-          opennsl_l3_egress_t l3_egr;
-          uint32 flags = OPENNSL_L3_REPLACE | OPENNSL_L3_WITH_ID;
-
-          rv = opennsl_l3_egress_get(0, l3_if_id, &l3_egr);
-          BRCM_SAI_API_CHK(SAI_API_ROUTE, "L3 egress get", rv);
-
-          l3_egr.flags |= OPENNSL_L3_COPY_TO_CPU;
-          rv = opennsl_l3_egress_create(0, flags, &l3_egr, &l3_if_id);
-          BRCM_SAI_API_CHK(SAI_API_ROUTE, "L3 egress create w/ replace", rv);
-        }
+        BRCM_SAI_FUNCTION_EXIT(SAI_API_ROUTE);
+        return rv;
     }
-    BRCM_SAI_LOG_ROUTE(SAI_LOG_DEBUG,
-                       "Add route vrf: %d, egr %s id: %d mask 0x%x, subnet 0x%x\n",
-                       l3_rt.l3a_vrf,
-                       !(l3_rt.l3a_flags & OPENNSL_L3_MULTIPATH) ? "nh" : "nhg",
-                       l3_rt.l3a_intf,
-                       l3_rt.l3a_ip_mask,
-                       l3_rt.l3a_subnet );
-    rv = opennsl_l3_route_add(0, &l3_rt);
-    BRCM_SAI_API_CHK(SAI_API_ROUTE, "L3 route add", rv);
+    _BRCM_SAI_ROUTE_LOCK();
+    rv = _brcm_sai_route_create(unicast_route_entry, attr_count, attr_list);
+    _BRCM_SAI_ROUTE_UNLOCK();
 
     BRCM_SAI_FUNCTION_EXIT(SAI_API_ROUTE);
 
@@ -194,8 +302,6 @@ sai_status_t
 brcm_sai_remove_route(_In_ const sai_unicast_route_entry_t* unicast_route_entry)
 {
     sai_status_t rv;
-    opennsl_l3_route_t l3_rt;
-    sai_uint32_t vr_id;
 
     BRCM_SAI_FUNCTION_ENTER(SAI_API_ROUTE);
     BRCM_SAI_SWITCH_INIT_CHECK;
@@ -206,25 +312,15 @@ brcm_sai_remove_route(_In_ const sai_unicast_route_entry_t* unicast_route_entry)
         return SAI_STATUS_INVALID_PARAMETER;
     }
 
-    opennsl_l3_route_t_init(&l3_rt);
-    vr_id = BRCM_SAI_GET_OBJ_VAL(sai_uint32_t, unicast_route_entry->vr_id);
-    l3_rt.l3a_vrf = vr_id;
-    if (SAI_IP_ADDR_FAMILY_IPV4 == unicast_route_entry->destination.addr_family)
-    {
-        l3_rt.l3a_ip_mask = ntohl(unicast_route_entry->destination.mask.ip4);
-        l3_rt.l3a_subnet = ntohl(unicast_route_entry->destination.addr.ip4 &
-                                 unicast_route_entry->destination.mask.ip4);
-    }
-    else if (SAI_IP_ADDR_FAMILY_IPV6 ==
-             unicast_route_entry->destination.addr_family)
+    if (_brcm_sai_route_async_post(BRCM_SAI_ROUTE_OP_REMOVE, unicast_route_entry,
+                                   0, NULL, &rv))
     {
-        memcpy(l3_rt.l3a_ip6_net, unicast_route_entry->destination.addr.ip6,
-               sizeof(l3_rt.l3a_ip6_net));
-        memcpy(l3_rt.l3a_ip6_mask, unicast_route_entry->destination.mask.ip6,
-               sizeof(l3_rt.l3a_ip6_mask));
+        BRCM_SAI_FUNCTION_EXIT(SAI_API_ROUTE);
+        return rv;
     }
-    rv = opennsl_l3_route_delete(0, &l3_rt);
-    BRCM_SAI_API_CHK(SAI_API_ROUTE, "L3 route delete", rv);
+    _BRCM_SAI_ROUTE_LOCK();
+    rv = _brcm_sai_route_remove(unicast_route_entry);
+    _BRCM_SAI_ROUTE_UNLOCK();
 
     BRCM_SAI_FUNCTION_EXIT(SAI_API_ROUTE);
 
@@ -259,7 +355,15 @@ brcm_sai_set_route_attribute(_In_ const sai_unicast_route_entry_t*
         return SAI_STATUS_INVALID_PARAMETER;
     }
 
+    if (_brcm_sai_route_async_post(BRCM_SAI_ROUTE_OP_SET, unicast_route_entry,
+                                   1, attr, &rv))
+    {
+        BRCM_SAI_FUNCTION_EXIT(SAI_API_ROUTE);
+        return rv;
+    }
+    _BRCM_SAI_ROUTE_LOCK();
     rv = _brcm_sai_update_route(unicast_route_entry, 1, attr);
+    _BRCM_SAI_ROUTE_UNLOCK();
 
     BRCM_SAI_FUNCTION_EXIT(SAI_API_ROUTE);
 
@@ -285,10 +389,63 @@ brcm_sai_get_route_attribute(_In_ const sai_unicast_route_entry_t*
                              _In_ sai_uint32_t attr_count,
                              _Inout_ sai_attribute_t *attr_list)
 {
-    sai_status_t rv = SAI_STATUS_NOT_IMPLEMENTED;
+    int i;
+    sai_status_t rv = SAI_STATUS_SUCCESS;
+    _brcm_sai_rib_node_t *node;
 
     BRCM_SAI_FUNCTION_ENTER(SAI_API_ROUTE);
     BRCM_SAI_SWITCH_INIT_CHECK;
+    BRCM_SAI_GET_ATTRIB_PARAM_CHK;
+
+    if (NULL == unicast_route_entry)
+    {
+        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "NULL route passed\n");
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+    if (_BRCM_SAI_ROUTE_ASYNC())
+    {
+        /* Reflect the operations this caller already queued */
+        _brcm_sai_route_async_drain();
+    }
+    _BRCM_SAI_ROUTE_LOCK();
+    /* Served from the rib, the SDK is not consulted */
+    node = _brcm_sai_rib_lookup(BRCM_SAI_GET_OBJ_VAL(sai_uint32_t,
+                                    unicast_route_entry->vr_id),
+                                &unicast_route_entry->destination);
+    if (NULL == node)
+    {
+        rv = SAI_STATUS_ITEM_NOT_FOUND;
+        attr_count = 0;
+    }
+    for (i=0; i<attr_count; i++)
+    {
+        switch (attr_list[i].id)
+        {
+            case SAI_ROUTE_ATTR_PACKET_ACTION:
+                attr_list[i].value.s32 = node->info.action;
+                break;
+            case SAI_ROUTE_ATTR_TRAP_PRIORITY:
+                /* Not kept, trapped routes use the default priority */
+                BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR,
+                                   "Route trap priority not supported\n");
+                rv = SAI_STATUS_ATTR_NOT_SUPPORTED_0 + i;
+                break;
+            case SAI_ROUTE_ATTR_NEXT_HOP_ID:
+                BRCM_SAI_ATTR_LIST_OBJ(i) = node->info.nh_id;
+                break;
+            default:
+                BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR,
+                                   "Unknown route attribute %d passed\n",
+                                   attr_list[i].id);
+                rv = SAI_STATUS_INVALID_PARAMETER;
+                break;
+        }
+        if (SAI_STATUS_SUCCESS != rv)
+        {
+            break;
+        }
+    }
+    _BRCM_SAI_ROUTE_UNLOCK();
 
     BRCM_SAI_FUNCTION_EXIT(SAI_API_ROUTE);
 
@@ -296,127 +453,2620 @@ brcm_sai_get_route_attribute(_In_ const sai_unicast_route_entry_t*
 }
 
 /*
-################################################################################
-#                               Internal functions                             #
-################################################################################
+* Routine Description:
+*    Create a batch of routes
+*
+* Arguments:
+*    [in] object_count - number of routes
+*    [in] route_entries - array of route entries
+*    [in] attr_count - per route number of attributes
+*    [in] attr_list - per route array of attributes
+*    [out] object_statuses - per route status
+*
+* Return Values:
+*    SAI_STATUS_SUCCESS on success
+*    SAI_STATUS_FAILURE if any of the routes failed
+*    Failure status code on error
 */
 sai_status_t
-_brcm_sai_update_route(const sai_unicast_route_entry_t* unicast_route_entry,
-                       sai_uint32_t attr_count,
-                       const sai_attribute_t *attr_list)
+brcm_sai_bulk_create_route(_In_ uint32_t object_count,
+                           _In_ const sai_unicast_route_entry_t *route_entries,
+                           _In_ const uint32_t *attr_count,
+                           _In_ const sai_attribute_t **attr_list,
+                           _Out_ sai_status_t *object_statuses)
 {
-    int i;
-    sai_status_t rv;
-    opennsl_if_t l3_if_id = -1;
-    opennsl_l3_route_t l3_rt;
-    bool trap = false, drop = false;
+    int i, rv;
     sai_uint32_t vr_id;
+    sai_status_t status = SAI_STATUS_SUCCESS;
+    _brcm_sai_rib_node_t *node;
+    _brcm_sai_route_bulk_t *routes = NULL;
 
     BRCM_SAI_FUNCTION_ENTER(SAI_API_ROUTE);
     BRCM_SAI_SWITCH_INIT_CHECK;
 
-    if ((NULL == unicast_route_entry) || (NULL == attr_list) || (0 == attr_count))
+    if ((0 == object_count) || (NULL == route_entries) ||
+        (NULL == attr_count) || (NULL == attr_list) ||
+        (NULL == object_statuses))
     {
         BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "NULL params passed\n");
         return SAI_STATUS_INVALID_PARAMETER;
     }
-    opennsl_l3_route_t_init(&l3_rt);
-    for (i=0; i<attr_count; i++)
-    {
-        switch (attr_list[i].id)
-        {
-            case SAI_ROUTE_ATTR_NEXT_HOP_ID:
-                l3_if_id = attr_list[i].value.u32;
-                if (SAI_OBJECT_TYPE_NEXT_HOP_GROUP ==
-                    BRCM_SAI_GET_OBJ_TYPE(BRCM_SAI_ATTR_LIST_OBJ(i)))
-                {
-                    l3_rt.l3a_flags |= OPENNSL_L3_MULTIPATH;
-                }
-                break;
-            case SAI_ROUTE_ATTR_PACKET_ACTION:
-                if (SAI_PACKET_ACTION_LOG == attr_list[i].value.u32)
-                {
-                    l3_rt.l3a_flags |= OPENNSL_L3_COPY_TO_CPU;
-                }
-                else if (SAI_PACKET_ACTION_TRAP == attr_list[i].value.u32)
-                {
-                    trap = true;
-                    l3_rt.l3a_flags |= OPENNSL_L3_DEFIP_CPU;
-                }
-                else if (SAI_PACKET_ACTION_DROP == attr_list[i].value.u32)
-                {
-                    drop = true;
-                    l3_rt.l3a_flags |= OPENNSL_L3_DST_DISCARD;
-                }
-                else
-                {
-                    BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "Bad attribute passed\n");
-                    return SAI_STATUS_INVALID_PARAMETER;
-                }
-            default:
-                BRCM_SAI_LOG_ROUTE(SAI_LOG_INFO, "Un-supported attribute %d passed\n",
-                                   attr_list[i].id);
-                break;
-        }
-    }
-    if (-1 == l3_if_id && FALSE == trap && FALSE == drop)
+    if (_BRCM_SAI_ROUTE_ASYNC())
     {
-        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "Missing routing info.\n");
-                           return SAI_STATUS_INVALID_PARAMETER;
+        /* Keep the batch ordered after the queued operations */
+        _brcm_sai_route_async_drain();
     }
-    if (SAI_IP_ADDR_FAMILY_IPV4 == unicast_route_entry->destination.addr_family)
+    _BRCM_SAI_ROUTE_LOCK();
+    if (_brcm_sai_route_coalesce.enabled || _brcm_sai_route_fib_compress)
     {
-        l3_rt.l3a_ip_mask = ntohl(unicast_route_entry->destination.mask.ip4);
-        l3_rt.l3a_subnet = ntohl(unicast_route_entry->destination.addr.ip4 &
-                                 unicast_route_entry->destination.mask.ip4);
+        /* Routes need to be handled one by one to coalesce or compress */
+        for (i=0; i<object_count; i++)
+        {
+            object_statuses[i] = SAI_STATUS_INVALID_PARAMETER;
+            if ((NULL != attr_list[i]) && (0 != attr_count[i]))
+            {
+                object_statuses[i] = _brcm_sai_route_create(&route_entries[i],
+                                                            attr_count[i],
+                                                            attr_list[i]);
+            }
+            if (SAI_STATUS_SUCCESS != object_statuses[i])
+            {
+                status = SAI_STATUS_FAILURE;
+            }
+        }
+        _BRCM_SAI_ROUTE_UNLOCK();
+        BRCM_SAI_FUNCTION_EXIT(SAI_API_ROUTE);
+        return status;
     }
-    else if (SAI_IP_ADDR_FAMILY_IPV6 ==
-             unicast_route_entry->destination.addr_family)
+    routes = (_brcm_sai_route_bulk_t*)malloc(object_count *
+                                             sizeof(_brcm_sai_route_bulk_t));
+    if (NULL == routes)
     {
-        memcpy(l3_rt.l3a_ip6_net, unicast_route_entry->destination.addr.ip6,
-               sizeof(l3_rt.l3a_ip6_net));
-        memcpy(l3_rt.l3a_ip6_mask, unicast_route_entry->destination.mask.ip6,
-               sizeof(l3_rt.l3a_ip6_mask));
+        _BRCM_SAI_ROUTE_UNLOCK();
+        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "Error with alloc %d\n",
+                           object_count);
+        return SAI_STATUS_NO_MEMORY;
     }
-    else
+    /* Build all the SDK records first */
+    for (i=0; i<object_count; i++)
     {
-        return SAI_STATUS_INVALID_PARAMETER;
+        if ((NULL == attr_list[i]) || (0 == attr_count[i]))
+        {
+            object_statuses[i] = SAI_STATUS_INVALID_PARAMETER;
+            continue;
+        }
+        routes[i].exists = false;
+        routes[i].info.nh_id = SAI_NULL_OBJECT_ID;
+        routes[i].info.action = SAI_PACKET_ACTION_FORWARD;
+        routes[i].info.host = false;
+        object_statuses[i] = _brcm_sai_route_attr_parse(attr_count[i],
+                                                        attr_list[i],
+                                                        &routes[i].info);
+        if (SAI_STATUS_SUCCESS != object_statuses[i])
+        {
+            continue;
+        }
+        vr_id = BRCM_SAI_GET_OBJ_VAL(sai_uint32_t, route_entries[i].vr_id);
+        node = _brcm_sai_rib_lookup(vr_id, &route_entries[i].destination);
+        if (NULL != node)
+        {
+            /* Re-adding an identical route is a no-op, as for one route */
+            if ((node->info.nh_id == routes[i].info.nh_id) &&
+                (node->info.action == routes[i].info.action))
+            {
+                routes[i].exists = true;
+                continue;
+            }
+            BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "Route already exists in vrf "
+                               "%d\n", vr_id);
+            object_statuses[i] = SAI_STATUS_ITEM_ALREADY_EXISTS;
+            continue;
+        }
+        object_statuses[i] = _brcm_sai_route_l3_build(&route_entries[i],
+                                                      &routes[i].info,
+                                                      &routes[i].l3_rt);
     }
-    vr_id = BRCM_SAI_GET_OBJ_VAL(sai_uint32_t, unicast_route_entry->vr_id);
-    if (false == _brcm_sai_vr_id_valid(vr_id))
+    /* Then push them to the SDK back to back */
+    for (i=0; i<object_count; i++)
     {
-        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR,
-                           "Invalid VR id passed during route create %d\n",
-                           vr_id);
-        return SAI_STATUS_INVALID_PARAMETER;
+        if ((SAI_STATUS_SUCCESS == object_statuses[i]) &&
+            (false == routes[i].exists))
+        {
+            rv = _brcm_sai_route_hw_add(&routes[i].l3_rt, &routes[i].info,
+                                        NULL);
+            object_statuses[i] = BRCM_RV_OPENNSL_TO_SAI(rv);
+            if (SAI_STATUS_SUCCESS == object_statuses[i])
+            {
+                object_statuses[i] =
+                    _brcm_sai_rib_add(routes[i].l3_rt.l3a_vrf,
+                                      &route_entries[i].destination,
+                                      &routes[i].info, NULL);
+                if (SAI_STATUS_SUCCESS != object_statuses[i])
+                {
+                    (void)_brcm_sai_route_hw_delete(&routes[i].l3_rt,
+                                                    routes[i].info.host);
+                }
+            }
+            if (SAI_STATUS_SUCCESS != object_statuses[i])
+            {
+                _brcm_sai_route_info_release(&routes[i].info);
+            }
+        }
+        if (SAI_STATUS_SUCCESS != object_statuses[i])
+        {
+            status = SAI_STATUS_FAILURE;
+        }
     }
+    _BRCM_SAI_ROUTE_UNLOCK();
+    free(routes);
+    BRCM_SAI_LOG_ROUTE(SAI_LOG_DEBUG, "Bulk add of %d routes, status %d\n",
+                       object_count, status);
+
+    BRCM_SAI_FUNCTION_EXIT(SAI_API_ROUTE);
+
+    return status;
+}
 
-    l3_rt.l3a_vrf = vr_id;
-    if (trap)
+/*
+* Routine Description:
+*    Remove a batch of routes
+*
+* Arguments:
+*    [in] object_count - number of routes
+*    [in] route_entries - array of route entries
+*    [out] object_statuses - per route status
+*
+* Return Values:
+*    SAI_STATUS_SUCCESS on success
+*    SAI_STATUS_FAILURE if any of the routes failed
+*    Failure status code on error
+*/
+sai_status_t
+brcm_sai_bulk_remove_route(_In_ uint32_t object_count,
+                           _In_ const sai_unicast_route_entry_t *route_entries,
+                           _Out_ sai_status_t *object_statuses)
+{
+    int i;
+    sai_status_t status = SAI_STATUS_SUCCESS;
+
+    BRCM_SAI_FUNCTION_ENTER(SAI_API_ROUTE);
+    BRCM_SAI_SWITCH_INIT_CHECK;
+
+    if ((0 == object_count) || (NULL == route_entries) ||
+        (NULL == object_statuses))
     {
-        l3_rt.l3a_intf = _brcm_sai_vrf_if_get(l3_rt.l3a_vrf);
+        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "NULL params passed\n");
+        return SAI_STATUS_INVALID_PARAMETER;
     }
-    else if (drop)
+    if (_BRCM_SAI_ROUTE_ASYNC())
     {
-        l3_rt.l3a_intf = _brcm_sai_vrf_drop_if_get(l3_rt.l3a_vrf);
+        _brcm_sai_route_async_drain();
     }
-    else
+    _BRCM_SAI_ROUTE_LOCK();
+    for (i=0; i<object_count; i++)
     {
-        l3_rt.l3a_intf = l3_if_id;
+        object_statuses[i] = _brcm_sai_route_remove(&route_entries[i]);
+        if (SAI_STATUS_SUCCESS != object_statuses[i])
+        {
+            status = SAI_STATUS_FAILURE;
+        }
     }
-
-    l3_rt.l3a_flags |= OPENNSL_L3_REPLACE;
-
-    BRCM_SAI_LOG_ROUTE(SAI_LOG_DEBUG, "Update route vrf: %d, egr %s id: %d\n",
-                       l3_rt.l3a_vrf,
-                       !(l3_rt.l3a_flags & OPENNSL_L3_MULTIPATH) ? "nh" : "nhg",
-                       l3_rt.l3a_intf);
-    rv = opennsl_l3_route_add(0, &l3_rt);
-    BRCM_SAI_API_CHK(SAI_API_ROUTE, "L3 route add", rv);
+    _BRCM_SAI_ROUTE_UNLOCK();
+    BRCM_SAI_LOG_ROUTE(SAI_LOG_DEBUG, "Bulk delete of %d routes, status %d\n",
+                       object_count, status);
 
     BRCM_SAI_FUNCTION_EXIT(SAI_API_ROUTE);
 
-    return rv;
+    return status;
+}
+
+/*
+################################################################################
+#                               Internal functions                             #
+################################################################################
+*/
+/* Routine to create a route, called with the route lock held */
+STATIC sai_status_t
+_brcm_sai_route_create(const sai_unicast_route_entry_t* unicast_route_entry,
+                       sai_uint32_t attr_count,
+                       const sai_attribute_t *attr_list)
+{
+    sai_status_t rv;
+    sai_uint32_t vr_id;
+    opennsl_l3_route_t l3_rt;
+    _brcm_sai_route_info_t info;
+    _brcm_sai_rib_node_t *node;
+
+    info.nh_id = SAI_NULL_OBJECT_ID;
+    info.action = SAI_PACKET_ACTION_FORWARD;
+    info.host = false;
+    rv = _brcm_sai_route_attr_parse(attr_count, attr_list, &info);
+    if (SAI_STATUS_SUCCESS != rv)
+    {
+        return rv;
+    }
+    vr_id = BRCM_SAI_GET_OBJ_VAL(sai_uint32_t, unicast_route_entry->vr_id);
+    node = _brcm_sai_rib_lookup(vr_id, &unicast_route_entry->destination);
+    if (NULL != node)
+    {
+        /* Re-adding an identical route is a no-op */
+        if ((node->info.nh_id == info.nh_id) &&
+            (node->info.action == info.action))
+        {
+            return SAI_STATUS_SUCCESS;
+        }
+        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "Route already exists in vrf %d\n",
+                           vr_id);
+        return SAI_STATUS_ITEM_ALREADY_EXISTS;
+    }
+    if (_brcm_sai_route_fib_compress)
+    {
+        return _brcm_sai_route_fib_create(unicast_route_entry, &info);
+    }
+    if (_brcm_sai_route_coalesce.enabled)
+    {
+        rv = _brcm_sai_route_check(unicast_route_entry, &info);
+        if (SAI_STATUS_SUCCESS != rv)
+        {
+            return rv;
+        }
+        rv = _brcm_sai_route_pending_mark(unicast_route_entry, NULL);
+        if (SAI_STATUS_SUCCESS != rv)
+        {
+            return rv;
+        }
+        rv = _brcm_sai_rib_add(vr_id, &unicast_route_entry->destination,
+                               &info, NULL);
+        _brcm_sai_route_pending_batch_check();
+        return rv;
+    }
+    rv = _brcm_sai_route_l3_build(unicast_route_entry, &info, &l3_rt);
+    if (SAI_STATUS_SUCCESS != rv)
+    {
+        return rv;
+    }
+    BRCM_SAI_LOG_ROUTE(SAI_LOG_DEBUG,
+                       "Add route vrf: %d, egr %s id: %d mask 0x%x, subnet 0x%x\n",
+                       l3_rt.l3a_vrf,
+                       !(l3_rt.l3a_flags & OPENNSL_L3_MULTIPATH) ? "nh" : "nhg",
+                       l3_rt.l3a_intf,
+                       l3_rt.l3a_ip_mask,
+                       l3_rt.l3a_subnet );
+    rv = _brcm_sai_route_hw_add(&l3_rt, &info, NULL);
+    if (OPENNSL_E_NONE != rv)
+    {
+        _brcm_sai_route_info_release(&info);
+    }
+    BRCM_SAI_API_CHK(SAI_API_ROUTE, "L3 route add", rv);
+    rv = _brcm_sai_rib_add(vr_id, &unicast_route_entry->destination, &info,
+                           NULL);
+    if (SAI_STATUS_SUCCESS != rv)
+    {
+        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "Error %d adding route to rib\n", rv);
+        (void)_brcm_sai_route_hw_delete(&l3_rt, info.host);
+        _brcm_sai_route_info_release(&info);
+    }
+    return rv;
+}
+
+/* Routine to remove a route, called with the route lock held */
+STATIC sai_status_t
+_brcm_sai_route_remove(const sai_unicast_route_entry_t* unicast_route_entry)
+{
+    sai_status_t rv;
+    sai_uint32_t vr_id;
+    opennsl_l3_route_t l3_rt;
+    _brcm_sai_rib_node_t *node;
+
+    vr_id = BRCM_SAI_GET_OBJ_VAL(sai_uint32_t, unicast_route_entry->vr_id);
+    node = _brcm_sai_rib_lookup(vr_id, &unicast_route_entry->destination);
+    if (NULL == node)
+    {
+        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "Route not found in vrf %d\n", vr_id);
+        return SAI_STATUS_ITEM_NOT_FOUND;
+    }
+    if (_brcm_sai_route_fib_compress)
+    {
+        return _brcm_sai_route_fib_remove(node);
+    }
+    if (_brcm_sai_route_coalesce.enabled)
+    {
+        rv = _brcm_sai_route_pending_mark(unicast_route_entry, &node->info);
+        if (SAI_STATUS_SUCCESS != rv)
+        {
+            return rv;
+        }
+        rv = _brcm_sai_rib_delete(vr_id, &unicast_route_entry->destination);
+        _brcm_sai_route_pending_batch_check();
+        return rv;
+    }
+
+    opennsl_l3_route_t_init(&l3_rt);
+    (void)_brcm_sai_route_key_set(unicast_route_entry, &l3_rt);
+    rv = _brcm_sai_route_hw_delete(&l3_rt, node->info.host);
+    BRCM_SAI_API_CHK(SAI_API_ROUTE, "L3 route delete", rv);
+    _brcm_sai_route_info_release(&node->info);
+
+    return _brcm_sai_rib_delete(vr_id, &unicast_route_entry->destination);
+}
+
+/* Routine to fill in the vrf and prefix of an SDK route from a SAI route */
+STATIC sai_status_t
+_brcm_sai_route_key_set(const sai_unicast_route_entry_t* unicast_route_entry,
+                        opennsl_l3_route_t *l3_rt)
+{
+    l3_rt->l3a_vrf = BRCM_SAI_GET_OBJ_VAL(sai_uint32_t,
+                                          unicast_route_entry->vr_id);
+    if (SAI_IP_ADDR_FAMILY_IPV4 == unicast_route_entry->destination.addr_family)
+    {
+        l3_rt->l3a_ip_mask = ntohl(unicast_route_entry->destination.mask.ip4);
+        l3_rt->l3a_subnet = ntohl(unicast_route_entry->destination.addr.ip4 &
+                                  unicast_route_entry->destination.mask.ip4);
+    }
+    else if (SAI_IP_ADDR_FAMILY_IPV6 ==
+             unicast_route_entry->destination.addr_family)
+    {
+        memcpy(l3_rt->l3a_ip6_net, unicast_route_entry->destination.addr.ip6,
+               sizeof(l3_rt->l3a_ip6_net));
+        memcpy(l3_rt->l3a_ip6_mask, unicast_route_entry->destination.mask.ip6,
+               sizeof(l3_rt->l3a_ip6_mask));
+        l3_rt->l3a_flags |= OPENNSL_L3_IP6;
+    }
+    else
+    {
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Routine to merge route attributes into the route info */
+STATIC sai_status_t
+_brcm_sai_route_attr_parse(sai_uint32_t attr_count,
+                           const sai_attribute_t *attr_list,
+                           _brcm_sai_route_info_t *info)
+{
+    int i;
+
+    for (i=0; i<attr_count; i++)
+    {
+        switch (attr_list[i].id)
+        {
+            case SAI_ROUTE_ATTR_NEXT_HOP_ID:
+                info->nh_id = BRCM_SAI_ATTR_LIST_OBJ(i);
+                break;
+            case SAI_ROUTE_ATTR_PACKET_ACTION:
+                switch (attr_list[i].value.s32)
+                {
+                    case SAI_PACKET_ACTION_FORWARD:
+                    case SAI_PACKET_ACTION_LOG:
+                    case SAI_PACKET_ACTION_TRAP:
+                    case SAI_PACKET_ACTION_DROP:
+                        info->action = attr_list[i].value.s32;
+                        break;
+                    default:
+                        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR,
+                                           "Bad attribute passed\n");
+                        return SAI_STATUS_INVALID_PARAMETER;
+                }
+                break;
+            default:
+                BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "Unimplemented attribute passed\n");
+                break;
+        }
+    }
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Routine to validate a route before it is accepted */
+STATIC sai_status_t
+_brcm_sai_route_check(const sai_unicast_route_entry_t* unicast_route_entry,
+                      const _brcm_sai_route_info_t *info)
+{
+    sai_uint32_t vr_id;
+
+    if ((SAI_IP_ADDR_FAMILY_IPV4 !=
+         unicast_route_entry->destination.addr_family) &&
+        (SAI_IP_ADDR_FAMILY_IPV6 !=
+         unicast_route_entry->destination.addr_family))
+    {
+        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "Bad address family passed\n");
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+    vr_id = BRCM_SAI_GET_OBJ_VAL(sai_uint32_t, unicast_route_entry->vr_id);
+    if (false == _brcm_sai_vr_id_valid(vr_id))
+    {
+        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR,
+                           "Invalid VR id passed during route create %d\n",
+                           vr_id);
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+    if ((SAI_PACKET_ACTION_TRAP != info->action) &&
+        (SAI_PACKET_ACTION_DROP != info->action) &&
+        (SAI_NULL_OBJECT_ID == info->nh_id))
+    {
+        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "Missing routing info.\n");
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+    if ((SAI_PACKET_ACTION_LOG == info->action) &&
+        (SAI_OBJECT_TYPE_NEXT_HOP_GROUP == BRCM_SAI_GET_OBJ_TYPE(info->nh_id)))
+    {
+        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR,
+                           "Log action not supported with next hop groups\n");
+        return SAI_STATUS_NOT_SUPPORTED;
+    }
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Routine to build a complete SDK route from a SAI route and its info */
+STATIC sai_status_t
+_brcm_sai_route_l3_build(const sai_unicast_route_entry_t* unicast_route_entry,
+                         const _brcm_sai_route_info_t *info,
+                         opennsl_l3_route_t *l3_rt)
+{
+    sai_status_t rv;
+    opennsl_if_t l3_if_id;
+
+    rv = _brcm_sai_route_check(unicast_route_entry, info);
+    if (SAI_STATUS_SUCCESS != rv)
+    {
+        return rv;
+    }
+    opennsl_l3_route_t_init(l3_rt);
+    (void)_brcm_sai_route_key_set(unicast_route_entry, l3_rt);
+    if (SAI_PACKET_ACTION_TRAP == info->action)
+    {
+        l3_rt->l3a_flags |= OPENNSL_L3_DEFIP_CPU;
+        l3_rt->l3a_intf = _brcm_sai_vrf_if_get(l3_rt->l3a_vrf);
+    }
+    else if (SAI_PACKET_ACTION_DROP == info->action)
+    {
+        l3_rt->l3a_flags |= OPENNSL_L3_DST_DISCARD;
+        l3_rt->l3a_intf = _brcm_sai_vrf_drop_if_get(l3_rt->l3a_vrf);
+    }
+    else
+    {
+        l3_if_id = BRCM_SAI_GET_OBJ_VAL(opennsl_if_t, info->nh_id);
+        if (SAI_OBJECT_TYPE_NEXT_HOP_GROUP ==
+            BRCM_SAI_GET_OBJ_TYPE(info->nh_id))
+        {
+            l3_rt->l3a_flags |= OPENNSL_L3_MULTIPATH;
+        }
+        l3_rt->l3a_intf = l3_if_id;
+
+        if (SAI_PACKET_ACTION_LOG == info->action)
+        {
+            /* Point at a shared copy of the next hop, must be released with
+               _brcm_sai_route_info_release once the route no longer uses it */
+            rv = _brcm_sai_route_log_egr_get(l3_if_id, OPENNSL_L3_COPY_TO_CPU,
+                                             &l3_rt->l3a_intf);
+            if (SAI_STATUS_SUCCESS != rv)
+            {
+                return rv;
+            }
+        }
+    }
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Routine to apply attribute changes on top of an existing route */
+STATIC sai_status_t
+_brcm_sai_update_route(const sai_unicast_route_entry_t* unicast_route_entry,
+                       sai_uint32_t attr_count,
+                       const sai_attribute_t *attr_list)
+{
+    sai_status_t rv;
+    opennsl_l3_route_t l3_rt;
+    _brcm_sai_route_info_t info;
+    _brcm_sai_rib_node_t *node;
+
+    if ((NULL == unicast_route_entry) || (NULL == attr_list) || (0 == attr_count))
+    {
+        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "NULL params passed\n");
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+    node = _brcm_sai_rib_lookup(BRCM_SAI_GET_OBJ_VAL(sai_uint32_t,
+                                    unicast_route_entry->vr_id),
+                                &unicast_route_entry->destination);
+    if (NULL == node)
+    {
+        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "Route not found for update\n");
+        return SAI_STATUS_ITEM_NOT_FOUND;
+    }
+    /* Attributes not being set keep their current value */
+    info = node->info;
+    rv = _brcm_sai_route_attr_parse(attr_count, attr_list, &info);
+    if (SAI_STATUS_SUCCESS != rv)
+    {
+        return rv;
+    }
+    if (_brcm_sai_route_fib_compress)
+    {
+        rv = _brcm_sai_route_check(unicast_route_entry, &info);
+        if (SAI_STATUS_SUCCESS != rv)
+        {
+            return rv;
+        }
+        return _brcm_sai_route_fib_update(node, &info);
+    }
+    if (_brcm_sai_route_coalesce.enabled)
+    {
+        rv = _brcm_sai_route_check(unicast_route_entry, &info);
+        if (SAI_STATUS_SUCCESS == rv)
+        {
+            rv = _brcm_sai_route_pending_mark(unicast_route_entry,
+                                              &node->info);
+        }
+        if (SAI_STATUS_SUCCESS == rv)
+        {
+            _brcm_sai_rib_info_set(node, &info);
+            _brcm_sai_route_pending_batch_check();
+        }
+        return rv;
+    }
+    rv = _brcm_sai_route_l3_build(unicast_route_entry, &info, &l3_rt);
+    if (SAI_STATUS_SUCCESS != rv)
+    {
+        return rv;
+    }
+    BRCM_SAI_LOG_ROUTE(SAI_LOG_DEBUG, "Update route vrf: %d, egr %s id: %d\n",
+                       l3_rt.l3a_vrf,
+                       !(l3_rt.l3a_flags & OPENNSL_L3_MULTIPATH) ? "nh" : "nhg",
+                       l3_rt.l3a_intf);
+    rv = _brcm_sai_route_hw_add(&l3_rt, &info, &node->info);
+    if (OPENNSL_E_NONE != rv)
+    {
+        _brcm_sai_route_info_release(&info);
+    }
+    BRCM_SAI_API_CHK(SAI_API_ROUTE, "L3 route add", rv);
+    _brcm_sai_route_info_release(&node->info);
+    _brcm_sai_rib_info_set(node, &info);
+
+    return rv;
+}
+
+/*
+################################################################################
+#                              Route placement                                 #
+################################################################################
+*/
+/* Routine to check if a route can live in the host table */
+STATIC bool
+_brcm_sai_route_host_eligible(const opennsl_l3_route_t *l3_rt)
+{
+    int i;
+
+    if (l3_rt->l3a_flags & (OPENNSL_L3_DEFIP_CPU | OPENNSL_L3_DST_DISCARD))
+    {
+        return false;
+    }
+    if (l3_rt->l3a_flags & OPENNSL_L3_IP6)
+    {
+        for (i=0; i<sizeof(opennsl_ip6_t); i++)
+        {
+            if (0xff != l3_rt->l3a_ip6_mask[i])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+    return (0xffffffff == l3_rt->l3a_ip_mask);
+}
+
+/* Routine to convert a full length route into a host entry */
+STATIC void
+_brcm_sai_route_host_set(const opennsl_l3_route_t *l3_rt,
+                         opennsl_l3_host_t *l3_host)
+{
+    opennsl_l3_host_t_init(l3_host);
+    l3_host->l3a_vrf = l3_rt->l3a_vrf;
+    l3_host->l3a_intf = l3_rt->l3a_intf;
+    l3_host->l3a_flags = l3_rt->l3a_flags &
+                         (OPENNSL_L3_IP6 | OPENNSL_L3_MULTIPATH);
+    if (l3_rt->l3a_flags & OPENNSL_L3_IP6)
+    {
+        memcpy(l3_host->l3a_ip6_addr, l3_rt->l3a_ip6_net,
+               sizeof(l3_host->l3a_ip6_addr));
+    }
+    else
+    {
+        l3_host->l3a_ip_addr = l3_rt->l3a_subnet;
+    }
+}
+
+/*
+ * Routine to write a route to the hardware. New full length prefixes are
+ * placed in the host table to save LPM space and fall back to LPM when the
+ * host table is full or already has the address (e.g. a neighbor). Updates,
+ * which pass in the current hardware state, stay in the table they are in.
+ * The table used is recorded in info->host.
+ */
+STATIC int
+_brcm_sai_route_hw_add(opennsl_l3_route_t *l3_rt, _brcm_sai_route_info_t *info,
+                       const _brcm_sai_route_info_t *hw_info)
+{
+    int rv;
+    opennsl_l3_host_t l3_host;
+    bool eligible = _brcm_sai_route_host_eligible(l3_rt);
+
+    if ((NULL != hw_info) && hw_info->host)
+    {
+        if (eligible)
+        {
+            _brcm_sai_route_host_set(l3_rt, &l3_host);
+            l3_host.l3a_flags |= OPENNSL_L3_REPLACE;
+            rv = opennsl_l3_host_add(0, &l3_host);
+            if (OPENNSL_E_NONE == rv)
+            {
+                info->host = true;
+            }
+            return rv;
+        }
+        /* Trap and drop need LPM, add there before leaving the host table */
+        rv = opennsl_l3_route_add(0, l3_rt);
+        if (OPENNSL_E_NONE == rv)
+        {
+            _brcm_sai_route_hw_count(l3_rt, false, 1);
+            (void)_brcm_sai_route_hw_delete(l3_rt, true);
+            info->host = false;
+        }
+        return rv;
+    }
+    if (NULL != hw_info)
+    {
+        l3_rt->l3a_flags |= OPENNSL_L3_REPLACE;
+    }
+    else if (eligible)
+    {
+        _brcm_sai_route_host_set(l3_rt, &l3_host);
+        rv = opennsl_l3_host_add(0, &l3_host);
+        if (OPENNSL_E_NONE == rv)
+        {
+            _brcm_sai_route_hw_count(l3_rt, true, 1);
+            info->host = true;
+            return rv;
+        }
+        if ((OPENNSL_E_FULL != rv) && (OPENNSL_E_EXISTS != rv))
+        {
+            return rv;
+        }
+        BRCM_SAI_LOG_ROUTE(SAI_LOG_DEBUG,
+                           "Host table add failed (%d), using LPM\n", rv);
+    }
+    rv = opennsl_l3_route_add(0, l3_rt);
+    if (OPENNSL_E_NONE == rv)
+    {
+        if (NULL == hw_info)
+        {
+            _brcm_sai_route_hw_count(l3_rt, false, 1);
+        }
+        info->host = false;
+    }
+    return rv;
+}
+
+/* Routine to delete a route from the table it was placed in */
+STATIC int
+_brcm_sai_route_hw_delete(const opennsl_l3_route_t *l3_rt, bool host)
+{
+    int rv;
+    opennsl_l3_host_t l3_host;
+
+    if (host)
+    {
+        _brcm_sai_route_host_set(l3_rt, &l3_host);
+        rv = opennsl_l3_host_delete(0, &l3_host);
+    }
+    else
+    {
+        rv = opennsl_l3_route_delete(0, (opennsl_l3_route_t*)l3_rt);
+    }
+    if (OPENNSL_E_NONE == rv)
+    {
+        _brcm_sai_route_hw_count(l3_rt, host, -1);
+    }
+    return rv;
+}
+
+/* Routine to get the full length route for an address */
+STATIC void
+_brcm_sai_route_host_prefix(sai_uint32_t vr_id,
+                            const sai_ip_address_t *ip_address,
+                            sai_unicast_route_entry_t *route)
+{
+    memset(route, 0, sizeof(*route));
+    route->vr_id = BRCM_SAI_CREATE_OBJ(SAI_OBJECT_TYPE_VIRTUAL_ROUTER, vr_id);
+    route->destination.addr_family = ip_address->addr_family;
+    if (SAI_IP_ADDR_FAMILY_IPV4 == ip_address->addr_family)
+    {
+        route->destination.addr.ip4 = ip_address->addr.ip4;
+        route->destination.mask.ip4 = 0xffffffff;
+    }
+    else
+    {
+        memcpy(route->destination.addr.ip6, ip_address->addr.ip6,
+               sizeof(sai_ip6_t));
+        memset(route->destination.mask.ip6, 0xff, sizeof(sai_ip6_t));
+    }
+}
+
+/*
+ * Routine to move a full length route for an address out of the host table
+ * so that a neighbor entry can be added for it.
+ */
+void
+_brcm_sai_route_host_evict(sai_uint32_t vr_id,
+                           const sai_ip_address_t *ip_address)
+{
+    int rv;
+    opennsl_l3_route_t l3_rt;
+    sai_unicast_route_entry_t route;
+    _brcm_sai_rib_node_t *node;
+
+    _brcm_sai_route_host_prefix(vr_id, ip_address, &route);
+
+    _BRCM_SAI_ROUTE_LOCK();
+    if (_brcm_sai_route_coalesce.enabled)
+    {
+        /* Bring the hardware in line with the rib first */
+        _brcm_sai_route_pending_flush();
+    }
+    node = _brcm_sai_rib_lookup(vr_id, &route.destination);
+    if ((NULL != node) && node->info.host &&
+        (SAI_STATUS_SUCCESS == _brcm_sai_route_l3_build(&route, &node->info,
+                                                        &l3_rt)))
+    {
+        rv = opennsl_l3_route_add(0, &l3_rt);
+        if (OPENNSL_E_NONE == rv)
+        {
+            _brcm_sai_route_hw_count(&l3_rt, false, 1);
+            (void)_brcm_sai_route_hw_delete(&l3_rt, true);
+            node->info.host = false;
+        }
+        else
+        {
+            BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR,
+                               "Error %d moving host route to LPM\n", rv);
+        }
+        /* Drop the extra reference taken by the build */
+        _brcm_sai_route_info_release(&node->info);
+    }
+    _BRCM_SAI_ROUTE_UNLOCK();
+}
+
+/*
+################################################################################
+#                              FIB compression                                 #
+################################################################################
+*/
+/*
+ * With compression a route is not programmed when the closest less specific
+ * route forwards the same way, as lookups then fall through to that route.
+ * A suppressed route still covers its own more specific routes, comparing
+ * against it is the same as comparing against the programmed route above.
+ * Compression and coalescing are mutually exclusive.
+ */
+typedef struct _brcm_sai_route_fib_fix_s {
+    const _brcm_sai_route_info_t *cover;
+    bool install;
+} _brcm_sai_route_fib_fix_t;
+
+/* Routine to program a suppressed route node */
+STATIC sai_status_t
+_brcm_sai_route_node_install(_brcm_sai_rib_node_t *node)
+{
+    int rv;
+    opennsl_l3_route_t l3_rt;
+    sai_unicast_route_entry_t route;
+
+    _brcm_sai_rib_route_get(node, &route);
+    rv = _brcm_sai_route_l3_build(&route, &node->info, &l3_rt);
+    if (SAI_STATUS_SUCCESS != rv)
+    {
+        return rv;
+    }
+    rv = _brcm_sai_route_hw_add(&l3_rt, &node->info, NULL);
+    if (OPENNSL_E_NONE != rv)
+    {
+        _brcm_sai_route_info_release(&node->info);
+    }
+    BRCM_SAI_API_CHK(SAI_API_ROUTE, "L3 route add", rv);
+    node->suppressed = false;
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Routine to take a programmed route node out of the hardware */
+STATIC sai_status_t
+_brcm_sai_route_node_uninstall(_brcm_sai_rib_node_t *node)
+{
+    int rv;
+    opennsl_l3_route_t l3_rt;
+    sai_unicast_route_entry_t route;
+
+    _brcm_sai_rib_route_get(node, &route);
+    opennsl_l3_route_t_init(&l3_rt);
+    (void)_brcm_sai_route_key_set(&route, &l3_rt);
+    rv = _brcm_sai_route_hw_delete(&l3_rt, node->info.host);
+    BRCM_SAI_API_CHK(SAI_API_ROUTE, "L3 route delete", rv);
+    _brcm_sai_route_info_release(&node->info);
+    node->info.host = false;
+    node->suppressed = true;
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Walk callback to bring a route in line with a new covering route */
+STATIC sai_status_t
+_brcm_sai_route_fib_child_fix(_brcm_sai_rib_node_t *node, void *data)
+{
+    _brcm_sai_route_fib_fix_t *fix = (_brcm_sai_route_fib_fix_t*)data;
+    bool suppress = (NULL != fix->cover) &&
+                    _BRCM_SAI_ROUTE_SAME_FWD(&node->info, fix->cover);
+
+    if (fix->install && node->suppressed && (false == suppress))
+    {
+        return _brcm_sai_route_node_install(node);
+    }
+    if ((false == fix->install) && (false == node->suppressed) && suppress)
+    {
+        return _brcm_sai_route_node_uninstall(node);
+    }
+    return SAI_STATUS_SUCCESS;
+}
+
+/*
+ * Routine to re-evaluate the routes directly below a node against a new
+ * covering route. Installs and removals are done in separate passes so that
+ * routes which are needed get programmed before the ones above them change.
+ */
+STATIC void
+_brcm_sai_route_fib_children_fix(_brcm_sai_rib_node_t *node,
+                                 const _brcm_sai_route_info_t *cover,
+                                 bool install)
+{
+    sai_status_t rv;
+    _brcm_sai_route_fib_fix_t fix;
+
+    fix.cover = cover;
+    fix.install = install;
+    rv = _brcm_sai_rib_subtree_walk(node, _brcm_sai_route_fib_child_fix, &fix);
+    if (SAI_STATUS_SUCCESS != rv)
+    {
+        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR,
+                           "Error %d updating more specific routes\n", rv);
+    }
+}
+
+/* Routine to create a route with compression */
+STATIC sai_status_t
+_brcm_sai_route_fib_create(const sai_unicast_route_entry_t* unicast_route_entry,
+                           const _brcm_sai_route_info_t *info)
+{
+    sai_status_t rv;
+    sai_uint32_t vr_id;
+    _brcm_sai_rib_node_t *node, *cover;
+
+    rv = _brcm_sai_route_check(unicast_route_entry, info);
+    if (SAI_STATUS_SUCCESS != rv)
+    {
+        return rv;
+    }
+    vr_id = BRCM_SAI_GET_OBJ_VAL(sai_uint32_t, unicast_route_entry->vr_id);
+    rv = _brcm_sai_rib_add(vr_id, &unicast_route_entry->destination, info,
+                           &node);
+    if (SAI_STATUS_SUCCESS != rv)
+    {
+        return rv;
+    }
+    cover = _brcm_sai_rib_cover_get(node);
+    if ((NULL != cover) && _BRCM_SAI_ROUTE_SAME_FWD(info, &cover->info))
+    {
+        /* The routes below see no difference either */
+        node->suppressed = true;
+        return SAI_STATUS_SUCCESS;
+    }
+    _brcm_sai_route_fib_children_fix(node, &node->info, true);
+    rv = _brcm_sai_route_node_install(node);
+    if (SAI_STATUS_SUCCESS != rv)
+    {
+        _brcm_sai_route_fib_children_fix(node, cover ? &cover->info : NULL,
+                                         false);
+        (void)_brcm_sai_rib_delete(vr_id, &unicast_route_entry->destination);
+        return rv;
+    }
+    _brcm_sai_route_fib_children_fix(node, &node->info, false);
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Routine to remove a route with compression */
+STATIC sai_status_t
+_brcm_sai_route_fib_remove(_brcm_sai_rib_node_t *node)
+{
+    sai_status_t rv;
+    sai_unicast_route_entry_t route;
+    _brcm_sai_rib_node_t *cover;
+    const _brcm_sai_route_info_t *cover_info;
+
+    cover = _brcm_sai_rib_cover_get(node);
+    cover_info = cover ? &cover->info : NULL;
+    if (false == node->suppressed)
+    {
+        _brcm_sai_route_fib_children_fix(node, cover_info, true);
+        rv = _brcm_sai_route_node_uninstall(node);
+        if (SAI_STATUS_SUCCESS != rv)
+        {
+            return rv;
+        }
+        _brcm_sai_route_fib_children_fix(node, cover_info, false);
+    }
+    _brcm_sai_rib_route_get(node, &route);
+    return _brcm_sai_rib_delete(node->vr_id, &route.destination);
+}
+
+/* Routine to update a route with compression */
+STATIC sai_status_t
+_brcm_sai_route_fib_update(_brcm_sai_rib_node_t *node,
+                           const _brcm_sai_route_info_t *info)
+{
+    sai_status_t rv;
+    opennsl_l3_route_t l3_rt;
+    sai_unicast_route_entry_t route;
+    _brcm_sai_rib_node_t *cover;
+    _brcm_sai_route_info_t old = node->info;
+    bool suppress;
+
+    cover = _brcm_sai_rib_cover_get(node);
+    suppress = (NULL != cover) && _BRCM_SAI_ROUTE_SAME_FWD(info, &cover->info);
+    _brcm_sai_route_fib_children_fix(node, info, true);
+    if (node->suppressed)
+    {
+        _brcm_sai_rib_info_set(node, info);
+        node->info.host = false;
+        if (false == suppress)
+        {
+            rv = _brcm_sai_route_node_install(node);
+            if (SAI_STATUS_SUCCESS != rv)
+            {
+                _brcm_sai_rib_info_set(node, &old);
+                return rv;
+            }
+        }
+    }
+    else if (suppress)
+    {
+        rv = _brcm_sai_route_node_uninstall(node);
+        if (SAI_STATUS_SUCCESS != rv)
+        {
+            return rv;
+        }
+        _brcm_sai_rib_info_set(node, info);
+        node->info.host = false;
+    }
+    else
+    {
+        _brcm_sai_rib_route_get(node, &route);
+        rv = _brcm_sai_route_l3_build(&route, info, &l3_rt);
+        if (SAI_STATUS_SUCCESS != rv)
+        {
+            return rv;
+        }
+        _brcm_sai_rib_info_set(node, info);
+        rv = _brcm_sai_route_hw_add(&l3_rt, &node->info, &old);
+        if (OPENNSL_E_NONE != rv)
+        {
+            _brcm_sai_route_info_release(&node->info);
+            _brcm_sai_rib_info_set(node, &old);
+        }
+        BRCM_SAI_API_CHK(SAI_API_ROUTE, "L3 route add", rv);
+        _brcm_sai_route_info_release(&old);
+    }
+    _brcm_sai_route_fib_children_fix(node, &node->info, false);
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Walk callback to apply compression to an existing table */
+STATIC sai_status_t
+_brcm_sai_route_fib_compress_cb(_brcm_sai_rib_node_t *node, void *data)
+{
+    _brcm_sai_rib_node_t *cover;
+
+    if (false == *(bool*)data)
+    {
+        return node->suppressed ? _brcm_sai_route_node_install(node) :
+                                  SAI_STATUS_SUCCESS;
+    }
+    cover = _brcm_sai_rib_cover_get(node);
+    if ((false == node->suppressed) && (NULL != cover) &&
+        _BRCM_SAI_ROUTE_SAME_FWD(&node->info, &cover->info))
+    {
+        return _brcm_sai_route_node_uninstall(node);
+    }
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Routine to turn FIB compression on or off */
+sai_status_t
+_brcm_sai_route_fib_compress_set(bool enable)
+{
+    sai_status_t rv = SAI_STATUS_SUCCESS;
+
+    _BRCM_SAI_ROUTE_LOCK();
+    if (enable && _brcm_sai_route_coalesce.enabled)
+    {
+        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "FIB compression can't be used "
+                           "with coalescing\n");
+        rv = SAI_STATUS_NOT_SUPPORTED;
+    }
+    else if (enable != _brcm_sai_route_fib_compress)
+    {
+        /* Compress (or expand) whatever is already programmed */
+        rv = _brcm_sai_rib_walk(_brcm_sai_route_fib_compress_cb, &enable);
+        if (SAI_STATUS_SUCCESS != rv)
+        {
+            BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR,
+                               "Error %d applying FIB compression\n", rv);
+        }
+        /* Partially expanded tables stay in compressed mode */
+        _brcm_sai_route_fib_compress = enable || (SAI_STATUS_SUCCESS != rv);
+    }
+    _BRCM_SAI_ROUTE_UNLOCK();
+    return rv;
+}
+
+/*
+################################################################################
+#                              Derived egress cache                            #
+################################################################################
+*/
+/* Routine to get a reference to a copy of an egress object with extra flags */
+STATIC sai_status_t
+_brcm_sai_route_log_egr_get(opennsl_if_t base, uint32 flags,
+                            opennsl_if_t *clone)
+{
+    int rv;
+    sai_uint32_t hash;
+    opennsl_l3_egress_t l3_egr;
+    _brcm_sai_route_log_egr_t *egr;
+
+    hash = ((sai_uint32_t)base * 2654435761u ^ flags) %
+           _BRCM_SAI_ROUTE_LOG_EGR_BUCKETS;
+    for (egr = _brcm_sai_route_log_egr[hash]; NULL != egr; egr = egr->next)
+    {
+        if ((egr->base == base) && (egr->flags == flags))
+        {
+            egr->ref_count++;
+            *clone = egr->clone;
+            return SAI_STATUS_SUCCESS;
+        }
+    }
+    egr = (_brcm_sai_route_log_egr_t*)calloc(1,
+              sizeof(_brcm_sai_route_log_egr_t));
+    if (NULL == egr)
+    {
+        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "Error allocating egress cache\n");
+        return SAI_STATUS_NO_MEMORY;
+    }
+    opennsl_l3_egress_t_init(&l3_egr);
+    rv = opennsl_l3_egress_get(0, base, &l3_egr);
+    if (OPENNSL_E_NONE == rv)
+    {
+        l3_egr.flags |= flags;
+        rv = opennsl_l3_egress_create(0, 0, &l3_egr, &egr->clone);
+    }
+    if (OPENNSL_E_NONE != rv)
+    {
+        free(egr);
+    }
+    BRCM_SAI_API_CHK(SAI_API_ROUTE, "L3 egress clone", rv);
+    egr->base = base;
+    egr->flags = flags;
+    egr->ref_count = 1;
+    egr->next = _brcm_sai_route_log_egr[hash];
+    _brcm_sai_route_log_egr[hash] = egr;
+    *clone = egr->clone;
+    BRCM_SAI_LOG_ROUTE(SAI_LOG_DEBUG, "Egress %d cloned to %d flags 0x%x\n",
+                       base, egr->clone, flags);
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Routine to drop a reference, the copy is destroyed with the last one */
+STATIC void
+_brcm_sai_route_log_egr_put(opennsl_if_t base, uint32 flags)
+{
+    int rv;
+    sai_uint32_t hash;
+    _brcm_sai_route_log_egr_t **link, *egr;
+
+    hash = ((sai_uint32_t)base * 2654435761u ^ flags) %
+           _BRCM_SAI_ROUTE_LOG_EGR_BUCKETS;
+    for (link = &_brcm_sai_route_log_egr[hash]; NULL != *link;
+         link = &(*link)->next)
+    {
+        egr = *link;
+        if ((egr->base != base) || (egr->flags != flags))
+        {
+            continue;
+        }
+        if (0 == --egr->ref_count)
+        {
+            rv = opennsl_l3_egress_destroy(0, egr->clone);
+            if (OPENNSL_E_NONE != rv)
+            {
+                BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR,
+                                   "Error %d destroying egress %d\n", rv,
+                                   egr->clone);
+            }
+            *link = egr->next;
+            free(egr);
+        }
+        return;
+    }
+}
+
+/*
+ * Routine to rewrite the copies of an egress object after it was changed,
+ * so that they keep forwarding like it (e.g. to a neighbor's new MAC).
+ */
+void
+_brcm_sai_route_egr_refresh(opennsl_if_t base)
+{
+    int i, rv;
+    opennsl_l3_egress_t l3_egr;
+    _brcm_sai_route_log_egr_t *egr;
+
+    _BRCM_SAI_ROUTE_LOCK();
+    for (i=0; i<_BRCM_SAI_ROUTE_LOG_EGR_BUCKETS; i++)
+    {
+        for (egr = _brcm_sai_route_log_egr[i]; NULL != egr; egr = egr->next)
+        {
+            if (egr->base != base)
+            {
+                continue;
+            }
+            opennsl_l3_egress_t_init(&l3_egr);
+            rv = opennsl_l3_egress_get(0, base, &l3_egr);
+            if (OPENNSL_E_NONE == rv)
+            {
+                l3_egr.flags |= egr->flags;
+                rv = opennsl_l3_egress_create(0, OPENNSL_L3_REPLACE |
+                                              OPENNSL_L3_WITH_ID, &l3_egr,
+                                              &egr->clone);
+            }
+            if (OPENNSL_E_NONE != rv)
+            {
+                BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "Error %d refreshing egress "
+                                   "%d from %d\n", rv, egr->clone, base);
+            }
+        }
+    }
+    _BRCM_SAI_ROUTE_UNLOCK();
+}
+
+/* Routine to release what a programmed route holds in the egress cache */
+STATIC void
+_brcm_sai_route_info_release(const _brcm_sai_route_info_t *info)
+{
+    if (SAI_PACKET_ACTION_LOG == info->action)
+    {
+        _brcm_sai_route_log_egr_put(BRCM_SAI_GET_OBJ_VAL(opennsl_if_t,
+                                                         info->nh_id),
+                                    OPENNSL_L3_COPY_TO_CPU);
+    }
+}
+
+/*
+################################################################################
+#                            Next hop indirection                              #
+################################################################################
+*/
+/* Routine to find an indirect next hop, called with the route lock */
+STATIC _brcm_sai_route_nhi_t **
+_brcm_sai_route_nhi_find(opennsl_if_t ecmp_intf)
+{
+    _brcm_sai_route_nhi_t **link;
+
+    for (link = &_brcm_sai_route_nhi[(sai_uint32_t)ecmp_intf %
+                                     _BRCM_SAI_ROUTE_NHI_BUCKETS];
+         NULL != *link; link = &(*link)->next)
+    {
+        if ((*link)->ecmp_intf == ecmp_intf)
+        {
+            break;
+        }
+    }
+    return link;
+}
+
+/*
+ * Routine to resolve a target into the egress objects it forwards to. The
+ * paths are read back from the group with a buffer grown until it holds
+ * them all, the caller frees them.
+ */
+STATIC sai_status_t
+_brcm_sai_route_nhi_paths_get(sai_object_id_t target_id, opennsl_if_t **paths,
+                              int *count)
+{
+    int rv, size = _BRCM_SAI_ROUTE_NHI_MAX_PATHS;
+    bool more = true;
+    opennsl_l3_egress_ecmp_t ecmp_object;
+
+    *paths = NULL;
+    switch (BRCM_SAI_GET_OBJ_TYPE(target_id))
+    {
+        case SAI_OBJECT_TYPE_NEXT_HOP:
+            *paths = (opennsl_if_t*)malloc(sizeof(opennsl_if_t));
+            if (NULL == *paths)
+            {
+                return SAI_STATUS_NO_MEMORY;
+            }
+            (*paths)[0] = BRCM_SAI_GET_OBJ_VAL(opennsl_if_t, target_id);
+            *count = 1;
+            break;
+        case SAI_OBJECT_TYPE_NEXT_HOP_GROUP:
+            if (NULL != *_brcm_sai_route_nhi_find(
+                             BRCM_SAI_GET_OBJ_VAL(opennsl_if_t, target_id)))
+            {
+                BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "Indirect next hop can't "
+                                   "target another indirect next hop\n");
+                return SAI_STATUS_INVALID_PARAMETER;
+            }
+            opennsl_l3_egress_ecmp_t_init(&ecmp_object);
+            ecmp_object.ecmp_intf = BRCM_SAI_GET_OBJ_VAL(opennsl_if_t,
+                                                         target_id);
+            while (more)
+            {
+                *paths = (opennsl_if_t*)malloc(size * sizeof(opennsl_if_t));
+                if (NULL == *paths)
+                {
+                    return SAI_STATUS_NO_MEMORY;
+                }
+                rv = opennsl_l3_egress_ecmp_get(0, &ecmp_object, size, *paths,
+                                                count);
+                if (OPENNSL_E_NONE != rv)
+                {
+                    free(*paths);
+                    *paths = NULL;
+                }
+                BRCM_SAI_API_CHK(SAI_API_ROUTE, "ecmp nh group get", rv);
+                /* A full buffer may have cut the group short */
+                more = (*count == size);
+                if (more)
+                {
+                    free(*paths);
+                    size *= 2;
+                }
+            }
+            if (0 == *count)
+            {
+                free(*paths);
+                *paths = NULL;
+                BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "Empty next hop group\n");
+                return SAI_STATUS_INVALID_PARAMETER;
+            }
+            break;
+        default:
+            BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR,
+                               "Invalid indirect next hop target\n");
+            return SAI_STATUS_INVALID_OBJECT_TYPE;
+    }
+    return SAI_STATUS_SUCCESS;
+}
+
+/*
+ * Routine to point the group of an indirect next hop at the current paths
+ * of a target, called with the route lock. The group grows if the target
+ * has more paths than it has room for.
+ */
+STATIC sai_status_t
+_brcm_sai_route_nhi_program(_brcm_sai_route_nhi_t *nhi,
+                            sai_object_id_t target_id)
+{
+    int count = 0;
+    sai_status_t rv;
+    opennsl_l3_egress_ecmp_t ecmp_object;
+    opennsl_if_t *paths;
+
+    rv = _brcm_sai_route_nhi_paths_get(target_id, &paths, &count);
+    if (SAI_STATUS_SUCCESS != rv)
+    {
+        return rv;
+    }
+    opennsl_l3_egress_ecmp_t_init(&ecmp_object);
+    ecmp_object.flags = OPENNSL_L3_REPLACE | OPENNSL_L3_WITH_ID;
+    ecmp_object.ecmp_intf = nhi->ecmp_intf;
+    ecmp_object.max_paths = (count > nhi->max_paths) ? count : nhi->max_paths;
+    rv = BRCM_RV_OPENNSL_TO_SAI(
+             opennsl_l3_egress_ecmp_create(0, &ecmp_object, count, paths));
+    free(paths);
+    if (SAI_STATUS_SUCCESS == rv)
+    {
+        nhi->max_paths = ecmp_object.max_paths;
+    }
+    return rv;
+}
+
+/*
+* Routine Description:
+*    Create an indirect next hop. The indirect next hop is a next hop group
+*    owned by the adapter which forwards like its target, a next hop or a
+*    next hop group. Routes which use it follow a retarget with no further
+*    route updates.
+*
+* Arguments:
+*    [out] indirect_id - indirect next hop id, a next hop group object
+*    [in] target_id - next hop or next hop group to forward to
+*
+* Return Values:
+*    SAI_STATUS_SUCCESS on success
+*    Failure status code on error
+*/
+sai_status_t
+brcm_sai_create_indirect_next_hop(_Out_ sai_object_id_t *indirect_id,
+                                  _In_ sai_object_id_t target_id)
+{
+    int count = 0;
+    bool held;
+    sai_status_t rv;
+    opennsl_l3_egress_ecmp_t ecmp_object;
+    opennsl_if_t *paths;
+    _brcm_sai_route_nhi_t *nhi, **link;
+
+    BRCM_SAI_FUNCTION_ENTER(SAI_API_ROUTE);
+    BRCM_SAI_SWITCH_INIT_CHECK;
+    if (NULL == indirect_id)
+    {
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+
+    nhi = (_brcm_sai_route_nhi_t*)calloc(1, sizeof(_brcm_sai_route_nhi_t));
+    if (NULL == nhi)
+    {
+        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR,
+                           "Error allocating indirect next hop\n");
+        return SAI_STATUS_NO_MEMORY;
+    }
+    _BRCM_SAI_ROUTE_LOCK();
+    /* Hold the target until the indirect next hop takes its own reference */
+    rv = _brcm_sai_deps_ref(target_id, SAI_NULL_OBJECT_ID);
+    held = (SAI_STATUS_SUCCESS == rv);
+    if (held)
+    {
+        rv = _brcm_sai_route_nhi_paths_get(target_id, &paths, &count);
+    }
+    if (SAI_STATUS_SUCCESS == rv)
+    {
+        opennsl_l3_egress_ecmp_t_init(&ecmp_object);
+        ecmp_object.max_paths = (count > _BRCM_SAI_ROUTE_NHI_MAX_PATHS) ?
+                                count : _BRCM_SAI_ROUTE_NHI_MAX_PATHS;
+        rv = BRCM_RV_OPENNSL_TO_SAI(
+                 opennsl_l3_egress_ecmp_create(0, &ecmp_object, count,
+                                               paths));
+        free(paths);
+        if (SAI_STATUS_SUCCESS == rv)
+        {
+            *indirect_id = BRCM_SAI_CREATE_OBJ(SAI_OBJECT_TYPE_NEXT_HOP_GROUP,
+                                               ecmp_object.ecmp_intf);
+            rv = _brcm_sai_deps_ref(target_id, *indirect_id);
+            if (SAI_STATUS_SUCCESS != rv)
+            {
+                (void)opennsl_l3_egress_ecmp_destroy(0, &ecmp_object);
+            }
+        }
+    }
+    if (held)
+    {
+        _brcm_sai_deps_unref(target_id, SAI_NULL_OBJECT_ID);
+    }
+    if (SAI_STATUS_SUCCESS != rv)
+    {
+        _BRCM_SAI_ROUTE_UNLOCK();
+        free(nhi);
+        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR,
+                           "Error %d creating indirect next hop\n", rv);
+        return rv;
+    }
+    nhi->ecmp_intf = ecmp_object.ecmp_intf;
+    nhi->max_paths = ecmp_object.max_paths;
+    nhi->target_id = target_id;
+    link = _brcm_sai_route_nhi_find(nhi->ecmp_intf);
+    nhi->next = *link;
+    *link = nhi;
+    _BRCM_SAI_ROUTE_UNLOCK();
+
+    BRCM_SAI_LOG_ROUTE(SAI_LOG_DEBUG, "Indirect next hop %d with %d paths\n",
+                       nhi->ecmp_intf, count);
+    BRCM_SAI_FUNCTION_EXIT(SAI_API_ROUTE);
+
+    return rv;
+}
+
+/*
+* Routine Description:
+*    Retarget an indirect next hop. The hardware group is replaced in place
+*    so all the routes using it switch over with a single update.
+*
+* Arguments:
+*    [in] indirect_id - indirect next hop id
+*    [in] target_id - new next hop or next hop group to forward to
+*
+* Return Values:
+*    SAI_STATUS_SUCCESS on success
+*    Failure status code on error
+*/
+sai_status_t
+brcm_sai_set_indirect_next_hop(_In_ sai_object_id_t indirect_id,
+                               _In_ sai_object_id_t target_id)
+{
+    sai_status_t rv;
+    _brcm_sai_route_nhi_t *nhi;
+
+    BRCM_SAI_FUNCTION_ENTER(SAI_API_ROUTE);
+    BRCM_SAI_SWITCH_INIT_CHECK;
+
+    _BRCM_SAI_ROUTE_LOCK();
+    nhi = *_brcm_sai_route_nhi_find(BRCM_SAI_GET_OBJ_VAL(opennsl_if_t,
+                                                         indirect_id));
+    if ((SAI_OBJECT_TYPE_NEXT_HOP_GROUP !=
+         BRCM_SAI_GET_OBJ_TYPE(indirect_id)) || (NULL == nhi))
+    {
+        _BRCM_SAI_ROUTE_UNLOCK();
+        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "Invalid indirect next hop\n");
+        return SAI_STATUS_INVALID_OBJECT_ID;
+    }
+    if (nhi->target_id == target_id)
+    {
+        _BRCM_SAI_ROUTE_UNLOCK();
+        return SAI_STATUS_SUCCESS;
+    }
+    rv = _brcm_sai_route_nhi_program(nhi, target_id);
+    if (SAI_STATUS_SUCCESS == rv)
+    {
+        (void)_brcm_sai_deps_set(indirect_id, 1, &target_id);
+        nhi->target_id = target_id;
+    }
+    _BRCM_SAI_ROUTE_UNLOCK();
+    if (SAI_STATUS_SUCCESS != rv)
+    {
+        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR,
+                           "Error %d retargeting indirect next hop\n", rv);
+        return rv;
+    }
+    BRCM_SAI_FUNCTION_EXIT(SAI_API_ROUTE);
+
+    return rv;
+}
+
+/*
+* Routine Description:
+*    Get the current target of an indirect next hop.
+*
+* Arguments:
+*    [in] indirect_id - indirect next hop id
+*    [out] target_id - next hop or next hop group forwarded to
+*
+* Return Values:
+*    SAI_STATUS_SUCCESS on success
+*    Failure status code on error
+*/
+sai_status_t
+brcm_sai_get_indirect_next_hop(_In_ sai_object_id_t indirect_id,
+                               _Out_ sai_object_id_t *target_id)
+{
+    sai_status_t rv = SAI_STATUS_INVALID_OBJECT_ID;
+    _brcm_sai_route_nhi_t *nhi;
+
+    BRCM_SAI_FUNCTION_ENTER(SAI_API_ROUTE);
+    BRCM_SAI_SWITCH_INIT_CHECK;
+    if (NULL == target_id)
+    {
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+
+    _BRCM_SAI_ROUTE_LOCK();
+    nhi = *_brcm_sai_route_nhi_find(BRCM_SAI_GET_OBJ_VAL(opennsl_if_t,
+                                                         indirect_id));
+    if ((SAI_OBJECT_TYPE_NEXT_HOP_GROUP ==
+         BRCM_SAI_GET_OBJ_TYPE(indirect_id)) && (NULL != nhi))
+    {
+        *target_id = nhi->target_id;
+        rv = SAI_STATUS_SUCCESS;
+    }
+    _BRCM_SAI_ROUTE_UNLOCK();
+
+    BRCM_SAI_FUNCTION_EXIT(SAI_API_ROUTE);
+
+    return rv;
+}
+
+/*
+* Routine Description:
+*    Remove an indirect next hop. Fails while routes still use it.
+*
+* Arguments:
+*    [in] indirect_id - indirect next hop id
+*
+* Return Values:
+*    SAI_STATUS_SUCCESS on success
+*    Failure status code on error
+*/
+sai_status_t
+brcm_sai_remove_indirect_next_hop(_In_ sai_object_id_t indirect_id)
+{
+    sai_status_t rv;
+    opennsl_l3_egress_ecmp_t ecmp_object;
+    _brcm_sai_route_nhi_t *nhi, **link;
+
+    BRCM_SAI_FUNCTION_ENTER(SAI_API_ROUTE);
+    BRCM_SAI_SWITCH_INIT_CHECK;
+
+    _BRCM_SAI_ROUTE_LOCK();
+    link = _brcm_sai_route_nhi_find(BRCM_SAI_GET_OBJ_VAL(opennsl_if_t,
+                                                         indirect_id));
+    if ((SAI_OBJECT_TYPE_NEXT_HOP_GROUP !=
+         BRCM_SAI_GET_OBJ_TYPE(indirect_id)) || (NULL == *link))
+    {
+        _BRCM_SAI_ROUTE_UNLOCK();
+        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "Invalid indirect next hop\n");
+        return SAI_STATUS_INVALID_OBJECT_ID;
+    }
+    if (_brcm_sai_deps_count(indirect_id))
+    {
+        _BRCM_SAI_ROUTE_UNLOCK();
+        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "Indirect next hop still used by "
+                           "routes\n");
+        return SAI_STATUS_OBJECT_IN_USE;
+    }
+    nhi = *link;
+    opennsl_l3_egress_ecmp_t_init(&ecmp_object);
+    ecmp_object.ecmp_intf = nhi->ecmp_intf;
+    rv = BRCM_RV_OPENNSL_TO_SAI(opennsl_l3_egress_ecmp_destroy(0,
+                                                               &ecmp_object));
+    if (SAI_STATUS_SUCCESS == rv)
+    {
+        *link = nhi->next;
+        free(nhi);
+        _brcm_sai_deps_release(indirect_id);
+    }
+    _BRCM_SAI_ROUTE_UNLOCK();
+    if (SAI_STATUS_SUCCESS != rv)
+    {
+        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR,
+                           "Error %d removing indirect next hop\n", rv);
+        return rv;
+    }
+    BRCM_SAI_FUNCTION_EXIT(SAI_API_ROUTE);
+
+    return rv;
+}
+
+/*
+ * Routine to reprogram the indirect next hops which forward like a group,
+ * called by the next hop group module once the group's paths have changed.
+ */
+void
+_brcm_sai_route_nhi_refresh(sai_object_id_t target_id)
+{
+    int i;
+    sai_status_t rv;
+    _brcm_sai_route_nhi_t *nhi;
+
+    _BRCM_SAI_ROUTE_LOCK();
+    for (i=0; i<_BRCM_SAI_ROUTE_NHI_BUCKETS; i++)
+    {
+        for (nhi = _brcm_sai_route_nhi[i]; NULL != nhi; nhi = nhi->next)
+        {
+            if (nhi->target_id != target_id)
+            {
+                continue;
+            }
+            rv = _brcm_sai_route_nhi_program(nhi, target_id);
+            if (SAI_STATUS_SUCCESS != rv)
+            {
+                BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "Error %d refreshing "
+                                   "indirect next hop %d\n", rv,
+                                   nhi->ecmp_intf);
+            }
+        }
+    }
+    _BRCM_SAI_ROUTE_UNLOCK();
+}
+
+/* Routine to check if a group is the group of an indirect next hop */
+bool
+_brcm_sai_route_nhi_owned(opennsl_if_t ecmp_intf)
+{
+    bool owned;
+
+    _BRCM_SAI_ROUTE_LOCK();
+    owned = (NULL != *_brcm_sai_route_nhi_find(ecmp_intf));
+    _BRCM_SAI_ROUTE_UNLOCK();
+
+    return owned;
+}
+
+/*
+################################################################################
+#                           Asynchronous programming                           #
+################################################################################
+*/
+/*
+ * Routine to queue a route operation, lock free for any number of callers.
+ * Returns false when operations are not queued and the caller is to program
+ * it, otherwise rv has the queueing status. The busy count lets disabling
+ * wait for callers already past the enabled check.
+ */
+STATIC bool
+_brcm_sai_route_async_post(brcm_sai_route_op_t op,
+                           const sai_unicast_route_entry_t* unicast_route_entry,
+                           sai_uint32_t attr_count,
+                           const sai_attribute_t *attr_list,
+                           sai_status_t *rv)
+{
+    sai_int32_t diff;
+    sai_uint32_t pos, seq;
+    _brcm_sai_route_async_slot_t *slot;
+
+    __atomic_add_fetch(&_brcm_sai_route_async.busy, 1, __ATOMIC_SEQ_CST);
+    if (false == __atomic_load_n(&_brcm_sai_route_async.enabled,
+                                 __ATOMIC_SEQ_CST))
+    {
+        __atomic_sub_fetch(&_brcm_sai_route_async.busy, 1, __ATOMIC_RELEASE);
+        return false;
+    }
+    if (attr_count > _BRCM_SAI_ROUTE_ASYNC_MAX_ATTRS)
+    {
+        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "Too many attributes passed\n");
+        __atomic_sub_fetch(&_brcm_sai_route_async.busy, 1, __ATOMIC_RELEASE);
+        *rv = SAI_STATUS_INVALID_PARAMETER;
+        return true;
+    }
+    pos = __atomic_load_n(&_brcm_sai_route_async.head, __ATOMIC_RELAXED);
+    while (1)
+    {
+        slot = &_brcm_sai_route_async.ring[pos & _brcm_sai_route_async.mask];
+        seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        diff = (sai_int32_t)(seq - pos);
+        if (0 == diff)
+        {
+            /* Slot is free, claim it */
+            if (__atomic_compare_exchange_n(&_brcm_sai_route_async.head, &pos,
+                                            pos + 1, true, __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            /* Worker hasn't consumed this slot yet, queue is full */
+            BRCM_SAI_LOG_ROUTE(SAI_LOG_DEBUG, "Route queue full\n");
+            __atomic_sub_fetch(&_brcm_sai_route_async.busy, 1,
+                               __ATOMIC_RELEASE);
+            *rv = SAI_STATUS_INSUFFICIENT_RESOURCES;
+            return true;
+        }
+        else
+        {
+            pos = __atomic_load_n(&_brcm_sai_route_async.head,
+                                  __ATOMIC_RELAXED);
+        }
+    }
+    slot->op = op;
+    slot->route = *unicast_route_entry;
+    slot->attr_count = attr_count;
+    if (attr_count)
+    {
+        memcpy(slot->attrs, attr_list, attr_count * sizeof(sai_attribute_t));
+    }
+    __atomic_add_fetch(&_brcm_sai_route_async.posted, 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+    sem_post(&_brcm_sai_route_async.sem);
+    __atomic_sub_fetch(&_brcm_sai_route_async.busy, 1, __ATOMIC_RELEASE);
+    *rv = SAI_STATUS_SUCCESS;
+    return true;
+}
+
+/* Routine to program the queued route operations in order */
+STATIC void *
+_brcm_sai_route_async_thread(void *arg)
+{
+    sai_status_t rv;
+    sai_uint32_t pos;
+    brcm_sai_route_async_notification_fn notify;
+    _brcm_sai_route_async_slot_t *slot;
+
+    pos = _brcm_sai_route_async.tail;
+    while (1)
+    {
+        sem_wait(&_brcm_sai_route_async.sem);
+        if (false == __atomic_load_n(&_brcm_sai_route_async.thread_run,
+                                     __ATOMIC_ACQUIRE))
+        {
+            break;
+        }
+        /*
+         * Every post is one token, and the slots are claimed in order, so
+         * the token may be for a later slot while this one is still being
+         * filled in by its producer. Wait for it rather than giving the
+         * token up, the later slot would otherwise sit until the next post.
+         */
+        slot = &_brcm_sai_route_async.ring[pos & _brcm_sai_route_async.mask];
+        while (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != pos + 1)
+        {
+            if (false == __atomic_load_n(&_brcm_sai_route_async.thread_run,
+                                         __ATOMIC_ACQUIRE))
+            {
+                return NULL;
+            }
+            sched_yield();
+        }
+        _BRCM_SAI_ROUTE_LOCK();
+        switch (slot->op)
+        {
+            case BRCM_SAI_ROUTE_OP_CREATE:
+                rv = _brcm_sai_route_create(&slot->route, slot->attr_count,
+                                            slot->attrs);
+                break;
+            case BRCM_SAI_ROUTE_OP_REMOVE:
+                rv = _brcm_sai_route_remove(&slot->route);
+                break;
+            default:
+                rv = _brcm_sai_update_route(&slot->route, slot->attr_count,
+                                            slot->attrs);
+                break;
+        }
+        _BRCM_SAI_ROUTE_UNLOCK();
+        notify = __atomic_load_n(&_brcm_sai_route_async.notify,
+                                 __ATOMIC_ACQUIRE);
+        if (NULL != notify)
+        {
+            notify(slot->op, &slot->route, rv);
+        }
+        else if (SAI_STATUS_SUCCESS != rv)
+        {
+            BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR,
+                               "Queued route op %d failed with %d\n",
+                               slot->op, rv);
+        }
+        /* Hand the slot back to the producers */
+        __atomic_store_n(&slot->seq, pos + _brcm_sai_route_async.mask + 1,
+                         __ATOMIC_RELEASE);
+        _brcm_sai_route_async.tail = ++pos;
+
+        pthread_mutex_lock(&_brcm_sai_route_async.mutex);
+        _brcm_sai_route_async.done++;
+        pthread_cond_broadcast(&_brcm_sai_route_async.drained);
+        pthread_mutex_unlock(&_brcm_sai_route_async.mutex);
+    }
+    return NULL;
+}
+
+/* Routine to wait until every queued operation has been programmed */
+STATIC void
+_brcm_sai_route_async_drain(void)
+{
+    pthread_mutex_lock(&_brcm_sai_route_async.mutex);
+    while (_brcm_sai_route_async.thread_run &&
+           (_brcm_sai_route_async.done !=
+            __atomic_load_n(&_brcm_sai_route_async.posted, __ATOMIC_ACQUIRE)))
+    {
+        pthread_cond_wait(&_brcm_sai_route_async.drained,
+                          &_brcm_sai_route_async.mutex);
+    }
+    pthread_mutex_unlock(&_brcm_sai_route_async.mutex);
+}
+
+/* Routine to stop queueing and wait for the callers still posting */
+STATIC void
+_brcm_sai_route_async_quiesce(void)
+{
+    __atomic_store_n(&_brcm_sai_route_async.enabled, false, __ATOMIC_SEQ_CST);
+    while (0 != __atomic_load_n(&_brcm_sai_route_async.busy, __ATOMIC_SEQ_CST))
+    {
+        sched_yield();
+    }
+}
+
+/* Routine to stop the worker, operations still queued are discarded */
+STATIC void
+_brcm_sai_route_async_stop(void)
+{
+    if (false == _brcm_sai_route_async.thread_run)
+    {
+        return;
+    }
+    _brcm_sai_route_async_quiesce();
+    pthread_mutex_lock(&_brcm_sai_route_async.mutex);
+    __atomic_store_n(&_brcm_sai_route_async.thread_run, false,
+                     __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&_brcm_sai_route_async.drained);
+    pthread_mutex_unlock(&_brcm_sai_route_async.mutex);
+    sem_post(&_brcm_sai_route_async.sem);
+    pthread_join(_brcm_sai_route_async.thread, NULL);
+    sem_destroy(&_brcm_sai_route_async.sem);
+    CHECK_FREE(_brcm_sai_route_async.ring);
+    _brcm_sai_route_async.ring = NULL;
+}
+
+/* Routine to allocate the queue and start the worker */
+STATIC sai_status_t
+_brcm_sai_route_async_start(void)
+{
+    sai_uint32_t i, size;
+
+    if (_brcm_sai_route_async.thread_run)
+    {
+        return SAI_STATUS_SUCCESS;
+    }
+    /* Ring size must be a power of 2 for the index mask */
+    for (size = 1; size < _brcm_sai_route_async.depth; size <<= 1);
+    _brcm_sai_route_async.ring = (_brcm_sai_route_async_slot_t*)
+        calloc(size, sizeof(_brcm_sai_route_async_slot_t));
+    if (NULL == _brcm_sai_route_async.ring)
+    {
+        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "Error allocating route queue\n");
+        return SAI_STATUS_NO_MEMORY;
+    }
+    for (i=0; i<size; i++)
+    {
+        _brcm_sai_route_async.ring[i].seq = i;
+    }
+    _brcm_sai_route_async.mask = size - 1;
+    _brcm_sai_route_async.head = _brcm_sai_route_async.tail = 0;
+    _brcm_sai_route_async.posted = _brcm_sai_route_async.done = 0;
+    if (0 != sem_init(&_brcm_sai_route_async.sem, 0, 0))
+    {
+        free(_brcm_sai_route_async.ring);
+        _brcm_sai_route_async.ring = NULL;
+        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "Error creating route semaphore\n");
+        return SAI_STATUS_FAILURE;
+    }
+    _brcm_sai_route_async.thread_run = true;
+    if (0 != pthread_create(&_brcm_sai_route_async.thread, NULL,
+                            _brcm_sai_route_async_thread, NULL))
+    {
+        _brcm_sai_route_async.thread_run = false;
+        sem_destroy(&_brcm_sai_route_async.sem);
+        free(_brcm_sai_route_async.ring);
+        _brcm_sai_route_async.ring = NULL;
+        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "Error creating route thread\n");
+        return SAI_STATUS_FAILURE;
+    }
+    __atomic_store_n(&_brcm_sai_route_async.enabled, true, __ATOMIC_RELEASE);
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Routine to handle the asynchronous route programming switch attributes */
+sai_status_t
+_brcm_sai_route_async_set(const sai_attribute_t *attr)
+{
+    sai_status_t rv = SAI_STATUS_SUCCESS;
+
+    switch (attr->id)
+    {
+        case SAI_SWITCH_ATTR_BRCM_ROUTE_ASYNC_ENABLE:
+            if (attr->value.booldata)
+            {
+                rv = _brcm_sai_route_async_start();
+            }
+            else
+            {
+                /* Operations queued before this are still programmed */
+                _brcm_sai_route_async_quiesce();
+                _brcm_sai_route_async_drain();
+                _brcm_sai_route_async_stop();
+            }
+            break;
+        case SAI_SWITCH_ATTR_BRCM_ROUTE_ASYNC_DEPTH:
+            if (_brcm_sai_route_async.thread_run)
+            {
+                BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "Route queue depth can't "
+                                   "change while in use\n");
+                return SAI_STATUS_OBJECT_IN_USE;
+            }
+            if (0 == attr->value.u32)
+            {
+                return SAI_STATUS_INVALID_PARAMETER;
+            }
+            _brcm_sai_route_async.depth = attr->value.u32;
+            break;
+        case SAI_SWITCH_ATTR_BRCM_ROUTE_ASYNC_DRAIN:
+            _brcm_sai_route_async_drain();
+            break;
+        default:
+            rv = SAI_STATUS_INVALID_PARAMETER;
+            break;
+    }
+    return rv;
+}
+
+/*
+* Routine Description:
+*    Register the completion callback for asynchronous route programming.
+*
+* Arguments:
+*    [in] notification - callback, NULL to unregister
+*
+* Return Values:
+*    SAI_STATUS_SUCCESS on success
+*/
+sai_status_t
+brcm_sai_route_async_notification_register(_In_
+    brcm_sai_route_async_notification_fn notification)
+{
+    BRCM_SAI_FUNCTION_ENTER(SAI_API_ROUTE);
+
+    __atomic_store_n(&_brcm_sai_route_async.notify, notification,
+                     __ATOMIC_RELEASE);
+
+    BRCM_SAI_FUNCTION_EXIT(SAI_API_ROUTE);
+
+    return SAI_STATUS_SUCCESS;
+}
+
+/*
+################################################################################
+#                             Resource accounting                              #
+################################################################################
+*/
+/*
+ * Routine to record a watermark crossing when the occupancy of a table
+ * crosses one. Called with the route lock held.
+ */
+STATIC void
+_brcm_sai_route_watermark_check(brcm_sai_route_table_t table)
+{
+    bool host = (BRCM_SAI_ROUTE_TABLE_HOST == table);
+    sai_uint32_t count;
+    _brcm_sai_route_watermark_t *wm = &_brcm_sai_route_watermark[table];
+
+    if (0 == wm->high)
+    {
+        return;
+    }
+    count = _brcm_sai_rib_hw_total_get(SAI_IP_ADDR_FAMILY_IPV4, host) +
+            _brcm_sai_rib_hw_total_get(SAI_IP_ADDR_FAMILY_IPV6, host);
+    if (!wm->above && (count >= wm->high))
+    {
+        wm->above = true;
+    }
+    else if (wm->above && (count <= wm->low))
+    {
+        wm->above = false;
+    }
+    else
+    {
+        return;
+    }
+    wm->count = count;
+    BRCM_SAI_LOG_ROUTE(SAI_LOG_NOTICE, "Route %s table at %s watermark, "
+                       "%d entries\n", host ? "host" : "LPM",
+                       wm->above ? "high" : "low", count);
+}
+
+/*
+ * Routine to drop the route lock and deliver the watermark crossings
+ * recorded under it. The callback may call the route APIs, crossings it
+ * causes are left to the thread already delivering so they stay in order.
+ */
+STATIC void
+_brcm_sai_route_unlock(void)
+{
+    int table;
+    bool high;
+    sai_uint32_t count;
+    _brcm_sai_route_watermark_t *wm;
+    brcm_sai_route_resource_notification_fn notify;
+
+    while (!_brcm_sai_route_resource_busy)
+    {
+        for (table = BRCM_SAI_ROUTE_TABLE_LPM;
+             table <= BRCM_SAI_ROUTE_TABLE_HOST; table++)
+        {
+            if (_brcm_sai_route_watermark[table].above !=
+                _brcm_sai_route_watermark[table].notified)
+            {
+                break;
+            }
+        }
+        if (table > BRCM_SAI_ROUTE_TABLE_HOST)
+        {
+            break;
+        }
+        wm = &_brcm_sai_route_watermark[table];
+        wm->notified = high = wm->above;
+        count = wm->count;
+        notify = _brcm_sai_route_resource_notify;
+        if (NULL == notify)
+        {
+            continue;
+        }
+        _brcm_sai_route_resource_busy = true;
+        pthread_mutex_unlock(&_brcm_sai_route_mutex);
+        notify(table, high, count);
+        pthread_mutex_lock(&_brcm_sai_route_mutex);
+        _brcm_sai_route_resource_busy = false;
+    }
+    pthread_mutex_unlock(&_brcm_sai_route_mutex);
+}
+
+/* Routine to account for a route written to or removed from a table */
+STATIC void
+_brcm_sai_route_hw_count(const opennsl_l3_route_t *l3_rt, bool host,
+                         int delta)
+{
+    _brcm_sai_rib_hw_count_update(l3_rt->l3a_vrf,
+                                  (l3_rt->l3a_flags & OPENNSL_L3_IP6) ?
+                                  SAI_IP_ADDR_FAMILY_IPV6 :
+                                  SAI_IP_ADDR_FAMILY_IPV4, host, delta);
+    _brcm_sai_route_watermark_check(host ? BRCM_SAI_ROUTE_TABLE_HOST :
+                                           BRCM_SAI_ROUTE_TABLE_LPM);
+}
+
+/* Routine to handle the route table watermark switch attributes */
+sai_status_t
+_brcm_sai_route_resource_set(const sai_attribute_t *attr)
+{
+    sai_status_t rv = SAI_STATUS_SUCCESS;
+    brcm_sai_route_table_t table;
+    _brcm_sai_route_watermark_t wm;
+
+    switch (attr->id)
+    {
+        case SAI_SWITCH_ATTR_BRCM_ROUTE_LPM_HIGH_WATERMARK:
+        case SAI_SWITCH_ATTR_BRCM_ROUTE_LPM_LOW_WATERMARK:
+            table = BRCM_SAI_ROUTE_TABLE_LPM;
+            break;
+        case SAI_SWITCH_ATTR_BRCM_ROUTE_HOST_HIGH_WATERMARK:
+        case SAI_SWITCH_ATTR_BRCM_ROUTE_HOST_LOW_WATERMARK:
+            table = BRCM_SAI_ROUTE_TABLE_HOST;
+            break;
+        default:
+            return SAI_STATUS_INVALID_PARAMETER;
+    }
+    _BRCM_SAI_ROUTE_LOCK();
+    wm = _brcm_sai_route_watermark[table];
+    if ((SAI_SWITCH_ATTR_BRCM_ROUTE_LPM_HIGH_WATERMARK == attr->id) ||
+        (SAI_SWITCH_ATTR_BRCM_ROUTE_HOST_HIGH_WATERMARK == attr->id))
+    {
+        wm.high = attr->value.u32;
+    }
+    else
+    {
+        wm.low = attr->value.u32;
+    }
+    if (wm.high && (wm.low >= wm.high))
+    {
+        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "Route low watermark %d must be "
+                           "below the high watermark %d\n", wm.low, wm.high);
+        rv = SAI_STATUS_INVALID_ATTR_VALUE_0;
+    }
+    else
+    {
+        if (0 == wm.high)
+        {
+            wm.above = wm.notified = false;
+        }
+        _brcm_sai_route_watermark[table] = wm;
+        _brcm_sai_route_watermark_check(table);
+    }
+    _BRCM_SAI_ROUTE_UNLOCK();
+    return rv;
+}
+
+/*
+ * Routine to get the route table occupancy and watermark switch attributes.
+ * The counters are read without the route lock.
+ */
+sai_status_t
+_brcm_sai_route_resource_get(sai_attribute_t *attr)
+{
+    switch (attr->id)
+    {
+        case SAI_SWITCH_ATTR_BRCM_ROUTE_IPV4_LPM_ENTRIES:
+            attr->value.u32 =
+                _brcm_sai_rib_hw_total_get(SAI_IP_ADDR_FAMILY_IPV4, false);
+            break;
+        case SAI_SWITCH_ATTR_BRCM_ROUTE_IPV4_HOST_ENTRIES:
+            attr->value.u32 =
+                _brcm_sai_rib_hw_total_get(SAI_IP_ADDR_FAMILY_IPV4, true);
+            break;
+        case SAI_SWITCH_ATTR_BRCM_ROUTE_IPV6_LPM_ENTRIES:
+            attr->value.u32 =
+                _brcm_sai_rib_hw_total_get(SAI_IP_ADDR_FAMILY_IPV6, false);
+            break;
+        case SAI_SWITCH_ATTR_BRCM_ROUTE_IPV6_HOST_ENTRIES:
+            attr->value.u32 =
+                _brcm_sai_rib_hw_total_get(SAI_IP_ADDR_FAMILY_IPV6, true);
+            break;
+        case SAI_SWITCH_ATTR_BRCM_ROUTE_LPM_HIGH_WATERMARK:
+            attr->value.u32 =
+                _brcm_sai_route_watermark[BRCM_SAI_ROUTE_TABLE_LPM].high;
+            break;
+        case SAI_SWITCH_ATTR_BRCM_ROUTE_LPM_LOW_WATERMARK:
+            attr->value.u32 =
+                _brcm_sai_route_watermark[BRCM_SAI_ROUTE_TABLE_LPM].low;
+            break;
+        case SAI_SWITCH_ATTR_BRCM_ROUTE_HOST_HIGH_WATERMARK:
+            attr->value.u32 =
+                _brcm_sai_route_watermark[BRCM_SAI_ROUTE_TABLE_HOST].high;
+            break;
+        case SAI_SWITCH_ATTR_BRCM_ROUTE_HOST_LOW_WATERMARK:
+            attr->value.u32 =
+                _brcm_sai_route_watermark[BRCM_SAI_ROUTE_TABLE_HOST].low;
+            break;
+        default:
+            return SAI_STATUS_INVALID_PARAMETER;
+    }
+    return SAI_STATUS_SUCCESS;
+}
+
+/*
+* Routine Description:
+*    Register the route table watermark callback.
+*
+* Arguments:
+*    [in] notification - callback, NULL to unregister
+*
+* Return Values:
+*    SAI_STATUS_SUCCESS on success
+*/
+sai_status_t
+brcm_sai_route_resource_notification_register(_In_
+    brcm_sai_route_resource_notification_fn notification)
+{
+    BRCM_SAI_FUNCTION_ENTER(SAI_API_ROUTE);
+
+    _BRCM_SAI_ROUTE_LOCK();
+    _brcm_sai_route_resource_notify = notification;
+    _BRCM_SAI_ROUTE_UNLOCK();
+
+    BRCM_SAI_FUNCTION_EXIT(SAI_API_ROUTE);
+
+    return SAI_STATUS_SUCCESS;
+}
+
+/*
+################################################################################
+#                              Route coalescing                                #
+################################################################################
+*/
+/* Routine to hash the vrf and prefix of a route */
+STATIC sai_uint32_t
+_brcm_sai_route_pending_hash(const sai_unicast_route_entry_t* route)
+{
+    int i, bytes;
+    sai_uint32_t hash = 2166136261u;
+    const uint8_t *addr, *mask;
+
+    if (SAI_IP_ADDR_FAMILY_IPV4 == route->destination.addr_family)
+    {
+        bytes = sizeof(sai_ip4_t);
+        addr = (const uint8_t*)&route->destination.addr.ip4;
+        mask = (const uint8_t*)&route->destination.mask.ip4;
+    }
+    else
+    {
+        bytes = sizeof(sai_ip6_t);
+        addr = route->destination.addr.ip6;
+        mask = route->destination.mask.ip6;
+    }
+    hash = (hash ^ BRCM_SAI_GET_OBJ_VAL(sai_uint32_t, route->vr_id)) *
+           16777619u;
+    for (i=0; i<bytes; i++)
+    {
+        hash = (hash ^ (addr[i] & mask[i])) * 16777619u;
+        hash = (hash ^ mask[i]) * 16777619u;
+    }
+    return hash % _BRCM_SAI_ROUTE_PENDING_BUCKETS;
+}
+
+/* Routine to compare the vrf and prefix of two routes */
+STATIC bool
+_brcm_sai_route_key_equal(const sai_unicast_route_entry_t* a,
+                          const sai_unicast_route_entry_t* b)
+{
+    int i;
+
+    if ((BRCM_SAI_GET_OBJ_VAL(sai_uint32_t, a->vr_id) !=
+         BRCM_SAI_GET_OBJ_VAL(sai_uint32_t, b->vr_id)) ||
+        (a->destination.addr_family != b->destination.addr_family))
+    {
+        return false;
+    }
+    if (SAI_IP_ADDR_FAMILY_IPV4 == a->destination.addr_family)
+    {
+        return (a->destination.mask.ip4 == b->destination.mask.ip4) &&
+               ((a->destination.addr.ip4 & a->destination.mask.ip4) ==
+                (b->destination.addr.ip4 & b->destination.mask.ip4));
+    }
+    for (i=0; i<sizeof(sai_ip6_t); i++)
+    {
+        if ((a->destination.mask.ip6[i] != b->destination.mask.ip6[i]) ||
+            ((a->destination.addr.ip6[i] & a->destination.mask.ip6[i]) !=
+             (b->destination.addr.ip6[i] & b->destination.mask.ip6[i])))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Routine to note a deferred operation on a route. Only the first operation
+ * since the last flush records the hardware state (NULL if the route is not
+ * in hardware), later ones are collapsed into it.
+ */
+STATIC sai_status_t
+_brcm_sai_route_pending_mark(const sai_unicast_route_entry_t* unicast_route_entry,
+                             const _brcm_sai_route_info_t *hw_info)
+{
+    sai_uint32_t hash;
+    _brcm_sai_route_pending_t *pending;
+
+    hash = _brcm_sai_route_pending_hash(unicast_route_entry);
+    for (pending = _brcm_sai_route_coalesce.table[hash]; NULL != pending;
+         pending = pending->next)
+    {
+        if (_brcm_sai_route_key_equal(&pending->route, unicast_route_entry))
+        {
+            return SAI_STATUS_SUCCESS;
+        }
+    }
+    pending = (_brcm_sai_route_pending_t*)
+                  calloc(1, sizeof(_brcm_sai_route_pending_t));
+    if (NULL == pending)
+    {
+        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "Error allocating pending route\n");
+        return SAI_STATUS_NO_MEMORY;
+    }
+    pending->route = *unicast_route_entry;
+    if (NULL != hw_info)
+    {
+        pending->hw_valid = true;
+        pending->hw_info = *hw_info;
+    }
+    pending->next = _brcm_sai_route_coalesce.table[hash];
+    _brcm_sai_route_coalesce.table[hash] = pending;
+    if (NULL == _brcm_sai_route_coalesce.tail)
+    {
+        _brcm_sai_route_coalesce.head = pending;
+    }
+    else
+    {
+        _brcm_sai_route_coalesce.tail->list = pending;
+    }
+    _brcm_sai_route_coalesce.tail = pending;
+    _brcm_sai_route_coalesce.count++;
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Routine to flush once the batch limit is reached, after the rib update */
+STATIC void
+_brcm_sai_route_pending_batch_check(void)
+{
+    if (_brcm_sai_route_coalesce.batch &&
+        (_brcm_sai_route_coalesce.count >= _brcm_sai_route_coalesce.batch))
+    {
+        _brcm_sai_route_pending_flush();
+    }
+}
+
+/* Routine to write the net change of a pending route to the hardware */
+STATIC sai_status_t
+_brcm_sai_route_pending_write(_brcm_sai_route_pending_t *pending, bool *wrote)
+{
+    int rv;
+    sai_uint32_t vr_id;
+    opennsl_l3_route_t l3_rt;
+    _brcm_sai_rib_node_t *node;
+    const sai_ip_prefix_t *prefix = &pending->route.destination;
+
+    *wrote = false;
+    vr_id = BRCM_SAI_GET_OBJ_VAL(sai_uint32_t, pending->route.vr_id);
+    node = _brcm_sai_rib_lookup(vr_id, prefix);
+    if (NULL != node)
+    {
+        if (pending->hw_valid &&
+            (pending->hw_info.nh_id == node->info.nh_id) &&
+            (pending->hw_info.action == node->info.action))
+        {
+            node->info.host = pending->hw_info.host;
+            return SAI_STATUS_SUCCESS;
+        }
+        rv = _brcm_sai_route_l3_build(&pending->route, &node->info, &l3_rt);
+        if (SAI_STATUS_SUCCESS == rv)
+        {
+            *wrote = true;
+            rv = _brcm_sai_route_hw_add(&l3_rt, &node->info,
+                                        pending->hw_valid ?
+                                        &pending->hw_info : NULL);
+            rv = BRCM_RV_OPENNSL_TO_SAI(rv);
+            if (SAI_STATUS_SUCCESS != rv)
+            {
+                _brcm_sai_route_info_release(&node->info);
+            }
+            else if (pending->hw_valid)
+            {
+                _brcm_sai_route_info_release(&pending->hw_info);
+            }
+        }
+        if (SAI_STATUS_SUCCESS != rv)
+        {
+            /* Fall back to what the hardware still has */
+            if (pending->hw_valid)
+            {
+                _brcm_sai_rib_info_set(node, &pending->hw_info);
+            }
+            else
+            {
+                (void)_brcm_sai_rib_delete(vr_id, prefix);
+            }
+        }
+        return rv;
+    }
+    if (false == pending->hw_valid)
+    {
+        return SAI_STATUS_SUCCESS;
+    }
+    opennsl_l3_route_t_init(&l3_rt);
+    (void)_brcm_sai_route_key_set(&pending->route, &l3_rt);
+    *wrote = true;
+    rv = _brcm_sai_route_hw_delete(&l3_rt, pending->hw_info.host);
+    rv = BRCM_RV_OPENNSL_TO_SAI(rv);
+    if (SAI_STATUS_SUCCESS != rv)
+    {
+        (void)_brcm_sai_rib_add(vr_id, prefix, &pending->hw_info, NULL);
+    }
+    else
+    {
+        _brcm_sai_route_info_release(&pending->hw_info);
+    }
+    return rv;
+}
+
+/* Routine to flush all pending routes, called with the route lock held */
+STATIC void
+_brcm_sai_route_pending_flush(void)
+{
+    sai_status_t rv;
+    bool wrote;
+    int writes = 0, errors = 0, count;
+    _brcm_sai_route_pending_t *pending, *next;
+
+    count = _brcm_sai_route_coalesce.count;
+    if (0 == count)
+    {
+        return;
+    }
+    for (pending = _brcm_sai_route_coalesce.head; NULL != pending;
+         pending = next)
+    {
+        next = pending->list;
+        rv = _brcm_sai_route_pending_write(pending, &wrote);
+        if (SAI_STATUS_SUCCESS != rv)
+        {
+            BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR,
+                               "Error %d flushing route in vrf %d\n", rv,
+                               BRCM_SAI_GET_OBJ_VAL(sai_uint32_t,
+                                                    pending->route.vr_id));
+            errors++;
+        }
+        if (wrote)
+        {
+            writes++;
+        }
+        free(pending);
+    }
+    memset(_brcm_sai_route_coalesce.table, 0,
+           _BRCM_SAI_ROUTE_PENDING_BUCKETS * sizeof(_brcm_sai_route_pending_t*));
+    _brcm_sai_route_coalesce.head = _brcm_sai_route_coalesce.tail = NULL;
+    _brcm_sai_route_coalesce.count = 0;
+    BRCM_SAI_LOG_ROUTE(SAI_LOG_DEBUG,
+                       "Flushed %d pending routes with %d writes, %d errors\n",
+                       count, writes, errors);
+}
+
+/* Interval flush thread */
+STATIC void *
+_brcm_sai_route_coalesce_thread(void *arg)
+{
+    struct timespec ts;
+
+    _BRCM_SAI_ROUTE_LOCK();
+    while (_brcm_sai_route_coalesce.thread_run)
+    {
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += _brcm_sai_route_coalesce.interval / 1000;
+        ts.tv_nsec += (_brcm_sai_route_coalesce.interval % 1000) * 1000000;
+        if (ts.tv_nsec >= 1000000000)
+        {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000;
+        }
+        (void)pthread_cond_timedwait(&_brcm_sai_route_coalesce.cond,
+                                     &_brcm_sai_route_mutex, &ts);
+        if (_brcm_sai_route_coalesce.thread_run)
+        {
+            _brcm_sai_route_pending_flush();
+            /* Deliver any watermark crossing of the flush */
+            _BRCM_SAI_ROUTE_UNLOCK();
+            _BRCM_SAI_ROUTE_LOCK();
+        }
+    }
+    _BRCM_SAI_ROUTE_UNLOCK();
+    return NULL;
+}
+
+/* Routine to stop the flush thread, called without the route lock */
+STATIC void
+_brcm_sai_route_coalesce_thread_stop(void)
+{
+    bool running;
+
+    _BRCM_SAI_ROUTE_LOCK();
+    running = _brcm_sai_route_coalesce.thread_run;
+    _brcm_sai_route_coalesce.thread_run = false;
+    pthread_cond_signal(&_brcm_sai_route_coalesce.cond);
+    _BRCM_SAI_ROUTE_UNLOCK();
+    if (running)
+    {
+        pthread_join(_brcm_sai_route_coalesce.thread, NULL);
+    }
+}
+
+/* Routine to start the flush thread if needed, called with the route lock */
+STATIC sai_status_t
+_brcm_sai_route_coalesce_thread_start(void)
+{
+    if (_brcm_sai_route_coalesce.thread_run ||
+        (false == _brcm_sai_route_coalesce.enabled) ||
+        (0 == _brcm_sai_route_coalesce.interval))
+    {
+        return SAI_STATUS_SUCCESS;
+    }
+    _brcm_sai_route_coalesce.thread_run = true;
+    if (0 != pthread_create(&_brcm_sai_route_coalesce.thread, NULL,
+                            _brcm_sai_route_coalesce_thread, NULL))
+    {
+        _brcm_sai_route_coalesce.thread_run = false;
+        BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR,
+                           "Error creating route coalesce thread\n");
+        return SAI_STATUS_FAILURE;
+    }
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Routine to handle the route coalescing switch attributes */
+sai_status_t
+_brcm_sai_route_coalesce_set(const sai_attribute_t *attr)
+{
+    sai_status_t rv = SAI_STATUS_SUCCESS;
+
+    switch (attr->id)
+    {
+        case SAI_SWITCH_ATTR_BRCM_ROUTE_COALESCE_ENABLE:
+            if (attr->value.booldata)
+            {
+                _BRCM_SAI_ROUTE_LOCK();
+                if (_brcm_sai_route_fib_compress)
+                {
+                    BRCM_SAI_LOG_ROUTE(SAI_LOG_ERROR, "Coalescing can't be "
+                                       "used with FIB compression\n");
+                    _BRCM_SAI_ROUTE_UNLOCK();
+                    return SAI_STATUS_NOT_SUPPORTED;
+                }
+                if (NULL == _brcm_sai_route_coalesce.table)
+                {
+                    _brcm_sai_route_coalesce.table =
+                        (_brcm_sai_route_pending_t**)
+                        calloc(_BRCM_SAI_ROUTE_PENDING_BUCKETS,
+                               sizeof(_brcm_sai_route_pending_t*));
+                }
+                if (NULL == _brcm_sai_route_coalesce.table)
+                {
+                    rv = SAI_STATUS_NO_MEMORY;
+                }
+                else
+                {
+                    _brcm_sai_route_coalesce.enabled = true;
+                    rv = _brcm_sai_route_coalesce_thread_start();
+                }
+                _BRCM_SAI_ROUTE_UNLOCK();
+            }
+            else
+            {
+                _brcm_sai_route_coalesce_thread_stop();
+                _BRCM_SAI_ROUTE_LOCK();
+                if (_brcm_sai_route_coalesce.enabled)
+                {
+                    _brcm_sai_route_pending_flush();
+                }
+                _brcm_sai_route_coalesce.enabled = false;
+                _BRCM_SAI_ROUTE_UNLOCK();
+            }
+            break;
+        case SAI_SWITCH_ATTR_BRCM_ROUTE_COALESCE_INTERVAL:
+            _brcm_sai_route_coalesce_thread_stop();
+            _BRCM_SAI_ROUTE_LOCK();
+            _brcm_sai_route_coalesce.interval = attr->value.u32;
+            rv = _brcm_sai_route_coalesce_thread_start();
+            _BRCM_SAI_ROUTE_UNLOCK();
+            break;
+        case SAI_SWITCH_ATTR_BRCM_ROUTE_COALESCE_BATCH:
+            _BRCM_SAI_ROUTE_LOCK();
+            _brcm_sai_route_coalesce.batch = attr->value.u32;
+            if (_brcm_sai_route_coalesce.enabled &&
+                _brcm_sai_route_coalesce.batch &&
+                (_brcm_sai_route_coalesce.count >=
+                 _brcm_sai_route_coalesce.batch))
+            {
+                _brcm_sai_route_pending_flush();
+            }
+            _BRCM_SAI_ROUTE_UNLOCK();
+            break;
+        case SAI_SWITCH_ATTR_BRCM_ROUTE_COALESCE_FLUSH:
+            _BRCM_SAI_ROUTE_LOCK();
+            if (_brcm_sai_route_coalesce.enabled)
+            {
+                _brcm_sai_route_pending_flush();
+            }
+            _BRCM_SAI_ROUTE_UNLOCK();
+            break;
+        default:
+            rv = SAI_STATUS_INVALID_PARAMETER;
+            break;
+    }
+    return rv;
+}
+
+/* Routine to free route state, pending and queued routes are discarded */
+void
+_brcm_sai_free_route(void)
+{
+    int i;
+    _brcm_sai_route_pending_t *pending, *next;
+    _brcm_sai_route_log_egr_t *egr, *egr_next;
+    _brcm_sai_route_nhi_t *nhi, *nhi_next;
+
+    _brcm_sai_route_async_stop();
+    _brcm_sai_route_coalesce_thread_stop();
+    _BRCM_SAI_ROUTE_LOCK();
+    for (pending = _brcm_sai_route_coalesce.head; NULL != pending;
+         pending = next)
+    {
+        next = pending->list;
+        free(pending);
+    }
+    CHECK_FREE(_brcm_sai_route_coalesce.table);
+    _brcm_sai_route_coalesce.table = NULL;
+    _brcm_sai_route_coalesce.head = _brcm_sai_route_coalesce.tail = NULL;
+    _brcm_sai_route_coalesce.count = 0;
+    _brcm_sai_route_coalesce.enabled = false;
+    for (i=0; i<_BRCM_SAI_ROUTE_LOG_EGR_BUCKETS; i++)
+    {
+        for (egr = _brcm_sai_route_log_egr[i]; NULL != egr; egr = egr_next)
+        {
+            egr_next = egr->next;
+            free(egr);
+        }
+        _brcm_sai_route_log_egr[i] = NULL;
+    }
+    for (i=0; i<_BRCM_SAI_ROUTE_NHI_BUCKETS; i++)
+    {
+        for (nhi = _brcm_sai_route_nhi[i]; NULL != nhi; nhi = nhi_next)
+        {
+            nhi_next = nhi->next;
+            free(nhi);
+        }
+        _brcm_sai_route_nhi[i] = NULL;
+    }
+    /* The rib counters go with the rib, keep the watermarks armed */
+    for (i=BRCM_SAI_ROUTE_TABLE_LPM; i<=BRCM_SAI_ROUTE_TABLE_HOST; i++)
+    {
+        _brcm_sai_route_watermark[i].above = false;
+        _brcm_sai_route_watermark[i].notified = false;
+    }
+    _BRCM_SAI_ROUTE_UNLOCK();
 }
 
 /*
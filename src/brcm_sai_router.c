@@ -221,11 +221,59 @@ brcm_sai_get_virtual_router_attribute(_In_ sai_object_id_t vr_id,
                                       _In_ sai_uint32_t attr_count,
                                       _Inout_ sai_attribute_t *attr_list)
 {
-    sai_status_t rv = SAI_STATUS_NOT_IMPLEMENTED;
+    int i;
+    sai_uint32_t vrf;
+    sai_status_t rv = SAI_STATUS_SUCCESS;
 
     BRCM_SAI_FUNCTION_ENTER(SAI_API_VIRTUAL_ROUTER);
     BRCM_SAI_SWITCH_INIT_CHECK;
 
+    if (NULL == attr_list)
+    {
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+    vrf = BRCM_SAI_GET_OBJ_VAL(sai_uint32_t, vr_id);
+    if ((SAI_OBJECT_TYPE_VIRTUAL_ROUTER != BRCM_SAI_GET_OBJ_TYPE(vr_id)) ||
+        (false == _brcm_sai_vr_id_valid(vrf)))
+    {
+        BRCM_SAI_LOG_VR(SAI_LOG_ERROR, "Invalid VR id %d\n", vrf);
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+    for (i=0; i<attr_count; i++)
+    {
+        switch(attr_list[i].id)
+        {
+            /* Route counters are kept up to date by the route module */
+            case SAI_VIRTUAL_ROUTER_ATTR_BRCM_IPV4_LPM_ENTRIES:
+                attr_list[i].value.u32 =
+                    _brcm_sai_rib_hw_count_get(vrf, SAI_IP_ADDR_FAMILY_IPV4,
+                                               false);
+                break;
+            case SAI_VIRTUAL_ROUTER_ATTR_BRCM_IPV4_HOST_ENTRIES:
+                attr_list[i].value.u32 =
+                    _brcm_sai_rib_hw_count_get(vrf, SAI_IP_ADDR_FAMILY_IPV4,
+                                               true);
+                break;
+            case SAI_VIRTUAL_ROUTER_ATTR_BRCM_IPV6_LPM_ENTRIES:
+                attr_list[i].value.u32 =
+                    _brcm_sai_rib_hw_count_get(vrf, SAI_IP_ADDR_FAMILY_IPV6,
+                                               false);
+                break;
+            case SAI_VIRTUAL_ROUTER_ATTR_BRCM_IPV6_HOST_ENTRIES:
+                attr_list[i].value.u32 =
+                    _brcm_sai_rib_hw_count_get(vrf, SAI_IP_ADDR_FAMILY_IPV6,
+                                               true);
+                break;
+            default:
+                rv = SAI_STATUS_NOT_IMPLEMENTED;
+                break;
+        }
+        if (SAI_STATUS_SUCCESS != rv)
+        {
+            break;
+        }
+    }
+
     BRCM_SAI_FUNCTION_EXIT(SAI_API_VIRTUAL_ROUTER);
 
     return rv;
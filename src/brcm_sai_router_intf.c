@@ -237,6 +237,12 @@ brcm_sai_remove_router_interface(_In_ sai_object_id_t rif_id)
     BRCM_SAI_FUNCTION_ENTER(SAI_API_ROUTER_INTERFACE);
     BRCM_SAI_SWITCH_INIT_CHECK;
 
+    if (_brcm_sai_deps_count(rif_id))
+    {
+        BRCM_SAI_LOG_RINTF(SAI_LOG_ERROR, "Router interface still used by "
+                           "neighbors, next hops or routes\n");
+        return SAI_STATUS_OBJECT_IN_USE;
+    }
     opennsl_l3_intf_t_init(&l3_intf);
     l3_intf.l3a_intf_id = BRCM_SAI_GET_OBJ_VAL(opennsl_if_t, rif_id);
     rv = opennsl_l3_intf_delete(0, &l3_intf);
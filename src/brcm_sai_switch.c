@@ -163,6 +163,13 @@ brcm_sai_initialize_switch(_In_ sai_switch_profile_id_t profile_id,
                             "Error %d registering for link events !!\n", rv);
         return SAI_STATUS_FAILURE;
     }
+    rv = _brcm_sai_fdb_init();
+    if (SAI_STATUS_SUCCESS != rv)
+    {
+        BRCM_SAI_LOG_SWITCH(SAI_LOG_CRITICAL,
+                            "Error %d initializing fdb shadow !!\n", rv);
+        return SAI_STATUS_FAILURE;
+    }
     rv = opennsl_l2_addr_register(0, _brcm_sai_fdb_event_cb, (void*)0x5A1092);
     if (OPENNSL_E_NONE != rv)
     {
@@ -186,6 +193,13 @@ brcm_sai_initialize_switch(_In_ sai_switch_profile_id_t profile_id,
                                 "Error %d initializing vrf state !!\n", rv);
             return SAI_STATUS_FAILURE;
         }
+        rv = _brcm_sai_alloc_rib(val);
+        if (0 != rv)
+        {
+            BRCM_SAI_LOG_SWITCH(SAI_LOG_CRITICAL,
+                                "Error %d initializing rib state !!\n", rv);
+            return SAI_STATUS_FAILURE;
+        }
     }
     rv = _brcm_sai_alloc_rif();
     if (0 != rv)
@@ -244,8 +258,15 @@ brcm_sai_shutdown_switch(_In_ bool warm_restart_hint)
     BRCM_SAI_FUNCTION_ENTER(SAI_API_SWITCH);
 
     memset(&host_callbacks, 0, sizeof(sai_switch_notification_t));
+    _brcm_sai_free_fdb();
+    _brcm_sai_free_nbr();
+    _brcm_sai_free_route();
+    _brcm_sai_free_nhg();
+    _brcm_sai_free_nh();
     _brcm_sai_free_vrf();
+    _brcm_sai_free_rib();
     _brcm_sai_free_rif();
+    _brcm_sai_free_deps();
     _brcm_sai_clear_port_state();
     _brcm_sai_switch_init_set(false);
 
@@ -429,6 +450,44 @@ brcm_sai_set_switch_attribute(_In_ const sai_attribute_t *attr)
         case SAI_SWITCH_ATTR_CPU_PORT:
             rv = SAI_STATUS_NOT_SUPPORTED;
             break;
+        case SAI_SWITCH_ATTR_BRCM_ROUTE_COALESCE_ENABLE:
+        case SAI_SWITCH_ATTR_BRCM_ROUTE_COALESCE_INTERVAL:
+        case SAI_SWITCH_ATTR_BRCM_ROUTE_COALESCE_BATCH:
+        case SAI_SWITCH_ATTR_BRCM_ROUTE_COALESCE_FLUSH:
+            rv = _brcm_sai_route_coalesce_set(attr);
+            break;
+        case SAI_SWITCH_ATTR_BRCM_ROUTE_FIB_COMPRESS:
+            rv = _brcm_sai_route_fib_compress_set(attr->value.booldata);
+            break;
+        case SAI_SWITCH_ATTR_BRCM_ROUTE_ASYNC_ENABLE:
+        case SAI_SWITCH_ATTR_BRCM_ROUTE_ASYNC_DEPTH:
+        case SAI_SWITCH_ATTR_BRCM_ROUTE_ASYNC_DRAIN:
+            rv = _brcm_sai_route_async_set(attr);
+            break;
+        case SAI_SWITCH_ATTR_BRCM_ROUTE_LPM_HIGH_WATERMARK:
+        case SAI_SWITCH_ATTR_BRCM_ROUTE_LPM_LOW_WATERMARK:
+        case SAI_SWITCH_ATTR_BRCM_ROUTE_HOST_HIGH_WATERMARK:
+        case SAI_SWITCH_ATTR_BRCM_ROUTE_HOST_LOW_WATERMARK:
+            rv = _brcm_sai_route_resource_set(attr);
+            break;
+        case SAI_SWITCH_ATTR_BRCM_ECMP_LINK_PROTECT:
+            rv = _brcm_sai_nhg_link_protect_set(attr->value.booldata);
+            break;
+        case SAI_SWITCH_ATTR_BRCM_NEIGHBOR_SCAN_INTERVAL:
+        case SAI_SWITCH_ATTR_BRCM_NEIGHBOR_SCAN_BATCH:
+        case SAI_SWITCH_ATTR_BRCM_NEIGHBOR_IDLE_TIMEOUT:
+            rv = _brcm_sai_nbr_scan_set(attr);
+            break;
+        case SAI_SWITCH_ATTR_BRCM_FDB_EVENT_BATCH:
+        case SAI_SWITCH_ATTR_BRCM_FDB_EVENT_DELAY:
+        case SAI_SWITCH_ATTR_BRCM_FDB_EVENT_DEPTH:
+        case SAI_SWITCH_ATTR_BRCM_FDB_VERIFY:
+        case SAI_SWITCH_ATTR_BRCM_FDB_MOVE_THRESHOLD:
+        case SAI_SWITCH_ATTR_BRCM_FDB_MOVE_WINDOW:
+        case SAI_SWITCH_ATTR_BRCM_FDB_MOVE_HOLD:
+        case SAI_SWITCH_ATTR_BRCM_FDB_MOVE_PIN:
+            rv = _brcm_sai_fdb_switch_attr_set(attr);
+            break;
         default:
             BRCM_SAI_LOG_SWITCH(SAI_LOG_ERROR,
                                 "Unknown switch attribute %d passed\n",
@@ -457,7 +516,58 @@ STATIC sai_status_t
 brcm_sai_get_switch_attribute(_In_ uint32_t attr_count,
                               _Inout_ sai_attribute_t *attr_list)
 {
-  return _brcm_sai_get_switch_attribute(attr_count, attr_list);
+    int i;
+    sai_status_t rv = SAI_STATUS_SUCCESS;
+
+    if (NULL == attr_list)
+    {
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+    for (i=0; i<attr_count; i++)
+    {
+        switch (attr_list[i].id)
+        {
+            /* Route resource state is kept by the adapter */
+            case SAI_SWITCH_ATTR_BRCM_ROUTE_IPV4_LPM_ENTRIES:
+            case SAI_SWITCH_ATTR_BRCM_ROUTE_IPV4_HOST_ENTRIES:
+            case SAI_SWITCH_ATTR_BRCM_ROUTE_IPV6_LPM_ENTRIES:
+            case SAI_SWITCH_ATTR_BRCM_ROUTE_IPV6_HOST_ENTRIES:
+            case SAI_SWITCH_ATTR_BRCM_ROUTE_LPM_HIGH_WATERMARK:
+            case SAI_SWITCH_ATTR_BRCM_ROUTE_LPM_LOW_WATERMARK:
+            case SAI_SWITCH_ATTR_BRCM_ROUTE_HOST_HIGH_WATERMARK:
+            case SAI_SWITCH_ATTR_BRCM_ROUTE_HOST_LOW_WATERMARK:
+                rv = _brcm_sai_route_resource_get(&attr_list[i]);
+                break;
+            case SAI_SWITCH_ATTR_BRCM_ECMP_LINK_PROTECT:
+                attr_list[i].value.booldata = _brcm_sai_nhg_link_protect_get();
+                break;
+            case SAI_SWITCH_ATTR_BRCM_NEIGHBOR_SCAN_INTERVAL:
+            case SAI_SWITCH_ATTR_BRCM_NEIGHBOR_SCAN_BATCH:
+            case SAI_SWITCH_ATTR_BRCM_NEIGHBOR_IDLE_TIMEOUT:
+                rv = _brcm_sai_nbr_scan_get(&attr_list[i]);
+                break;
+            case SAI_SWITCH_ATTR_BRCM_FDB_EVENT_BATCH:
+            case SAI_SWITCH_ATTR_BRCM_FDB_EVENT_DELAY:
+            case SAI_SWITCH_ATTR_BRCM_FDB_EVENT_DEPTH:
+            case SAI_SWITCH_ATTR_BRCM_FDB_EVENT_DROPS:
+            case SAI_SWITCH_ATTR_BRCM_FDB_VERIFY:
+            case SAI_SWITCH_ATTR_BRCM_FDB_MOVE_THRESHOLD:
+            case SAI_SWITCH_ATTR_BRCM_FDB_MOVE_WINDOW:
+            case SAI_SWITCH_ATTR_BRCM_FDB_MOVE_HOLD:
+            case SAI_SWITCH_ATTR_BRCM_FDB_MOVE_PIN:
+            case SAI_SWITCH_ATTR_BRCM_FDB_MOVE_DAMPED:
+                rv = _brcm_sai_fdb_switch_attr_get(&attr_list[i]);
+                break;
+            default:
+                rv = _brcm_sai_get_switch_attribute(1, &attr_list[i]);
+                break;
+        }
+        if (SAI_STATUS_SUCCESS != rv)
+        {
+            break;
+        }
+    }
+    return rv;
 }
 
 /*
@@ -0,0 +1,1508 @@
+/*********************************************************************
+ *
+ * (C) Copyright Broadcom Corporation 2013-2016
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ **********************************************************************/
+
+/*
+ * Stand in for libopennsl used by the route benchmark. It keeps just enough
+ * L3 state for the adapter to behave as it does on a switch (duplicate and
+ * missing entries, a bounded host table, REPLACE and WITH_ID semantics) and
+ * charges a configurable latency for every table write.
+ *
+ * Environment:
+ *    OPENNSL_MOCK_LATENCY_NS - busy wait per table write (default 0)
+ *    OPENNSL_MOCK_HOST_MAX   - host table size (default 16384)
+ *    OPENNSL_MOCK_ROUTE_MAX  - LPM table size (default 2097152)
+ *
+ * Only the entry points reached by switch init and the route, next hop,
+ * next hop group and neighbor paths are modelled. The rest of what libsai
+ * links against is stubbed to fail, so the link leaves nothing unresolved.
+ */
+
+#include <sai.h>
+#include <brcm_sai_common.h>
+#include <time.h>
+
+/*
+################################################################################
+#                                Local state                                   #
+################################################################################
+*/
+#define _MOCK_L3_BUCKETS        (1 << 20)
+#define _MOCK_EGRESS_BASE       100000
+#define _MOCK_ECMP_BASE         200000
+#define _MOCK_INTF_MAX          4096
+#define _MOCK_HOST_MAX          16384
+#define _MOCK_ROUTE_MAX         (2 << 20)
+
+typedef struct _mock_l3_entry_s {
+    struct _mock_l3_entry_s *next;
+    opennsl_vrf_t vrf;
+    bool v6;
+    uint8 addr[16];
+    uint8 mask[16];
+    uint32 flags;
+    opennsl_if_t intf;
+} _mock_l3_entry_t;
+
+typedef struct _mock_l3_table_s {
+    _mock_l3_entry_t **buckets;
+    int count;
+    int max;
+} _mock_l3_table_t;
+
+typedef struct _mock_egress_s {
+    bool valid;
+    opennsl_l3_egress_t egr;
+} _mock_egress_t;
+
+typedef struct _mock_ecmp_s {
+    bool valid;
+    int count;
+    int max;
+    opennsl_if_t *paths;
+} _mock_ecmp_t;
+
+static pthread_mutex_t _mock_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint64 _mock_latency_ns;
+static uint64 _mock_writes;
+static bool _mock_switch_inited;
+static sai_mac_t _mock_mac = { 0x00, 0x05, 0x1b, 0x00, 0x00, 0x01 };
+
+static _mock_l3_table_t _mock_routes;
+static _mock_l3_table_t _mock_hosts;
+static _mock_l3_table_t _mock_nbrs;             /* Neighbors with no host */
+static _mock_egress_t *_mock_egress;
+static int _mock_egress_count;
+static _mock_ecmp_t *_mock_ecmp;
+static int _mock_ecmp_count;
+static opennsl_vrf_t _mock_intf_vrf[_MOCK_INTF_MAX];
+static int _mock_intf_count;
+
+#define _MOCK_LOCK()    pthread_mutex_lock(&_mock_mutex)
+#define _MOCK_UNLOCK()  pthread_mutex_unlock(&_mock_mutex)
+
+/*
+################################################################################
+#                                  Helpers                                     #
+################################################################################
+*/
+STATIC uint64
+_mock_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* Routine to account for a table write, spins to keep short delays exact */
+STATIC void
+_mock_write(void)
+{
+    uint64 end;
+
+    _mock_writes++;
+    if (0 == _mock_latency_ns)
+    {
+        return;
+    }
+    end = _mock_now_ns() + _mock_latency_ns;
+    while (_mock_now_ns() < end);
+}
+
+STATIC int
+_mock_env_get(const char *name, int def)
+{
+    const char *val = getenv(name);
+
+    return (NULL != val) ? atoi(val) : def;
+}
+
+STATIC sai_uint32_t
+_mock_l3_hash(opennsl_vrf_t vrf, bool v6, const uint8 *addr, const uint8 *mask)
+{
+    int i;
+    sai_uint32_t hash = 2166136261u ^ (sai_uint32_t)vrf ^ (v6 ? 0x80000000 : 0);
+
+    for (i=0; i<(v6 ? 16 : 4); i++)
+    {
+        hash = (hash ^ addr[i]) * 16777619u;
+        hash = (hash ^ mask[i]) * 16777619u;
+    }
+    return hash & (_MOCK_L3_BUCKETS - 1);
+}
+
+/* Routine to find an entry, returns the link pointing at it */
+STATIC _mock_l3_entry_t **
+_mock_l3_find(_mock_l3_table_t *table, opennsl_vrf_t vrf, bool v6,
+              const uint8 *addr, const uint8 *mask)
+{
+    int len = v6 ? 16 : 4;
+    _mock_l3_entry_t **link;
+
+    for (link = &table->buckets[_mock_l3_hash(vrf, v6, addr, mask)];
+         NULL != *link; link = &(*link)->next)
+    {
+        if (((*link)->vrf == vrf) && ((*link)->v6 == v6) &&
+            (0 == memcmp((*link)->addr, addr, len)) &&
+            (0 == memcmp((*link)->mask, mask, len)))
+        {
+            break;
+        }
+    }
+    return link;
+}
+
+STATIC int
+_mock_l3_add(_mock_l3_table_t *table, opennsl_vrf_t vrf, bool v6,
+             const uint8 *addr, const uint8 *mask, uint32 flags,
+             opennsl_if_t intf)
+{
+    _mock_l3_entry_t **link, *entry;
+
+    link = _mock_l3_find(table, vrf, v6, addr, mask);
+    if (NULL != *link)
+    {
+        if (0 == (flags & OPENNSL_L3_REPLACE))
+        {
+            return OPENNSL_E_EXISTS;
+        }
+        (*link)->flags = flags;
+        (*link)->intf = intf;
+        _mock_write();
+        return OPENNSL_E_NONE;
+    }
+    if (table->count >= table->max)
+    {
+        return OPENNSL_E_FULL;
+    }
+    entry = (_mock_l3_entry_t*)calloc(1, sizeof(_mock_l3_entry_t));
+    if (NULL == entry)
+    {
+        return OPENNSL_E_MEMORY;
+    }
+    entry->vrf = vrf;
+    entry->v6 = v6;
+    memcpy(entry->addr, addr, v6 ? 16 : 4);
+    memcpy(entry->mask, mask, v6 ? 16 : 4);
+    entry->flags = flags;
+    entry->intf = intf;
+    entry->next = table->buckets[_mock_l3_hash(vrf, v6, addr, mask)];
+    table->buckets[_mock_l3_hash(vrf, v6, addr, mask)] = entry;
+    table->count++;
+    _mock_write();
+    return OPENNSL_E_NONE;
+}
+
+STATIC int
+_mock_l3_delete(_mock_l3_table_t *table, opennsl_vrf_t vrf, bool v6,
+                const uint8 *addr, const uint8 *mask)
+{
+    _mock_l3_entry_t **link, *entry;
+
+    link = _mock_l3_find(table, vrf, v6, addr, mask);
+    if (NULL == *link)
+    {
+        return OPENNSL_E_NOT_FOUND;
+    }
+    entry = *link;
+    *link = entry->next;
+    free(entry);
+    table->count--;
+    _mock_write();
+    return OPENNSL_E_NONE;
+}
+
+STATIC void
+_mock_l3_table_init(_mock_l3_table_t *table, int max)
+{
+    table->buckets = (_mock_l3_entry_t**)calloc(_MOCK_L3_BUCKETS,
+                                               sizeof(_mock_l3_entry_t*));
+    table->count = 0;
+    table->max = max;
+}
+
+/* Routine to get the route key in the byte order used for the table */
+STATIC void
+_mock_route_key(const opennsl_l3_route_t *info, uint8 *addr, uint8 *mask)
+{
+    uint32 val;
+
+    if (info->l3a_flags & OPENNSL_L3_IP6)
+    {
+        memcpy(addr, info->l3a_ip6_net, 16);
+        memcpy(mask, info->l3a_ip6_mask, 16);
+        return;
+    }
+    val = info->l3a_subnet;
+    memcpy(addr, &val, 4);
+    val = info->l3a_ip_mask;
+    memcpy(mask, &val, 4);
+}
+
+STATIC void
+_mock_host_key(const opennsl_l3_host_t *info, uint8 *addr, uint8 *mask)
+{
+    uint32 val;
+
+    memset(mask, 0xff, 16);
+    if (info->l3a_flags & OPENNSL_L3_IP6)
+    {
+        memcpy(addr, info->l3a_ip6_addr, 16);
+        return;
+    }
+    val = info->l3a_ip_addr;
+    memcpy(addr, &val, 4);
+}
+
+STATIC _mock_egress_t *
+_mock_egress_get(opennsl_if_t intf)
+{
+    int idx = intf - _MOCK_EGRESS_BASE;
+
+    if ((idx < 0) || (idx >= _mock_egress_count) ||
+        (false == _mock_egress[idx].valid))
+    {
+        return NULL;
+    }
+    return &_mock_egress[idx];
+}
+
+STATIC _mock_ecmp_t *
+_mock_ecmp_get(opennsl_if_t intf)
+{
+    int idx = intf - _MOCK_ECMP_BASE;
+
+    if ((idx < 0) || (idx >= _mock_ecmp_count) ||
+        (false == _mock_ecmp[idx].valid))
+    {
+        return NULL;
+    }
+    return &_mock_ecmp[idx];
+}
+
+/*
+################################################################################
+#                              Mock control                                    #
+################################################################################
+*/
+/* Routine to return the number of table writes done so far */
+uint64
+opennsl_mock_writes_get(void)
+{
+    uint64 writes;
+
+    _MOCK_LOCK();
+    writes = _mock_writes;
+    _MOCK_UNLOCK();
+    return writes;
+}
+
+/*
+################################################################################
+#                               OpenNSL driver                                 #
+################################################################################
+*/
+int
+opennsl_driver_init(void *init)
+{
+    _MOCK_LOCK();
+    _mock_latency_ns = _mock_env_get("OPENNSL_MOCK_LATENCY_NS", 0);
+    if (NULL == _mock_routes.buckets)
+    {
+        _mock_l3_table_init(&_mock_routes,
+                            _mock_env_get("OPENNSL_MOCK_ROUTE_MAX",
+                                          _MOCK_ROUTE_MAX));
+        _mock_l3_table_init(&_mock_hosts,
+                            _mock_env_get("OPENNSL_MOCK_HOST_MAX",
+                                          _MOCK_HOST_MAX));
+        _mock_l3_table_init(&_mock_nbrs, _MOCK_HOST_MAX);
+    }
+    _MOCK_UNLOCK();
+    return ((NULL == _mock_routes.buckets) || (NULL == _mock_hosts.buckets)) ?
+           OPENNSL_E_MEMORY : OPENNSL_E_NONE;
+}
+
+const char *
+opennsl_errmsg(int rv)
+{
+    return "opennsl mock error";
+}
+
+int
+opennsl_switch_control_set(int unit, opennsl_switch_control_t type, int arg)
+{
+    return OPENNSL_E_NONE;
+}
+
+int
+opennsl_switch_event_register(int unit, opennsl_switch_event_cb_t cb,
+                              void *userdata)
+{
+    return OPENNSL_E_NONE;
+}
+
+int
+opennsl_linkscan_register(int unit, opennsl_linkscan_handler_t f)
+{
+    return OPENNSL_E_NONE;
+}
+
+int
+opennsl_l2_addr_register(int unit, opennsl_l2_addr_callback_t cb,
+                         void *userdata)
+{
+    return OPENNSL_E_NONE;
+}
+
+int
+opennsl_knet_netif_traverse(int unit, opennsl_knet_netif_traverse_cb cb,
+                            void *user_data)
+{
+    return OPENNSL_E_NONE;
+}
+
+int
+opennsl_knet_filter_traverse(int unit, opennsl_knet_filter_traverse_cb cb,
+                             void *user_data)
+{
+    return OPENNSL_E_NONE;
+}
+
+int
+opennsl_vlan_default_get(int unit, opennsl_vlan_t *vid)
+{
+    *vid = 1;
+    return OPENNSL_E_NONE;
+}
+
+int
+opennsl_port_config_get(int unit, opennsl_port_config_t *config)
+{
+    memset(config, 0, sizeof(*config));
+    return OPENNSL_E_NONE;
+}
+
+int
+opennsl_vlan_port_add(int unit, opennsl_vlan_t vid, opennsl_pbmp_t pbmp,
+                      opennsl_pbmp_t ubmp)
+{
+    return OPENNSL_E_NONE;
+}
+
+/*
+################################################################################
+#                                 OpenNSL L3                                   #
+################################################################################
+*/
+void
+opennsl_l3_route_t_init(opennsl_l3_route_t *info)
+{
+    memset(info, 0, sizeof(*info));
+}
+
+void
+opennsl_l3_host_t_init(opennsl_l3_host_t *info)
+{
+    memset(info, 0, sizeof(*info));
+}
+
+void
+opennsl_l3_intf_t_init(opennsl_l3_intf_t *info)
+{
+    memset(info, 0, sizeof(*info));
+}
+
+void
+opennsl_l3_egress_t_init(opennsl_l3_egress_t *info)
+{
+    memset(info, 0, sizeof(*info));
+}
+
+void
+opennsl_l3_egress_ecmp_t_init(opennsl_l3_egress_ecmp_t *info)
+{
+    memset(info, 0, sizeof(*info));
+}
+
+int
+opennsl_l3_intf_create(int unit, opennsl_l3_intf_t *intf)
+{
+    int rv = OPENNSL_E_FULL;
+
+    _MOCK_LOCK();
+    if (_mock_intf_count < _MOCK_INTF_MAX)
+    {
+        intf->l3a_intf_id = _mock_intf_count;
+        _mock_intf_vrf[_mock_intf_count++] = intf->l3a_vrf;
+        _mock_write();
+        rv = OPENNSL_E_NONE;
+    }
+    _MOCK_UNLOCK();
+    return rv;
+}
+
+int
+opennsl_l3_intf_get(int unit, opennsl_l3_intf_t *intf)
+{
+    if ((intf->l3a_intf_id < 0) || (intf->l3a_intf_id >= _mock_intf_count))
+    {
+        return OPENNSL_E_NOT_FOUND;
+    }
+    intf->l3a_vrf = _mock_intf_vrf[intf->l3a_intf_id];
+    return OPENNSL_E_NONE;
+}
+
+int
+opennsl_l3_egress_create(int unit, uint32 flags, opennsl_l3_egress_t *egr,
+                         opennsl_if_t *if_id)
+{
+    int rv = OPENNSL_E_NONE;
+    _mock_egress_t *entry, *table;
+
+    _MOCK_LOCK();
+    if (flags & OPENNSL_L3_WITH_ID)
+    {
+        entry = _mock_egress_get(*if_id);
+        if (NULL == entry)
+        {
+            rv = OPENNSL_E_NOT_FOUND;
+        }
+    }
+    else
+    {
+        table = (_mock_egress_t*)realloc(_mock_egress,
+                    (_mock_egress_count + 1) * sizeof(_mock_egress_t));
+        if (NULL == table)
+        {
+            rv = OPENNSL_E_MEMORY;
+        }
+        else
+        {
+            _mock_egress = table;
+            entry = &_mock_egress[_mock_egress_count];
+            *if_id = _MOCK_EGRESS_BASE + _mock_egress_count++;
+        }
+    }
+    if (OPENNSL_E_NONE == rv)
+    {
+        entry->valid = true;
+        entry->egr = *egr;
+        _mock_write();
+    }
+    _MOCK_UNLOCK();
+    return rv;
+}
+
+int
+opennsl_l3_egress_destroy(int unit, opennsl_if_t intf)
+{
+    int rv = OPENNSL_E_NOT_FOUND;
+    _mock_egress_t *entry;
+
+    _MOCK_LOCK();
+    entry = _mock_egress_get(intf);
+    if (NULL != entry)
+    {
+        entry->valid = false;
+        _mock_write();
+        rv = OPENNSL_E_NONE;
+    }
+    _MOCK_UNLOCK();
+    return rv;
+}
+
+int
+opennsl_l3_egress_get(int unit, opennsl_if_t intf, opennsl_l3_egress_t *egr)
+{
+    int rv = OPENNSL_E_NOT_FOUND;
+    _mock_egress_t *entry;
+
+    _MOCK_LOCK();
+    entry = _mock_egress_get(intf);
+    if (NULL != entry)
+    {
+        *egr = entry->egr;
+        rv = OPENNSL_E_NONE;
+    }
+    _MOCK_UNLOCK();
+    return rv;
+}
+
+int
+opennsl_l3_egress_ecmp_create(int unit, opennsl_l3_egress_ecmp_t *ecmp,
+                              int intf_count, opennsl_if_t *intf_array)
+{
+    int rv = OPENNSL_E_NONE;
+    int max = (ecmp->max_paths > intf_count) ? ecmp->max_paths : intf_count;
+    opennsl_if_t *paths;
+    _mock_ecmp_t *entry, *table;
+
+    paths = (opennsl_if_t*)malloc(max * sizeof(opennsl_if_t));
+    if (NULL == paths)
+    {
+        return OPENNSL_E_MEMORY;
+    }
+    memcpy(paths, intf_array, intf_count * sizeof(opennsl_if_t));
+    _MOCK_LOCK();
+    if (ecmp->flags & OPENNSL_L3_WITH_ID)
+    {
+        entry = _mock_ecmp_get(ecmp->ecmp_intf);
+        if (NULL == entry)
+        {
+            rv = OPENNSL_E_NOT_FOUND;
+        }
+        else
+        {
+            free(entry->paths);
+        }
+    }
+    else
+    {
+        table = (_mock_ecmp_t*)realloc(_mock_ecmp,
+                    (_mock_ecmp_count + 1) * sizeof(_mock_ecmp_t));
+        if (NULL == table)
+        {
+            rv = OPENNSL_E_MEMORY;
+        }
+        else
+        {
+            _mock_ecmp = table;
+            entry = &_mock_ecmp[_mock_ecmp_count];
+            ecmp->ecmp_intf = _MOCK_ECMP_BASE + _mock_ecmp_count++;
+        }
+    }
+    if (OPENNSL_E_NONE == rv)
+    {
+        entry->valid = true;
+        entry->count = intf_count;
+        entry->max = max;
+        entry->paths = paths;
+        _mock_write();
+    }
+    else
+    {
+        free(paths);
+    }
+    _MOCK_UNLOCK();
+    return rv;
+}
+
+int
+opennsl_l3_egress_ecmp_destroy(int unit, opennsl_l3_egress_ecmp_t *ecmp)
+{
+    int rv = OPENNSL_E_NOT_FOUND;
+    _mock_ecmp_t *entry;
+
+    _MOCK_LOCK();
+    entry = _mock_ecmp_get(ecmp->ecmp_intf);
+    if (NULL != entry)
+    {
+        entry->valid = false;
+        free(entry->paths);
+        entry->paths = NULL;
+        _mock_write();
+        rv = OPENNSL_E_NONE;
+    }
+    _MOCK_UNLOCK();
+    return rv;
+}
+
+int
+opennsl_l3_egress_ecmp_get(int unit, opennsl_l3_egress_ecmp_t *ecmp,
+                           int intf_size, opennsl_if_t *intf_array,
+                           int *intf_count)
+{
+    int rv = OPENNSL_E_NOT_FOUND;
+    _mock_ecmp_t *entry;
+
+    _MOCK_LOCK();
+    entry = _mock_ecmp_get(ecmp->ecmp_intf);
+    if (NULL != entry)
+    {
+        *intf_count = (entry->count < intf_size) ? entry->count : intf_size;
+        memcpy(intf_array, entry->paths, *intf_count * sizeof(opennsl_if_t));
+        rv = OPENNSL_E_NONE;
+    }
+    _MOCK_UNLOCK();
+    return rv;
+}
+
+int
+opennsl_l3_egress_ecmp_add(int unit, opennsl_l3_egress_ecmp_t *ecmp,
+                           opennsl_if_t intf)
+{
+    int rv = OPENNSL_E_NOT_FOUND;
+    _mock_ecmp_t *entry;
+
+    _MOCK_LOCK();
+    entry = _mock_ecmp_get(ecmp->ecmp_intf);
+    if (NULL != entry)
+    {
+        if (entry->count < entry->max)
+        {
+            entry->paths[entry->count++] = intf;
+            _mock_write();
+            rv = OPENNSL_E_NONE;
+        }
+        else
+        {
+            rv = OPENNSL_E_FULL;
+        }
+    }
+    _MOCK_UNLOCK();
+    return rv;
+}
+
+int
+opennsl_l3_egress_ecmp_delete(int unit, opennsl_l3_egress_ecmp_t *ecmp,
+                              opennsl_if_t intf)
+{
+    int i, rv = OPENNSL_E_NOT_FOUND;
+    _mock_ecmp_t *entry;
+
+    _MOCK_LOCK();
+    entry = _mock_ecmp_get(ecmp->ecmp_intf);
+    for (i=0; (NULL != entry) && (i < entry->count); i++)
+    {
+        if (intf == entry->paths[i])
+        {
+            memmove(&entry->paths[i], &entry->paths[i+1],
+                    (entry->count - i - 1) * sizeof(opennsl_if_t));
+            entry->count--;
+            _mock_write();
+            rv = OPENNSL_E_NONE;
+            break;
+        }
+    }
+    _MOCK_UNLOCK();
+    return rv;
+}
+
+int
+opennsl_l3_route_add(int unit, opennsl_l3_route_t *info)
+{
+    int rv;
+    uint8 addr[16], mask[16];
+
+    _mock_route_key(info, addr, mask);
+    _MOCK_LOCK();
+    rv = _mock_l3_add(&_mock_routes, info->l3a_vrf,
+                      (info->l3a_flags & OPENNSL_L3_IP6) ? true : false,
+                      addr, mask, info->l3a_flags, info->l3a_intf);
+    _MOCK_UNLOCK();
+    return rv;
+}
+
+int
+opennsl_l3_route_delete(int unit, opennsl_l3_route_t *info)
+{
+    int rv;
+    uint8 addr[16], mask[16];
+
+    _mock_route_key(info, addr, mask);
+    _MOCK_LOCK();
+    rv = _mock_l3_delete(&_mock_routes, info->l3a_vrf,
+                         (info->l3a_flags & OPENNSL_L3_IP6) ? true : false,
+                         addr, mask);
+    _MOCK_UNLOCK();
+    return rv;
+}
+
+int
+opennsl_l3_host_add(int unit, opennsl_l3_host_t *info)
+{
+    int rv;
+    uint8 addr[16], mask[16];
+
+    _mock_host_key(info, addr, mask);
+    _MOCK_LOCK();
+    rv = _mock_l3_add(&_mock_hosts, info->l3a_vrf,
+                      (info->l3a_flags & OPENNSL_L3_IP6) ? true : false,
+                      addr, mask, info->l3a_flags, info->l3a_intf);
+    _MOCK_UNLOCK();
+    return rv;
+}
+
+int
+opennsl_l3_host_delete(int unit, opennsl_l3_host_t *info)
+{
+    int rv;
+    uint8 addr[16], mask[16];
+
+    _mock_host_key(info, addr, mask);
+    _MOCK_LOCK();
+    rv = _mock_l3_delete(&_mock_hosts, info->l3a_vrf,
+                         (info->l3a_flags & OPENNSL_L3_IP6) ? true : false,
+                         addr, mask);
+    _MOCK_UNLOCK();
+    return rv;
+}
+
+/* The hit bit is whatever OPENNSL_L3_HIT was last written with the entry */
+int
+opennsl_l3_host_find(int unit, opennsl_l3_host_t *info)
+{
+    int rv = OPENNSL_E_NOT_FOUND;
+    uint8 addr[16], mask[16];
+    _mock_l3_entry_t **link;
+
+    _mock_host_key(info, addr, mask);
+    _MOCK_LOCK();
+    link = _mock_l3_find(&_mock_hosts, info->l3a_vrf,
+                         (info->l3a_flags & OPENNSL_L3_IP6) ? true : false,
+                         addr, mask);
+    if (NULL != *link)
+    {
+        info->l3a_intf = (*link)->intf;
+        if ((*link)->flags & OPENNSL_L3_HIT)
+        {
+            info->l3a_flags |= OPENNSL_L3_HIT;
+            if (info->l3a_flags & OPENNSL_L3_HIT_CLEAR)
+            {
+                (*link)->flags &= ~OPENNSL_L3_HIT;
+            }
+        }
+        rv = OPENNSL_E_NONE;
+    }
+    _MOCK_UNLOCK();
+    return rv;
+}
+
+int
+opennsl_l3_info(int unit, opennsl_l3_info_t *info)
+{
+    memset(info, 0, sizeof(*info));
+    _MOCK_LOCK();
+    info->l3info_max_intf = _MOCK_INTF_MAX;
+    info->l3info_max_host = _mock_hosts.max;
+    info->l3info_max_route = _mock_routes.max;
+    info->l3info_used_host = _mock_hosts.count;
+    info->l3info_used_route = _mock_routes.count;
+    _MOCK_UNLOCK();
+    return OPENNSL_E_NONE;
+}
+
+/* The callback is run without the mock lock so it can call back in */
+int
+opennsl_l3_host_traverse(int unit, uint32 flags, uint32 start, uint32 end,
+                         opennsl_l3_host_traverse_cb cb, void *user_data)
+{
+    int b, i, count = 0, rv = OPENNSL_E_NONE;
+    bool v6 = (flags & OPENNSL_L3_IP6) ? true : false;
+    uint32 val;
+    opennsl_l3_host_t *hosts;
+    _mock_l3_entry_t *entry;
+
+    _MOCK_LOCK();
+    hosts = (opennsl_l3_host_t*)calloc(_mock_hosts.count + 1,
+                                       sizeof(opennsl_l3_host_t));
+    if (NULL == hosts)
+    {
+        _MOCK_UNLOCK();
+        return OPENNSL_E_MEMORY;
+    }
+    for (b=0; b<_MOCK_L3_BUCKETS; b++)
+    {
+        for (entry = _mock_hosts.buckets[b]; NULL != entry;
+             entry = entry->next)
+        {
+            if (entry->v6 != v6)
+            {
+                continue;
+            }
+            hosts[count].l3a_flags = entry->flags & ~OPENNSL_L3_REPLACE;
+            hosts[count].l3a_vrf = entry->vrf;
+            hosts[count].l3a_intf = entry->intf;
+            if (v6)
+            {
+                memcpy(hosts[count].l3a_ip6_addr, entry->addr, 16);
+            }
+            else
+            {
+                memcpy(&val, entry->addr, 4);
+                hosts[count].l3a_ip_addr = val;
+            }
+            count++;
+        }
+    }
+    _MOCK_UNLOCK();
+    for (i=start; (i<count) && (i<=end); i++)
+    {
+        rv = cb(unit, i, &hosts[i], user_data);
+        if (OPENNSL_E_NONE != rv)
+        {
+            break;
+        }
+    }
+    free(hosts);
+    return rv;
+}
+
+/*
+################################################################################
+#                           Closed adapter functions                           #
+################################################################################
+*/
+bool
+_brcm_sai_switch_is_inited(void)
+{
+    return _mock_switch_inited;
+}
+
+void
+_brcm_sai_switch_init_set(bool init)
+{
+    _mock_switch_inited = init;
+}
+
+bool
+sai_log_check(sai_api_t sai_api_id, sai_log_level_t log_level)
+{
+    return (log_level >= SAI_LOG_ERROR) ? true : false;
+}
+
+sai_status_t
+_brcm_sai_initialize_switch(void)
+{
+    return SAI_STATUS_SUCCESS;
+}
+
+sai_mac_t *
+_brcm_sai_switch_system_mac_get(void)
+{
+    return &_mock_mac;
+}
+
+sai_status_t
+_brcm_sai_mmu_gport_init(void)
+{
+    return SAI_STATUS_SUCCESS;
+}
+
+void
+_brcm_sai_clear_port_state(void)
+{
+}
+
+void
+_brcm_sai_vlan_bmp_init(sai_vlan_id_t vlan_id)
+{
+}
+
+sai_status_t
+_brcm_sai_vrf_max_get(int *max)
+{
+    *max = 1024;
+    return SAI_STATUS_SUCCESS;
+}
+
+sai_status_t
+_brcm_sai_virtual_router_flags_get(sai_uint32_t *flags)
+{
+    *flags = OPENNSL_L3_COPY_TO_CPU;
+    return SAI_STATUS_SUCCESS;
+}
+
+sai_status_t
+_brcm_sai_get_switch_attribute(uint32_t attr_count, sai_attribute_t *attr_list)
+{
+    int i;
+
+    for (i=0; i<attr_count; i++)
+    {
+        if (SAI_SWITCH_ATTR_ECMP_MAX_PATHS != attr_list[i].id)
+        {
+            return SAI_STATUS_NOT_SUPPORTED;
+        }
+        attr_list[i].value.u32 = 64;
+    }
+    return SAI_STATUS_SUCCESS;
+}
+
+sai_status_t
+_brcm_sai_alloc_rif(void)
+{
+    return SAI_STATUS_SUCCESS;
+}
+
+void
+_brcm_sai_free_rif(void)
+{
+}
+
+/* Routine to get the host entry for a neighbor */
+STATIC sai_status_t
+_mock_neighbor_host(const sai_neighbor_entry_t *neighbor_entry,
+                    opennsl_l3_host_t *l3_host)
+{
+    opennsl_l3_intf_t l3_intf;
+
+    opennsl_l3_intf_t_init(&l3_intf);
+    l3_intf.l3a_intf_id = BRCM_SAI_GET_OBJ_VAL(opennsl_if_t,
+                                               neighbor_entry->rif_id);
+    if (OPENNSL_E_NONE != opennsl_l3_intf_get(0, &l3_intf))
+    {
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+    opennsl_l3_host_t_init(l3_host);
+    l3_host->l3a_vrf = l3_intf.l3a_vrf;
+    if (SAI_IP_ADDR_FAMILY_IPV4 == neighbor_entry->ip_address.addr_family)
+    {
+        l3_host->l3a_ip_addr = ntohl(neighbor_entry->ip_address.addr.ip4);
+    }
+    else
+    {
+        l3_host->l3a_flags = OPENNSL_L3_IP6;
+        memcpy(l3_host->l3a_ip6_addr, neighbor_entry->ip_address.addr.ip6,
+               sizeof(l3_host->l3a_ip6_addr));
+    }
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Neighbors get an egress object on the router interface and a host entry */
+sai_status_t
+_brcm_sai_create_neighbor_entry(const sai_neighbor_entry_t* neighbor_entry,
+                                uint32_t attr_count,
+                                const sai_attribute_t *attr_list)
+{
+    int i, rv;
+    bool host = true;
+    sai_status_t status;
+    opennsl_if_t if_id;
+    opennsl_l3_egress_t l3_egr;
+    opennsl_l3_host_t l3_host;
+    uint8 addr[16], mask[16];
+
+    if (NULL == neighbor_entry)
+    {
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+    status = _mock_neighbor_host(neighbor_entry, &l3_host);
+    if (SAI_STATUS_SUCCESS != status)
+    {
+        return status;
+    }
+    opennsl_l3_egress_t_init(&l3_egr);
+    l3_egr.intf = BRCM_SAI_GET_OBJ_VAL(opennsl_if_t, neighbor_entry->rif_id);
+    for (i=0; i<attr_count; i++)
+    {
+        if (SAI_NEIGHBOR_ATTR_DST_MAC_ADDRESS == attr_list[i].id)
+        {
+            memcpy(l3_egr.mac_addr, attr_list[i].value.mac,
+                   sizeof(l3_egr.mac_addr));
+        }
+        else if ((SAI_NEIGHBOR_ATTR_PACKET_ACTION == attr_list[i].id) &&
+                 (SAI_PACKET_ACTION_DROP == attr_list[i].value.s32))
+        {
+            l3_egr.flags |= OPENNSL_L3_DST_DISCARD;
+        }
+        else if (SAI_NEIGHBOR_ATTR_NO_HOST_ROUTE == attr_list[i].id)
+        {
+            host = !attr_list[i].value.booldata;
+        }
+    }
+    rv = opennsl_l3_egress_create(0, 0, &l3_egr, &if_id);
+    if (OPENNSL_E_NONE != rv)
+    {
+        return SAI_STATUS_INSUFFICIENT_RESOURCES;
+    }
+    if (false == host)
+    {
+        /* Kept aside so that the egress object can be found on remove */
+        _mock_host_key(&l3_host, addr, mask);
+        _MOCK_LOCK();
+        rv = _mock_l3_add(&_mock_nbrs, l3_host.l3a_vrf,
+                          (l3_host.l3a_flags & OPENNSL_L3_IP6) ? true : false,
+                          addr, mask, 0, if_id);
+        _MOCK_UNLOCK();
+        if (OPENNSL_E_NONE != rv)
+        {
+            (void)opennsl_l3_egress_destroy(0, if_id);
+        }
+        return BRCM_RV_OPENNSL_TO_SAI(rv);
+    }
+    l3_host.l3a_intf = if_id;
+    rv = opennsl_l3_host_add(0, &l3_host);
+    if (OPENNSL_E_NONE != rv)
+    {
+        (void)opennsl_l3_egress_destroy(0, if_id);
+        return BRCM_RV_OPENNSL_TO_SAI(rv);
+    }
+    return SAI_STATUS_SUCCESS;
+}
+
+sai_status_t
+_brcm_sai_remove_neighbor_entry(const sai_neighbor_entry_t* neighbor_entry)
+{
+    int rv = OPENNSL_E_NOT_FOUND;
+    sai_status_t status;
+    opennsl_if_t if_id = 0;
+    opennsl_l3_host_t l3_host;
+    uint8 addr[16], mask[16];
+    _mock_l3_entry_t **link;
+
+    if (NULL == neighbor_entry)
+    {
+        return SAI_STATUS_INVALID_PARAMETER;
+    }
+    status = _mock_neighbor_host(neighbor_entry, &l3_host);
+    if (SAI_STATUS_SUCCESS != status)
+    {
+        return status;
+    }
+    _mock_host_key(&l3_host, addr, mask);
+    _MOCK_LOCK();
+    link = _mock_l3_find(&_mock_hosts, l3_host.l3a_vrf,
+                         (l3_host.l3a_flags & OPENNSL_L3_IP6) ? true : false,
+                         addr, mask);
+    if (NULL != *link)
+    {
+        if_id = (*link)->intf;
+        rv = _mock_l3_delete(&_mock_hosts, l3_host.l3a_vrf,
+                             (l3_host.l3a_flags & OPENNSL_L3_IP6) ?
+                             true : false, addr, mask);
+    }
+    else
+    {
+        link = _mock_l3_find(&_mock_nbrs, l3_host.l3a_vrf,
+                             (l3_host.l3a_flags & OPENNSL_L3_IP6) ?
+                             true : false, addr, mask);
+        if (NULL != *link)
+        {
+            if_id = (*link)->intf;
+            rv = _mock_l3_delete(&_mock_nbrs, l3_host.l3a_vrf,
+                                 (l3_host.l3a_flags & OPENNSL_L3_IP6) ?
+                                 true : false, addr, mask);
+        }
+    }
+    _MOCK_UNLOCK();
+    if (OPENNSL_E_NONE != rv)
+    {
+        return BRCM_RV_OPENNSL_TO_SAI(rv);
+    }
+    (void)opennsl_l3_egress_destroy(0, if_id);
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Next hops only need a distinct egress object to be routed to */
+sai_status_t
+_brcm_sai_create_next_hop(sai_object_id_t* next_hop_id, uint32_t attr_count,
+                          const sai_attribute_t *attr_list)
+{
+    int rv;
+    opennsl_if_t if_id;
+    opennsl_l3_egress_t l3_egr;
+
+    opennsl_l3_egress_t_init(&l3_egr);
+    memcpy(l3_egr.mac_addr, _mock_mac, sizeof(l3_egr.mac_addr));
+    rv = opennsl_l3_egress_create(0, 0, &l3_egr, &if_id);
+    if (OPENNSL_E_NONE != rv)
+    {
+        return SAI_STATUS_INSUFFICIENT_RESOURCES;
+    }
+    *next_hop_id = BRCM_SAI_CREATE_OBJ(SAI_OBJECT_TYPE_NEXT_HOP, if_id);
+    return SAI_STATUS_SUCCESS;
+}
+
+/*
+################################################################################
+#                         Paths the benchmark doesn't use                      #
+################################################################################
+*/
+/* None of these is reached by the benchmark, they fail or find nothing */
+void
+opennsl_l2_addr_t_init(opennsl_l2_addr_t *l2addr, const opennsl_mac_t mac_addr,
+                       opennsl_vlan_t vid)
+{
+    memset(l2addr, 0, sizeof(*l2addr));
+    memcpy(l2addr->mac, mac_addr, sizeof(opennsl_mac_t));
+    l2addr->vid = vid;
+}
+
+int
+opennsl_l2_addr_add(int unit, opennsl_l2_addr_t *l2addr)
+{
+    return OPENNSL_E_UNAVAIL;
+}
+
+int
+opennsl_l2_addr_delete(int unit, opennsl_mac_t mac, opennsl_vlan_t vid)
+{
+    return OPENNSL_E_NOT_FOUND;
+}
+
+int
+opennsl_l2_addr_get(int unit, opennsl_mac_t mac, opennsl_vlan_t vid,
+                    opennsl_l2_addr_t *l2addr)
+{
+    return OPENNSL_E_NOT_FOUND;
+}
+
+int
+opennsl_l2_addr_delete_by_port(int unit, opennsl_module_t mod,
+                               opennsl_port_t port, uint32 flags)
+{
+    return OPENNSL_E_NONE;
+}
+
+int
+opennsl_l2_addr_delete_by_vlan(int unit, opennsl_vlan_t vid, uint32 flags)
+{
+    return OPENNSL_E_NONE;
+}
+
+int
+opennsl_l2_addr_delete_by_vlan_port(int unit, opennsl_vlan_t vid,
+                                    opennsl_module_t mod, opennsl_port_t port,
+                                    uint32 flags)
+{
+    return OPENNSL_E_NONE;
+}
+
+int
+opennsl_l2_age_timer_set(int unit, int age_seconds)
+{
+    return OPENNSL_E_UNAVAIL;
+}
+
+int
+opennsl_l2_replace(int unit, uint32 flags, opennsl_l2_addr_t *match_addr,
+                   opennsl_module_t new_module, opennsl_port_t new_port,
+                   opennsl_trunk_t new_trunk)
+{
+    return OPENNSL_E_UNAVAIL;
+}
+
+int
+opennsl_l2_traverse(int unit, opennsl_l2_traverse_cb cb, void *user_data)
+{
+    return OPENNSL_E_NONE;
+}
+
+void
+opennsl_l2_station_t_init(opennsl_l2_station_t *station)
+{
+    memset(station, 0, sizeof(*station));
+}
+
+int
+opennsl_l2_station_add(int unit, int *station_id,
+                       opennsl_l2_station_t *station)
+{
+    return OPENNSL_E_UNAVAIL;
+}
+
+int
+opennsl_l3_intf_delete(int unit, opennsl_l3_intf_t *intf)
+{
+    return OPENNSL_E_UNAVAIL;
+}
+
+int
+opennsl_vlan_create(int unit, opennsl_vlan_t vid)
+{
+    return OPENNSL_E_UNAVAIL;
+}
+
+int
+opennsl_vlan_destroy(int unit, opennsl_vlan_t vid)
+{
+    return OPENNSL_E_UNAVAIL;
+}
+
+int
+opennsl_vlan_destroy_all(int unit)
+{
+    return OPENNSL_E_NONE;
+}
+
+int
+opennsl_vlan_port_remove(int unit, opennsl_vlan_t vid, opennsl_pbmp_t pbmp)
+{
+    return OPENNSL_E_UNAVAIL;
+}
+
+int
+opennsl_port_untagged_vlan_set(int unit, opennsl_port_t port,
+                               opennsl_vlan_t vid)
+{
+    return OPENNSL_E_UNAVAIL;
+}
+
+int
+opennsl_stat_get(int unit, opennsl_port_t port, opennsl_stat_val_t type,
+                 uint64 *value)
+{
+    return OPENNSL_E_UNAVAIL;
+}
+
+int
+opennsl_stat_multi_get(int unit, opennsl_port_t port, int nstat,
+                       opennsl_stat_val_t *stat_arr, uint64 *value_arr)
+{
+    return OPENNSL_E_UNAVAIL;
+}
+
+int
+opennsl_knet_netif_destroy(int unit, int netif_id)
+{
+    return OPENNSL_E_NOT_FOUND;
+}
+
+int
+opennsl_knet_filter_destroy(int unit, int filter_id)
+{
+    return OPENNSL_E_NOT_FOUND;
+}
+
+sai_status_t
+_sai_log_set(sai_api_t sai_api_id, sai_log_level_t log_level)
+{
+    return SAI_STATUS_SUCCESS;
+}
+
+sai_status_t
+_brcm_sai_32bit_size_check(sai_meter_type_t meter_type,
+                           sai_uint64_t test_var)
+{
+    return SAI_STATUS_SUCCESS;
+}
+
+sai_status_t
+_brcm_sai_switch_system_mac_set(const sai_mac_t src_mac)
+{
+    memcpy(_mock_mac, src_mac, sizeof(sai_mac_t));
+    return SAI_STATUS_SUCCESS;
+}
+
+opennsl_vlan_t
+_brcm_sai_get_max_unused_vlan_id(void)
+{
+    return 4094;
+}
+
+bool
+_brcm_sai_vlan_exists(sai_vlan_id_t vlan_id)
+{
+    return false;
+}
+
+void
+_brcm_sai_vlan_bmp_set(sai_vlan_id_t vlan_id)
+{
+}
+
+void
+_brcm_sai_vlan_bmp_clear(sai_vlan_id_t vlan_id)
+{
+}
+
+sai_status_t
+_brcm_sai_add_ports_to_vlan(sai_vlan_id_t vlan_id, uint32_t port_count,
+                            const sai_vlan_port_t* port_list)
+{
+    return SAI_STATUS_NOT_SUPPORTED;
+}
+
+void
+_brcm_sai_rif_info_set(sai_uint32_t rif_id, sai_router_interface_type_t type,
+                       sai_int32_t port, sai_vlan_id_t vlan, sai_mac_t mac)
+{
+}
+
+sai_status_t
+_brcm_sai_get_port_attribute(sai_object_id_t port_id, uint32_t attr_count,
+                             sai_attribute_t *attr_list)
+{
+    return SAI_STATUS_NOT_SUPPORTED;
+}
+
+sai_status_t
+_brcm_sai_set_port_attribute(sai_object_id_t port_id,
+                             const sai_attribute_t *attr)
+{
+    return SAI_STATUS_NOT_SUPPORTED;
+}
+
+sai_status_t
+_brcm_sai_create_host_interface(sai_object_id_t* hif_id, uint32_t attr_count,
+                                const sai_attribute_t *attr_list)
+{
+    return SAI_STATUS_NOT_SUPPORTED;
+}
+
+sai_status_t
+_brcm_sai_remove_host_interface(sai_object_id_t hif_id)
+{
+    return SAI_STATUS_NOT_SUPPORTED;
+}
+
+sai_status_t
+_brcm_sai_set_trap_attribute(sai_hostif_trap_id_t hostif_trapid,
+                             const sai_attribute_t *attr)
+{
+    return SAI_STATUS_NOT_SUPPORTED;
+}
+
+sai_status_t
+_brcm_sai_create_acl_table(sai_object_id_t* acl_table_id, uint32_t attr_count,
+                           const sai_attribute_t *attr_list)
+{
+    return SAI_STATUS_NOT_SUPPORTED;
+}
+
+sai_status_t
+_brcm_sai_delete_acl_table(sai_object_id_t acl_table_id)
+{
+    return SAI_STATUS_NOT_SUPPORTED;
+}
+
+sai_status_t
+_brcm_sai_create_acl_entry(sai_object_id_t *acl_entry_id, uint32_t attr_count,
+                           const sai_attribute_t *attr_list)
+{
+    return SAI_STATUS_NOT_SUPPORTED;
+}
+
+sai_status_t
+_brcm_sai_delete_acl_entry(sai_object_id_t acl_entry_id)
+{
+    return SAI_STATUS_NOT_SUPPORTED;
+}
+
+sai_status_t
+_brcm_sai_set_acl_entry_attribute(sai_object_id_t acl_entry_id,
+                                  const sai_attribute_t *attr)
+{
+    return SAI_STATUS_NOT_SUPPORTED;
+}
+
+sai_status_t
+_brcm_sai_create_acl_counter(sai_object_id_t *acl_counter_id,
+                             uint32_t attr_count,
+                             const sai_attribute_t *attr_list)
+{
+    return SAI_STATUS_NOT_SUPPORTED;
+}
+
+sai_status_t
+_brcm_sai_delete_acl_counter(sai_object_id_t acl_counter_id)
+{
+    return SAI_STATUS_NOT_SUPPORTED;
+}
+
+sai_status_t
+_brcm_sai_get_acl_counter_attribute(sai_object_id_t acl_counter_id,
+                                    uint32_t attr_count,
+                                    sai_attribute_t *attr_list)
+{
+    return SAI_STATUS_NOT_SUPPORTED;
+}
+
+sai_status_t
+_brcm_sai_create_policer(sai_object_id_t *policer_id, uint32_t attr_count,
+                         const sai_attribute_t *attr_list)
+{
+    return SAI_STATUS_NOT_SUPPORTED;
+}
+
+sai_status_t
+_brcm_sai_remove_policer(sai_object_id_t policer_id)
+{
+    return SAI_STATUS_NOT_SUPPORTED;
+}
+
+sai_status_t
+_brcm_sai_create_qos_map(sai_object_id_t* qos_map_id, uint32_t attr_count,
+                         const sai_attribute_t *attr_list)
+{
+    return SAI_STATUS_NOT_SUPPORTED;
+}
+
+sai_status_t
+_brcm_sai_set_queue_attribute(sai_object_id_t queue_id,
+                              const sai_attribute_t *attr)
+{
+    return SAI_STATUS_NOT_SUPPORTED;
+}
+
+sai_status_t
+_brcm_sai_get_queue_stats(sai_object_id_t queue_id,
+                          const sai_queue_stat_counter_t *counter_ids,
+                          uint32_t number_of_counters, uint64_t* counters)
+{
+    return SAI_STATUS_NOT_SUPPORTED;
+}
+
+sai_status_t
+_brcm_sai_create_scheduler_profile(sai_object_id_t *scheduler_id,
+                                   uint32_t attr_count,
+                                   const sai_attribute_t *attr_list)
+{
+    return SAI_STATUS_NOT_SUPPORTED;
+}
+
+sai_status_t
+_brcm_sai_remove_scheduler_profile(sai_object_id_t scheduler_id,
+                                   sai_set_port_attribute_fn set_port_attribute,
+                                   sai_set_queue_attribute_fn
+                                       set_queue_attribute)
+{
+    return SAI_STATUS_NOT_SUPPORTED;
+}
+
+_brcm_sai_qos_scheduler_t *
+_brcm_sai_scheduler_get(int id)
+{
+    return NULL;
+}
+
+sai_status_t
+_brcm_sai_create_wred(sai_object_id_t *wred_id, uint32_t attr_count,
+                      const sai_attribute_t *attr_list)
+{
+    return SAI_STATUS_NOT_SUPPORTED;
+}
+
+sai_status_t
+_brcm_sai_remove_wred(sai_object_id_t wred_id)
+{
+    return SAI_STATUS_NOT_SUPPORTED;
+}
+
+sai_status_t
+_brcm_sai_create_buffer_pool(sai_object_id_t* pool_id, uint32_t attr_count,
+                             const sai_attribute_t *attr_list)
+{
+    return SAI_STATUS_NOT_SUPPORTED;
+}
+
+sai_status_t
+_brcm_sai_create_buffer_profile(sai_object_id_t* buffer_profile_id,
+                                uint32_t attr_count,
+                                const sai_attribute_t *attr_list)
+{
+    return SAI_STATUS_NOT_SUPPORTED;
+}
+
+sai_status_t
+_brcm_sai_set_ingress_priority_group_attr(sai_object_id_t ingress_pg_id,
+                                          const sai_attribute_t *attr)
+{
+    return SAI_STATUS_NOT_SUPPORTED;
+}
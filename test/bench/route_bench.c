@@ -0,0 +1,698 @@
+/*********************************************************************
+ *
+ * (C) Copyright Broadcom Corporation 2013-2016
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ **********************************************************************/
+
+/*
+ * Route programming benchmark. Drives a synthetic BGP feed through
+ * route_apis against the OpenNSL mock and reports throughput and latency
+ * percentiles per operation type.
+ *
+ * The feed is a full table announcement, a number of flap rounds (withdraw
+ * and re-announce of a share of the prefixes plus next hop changes on
+ * another share) and a full withdrawal.
+ *
+ * Usage: route_bench [-4 v4 prefixes] [-6 v6 prefixes] [-m realistic|random]
+ *                    [-f flap rounds] [-p flap percent] [-n next hops]
+ *                    [-g next hop groups] [-l SDK write latency ns]
+ *                    [-s seed] [-c] [-z] [-a]
+ *    -c  enable route write coalescing
+ *    -z  enable FIB compression
+ *    -a  enable asynchronous route programming, latencies are then the
+ *        time to queue
+ * Each phase waits for its writes to reach the mock before it is timed.
+ */
+
+#include <sai.h>
+#include <brcm_sai_common.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+
+/*
+################################################################################
+#                                Local state                                   #
+################################################################################
+*/
+#define _BENCH_OP_CREATE        0
+#define _BENCH_OP_REMOVE        1
+#define _BENCH_OP_SET           2
+#define _BENCH_OP_MAX           3
+
+#define _BENCH_ECMP_WIDTH       4
+
+typedef struct _bench_route_s {
+    sai_ip_prefix_t prefix;
+    sai_object_id_t nh_id;
+    bool installed;
+} _bench_route_t;
+
+typedef struct _bench_stats_s {
+    const char *name;
+    uint64_t *samples;
+    uint64_t count;
+    uint64_t size;
+    uint64_t failed;
+} _bench_stats_t;
+
+typedef struct _bench_len_weight_s {
+    int len;
+    int weight;
+} _bench_len_weight_t;
+
+/* Prefix length mix of the public tables, in per mille */
+static const _bench_len_weight_t _bench_v4_mix[] = {
+    { 8, 1 }, { 12, 2 }, { 13, 3 }, { 14, 5 }, { 15, 8 }, { 16, 14 },
+    { 17, 8 }, { 18, 14 }, { 19, 26 }, { 20, 45 }, { 21, 50 }, { 22, 110 },
+    { 23, 100 }, { 24, 590 }, { 32, 24 }
+};
+static const _bench_len_weight_t _bench_v6_mix[] = {
+    { 19, 1 }, { 20, 2 }, { 24, 5 }, { 28, 12 }, { 29, 60 }, { 32, 140 },
+    { 33, 10 }, { 34, 8 }, { 36, 40 }, { 40, 70 }, { 42, 10 }, { 44, 80 },
+    { 46, 20 }, { 47, 10 }, { 48, 500 }, { 56, 12 }, { 64, 10 },
+    { 128, 10 }
+};
+
+static sai_route_api_t *_bench_route_api;
+static sai_next_hop_api_t *_bench_nh_api;
+static sai_next_hop_group_api_t *_bench_nhg_api;
+static sai_switch_api_t *_bench_switch_api;
+static sai_virtual_router_api_t *_bench_vr_api;
+
+static sai_object_id_t _bench_vr_id;
+static sai_object_id_t *_bench_nh_ids;
+static int _bench_nh_count = 64;
+static int _bench_nhg_count = 16;
+static _bench_route_t *_bench_routes;
+static int _bench_route_count;
+static _bench_stats_t _bench_stats[_BENCH_OP_MAX] = {
+    { "create" }, { "remove" }, { "set" }
+};
+static bool _bench_async;
+static bool _bench_coalesce;
+static volatile uint64_t _bench_async_failed;
+
+extern uint64 opennsl_mock_writes_get(void);
+
+/*
+################################################################################
+#                                  Helpers                                     #
+################################################################################
+*/
+static uint64_t
+_bench_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* xorshift, rand() is too slow and too short for a million prefixes */
+static uint64_t _bench_seed = 88172645463325252ull;
+
+static uint64_t
+_bench_rand(void)
+{
+    _bench_seed ^= _bench_seed << 13;
+    _bench_seed ^= _bench_seed >> 7;
+    _bench_seed ^= _bench_seed << 17;
+    return _bench_seed;
+}
+
+static int
+_bench_len_pick(const _bench_len_weight_t *mix, int count)
+{
+    int i, total = 0, pick;
+
+    for (i=0; i<count; i++)
+    {
+        total += mix[i].weight;
+    }
+    pick = _bench_rand() % total;
+    for (i=0; i<count; i++)
+    {
+        if (pick < mix[i].weight)
+        {
+            break;
+        }
+        pick -= mix[i].weight;
+    }
+    return mix[i].len;
+}
+
+static void
+_bench_stats_add(int op, uint64_t ns, sai_status_t rv)
+{
+    _bench_stats_t *stats = &_bench_stats[op];
+
+    if (stats->count == stats->size)
+    {
+        stats->size = stats->size ? stats->size * 2 : 1 << 20;
+        stats->samples = (uint64_t*)realloc(stats->samples,
+                                            stats->size * sizeof(uint64_t));
+        if (NULL == stats->samples)
+        {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+    }
+    stats->samples[stats->count++] = ns;
+    if (SAI_STATUS_SUCCESS != rv)
+    {
+        stats->failed++;
+    }
+}
+
+static int
+_bench_u64_cmp(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+
+    return (x > y) - (x < y);
+}
+
+static uint64_t
+_bench_percentile(const _bench_stats_t *stats, double pct)
+{
+    uint64_t idx = (uint64_t)(pct * (stats->count - 1) / 100.0);
+
+    return stats->samples[idx];
+}
+
+/*
+################################################################################
+#                               Feed generation                                #
+################################################################################
+*/
+/* Simple open addressing set so that the feed has no duplicate prefixes */
+static uint64_t *_bench_keys;
+static uint64_t _bench_keys_size;
+
+static bool
+_bench_key_insert(uint64_t key)
+{
+    uint64_t idx = (key * 0x9e3779b97f4a7c15ull) & (_bench_keys_size - 1);
+
+    /* Keys are never 0, it marks an empty slot */
+    while (_bench_keys[idx])
+    {
+        if (_bench_keys[idx] == key)
+        {
+            return false;
+        }
+        idx = (idx + 1) & (_bench_keys_size - 1);
+    }
+    _bench_keys[idx] = key;
+    return true;
+}
+
+static void
+_bench_v4_make(sai_ip_prefix_t *prefix, int len)
+{
+    uint32_t addr, mask;
+
+    mask = len ? 0xffffffffu << (32 - len) : 0;
+    /* 1.0.0.0 - 223.255.255.255 */
+    addr = ((1 + _bench_rand() % 223) << 24) | (_bench_rand() & 0xffffff);
+    prefix->addr_family = SAI_IP_ADDR_FAMILY_IPV4;
+    prefix->addr.ip4 = htonl(addr & mask);
+    prefix->mask.ip4 = htonl(mask);
+}
+
+static void
+_bench_v6_make(sai_ip_prefix_t *prefix, int len)
+{
+    int i;
+    uint64_t hi, lo;
+
+    /* 2000::/3 */
+    hi = (_bench_rand() & 0x1fffffffffffffffull) | 0x2000000000000000ull;
+    lo = _bench_rand();
+    prefix->addr_family = SAI_IP_ADDR_FAMILY_IPV6;
+    for (i=0; i<16; i++)
+    {
+        prefix->addr.ip6[i] = (i < 8) ? (uint8_t)(hi >> (56 - i * 8)) :
+                                        (uint8_t)(lo >> (120 - i * 8));
+        prefix->mask.ip6[i] = (len >= (i + 1) * 8) ? 0xff :
+                              (len <= i * 8) ? 0 :
+                              (uint8_t)(0xff << ((i + 1) * 8 - len));
+        prefix->addr.ip6[i] &= prefix->mask.ip6[i];
+    }
+}
+
+static uint64_t
+_bench_prefix_key(const sai_ip_prefix_t *prefix, int len)
+{
+    int i;
+    uint64_t key = 1469598103934665603ull ^ (uint64_t)len;
+
+    if (SAI_IP_ADDR_FAMILY_IPV4 == prefix->addr_family)
+    {
+        return ((uint64_t)ntohl(prefix->addr.ip4) << 8) | len;
+    }
+    for (i=0; i<16; i++)
+    {
+        key = (key ^ prefix->addr.ip6[i]) * 1099511628211ull;
+    }
+    return key | (1ull << 63);
+}
+
+static void
+_bench_feed_build(int v4, int v6, bool realistic)
+{
+    int i, len, made = 0;
+    _bench_route_t *route;
+
+    _bench_route_count = v4 + v6;
+    _bench_routes = (_bench_route_t*)calloc(_bench_route_count,
+                                            sizeof(_bench_route_t));
+    for (_bench_keys_size = 1; _bench_keys_size < _bench_route_count * 2;
+         _bench_keys_size <<= 1);
+    _bench_keys = (uint64_t*)calloc(_bench_keys_size, sizeof(uint64_t));
+    if ((NULL == _bench_routes) || (NULL == _bench_keys))
+    {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    while (made < _bench_route_count)
+    {
+        route = &_bench_routes[made];
+        if (made < v4)
+        {
+            len = realistic ?
+                  _bench_len_pick(_bench_v4_mix, COUNTOF(_bench_v4_mix)) :
+                  8 + _bench_rand() % 25;
+            _bench_v4_make(&route->prefix, len);
+        }
+        else
+        {
+            len = realistic ?
+                  _bench_len_pick(_bench_v6_mix, COUNTOF(_bench_v6_mix)) :
+                  16 + _bench_rand() % 113;
+            _bench_v6_make(&route->prefix, len);
+        }
+        if (false == _bench_key_insert(_bench_prefix_key(&route->prefix, len)))
+        {
+            continue;
+        }
+        /* One in five prefixes is multipath */
+        i = (_bench_nhg_count && (0 == _bench_rand() % 5)) ?
+            _bench_nh_count + _bench_rand() % _bench_nhg_count :
+            _bench_rand() % _bench_nh_count;
+        route->nh_id = _bench_nh_ids[i];
+        made++;
+    }
+    free(_bench_keys);
+}
+
+/*
+################################################################################
+#                                Operations                                    #
+################################################################################
+*/
+static void
+_bench_async_notify(brcm_sai_route_op_t op,
+                    const sai_unicast_route_entry_t *unicast_route_entry,
+                    sai_status_t status)
+{
+    if (SAI_STATUS_SUCCESS != status)
+    {
+        __atomic_add_fetch(&_bench_async_failed, 1, __ATOMIC_RELAXED);
+    }
+}
+
+static sai_status_t
+_bench_op(int op, _bench_route_t *route, sai_object_id_t nh_id)
+{
+    uint64_t start;
+    sai_status_t rv;
+    sai_attribute_t attr;
+    sai_unicast_route_entry_t entry;
+
+    entry.vr_id = _bench_vr_id;
+    entry.destination = route->prefix;
+    attr.id = SAI_ROUTE_ATTR_NEXT_HOP_ID;
+    attr.value.oid = nh_id;
+    start = _bench_now_ns();
+    do
+    {
+        switch (op)
+        {
+            case _BENCH_OP_CREATE:
+                rv = _bench_route_api->create_route(&entry, 1, &attr);
+                break;
+            case _BENCH_OP_REMOVE:
+                rv = _bench_route_api->remove_route(&entry);
+                break;
+            default:
+                rv = _bench_route_api->set_route_attribute(&entry, &attr);
+                break;
+        }
+        /* A full queue is back pressure, not a failure */
+    } while (_bench_async && (SAI_STATUS_INSUFFICIENT_RESOURCES == rv));
+    _bench_stats_add(op, _bench_now_ns() - start, rv);
+    return rv;
+}
+
+/* Routine to get everything requested so far into the hardware */
+static void
+_bench_drain(void)
+{
+    sai_attribute_t attr;
+
+    if (_bench_async)
+    {
+        attr.id = SAI_SWITCH_ATTR_BRCM_ROUTE_ASYNC_DRAIN;
+        (void)_bench_switch_api->set_switch_attribute(&attr);
+    }
+    if (_bench_coalesce)
+    {
+        attr.id = SAI_SWITCH_ATTR_BRCM_ROUTE_COALESCE_FLUSH;
+        (void)_bench_switch_api->set_switch_attribute(&attr);
+    }
+}
+
+static void
+_bench_phase(const char *name, uint64_t start, uint64_t ops,
+             uint64_t writes)
+{
+    double secs = (_bench_now_ns() - start) / 1e9;
+
+    printf("%-10s %10llu ops %8.3f s %12.0f ops/s %10llu SDK writes\n",
+           name, (unsigned long long)ops, secs, ops / secs,
+           (unsigned long long)(opennsl_mock_writes_get() - writes));
+}
+
+static void
+_bench_announce(void)
+{
+    int i;
+    uint64_t start = _bench_now_ns(), writes = opennsl_mock_writes_get();
+
+    for (i=0; i<_bench_route_count; i++)
+    {
+        if (SAI_STATUS_SUCCESS == _bench_op(_BENCH_OP_CREATE,
+                                            &_bench_routes[i],
+                                            _bench_routes[i].nh_id))
+        {
+            _bench_routes[i].installed = true;
+        }
+    }
+    _bench_drain();
+    _bench_phase("announce", start, _bench_route_count, writes);
+}
+
+static void
+_bench_flap(int rounds, int percent)
+{
+    int r, i, count;
+    uint64_t ops = 0, start = _bench_now_ns();
+    uint64_t writes = opennsl_mock_writes_get();
+    sai_object_id_t nh_id;
+    _bench_route_t *route;
+
+    count = (uint64_t)_bench_route_count * percent / 100;
+    for (r=0; r<rounds; r++)
+    {
+        /* Session down: withdraw, then re-announce the same prefixes */
+        for (i=0; i<count; i++)
+        {
+            route = &_bench_routes[(r * count + i) % _bench_route_count];
+            if (route->installed)
+            {
+                (void)_bench_op(_BENCH_OP_REMOVE, route, 0);
+                ops++;
+            }
+        }
+        for (i=0; i<count; i++)
+        {
+            route = &_bench_routes[(r * count + i) % _bench_route_count];
+            if (route->installed)
+            {
+                (void)_bench_op(_BENCH_OP_CREATE, route, route->nh_id);
+                ops++;
+            }
+        }
+        /* Best path change on another share of the table */
+        for (i=0; i<count; i++)
+        {
+            route = &_bench_routes[_bench_rand() % _bench_route_count];
+            if (route->installed)
+            {
+                nh_id = _bench_nh_ids[_bench_rand() % _bench_nh_count];
+                if (SAI_STATUS_SUCCESS ==
+                    _bench_op(_BENCH_OP_SET, route, nh_id))
+                {
+                    route->nh_id = nh_id;
+                }
+                ops++;
+            }
+        }
+    }
+    _bench_drain();
+    _bench_phase("flap", start, ops, writes);
+}
+
+static void
+_bench_withdraw(void)
+{
+    int i;
+    uint64_t ops = 0, start = _bench_now_ns();
+    uint64_t writes = opennsl_mock_writes_get();
+
+    for (i=0; i<_bench_route_count; i++)
+    {
+        if (_bench_routes[i].installed)
+        {
+            (void)_bench_op(_BENCH_OP_REMOVE, &_bench_routes[i], 0);
+            _bench_routes[i].installed = false;
+            ops++;
+        }
+    }
+    _bench_drain();
+    _bench_phase("withdraw", start, ops, writes);
+}
+
+static void
+_bench_report(void)
+{
+    int i;
+    uint64_t j, busy;
+    _bench_stats_t *stats;
+
+    printf("\n%-8s %10s %8s %12s %9s %9s %9s %9s\n", "op", "count", "failed",
+           "ops/s", "p50 us", "p99 us", "p999 us", "max us");
+    for (i=0; i<_BENCH_OP_MAX; i++)
+    {
+        stats = &_bench_stats[i];
+        if (0 == stats->count)
+        {
+            continue;
+        }
+        qsort(stats->samples, stats->count, sizeof(uint64_t), _bench_u64_cmp);
+        /* Throughput of the calls themselves, time between calls excluded */
+        for (j=0, busy=0; j<stats->count; j++)
+        {
+            busy += stats->samples[j];
+        }
+        printf("%-8s %10llu %8llu %12.0f %9.2f %9.2f %9.2f %9.2f\n",
+               stats->name, (unsigned long long)stats->count,
+               (unsigned long long)stats->failed,
+               busy ? stats->count / (busy / 1e9) : 0.0,
+               _bench_percentile(stats, 50) / 1e3,
+               _bench_percentile(stats, 99) / 1e3,
+               _bench_percentile(stats, 99.9) / 1e3,
+               stats->samples[stats->count - 1] / 1e3);
+    }
+    if (_bench_async)
+    {
+        printf("async failures %llu\n",
+               (unsigned long long)_bench_async_failed);
+    }
+}
+
+/*
+################################################################################
+#                                    Setup                                     #
+################################################################################
+*/
+static const char *
+_bench_profile_get_value(sai_switch_profile_id_t profile_id,
+                         const char *variable)
+{
+    return NULL;
+}
+
+static int
+_bench_profile_get_next_value(sai_switch_profile_id_t profile_id,
+                              const char **variable, const char **value)
+{
+    return -1;
+}
+
+static void
+_bench_check(sai_status_t rv, const char *what)
+{
+    if (SAI_STATUS_SUCCESS != rv)
+    {
+        fprintf(stderr, "%s failed: %d\n", what, rv);
+        exit(1);
+    }
+}
+
+static void
+_bench_switch_set(sai_attr_id_t id, bool enable)
+{
+    sai_attribute_t attr;
+
+    attr.id = id;
+    attr.value.booldata = enable;
+    _bench_check(_bench_switch_api->set_switch_attribute(&attr),
+                 "Switch attribute set");
+}
+
+static void
+_bench_setup(bool compress)
+{
+    int i, j;
+    sai_attribute_t attr[2];
+    sai_object_id_t paths[_BENCH_ECMP_WIDTH];
+    sai_switch_notification_t notifications;
+    service_method_table_t services = {
+        _bench_profile_get_value,
+        _bench_profile_get_next_value
+    };
+
+    _bench_check(sai_api_initialize(0, &services), "API initialize");
+    _bench_check(sai_api_query(SAI_API_SWITCH, (void**)&_bench_switch_api),
+                 "Switch API query");
+    _bench_check(sai_api_query(SAI_API_VIRTUAL_ROUTER,
+                               (void**)&_bench_vr_api), "VR API query");
+    _bench_check(sai_api_query(SAI_API_ROUTE, (void**)&_bench_route_api),
+                 "Route API query");
+    _bench_check(sai_api_query(SAI_API_NEXT_HOP, (void**)&_bench_nh_api),
+                 "Next hop API query");
+    _bench_check(sai_api_query(SAI_API_NEXT_HOP_GROUP,
+                               (void**)&_bench_nhg_api), "NHG API query");
+
+    memset(&notifications, 0, sizeof(notifications));
+    _bench_check(_bench_switch_api->initialize_switch(0, "bench", NULL,
+                                                      &notifications),
+                 "Switch initialize");
+    _bench_check(_bench_vr_api->create_virtual_router(&_bench_vr_id, 0, NULL),
+                 "Virtual router create");
+
+    _bench_nh_ids = (sai_object_id_t*)calloc(_bench_nh_count +
+                                             _bench_nhg_count,
+                                             sizeof(sai_object_id_t));
+    if (NULL == _bench_nh_ids)
+    {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    for (i=0; i<_bench_nh_count; i++)
+    {
+        _bench_check(_bench_nh_api->create_next_hop(&_bench_nh_ids[i], 0,
+                                                    NULL),
+                     "Next hop create");
+    }
+    for (i=0; i<_bench_nhg_count; i++)
+    {
+        for (j=0; j<_BENCH_ECMP_WIDTH; j++)
+        {
+            paths[j] = _bench_nh_ids[(i + j) % _bench_nh_count];
+        }
+        attr[0].id = SAI_NEXT_HOP_GROUP_ATTR_TYPE;
+        attr[0].value.u32 = SAI_NEXT_HOP_GROUP_ECMP;
+        attr[1].id = SAI_NEXT_HOP_GROUP_ATTR_NEXT_HOP_LIST;
+        attr[1].value.objlist.count = _BENCH_ECMP_WIDTH;
+        attr[1].value.objlist.list = paths;
+        _bench_check(_bench_nhg_api->create_next_hop_group(
+                         &_bench_nh_ids[_bench_nh_count + i], 2, attr),
+                     "Next hop group create");
+    }
+    if (_bench_coalesce)
+    {
+        _bench_switch_set(SAI_SWITCH_ATTR_BRCM_ROUTE_COALESCE_ENABLE, true);
+    }
+    if (compress)
+    {
+        _bench_switch_set(SAI_SWITCH_ATTR_BRCM_ROUTE_FIB_COMPRESS, true);
+    }
+    if (_bench_async)
+    {
+        _bench_check(brcm_sai_route_async_notification_register(
+                         _bench_async_notify), "Notification register");
+        _bench_switch_set(SAI_SWITCH_ATTR_BRCM_ROUTE_ASYNC_ENABLE, true);
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    int opt, v4 = 800000, v6 = 150000, rounds = 3, percent = 5;
+    bool realistic = true, compress = false;
+    char latency[32] = "0";
+
+    while (-1 != (opt = getopt(argc, argv, "4:6:m:f:p:n:g:l:s:cza")))
+    {
+        switch (opt)
+        {
+            case '4': v4 = atoi(optarg); break;
+            case '6': v6 = atoi(optarg); break;
+            case 'm': realistic = (0 != strcmp(optarg, "random")); break;
+            case 'f': rounds = atoi(optarg); break;
+            case 'p': percent = atoi(optarg); break;
+            case 'n': _bench_nh_count = atoi(optarg); break;
+            case 'g': _bench_nhg_count = atoi(optarg); break;
+            case 'l': snprintf(latency, sizeof(latency), "%s", optarg); break;
+            case 's': _bench_seed = strtoull(optarg, NULL, 0) | 1; break;
+            case 'c': _bench_coalesce = true; break;
+            case 'z': compress = true; break;
+            case 'a': _bench_async = true; break;
+            default:
+                fprintf(stderr, "Usage: %s [-4 v4] [-6 v6] "
+                        "[-m realistic|random] [-f rounds] [-p percent] "
+                        "[-n nhs] [-g nhgs] [-l latency ns] [-s seed] "
+                        "[-c] [-z] [-a]\n", argv[0]);
+                return 1;
+        }
+    }
+    if ((_bench_nh_count < _BENCH_ECMP_WIDTH) || (v4 + v6 <= 0))
+    {
+        fprintf(stderr, "Need at least %d next hops and one prefix\n",
+                _BENCH_ECMP_WIDTH);
+        return 1;
+    }
+    /* Read by the mock at SDK init */
+    setenv("OPENNSL_MOCK_LATENCY_NS", latency, 1);
+
+    _bench_setup(compress);
+    _bench_feed_build(v4, v6, realistic);
+    printf("%d IPv4 + %d IPv6 prefixes, %s mix, %s ns per SDK write%s%s%s\n\n",
+           v4, v6, realistic ? "realistic" : "random", latency,
+           _bench_coalesce ? ", coalescing" : "", compress ? ", compression" : "",
+           _bench_async ? ", async" : "");
+
+    _bench_announce();
+    _bench_flap(rounds, percent);
+    _bench_withdraw();
+    _bench_report();
+
+    _bench_switch_api->shutdown_switch(false);
+    return 0;
+}